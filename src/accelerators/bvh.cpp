@@ -92,6 +92,15 @@ struct LBVHTreelet {
     BVHBuildNode *buildNodes;
 };
 
+struct BVHRefitTreelet {
+    // Node range [_rootIndex_, _endIndex_) and primitive range
+    // [_primStart_, _primEnd_) covered by the treelet; _cost_ is its SAH
+    // cost relative to the root's surface area when last (re)built.
+    int rootIndex, endIndex;
+    int primStart, primEnd;
+    Float cost;
+};
+
 struct LinearBVHNode {
     Bounds3f bounds;
     union {
@@ -103,6 +112,65 @@ struct LinearBVHNode {
     uint8_t pad[1];        // ensure 32 byte total size
 };
 
+// Ray packets are traced with one bit per ray in a 32-bit activity mask
+static constexpr int MaxBVHPacketSize = 32;
+
+struct BVHRayPacket {
+    // BVHRayPacket Public Methods
+    BVHRayPacket(const Ray *rays, int n) : n(n) {
+        CHECK_LE(n, MaxBVHPacketSize);
+        for (int i = 0; i < n; ++i) {
+            o[0][i] = rays[i].o.x;
+            o[1][i] = rays[i].o.y;
+            o[2][i] = rays[i].o.z;
+            invDir[0][i] = 1 / rays[i].d.x;
+            invDir[1][i] = 1 / rays[i].d.y;
+            invDir[2][i] = 1 / rays[i].d.z;
+            tMax[i] = rays[i].tMax;
+        }
+        // Pad unused lanes so that the slab test never reports a hit
+        for (int i = n; i < MaxBVHPacketSize; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                o[c][i] = 0;
+                invDir[c][i] = 1;
+            }
+            tMax[i] = -Infinity;
+        }
+    }
+    uint32_t AllMask() const {
+        return n == 32 ? ~0u : ((1u << n) - 1);
+    }
+    // Returns the subset of _active_ rays whose extent overlaps _b_
+    uint32_t IntersectBounds(const Bounds3f &b, uint32_t active) const {
+        // Evaluate the slab test for all lanes so that the loop is free
+        // of data-dependent branches and can be vectorized.
+        bool laneHit[MaxBVHPacketSize];
+        for (int i = 0; i < MaxBVHPacketSize; ++i) {
+            Float t0 = 0, t1 = tMax[i];
+            for (int c = 0; c < 3; ++c) {
+                Float tNear = (b.pMin[c] - o[c][i]) * invDir[c][i];
+                Float tFar = (b.pMax[c] - o[c][i]) * invDir[c][i];
+                if (tNear > tFar) std::swap(tNear, tFar);
+                // Update _tFar_ to ensure robust ray--bounds intersection
+                tFar *= 1 + 2 * gamma(3);
+                t0 = tNear > t0 ? tNear : t0;
+                t1 = tFar < t1 ? tFar : t1;
+            }
+            laneHit[i] = t0 <= t1;
+        }
+        uint32_t mask = 0;
+        for (int i = 0; i < MaxBVHPacketSize; ++i)
+            mask |= uint32_t(laneHit[i]) << i;
+        return mask & active;
+    }
+
+    // BVHRayPacket Public Data
+    alignas(PBRT_L1_CACHE_LINE_SIZE) Float o[3][MaxBVHPacketSize];
+    alignas(PBRT_L1_CACHE_LINE_SIZE) Float invDir[3][MaxBVHPacketSize];
+    alignas(PBRT_L1_CACHE_LINE_SIZE) Float tMax[MaxBVHPacketSize];
+    const int n;
+};
+
 // BVHAccel Utility Functions
 inline uint32_t LeftShift3(uint32_t x) {
     CHECK_LE(x, (1 << 10));
@@ -181,10 +249,21 @@ static void RadixSort(std::vector<MortonPrimitive> *v) {
 
 // BVHAccel Method Definitions
 BVHAccel::BVHAccel(const std::vector<std::shared_ptr<Primitive>> &p,
-                   int maxPrimsInNode, SplitMethod splitMethod)
+                   int maxPrimsInNode, SplitMethod splitMethod,
+                   Float refitRebuildRatio, int nMotionSegments,
+                   Float motionTimeStart, Float motionTimeEnd)
     : maxPrimsInNode(std::min(255, maxPrimsInNode)),
       splitMethod(splitMethod),
-      primitives(p) {
+      refitRebuildRatio(refitRebuildRatio),
+      primitives(p),
+      nMotionSegments(nMotionSegments),
+      motionTimeStart(motionTimeStart),
+      motionTimeEnd(motionTimeEnd) {
+    build();
+    if (nodes && nMotionSegments > 0) computeMotionBounds();
+}
+
+void BVHAccel::build() {
     ProfilePhase _(Prof::AccelConstruction);
     if (primitives.empty()) return;
     // Build BVH from _primitives_
@@ -219,6 +298,30 @@ BVHAccel::BVHAccel(const std::vector<std::shared_ptr<Primitive>> &p,
     int offset = 0;
     flattenBVHTree(root, &offset);
     CHECK_EQ(totalNodes, offset);
+    nNodes = totalNodes;
+
+    // HLBVH emits the leaves of its LBVH treelets in parallel, so the
+    // primitives of a subtree may be interleaved with those of others.
+    // Store them in depth-first leaf order so that every subtree covers a
+    // contiguous range of _primitives_, as the treelet rebuilds in
+    // _Refit()_ require.
+    if (splitMethod == SplitMethod::HLBVH) {
+        std::vector<std::shared_ptr<Primitive>> leafOrderedPrims;
+        leafOrderedPrims.reserve(primitives.size());
+        for (int i = 0; i < nNodes; ++i) {
+            LinearBVHNode &node = nodes[i];
+            if (node.nPrimitives == 0) continue;
+            int leafOffset = leafOrderedPrims.size();
+            for (int j = 0; j < node.nPrimitives; ++j)
+                leafOrderedPrims.push_back(
+                    std::move(primitives[node.primitivesOffset + j]));
+            node.primitivesOffset = leafOffset;
+        }
+        primitives.swap(leafOrderedPrims);
+    }
+
+    // Partition the tree into treelets that can be refit independently
+    initRefitTreelets();
 }
 
 Bounds3f BVHAccel::WorldBound() const {
@@ -654,7 +757,268 @@ int BVHAccel::flattenBVHTree(BVHBuildNode *node, int *offset) {
     return myOffset;
 }
 
-BVHAccel::~BVHAccel() { FreeAligned(nodes); }
+BVHAccel::~BVHAccel() {
+    FreeAligned(nodes);
+    FreeAligned(motionBounds);
+}
+
+void BVHAccel::computeMotionBounds() {
+    int nKeys = nMotionSegments + 1;
+    if (!motionBounds) {
+        motionBounds = AllocAligned<Bounds3f>(nNodes * nKeys);
+        treeBytes += nNodes * nKeys * sizeof(Bounds3f);
+    }
+    // Compute leaf node keys from their primitives in parallel
+    ParallelFor([&](int64_t nodeIndex) {
+        const LinearBVHNode &node = nodes[nodeIndex];
+        if (node.nPrimitives == 0) return;
+        Bounds3f *keys = &motionBounds[nodeIndex * nKeys];
+        std::vector<Bounds3f> primKeys(nKeys);
+        for (int k = 0; k < nKeys; ++k) keys[k] = Bounds3f();
+        for (int i = 0; i < node.nPrimitives; ++i) {
+            primitives[node.primitivesOffset + i]->WorldBoundKeys(
+                motionTimeStart, motionTimeEnd, nKeys, &primKeys[0]);
+            for (int k = 0; k < nKeys; ++k)
+                keys[k] = Union(keys[k], primKeys[k]);
+        }
+    }, nNodes, 1024);
+
+    // Children follow their parents in the depth-first layout, so walk
+    // the nodes backward to compute interior node keys
+    for (int nodeIndex = nNodes - 1; nodeIndex >= 0; --nodeIndex) {
+        const LinearBVHNode &node = nodes[nodeIndex];
+        if (node.nPrimitives > 0) continue;
+        Bounds3f *keys = &motionBounds[nodeIndex * nKeys];
+        const Bounds3f *keys0 = &motionBounds[(nodeIndex + 1) * nKeys];
+        const Bounds3f *keys1 = &motionBounds[node.secondChildOffset * nKeys];
+        for (int k = 0; k < nKeys; ++k) keys[k] = Union(keys0[k], keys1[k]);
+    }
+}
+
+void BVHAccel::initRefitTreelets() {
+    refitTreelets.clear();
+    refitTopNodes.clear();
+    // Split the tree at a depth that gives a few treelets per thread;
+    // nodes above that depth are refit serially once the treelets are done.
+    int splitDepth = Log2Int(uint32_t(4 * MaxThreadIndex())) + 1;
+    struct NodeDepth {
+        int nodeIndex, depth;
+    };
+    std::vector<NodeDepth> todo = {{0, 0}};
+    while (!todo.empty()) {
+        NodeDepth nd = todo.back();
+        todo.pop_back();
+        const LinearBVHNode &node = nodes[nd.nodeIndex];
+        if (node.nPrimitives > 0 || nd.depth == splitDepth) {
+            if (node.nPrimitives > 0 && nd.depth < splitDepth) {
+                refitTopNodes.push_back(nd.nodeIndex);
+                continue;
+            }
+            // Find the node and primitive ranges spanned by the treelet;
+            // its primitives are contiguous (see _build()_), though not
+            // necessarily in the order of its leaves.
+            BVHRefitTreelet treelet;
+            treelet.rootIndex = nd.nodeIndex;
+            int last = nd.nodeIndex;
+            while (nodes[last].nPrimitives == 0)
+                last = nodes[last].secondChildOffset;
+            treelet.endIndex = last + 1;
+            treelet.primStart = int(primitives.size());
+            treelet.primEnd = 0;
+            int nTreeletPrims = 0;
+            for (int i = treelet.rootIndex; i < treelet.endIndex; ++i)
+                if (nodes[i].nPrimitives > 0) {
+                    treelet.primStart =
+                        std::min(treelet.primStart, nodes[i].primitivesOffset);
+                    treelet.primEnd =
+                        std::max(treelet.primEnd, nodes[i].primitivesOffset +
+                                                      nodes[i].nPrimitives);
+                    nTreeletPrims += nodes[i].nPrimitives;
+                }
+            CHECK_EQ(nTreeletPrims, treelet.primEnd - treelet.primStart);
+            treelet.cost = subtreeCost(nd.nodeIndex);
+            refitTreelets.push_back(treelet);
+        } else {
+            refitTopNodes.push_back(nd.nodeIndex);
+            todo.push_back({node.secondChildOffset, nd.depth + 1});
+            todo.push_back({nd.nodeIndex + 1, nd.depth + 1});
+        }
+    }
+    // Children come after their parents in the depth-first layout, so
+    // processing in decreasing index order visits them bottom-up.
+    std::sort(refitTopNodes.begin(), refitTopNodes.end(),
+              [](int a, int b) { return a > b; });
+}
+
+void BVHAccel::refitNode(int nodeIndex) {
+    LinearBVHNode &node = nodes[nodeIndex];
+    if (node.nPrimitives > 0) {
+        Bounds3f b;
+        for (int i = 0; i < node.nPrimitives; ++i)
+            b = Union(b, primitives[node.primitivesOffset + i]->WorldBound());
+        node.bounds = b;
+    } else
+        node.bounds = Union(nodes[nodeIndex + 1].bounds,
+                            nodes[node.secondChildOffset].bounds);
+}
+
+void BVHAccel::refitSubtree(int rootIndex) {
+    // Gather the subtree's nodes in depth-first order; a rebuilt treelet
+    // may leave unused nodes in its index range, so the range itself
+    // can't be walked directly.
+    std::vector<int> order, todo = {rootIndex};
+    while (!todo.empty()) {
+        int nodeIndex = todo.back();
+        todo.pop_back();
+        order.push_back(nodeIndex);
+        if (nodes[nodeIndex].nPrimitives == 0) {
+            todo.push_back(nodes[nodeIndex].secondChildOffset);
+            todo.push_back(nodeIndex + 1);
+        }
+    }
+    for (auto iter = order.rbegin(); iter != order.rend(); ++iter)
+        refitNode(*iter);
+}
+
+Float BVHAccel::subtreeCost(int rootIndex) const {
+    // Use the same relative traversal and intersection costs as the SAH
+    // split evaluation in _recursiveBuild()_
+    Float rootArea = nodes[rootIndex].bounds.SurfaceArea();
+    if (rootArea == 0) return 0;
+    Float cost = 0;
+    std::vector<int> todo = {rootIndex};
+    while (!todo.empty()) {
+        const LinearBVHNode &node = nodes[todo.back()];
+        int nodeIndex = todo.back();
+        todo.pop_back();
+        if (node.nPrimitives > 0)
+            cost += node.nPrimitives * node.bounds.SurfaceArea();
+        else {
+            cost += node.bounds.SurfaceArea();
+            todo.push_back(node.secondChildOffset);
+            todo.push_back(nodeIndex + 1);
+        }
+    }
+    return cost / rootArea;
+}
+
+BVHBuildNode *BVHAccel::rebuildTreelet(MemoryArena &arena,
+                                      const BVHRefitTreelet &treelet,
+                                      int *totalNodes) {
+    // Build a new subtree over the treelet's primitives
+    int nPrims = treelet.primEnd - treelet.primStart;
+    std::vector<BVHPrimitiveInfo> primitiveInfo(nPrims);
+    for (int i = 0; i < nPrims; ++i) {
+        size_t primNum = treelet.primStart + i;
+        primitiveInfo[i] = {primNum, primitives[primNum]->WorldBound()};
+    }
+    std::vector<std::shared_ptr<Primitive>> orderedPrims;
+    orderedPrims.reserve(nPrims);
+    BVHBuildNode *root = recursiveBuild(arena, primitiveInfo, 0, nPrims,
+                                        totalNodes, orderedPrims);
+
+    // Store the reordered primitives back in the treelet's range and rebase
+    // the new leaves' offsets accordingly
+    std::copy(orderedPrims.begin(), orderedPrims.end(),
+              primitives.begin() + treelet.primStart);
+    std::vector<BVHBuildNode *> todo = {root};
+    while (!todo.empty()) {
+        BVHBuildNode *node = todo.back();
+        todo.pop_back();
+        if (node->nPrimitives > 0)
+            node->firstPrimOffset += treelet.primStart;
+        else {
+            todo.push_back(node->children[0]);
+            todo.push_back(node->children[1]);
+        }
+    }
+    return root;
+}
+
+int BVHAccel::relinkBVHTree(
+    const LinearBVHNode *oldNodes, int oldIndex,
+    const std::map<int, BVHBuildNode *> &rebuiltRoots, int *offset) {
+    // Splice in the rebuilt subtree if this node was a rebuilt treelet root
+    auto rebuilt = rebuiltRoots.find(oldIndex);
+    if (rebuilt != rebuiltRoots.end())
+        return flattenBVHTree(rebuilt->second, offset);
+
+    // Otherwise copy the node and relink its children
+    int myOffset = (*offset)++;
+    nodes[myOffset] = oldNodes[oldIndex];
+    if (oldNodes[oldIndex].nPrimitives == 0) {
+        relinkBVHTree(oldNodes, oldIndex + 1, rebuiltRoots, offset);
+        nodes[myOffset].secondChildOffset = relinkBVHTree(
+            oldNodes, oldNodes[oldIndex].secondChildOffset, rebuiltRoots,
+            offset);
+    }
+    return myOffset;
+}
+
+void BVHAccel::Refit() {
+    if (!nodes) return;
+    ProfilePhase _(Prof::AccelConstruction);
+    // Refit treelets in parallel, then the nodes above them
+    int nTreelets = refitTreelets.size();
+    std::vector<char> degraded(nTreelets, 0);
+    ParallelFor([&](int64_t i) {
+        BVHRefitTreelet &treelet = refitTreelets[i];
+        refitSubtree(treelet.rootIndex);
+        if (refitRebuildRatio > 0 &&
+            subtreeCost(treelet.rootIndex) > refitRebuildRatio * treelet.cost)
+            degraded[i] = 1;
+    }, nTreelets);
+    for (int nodeIndex : refitTopNodes) refitNode(nodeIndex);
+    if (std::find(degraded.begin(), degraded.end(), 1) == degraded.end()) {
+        if (motionBounds) computeMotionBounds();
+        return;
+    }
+
+    // Rebuild treelets whose SAH cost has degraded too much
+    std::vector<MemoryArena> arenas(nTreelets);
+    std::vector<BVHBuildNode *> rebuiltRoots(nTreelets, nullptr);
+    std::vector<int> rebuiltNodes(nTreelets, 0);
+    ParallelFor([&](int64_t i) {
+        if (degraded[i])
+            rebuiltRoots[i] = rebuildTreelet(arenas[i], refitTreelets[i],
+                                             &rebuiltNodes[i]);
+    }, nTreelets);
+
+    // Flatten the tree into a new node array, copying the nodes of
+    // treelets that were kept; rebuilt treelets are keyed by the offset of
+    // their old root node
+    std::map<int, BVHBuildNode *> rebuilt;
+    int newTotalNodes = nNodes;
+    std::vector<Float> oldCosts(nTreelets);
+    for (int i = 0; i < nTreelets; ++i) {
+        const BVHRefitTreelet &treelet = refitTreelets[i];
+        oldCosts[i] = treelet.cost;
+        if (!degraded[i]) continue;
+        rebuilt[treelet.rootIndex] = rebuiltRoots[i];
+        newTotalNodes +=
+            rebuiltNodes[i] - (treelet.endIndex - treelet.rootIndex);
+    }
+    LinearBVHNode *oldNodes = nodes;
+    nodes = AllocAligned<LinearBVHNode>(newTotalNodes);
+    int offset = 0;
+    relinkBVHTree(oldNodes, 0, rebuilt, &offset);
+    CHECK_EQ(newTotalNodes, offset);
+    FreeAligned(oldNodes);
+    treeBytes += (newTotalNodes - nNodes) * sizeof(LinearBVHNode);
+    nNodes = newTotalNodes;
+
+    // The treelet partition only depends on the unchanged upper levels of
+    // the tree; keep the original costs of the treelets that were refit
+    initRefitTreelets();
+    CHECK_EQ(nTreelets, int(refitTreelets.size()));
+    for (int i = 0; i < nTreelets; ++i)
+        if (!degraded[i]) refitTreelets[i].cost = oldCosts[i];
+    if (motionBounds) {
+        FreeAligned(motionBounds);
+        motionBounds = nullptr;
+        computeMotionBounds();
+    }
+}
 
 bool BVHAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
     if (!nodes) return false;
@@ -662,13 +1026,22 @@ bool BVHAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
     bool hit = false;
     Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
     int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    int segment = 0;
+    Float dt = 0;
+    bool useMotionBounds =
+        motionBounds && findMotionSegment(ray.time, &segment, &dt);
     // Follow ray through BVH nodes to find primitive intersections
     int toVisitOffset = 0, currentNodeIndex = 0;
     int nodesToVisit[64];
     while (true) {
         const LinearBVHNode *node = &nodes[currentNodeIndex];
         // Check ray against BVH node
-        if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
+        bool hitNode =
+            useMotionBounds
+                ? motionNodeBounds(currentNodeIndex, segment, dt)
+                      .IntersectP(ray, invDir, dirIsNeg)
+                : node->bounds.IntersectP(ray, invDir, dirIsNeg);
+        if (hitNode) {
             if (node->nPrimitives > 0) {
                 // Intersect ray with primitives in leaf BVH node
                 for (int i = 0; i < node->nPrimitives; ++i)
@@ -701,11 +1074,20 @@ bool BVHAccel::IntersectP(const Ray &ray) const {
     ProfilePhase p(Prof::AccelIntersectP);
     Vector3f invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
     int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    int segment = 0;
+    Float dt = 0;
+    bool useMotionBounds =
+        motionBounds && findMotionSegment(ray.time, &segment, &dt);
     int nodesToVisit[64];
     int toVisitOffset = 0, currentNodeIndex = 0;
     while (true) {
         const LinearBVHNode *node = &nodes[currentNodeIndex];
-        if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
+        bool hitNode =
+            useMotionBounds
+                ? motionNodeBounds(currentNodeIndex, segment, dt)
+                      .IntersectP(ray, invDir, dirIsNeg)
+                : node->bounds.IntersectP(ray, invDir, dirIsNeg);
+        if (hitNode) {
             // Process BVH node _node_ for traversal
             if (node->nPrimitives > 0) {
                 for (int i = 0; i < node->nPrimitives; ++i) {
@@ -734,6 +1116,133 @@ bool BVHAccel::IntersectP(const Ray &ray) const {
     return false;
 }
 
+void BVHAccel::IntersectBatch(const Ray *rays, int nRays,
+                              SurfaceInteraction *isects, bool *hits) const {
+    // Packets share node bounds, which motion BVHs don't have
+    if (motionBounds) {
+        Aggregate::IntersectBatch(rays, nRays, isects, hits);
+        return;
+    }
+    for (int i = 0; i < nRays; ++i) hits[i] = false;
+    if (!nodes) return;
+    ProfilePhase p(Prof::AccelIntersect);
+    for (int start = 0; start < nRays; start += MaxBVHPacketSize) {
+        int n = std::min(MaxBVHPacketSize, nRays - start);
+        BVHRayPacket packet(rays + start, n);
+        intersectPacket(packet, rays + start, isects + start, hits + start);
+    }
+}
+
+void BVHAccel::intersectPacket(BVHRayPacket &packet, const Ray *rays,
+                               SurfaceInteraction *isects, bool *hits) const {
+    // Follow the packet through BVH nodes, carrying the mask of rays that
+    // are still active for each deferred node
+    struct PacketToDo {
+        int nodeIndex;
+        uint32_t active;
+    };
+    PacketToDo nodesToVisit[64];
+    int toVisitOffset = 0, currentNodeIndex = 0;
+    uint32_t active = packet.AllMask();
+    // Order children using the direction of the packet's first ray
+    int dirIsNeg[3] = {packet.invDir[0][0] < 0, packet.invDir[1][0] < 0,
+                       packet.invDir[2][0] < 0};
+    while (true) {
+        const LinearBVHNode *node = &nodes[currentNodeIndex];
+        active = packet.IntersectBounds(node->bounds, active);
+        if (active) {
+            if (node->nPrimitives > 0) {
+                // Intersect each active ray with primitives in leaf node
+                for (uint32_t m = active; m; m &= m - 1) {
+                    int i = CountTrailingZeros(m);
+                    for (int j = 0; j < node->nPrimitives; ++j)
+                        if (primitives[node->primitivesOffset + j]->Intersect(
+                                rays[i], &isects[i]))
+                            hits[i] = true;
+                    packet.tMax[i] = rays[i].tMax;
+                }
+                if (toVisitOffset == 0) break;
+                --toVisitOffset;
+                currentNodeIndex = nodesToVisit[toVisitOffset].nodeIndex;
+                active = nodesToVisit[toVisitOffset].active;
+            } else {
+                // Put far BVH node on _nodesToVisit_ stack, advance to near
+                // node
+                if (dirIsNeg[node->axis]) {
+                    nodesToVisit[toVisitOffset++] = {currentNodeIndex + 1,
+                                                     active};
+                    currentNodeIndex = node->secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset++] = {node->secondChildOffset,
+                                                     active};
+                    currentNodeIndex = currentNodeIndex + 1;
+                }
+            }
+        } else {
+            if (toVisitOffset == 0) break;
+            --toVisitOffset;
+            currentNodeIndex = nodesToVisit[toVisitOffset].nodeIndex;
+            active = nodesToVisit[toVisitOffset].active;
+        }
+    }
+}
+
+void BVHAccel::IntersectPBatch(const Ray *rays, int nRays,
+                               bool *occluded) const {
+    if (motionBounds) {
+        Aggregate::IntersectPBatch(rays, nRays, occluded);
+        return;
+    }
+    for (int i = 0; i < nRays; ++i) occluded[i] = false;
+    if (!nodes) return;
+    ProfilePhase p(Prof::AccelIntersectP);
+    for (int start = 0; start < nRays; start += MaxBVHPacketSize) {
+        int n = std::min(MaxBVHPacketSize, nRays - start);
+        const Ray *packetRays = rays + start;
+        BVHRayPacket packet(packetRays, n);
+        struct PacketToDo {
+            int nodeIndex;
+            uint32_t active;
+        };
+        PacketToDo nodesToVisit[64];
+        int toVisitOffset = 0, currentNodeIndex = 0;
+        // Rays are retired from _live_ as soon as any occluder is found
+        uint32_t live = packet.AllMask(), active = live;
+        int dirIsNeg[3] = {packet.invDir[0][0] < 0, packet.invDir[1][0] < 0,
+                           packet.invDir[2][0] < 0};
+        while (live) {
+            const LinearBVHNode *node = &nodes[currentNodeIndex];
+            active = packet.IntersectBounds(node->bounds, active & live);
+            if (active && node->nPrimitives == 0) {
+                if (dirIsNeg[node->axis]) {
+                    nodesToVisit[toVisitOffset++] = {currentNodeIndex + 1,
+                                                     active};
+                    currentNodeIndex = node->secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset++] = {node->secondChildOffset,
+                                                     active};
+                    currentNodeIndex = currentNodeIndex + 1;
+                }
+                continue;
+            }
+            for (uint32_t m = active; m; m &= m - 1) {
+                int i = CountTrailingZeros(m);
+                for (int j = 0; j < node->nPrimitives; ++j)
+                    if (primitives[node->primitivesOffset + j]->IntersectP(
+                            packetRays[i])) {
+                        occluded[start + i] = true;
+                        live &= ~(1u << i);
+                        break;
+                    }
+            }
+            if (toVisitOffset == 0) break;
+            --toVisitOffset;
+            currentNodeIndex = nodesToVisit[toVisitOffset].nodeIndex;
+            active = nodesToVisit[toVisitOffset].active;
+        }
+    }
+}
+
 std::shared_ptr<BVHAccel> CreateBVHAccelerator(
     const std::vector<std::shared_ptr<Primitive>> &prims, const ParamSet &ps) {
     std::string splitMethodName = ps.FindOneString("splitmethod", "sah");
@@ -753,7 +1262,23 @@ std::shared_ptr<BVHAccel> CreateBVHAccelerator(
     }
 
     int maxPrimsInNode = ps.FindOneInt("maxnodeprims", 4);
-    return std::make_shared<BVHAccel>(prims, maxPrimsInNode, splitMethod);
+    Float refitRebuildRatio = ps.FindOneFloat("refitrebuildratio", 0.f);
+    int nMotionSegments = ps.FindOneInt("motionsegments", 0);
+    int nmt;
+    const Float *motionTimes = ps.FindFloat("motiontimes", &nmt);
+    Float motionTimeStart = 0, motionTimeEnd = 1;
+    if (motionTimes) {
+        if (nmt != 2 || motionTimes[1] <= motionTimes[0])
+            Error("Expected two increasing values for \"motiontimes\" "
+                  "parameter.");
+        else {
+            motionTimeStart = motionTimes[0];
+            motionTimeEnd = motionTimes[1];
+        }
+    }
+    return std::make_shared<BVHAccel>(prims, maxPrimsInNode, splitMethod,
+                                      refitRebuildRatio, nMotionSegments,
+                                      motionTimeStart, motionTimeEnd);
 }
 
 }  // namespace pbrt
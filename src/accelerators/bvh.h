@@ -42,6 +42,7 @@
 #include "pbrt.h"
 #include "primitive.h"
 #include <atomic>
+#include <map>
 
 namespace pbrt {
 struct BVHBuildNode;
@@ -50,6 +51,8 @@ struct BVHBuildNode;
 struct BVHPrimitiveInfo;
 struct MortonPrimitive;
 struct LinearBVHNode;
+struct BVHRayPacket;
+struct BVHRefitTreelet;
 
 // BVHAccel Declarations
 class BVHAccel : public Aggregate {
@@ -60,14 +63,50 @@ class BVHAccel : public Aggregate {
     // BVHAccel Public Methods
     BVHAccel(const std::vector<std::shared_ptr<Primitive>> &p,
              int maxPrimsInNode = 1,
-             SplitMethod splitMethod = SplitMethod::SAH);
+             SplitMethod splitMethod = SplitMethod::SAH,
+             Float refitRebuildRatio = 0, int nMotionSegments = 0,
+             Float motionTimeStart = 0, Float motionTimeEnd = 1);
     Bounds3f WorldBound() const;
     ~BVHAccel();
+    // Recomputes node bounds after the primitives have moved (e.g. after
+    // TriangleMesh::UpdateVertices()) while keeping the tree topology.
+    // Must not be called while other threads are tracing rays.
+    void Refit();
     bool Intersect(const Ray &ray, SurfaceInteraction *isect) const;
     bool IntersectP(const Ray &ray) const;
+    void IntersectBatch(const Ray *rays, int nRays, SurfaceInteraction *isects,
+                        bool *hits) const;
+    void IntersectPBatch(const Ray *rays, int nRays, bool *occluded) const;
 
   private:
     // BVHAccel Private Methods
+    void build();
+    void computeMotionBounds();
+    // Returns false if _time_ is outside the range covered by the motion
+    // bounds, in which case the static node bounds must be used
+    bool findMotionSegment(Float time, int *segment, Float *dt) const {
+        if (time < motionTimeStart || time > motionTimeEnd) return false;
+        Float u = (time - motionTimeStart) /
+                  (motionTimeEnd - motionTimeStart) * nMotionSegments;
+        *segment = std::min(int(u), nMotionSegments - 1);
+        *dt = u - *segment;
+        return true;
+    }
+    Bounds3f motionNodeBounds(int nodeIndex, int segment, Float dt) const {
+        const Bounds3f *keys = &motionBounds[nodeIndex * (nMotionSegments + 1)];
+        return Bounds3f(Lerp(dt, keys[segment].pMin, keys[segment + 1].pMin),
+                        Lerp(dt, keys[segment].pMax, keys[segment + 1].pMax));
+    }
+    void initRefitTreelets();
+    void refitSubtree(int rootIndex);
+    void refitNode(int nodeIndex);
+    Float subtreeCost(int rootIndex) const;
+    BVHBuildNode *rebuildTreelet(MemoryArena &arena,
+                                 const BVHRefitTreelet &treelet,
+                                 int *totalNodes);
+    int relinkBVHTree(
+        const LinearBVHNode *oldNodes, int oldIndex,
+        const std::map<int, BVHBuildNode *> &rebuiltRoots, int *offset);
     BVHBuildNode *recursiveBuild(
         MemoryArena &arena, std::vector<BVHPrimitiveInfo> &primitiveInfo,
         int start, int end, int *totalNodes,
@@ -86,12 +125,23 @@ class BVHAccel : public Aggregate {
                                 std::vector<BVHBuildNode *> &treeletRoots,
                                 int start, int end, int *totalNodes) const;
     int flattenBVHTree(BVHBuildNode *node, int *offset);
+    void intersectPacket(BVHRayPacket &packet, const Ray *rays,
+                         SurfaceInteraction *isects, bool *hits) const;
 
     // BVHAccel Private Data
     const int maxPrimsInNode;
     const SplitMethod splitMethod;
+    const Float refitRebuildRatio;
     std::vector<std::shared_ptr<Primitive>> primitives;
     LinearBVHNode *nodes = nullptr;
+    int nNodes = 0;
+    // Motion BVHs additionally store node bounds at _nMotionSegments_ + 1
+    // evenly spaced times, which are interpolated at the ray's time
+    const int nMotionSegments;
+    const Float motionTimeStart, motionTimeEnd;
+    Bounds3f *motionBounds = nullptr;
+    std::vector<BVHRefitTreelet> refitTreelets;
+    std::vector<int> refitTopNodes;
 };
 
 std::shared_ptr<BVHAccel> CreateBVHAccelerator(
@@ -0,0 +1,310 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+
+// accelerators/instancebvh.cpp*
+#include "accelerators/instancebvh.h"
+#include "interaction.h"
+#include "memory.h"
+#include "stats.h"
+#include <algorithm>
+
+namespace pbrt {
+
+STAT_MEMORY_COUNTER("Memory/Instance BVH", instanceBVHBytes);
+STAT_COUNTER("Scene/Instances in instance BVHs", nInstances);
+
+// InstanceBVHAccel Local Declarations
+struct InstanceBuildInfo {
+    Bounds3f bounds;
+    Point3f centroid;
+    int instanceNumber;
+};
+
+struct InstanceBVHNode {
+    Bounds3f bounds;
+    union {
+        int instancesOffset;    // leaf
+        int secondChildOffset;  // interior
+    };
+    uint16_t nInstances;  // 0 -> interior node
+    uint8_t axis;         // interior node: xyz
+    uint8_t pad[1];       // ensure 32 byte total size
+};
+
+// InstanceBVHAccel Method Definitions
+InstanceBVHAccel::InstanceBVHAccel(
+    const std::vector<std::shared_ptr<Primitive>> &allPrototypes,
+    std::vector<Instance> inst, int maxInstancesInNode)
+    : maxInstancesInNode(std::min(65535, std::max(1, maxInstancesInNode))) {
+    ProfilePhase _(Prof::AccelConstruction);
+    if (inst.empty()) return;
+    nInstances += inst.size();
+
+    // Gather the prototypes that are actually used and their bounds
+    std::vector<int> prototypeIndex(allPrototypes.size(), -1);
+    std::vector<Bounds3f> prototypeBounds;
+    for (Instance &in : inst) {
+        CHECK_LT(in.prototype, (int)allPrototypes.size());
+        if (prototypeIndex[in.prototype] == -1) {
+            prototypeIndex[in.prototype] = prototypes.size();
+            prototypes.push_back(allPrototypes[in.prototype]);
+            prototypeBounds.push_back(prototypes.back()->WorldBound());
+        }
+        in.prototype = prototypeIndex[in.prototype];
+    }
+
+    // Compute world space bounds of the instances
+    std::vector<InstanceBuildInfo> buildInfo(inst.size());
+    for (size_t i = 0; i < inst.size(); ++i) {
+        Transform instanceToWorld(inst[i].instanceToWorld.GetMatrix());
+        buildInfo[i].bounds =
+            instanceToWorld(prototypeBounds[inst[i].prototype]);
+        buildInfo[i].centroid =
+            .5f * buildInfo[i].bounds.pMin + .5f * buildInfo[i].bounds.pMax;
+        buildInfo[i].instanceNumber = i;
+    }
+
+    // Build the tree, reordering _buildInfo_ so that each leaf's instances
+    // are contiguous
+    std::vector<InstanceBVHNode> buildNodes;
+    buildNodes.reserve(2 * inst.size());
+    recursiveBuild(buildInfo, 0, buildInfo.size(), &buildNodes);
+
+    // Store the instance transformations and their inverses in leaf order
+    instances.resize(inst.size());
+    instanceToWorld.resize(inst.size());
+    for (size_t i = 0; i < inst.size(); ++i) {
+        const Instance &in = inst[buildInfo[i].instanceNumber];
+        instances[i].worldToInstance =
+            CompactTransform(Inverse(in.instanceToWorld.GetMatrix()));
+        instances[i].prototype = in.prototype;
+        instanceToWorld[i] = in.instanceToWorld;
+    }
+    nodes = AllocAligned<InstanceBVHNode>(buildNodes.size());
+    std::copy(buildNodes.begin(), buildNodes.end(), nodes);
+    instanceBVHBytes += sizeof(*this) +
+                        buildNodes.size() * sizeof(InstanceBVHNode) +
+                        instances.size() * sizeof(LinearInstance) +
+                        instanceToWorld.size() * sizeof(CompactTransform) +
+                        prototypes.size() * sizeof(prototypes[0]);
+}
+
+int InstanceBVHAccel::recursiveBuild(std::vector<InstanceBuildInfo> &buildInfo,
+                                     int start, int end,
+                                     std::vector<InstanceBVHNode> *buildNodes) {
+    CHECK_NE(start, end);
+    int nodeIndex = buildNodes->size();
+    buildNodes->push_back(InstanceBVHNode());
+    Bounds3f bounds, centroidBounds;
+    for (int i = start; i < end; ++i) {
+        bounds = Union(bounds, buildInfo[i].bounds);
+        centroidBounds = Union(centroidBounds, buildInfo[i].centroid);
+    }
+    int nInstances = end - start;
+    if (nInstances <= maxInstancesInNode) {
+        // Create leaf _InstanceBVHNode_
+        InstanceBVHNode &node = (*buildNodes)[nodeIndex];
+        node.bounds = bounds;
+        node.instancesOffset = start;
+        node.nInstances = nInstances;
+        return nodeIndex;
+    }
+
+    // Partition instances into two sets, using binned SAH where possible
+    int dim = centroidBounds.MaximumExtent();
+    int mid = (start + end) / 2;
+    if (centroidBounds.pMax[dim] > centroidBounds.pMin[dim]) {
+        constexpr int nBuckets = 12;
+        int count[nBuckets] = {0};
+        Bounds3f bucketBounds[nBuckets];
+        auto bucketIndex = [&](const InstanceBuildInfo &bi) {
+            int b = nBuckets * centroidBounds.Offset(bi.centroid)[dim];
+            return std::min(b, nBuckets - 1);
+        };
+        for (int i = start; i < end; ++i) {
+            int b = bucketIndex(buildInfo[i]);
+            ++count[b];
+            bucketBounds[b] = Union(bucketBounds[b], buildInfo[i].bounds);
+        }
+
+        // Sweep the buckets to find the split with minimum SAH cost
+        Float rightArea[nBuckets];
+        int rightCount[nBuckets];
+        Bounds3f b;
+        int c = 0;
+        for (int i = nBuckets - 1; i > 0; --i) {
+            b = Union(b, bucketBounds[i]);
+            c += count[i];
+            rightArea[i] = c > 0 ? b.SurfaceArea() : 0;
+            rightCount[i] = c;
+        }
+        b = Bounds3f();
+        c = 0;
+        Float minCost = Infinity;
+        int minCostSplitBucket = 0;
+        for (int i = 0; i < nBuckets - 1; ++i) {
+            b = Union(b, bucketBounds[i]);
+            c += count[i];
+            if (c == 0 || rightCount[i + 1] == 0) continue;
+            Float cost =
+                c * b.SurfaceArea() + rightCount[i + 1] * rightArea[i + 1];
+            if (cost < minCost) {
+                minCost = cost;
+                minCostSplitBucket = i;
+            }
+        }
+        if (minCost < Infinity) {
+            InstanceBuildInfo *pmid = std::partition(
+                &buildInfo[start], &buildInfo[end - 1] + 1,
+                [=](const InstanceBuildInfo &bi) {
+                    return bucketIndex(bi) <= minCostSplitBucket;
+                });
+            mid = pmid - &buildInfo[0];
+        } else
+            std::nth_element(&buildInfo[start], &buildInfo[mid],
+                             &buildInfo[end - 1] + 1,
+                             [dim](const InstanceBuildInfo &a,
+                                   const InstanceBuildInfo &b) {
+                                 return a.centroid[dim] < b.centroid[dim];
+                             });
+    }
+
+    // Create interior _InstanceBVHNode_; the first child immediately
+    // follows its parent
+    recursiveBuild(buildInfo, start, mid, buildNodes);
+    int secondChild = recursiveBuild(buildInfo, mid, end, buildNodes);
+    InstanceBVHNode &node = (*buildNodes)[nodeIndex];
+    node.bounds = bounds;
+    node.secondChildOffset = secondChild;
+    node.nInstances = 0;
+    node.axis = dim;
+    return nodeIndex;
+}
+
+Bounds3f InstanceBVHAccel::WorldBound() const {
+    return nodes ? nodes[0].bounds : Bounds3f();
+}
+
+InstanceBVHAccel::~InstanceBVHAccel() { FreeAligned(nodes); }
+
+bool InstanceBVHAccel::Intersect(const Ray &ray,
+                                 SurfaceInteraction *isect) const {
+    if (!nodes) return false;
+    ProfilePhase p(Prof::AccelIntersect);
+    int hitInstance = -1;
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    int nodesToVisit[64];
+    int toVisitOffset = 0, currentNodeIndex = 0;
+    while (true) {
+        const InstanceBVHNode *node = &nodes[currentNodeIndex];
+        if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
+            if (node->nInstances > 0) {
+                // Intersect ray with the instances in the leaf, in their
+                // own coordinate systems
+                for (int i = 0; i < node->nInstances; ++i) {
+                    const LinearInstance &in =
+                        instances[node->instancesOffset + i];
+                    Ray r = in.worldToInstance(ray);
+                    if (prototypes[in.prototype]->Intersect(r, isect)) {
+                        ray.tMax = r.tMax;
+                        hitInstance = node->instancesOffset + i;
+                    }
+                }
+                if (toVisitOffset == 0) break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            } else {
+                // Put far BVH node on _nodesToVisit_ stack, advance to near
+                // node
+                if (dirIsNeg[node->axis]) {
+                    nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
+                    currentNodeIndex = node->secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset++] = node->secondChildOffset;
+                    currentNodeIndex = currentNodeIndex + 1;
+                }
+            }
+        } else {
+            if (toVisitOffset == 0) break;
+            currentNodeIndex = nodesToVisit[--toVisitOffset];
+        }
+    }
+    if (hitInstance == -1) return false;
+
+    // Transform the closest hit's intersection data to world space
+    Transform toWorld(instanceToWorld[hitInstance].GetMatrix(),
+                      instances[hitInstance].worldToInstance.GetMatrix());
+    if (!toWorld.IsIdentity()) *isect = toWorld(*isect);
+    CHECK_GE(Dot(isect->n, isect->shading.n), 0);
+    return true;
+}
+
+bool InstanceBVHAccel::IntersectP(const Ray &ray) const {
+    if (!nodes) return false;
+    ProfilePhase p(Prof::AccelIntersectP);
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    int nodesToVisit[64];
+    int toVisitOffset = 0, currentNodeIndex = 0;
+    while (true) {
+        const InstanceBVHNode *node = &nodes[currentNodeIndex];
+        if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
+            if (node->nInstances > 0) {
+                for (int i = 0; i < node->nInstances; ++i) {
+                    const LinearInstance &in =
+                        instances[node->instancesOffset + i];
+                    if (prototypes[in.prototype]->IntersectP(
+                            in.worldToInstance(ray)))
+                        return true;
+                }
+                if (toVisitOffset == 0) break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            } else {
+                if (dirIsNeg[node->axis]) {
+                    nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
+                    currentNodeIndex = node->secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset++] = node->secondChildOffset;
+                    currentNodeIndex = currentNodeIndex + 1;
+                }
+            }
+        } else {
+            if (toVisitOffset == 0) break;
+            currentNodeIndex = nodesToVisit[--toVisitOffset];
+        }
+    }
+    return false;
+}
+
+}  // namespace pbrt
@@ -0,0 +1,152 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_ACCELERATORS_INSTANCEBVH_H
+#define PBRT_ACCELERATORS_INSTANCEBVH_H
+
+// accelerators/instancebvh.h*
+#include "pbrt.h"
+#include "primitive.h"
+#include "transform.h"
+
+namespace pbrt {
+
+// CompactTransform Declarations
+// An affine transformation stored as the top three rows of its matrix,
+// without the inverse that _Transform_ carries along.
+struct CompactTransform {
+    // CompactTransform Public Methods
+    CompactTransform() = default;
+    explicit CompactTransform(const Matrix4x4 &mat) {
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 4; ++j) m[i][j] = mat.m[i][j];
+    }
+    static bool IsAffine(const Matrix4x4 &mat) {
+        return mat.m[3][0] == 0 && mat.m[3][1] == 0 && mat.m[3][2] == 0 &&
+               mat.m[3][3] == 1;
+    }
+    Matrix4x4 GetMatrix() const {
+        return Matrix4x4(m[0][0], m[0][1], m[0][2], m[0][3], m[1][0], m[1][1],
+                         m[1][2], m[1][3], m[2][0], m[2][1], m[2][2], m[2][3],
+                         0, 0, 0, 1);
+    }
+    Transform ToTransform() const {
+        Matrix4x4 mat = GetMatrix();
+        return Transform(mat, Inverse(mat));
+    }
+    inline Ray operator()(const Ray &r) const;
+
+    // CompactTransform Public Data
+    Float m[3][4];
+};
+
+// InstanceBVHAccel Declarations
+struct InstanceBVHNode;
+struct InstanceBuildInfo;
+class InstanceBVHAccel : public Aggregate {
+  public:
+    // InstanceBVHAccel Public Types
+    struct Instance {
+        CompactTransform instanceToWorld;
+        // Index into the _prototypes_ passed to the constructor
+        int prototype;
+    };
+
+    // InstanceBVHAccel Public Methods
+    InstanceBVHAccel(const std::vector<std::shared_ptr<Primitive>> &prototypes,
+                     std::vector<Instance> instances,
+                     int maxInstancesInNode = 2);
+    Bounds3f WorldBound() const;
+    ~InstanceBVHAccel();
+    bool Intersect(const Ray &ray, SurfaceInteraction *isect) const;
+    bool IntersectP(const Ray &ray) const;
+
+  private:
+    // InstanceBVHAccel Private Types
+    struct LinearInstance {
+        CompactTransform worldToInstance;
+        int prototype;
+    };
+
+    // InstanceBVHAccel Private Methods
+    int recursiveBuild(std::vector<InstanceBuildInfo> &buildInfo, int start,
+                       int end, std::vector<InstanceBVHNode> *buildNodes);
+
+    // InstanceBVHAccel Private Data
+    const int maxInstancesInNode;
+    std::vector<std::shared_ptr<Primitive>> prototypes;
+    std::vector<LinearInstance> instances;
+    // Forward transformations, parallel to _instances_; only read for the
+    // closest hit, so they are kept out of the traversal data
+    std::vector<CompactTransform> instanceToWorld;
+    InstanceBVHNode *nodes = nullptr;
+};
+
+// CompactTransform Inline Functions
+inline Ray CompactTransform::operator()(const Ray &r) const {
+    // Transform ray origin and direction, bounding the origin's error
+    Float x = r.o.x, y = r.o.y, z = r.o.z;
+    Point3f o(m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3],
+              m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3],
+              m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3]);
+    Vector3f oError =
+        gamma(3) *
+        Vector3f(std::abs(m[0][0] * x) + std::abs(m[0][1] * y) +
+                     std::abs(m[0][2] * z) + std::abs(m[0][3]),
+                 std::abs(m[1][0] * x) + std::abs(m[1][1] * y) +
+                     std::abs(m[1][2] * z) + std::abs(m[1][3]),
+                 std::abs(m[2][0] * x) + std::abs(m[2][1] * y) +
+                     std::abs(m[2][2] * z) + std::abs(m[2][3]));
+    Vector3f d(m[0][0] * r.d.x + m[0][1] * r.d.y + m[0][2] * r.d.z,
+               m[1][0] * r.d.x + m[1][1] * r.d.y + m[1][2] * r.d.z,
+               m[2][0] * r.d.x + m[2][1] * r.d.y + m[2][2] * r.d.z);
+
+    // Offset ray origin to edge of error bounds and compute _tMax_
+    Float lengthSquared = d.LengthSquared();
+    Float tMax = r.tMax;
+    if (lengthSquared > 0) {
+        Float dt = Dot(Abs(d), oError) / lengthSquared;
+        o += d * dt;
+        tMax -= dt;
+    }
+    return Ray(o, d, tMax, r.time, r.medium);
+}
+
+}  // namespace pbrt
+
+#endif  // PBRT_ACCELERATORS_INSTANCEBVH_H
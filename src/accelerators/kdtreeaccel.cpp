@@ -36,6 +36,7 @@
 #include "paramset.h"
 #include "interaction.h"
 #include "stats.h"
+#include "parallel.h"
 #include <algorithm>
 
 namespace pbrt {
@@ -54,6 +55,7 @@ struct KdAccelNode {
     int SplitAxis() const { return flags & 3; }
     bool IsLeaf() const { return (flags & 3) == 3; }
     int AboveChild() const { return aboveChild >> 2; }
+    void SetAboveChild(int ac) { aboveChild = (ac << 2) | (flags & 3); }
     union {
         Float split;                 // Interior
         int onePrimitive;            // Leaf
@@ -68,6 +70,10 @@ struct KdAccelNode {
     };
 };
 
+#ifndef PBRT_FLOAT_AS_DOUBLE
+static_assert(sizeof(KdAccelNode) == 8, "KdAccelNode should be 8 bytes");
+#endif
+
 enum class EdgeType { Start, End };
 struct BoundEdge {
     // BoundEdge Public Methods
@@ -80,6 +86,51 @@ struct BoundEdge {
     EdgeType type;
 };
 
+// Nodes and leaf primitive indices of a kd-tree or one of its subtrees,
+// with node indices relative to the subtree's root
+struct KdBuildOutput {
+    std::vector<KdAccelNode> nodes;
+    std::vector<int> primitiveIndices;
+};
+
+// Subtree whose construction has been deferred so that it can be built
+// concurrently with the others; _nodeNum_ is the placeholder leaf that it
+// replaces in the top of the tree.
+struct KdSubtreeTask {
+    int nodeNum;
+    Bounds3f bounds;
+    std::vector<int> primNums;
+    int depth, badRefines;
+    KdBuildOutput output;
+};
+
+// Sorts _[begin, end)_ by sorting chunks in parallel and then merging them
+// pairwise, also in parallel. Kd-trees may be built inside other parallel
+// loops, such as those that build instance prototypes, so these loops may
+// be nested.
+template <typename T, typename Compare>
+static void ParallelSort(T *begin, T *end, Compare comp) {
+    int64_t n = end - begin;
+    int nChunks = RoundUpPow2(MaxThreadIndex());
+    if (nChunks == 1 || n < 65536) {
+        std::sort(begin, end, comp);
+        return;
+    }
+    auto chunkStart = [&](int64_t c) { return begin + n * c / nChunks; };
+    ParallelFor([&](int64_t c) {
+        std::sort(chunkStart(c), chunkStart(c + 1), comp);
+    }, nChunks, 1);
+    for (int width = 1; width < nChunks; width *= 2)
+        ParallelFor([&](int64_t i) {
+            int64_t c = 2 * width * i;
+            std::inplace_merge(chunkStart(c), chunkStart(c + width),
+                               chunkStart(c + 2 * width), comp);
+        }, nChunks / (2 * width), 1);
+}
+
+STAT_MEMORY_COUNTER("Memory/Kd-tree", kdTreeBytes);
+STAT_COUNTER("Kd-tree/Subtrees built in parallel", nParallelSubtrees);
+
 // KdTreeAccel Method Definitions
 KdTreeAccel::KdTreeAccel(const std::vector<std::shared_ptr<Primitive>> &p,
                          int isectCost, int traversalCost, Float emptyBonus,
@@ -91,18 +142,15 @@ KdTreeAccel::KdTreeAccel(const std::vector<std::shared_ptr<Primitive>> &p,
       primitives(p) {
     // Build kd-tree for accelerator
     ProfilePhase _(Prof::AccelConstruction);
-    nextFreeNode = nAllocedNodes = 0;
     if (maxDepth <= 0)
         maxDepth = std::round(8 + 1.3f * Log2Int(int64_t(primitives.size())));
 
     // Compute bounds for kd-tree construction
-    std::vector<Bounds3f> primBounds;
-    primBounds.reserve(primitives.size());
-    for (const std::shared_ptr<Primitive> &prim : primitives) {
-        Bounds3f b = prim->WorldBound();
-        bounds = Union(bounds, b);
-        primBounds.push_back(b);
-    }
+    std::vector<Bounds3f> primBounds(primitives.size());
+    ParallelFor([&](int64_t i) {
+        primBounds[i] = primitives[i]->WorldBound();
+    }, primitives.size(), 4096);
+    for (const Bounds3f &b : primBounds) bounds = Union(bounds, b);
 
     // Allocate working memory for kd-tree construction
     std::unique_ptr<BoundEdge[]> edges[3];
@@ -115,9 +163,68 @@ KdTreeAccel::KdTreeAccel(const std::vector<std::shared_ptr<Primitive>> &p,
     std::unique_ptr<int[]> primNums(new int[primitives.size()]);
     for (size_t i = 0; i < primitives.size(); ++i) primNums[i] = i;
 
-    // Start recursive construction of kd-tree
+    // Build the top of the kd-tree, deferring the subtrees below
+    // _parallelDepth_ when there are multiple threads
+    KdBuildOutput top;
+    std::vector<KdSubtreeTask> subtreeTasks;
+    int parallelDepth = MaxThreadIndex() > 1
+                            ? Log2Int(uint32_t(4 * MaxThreadIndex())) + 1
+                            : 0;
     buildTree(0, bounds, primBounds, primNums.get(), primitives.size(),
-              maxDepth, edges, prims0.get(), prims1.get());
+              maxDepth, edges, prims0.get(), prims1.get(), 0, &top,
+              parallelDepth > 0 ? &subtreeTasks : nullptr, parallelDepth);
+    prims0.reset();
+    prims1.reset();
+    for (int i = 0; i < 3; ++i) edges[i].reset();
+
+    // Build deferred subtrees in parallel, each with its own working memory
+    nParallelSubtrees += subtreeTasks.size();
+    ParallelFor([&](int64_t t) {
+        KdSubtreeTask &task = subtreeTasks[t];
+        int n = task.primNums.size();
+        std::unique_ptr<BoundEdge[]> edges[3];
+        for (int i = 0; i < 3; ++i) edges[i].reset(new BoundEdge[2 * n]);
+        std::unique_ptr<int[]> prims0(new int[n]);
+        std::unique_ptr<int[]> prims1(new int[(task.depth + 1) * n]);
+        buildTree(0, task.bounds, primBounds, &task.primNums[0], n,
+                  task.depth, edges, prims0.get(), prims1.get(),
+                  task.badRefines, &task.output);
+    }, subtreeTasks.size(), 1);
+
+    // Splice the subtrees into the top of the tree, replacing their
+    // placeholder leaves; nodes stay in depth-first order.
+    size_t totalNodes = top.nodes.size();
+    for (const KdSubtreeTask &task : subtreeTasks)
+        totalNodes += task.output.nodes.size() - 1;
+    nodes = AllocAligned<KdAccelNode>(totalNodes);
+    std::vector<int> newNodeNum(top.nodes.size());
+    primitiveIndices = std::move(top.primitiveIndices);
+    auto task = subtreeTasks.begin();
+    for (size_t i = 0; i < top.nodes.size(); ++i) {
+        newNodeNum[i] = nNodes;
+        if (task != subtreeTasks.end() && task->nodeNum == (int)i) {
+            int primOffset = primitiveIndices.size();
+            for (KdAccelNode node : task->output.nodes) {
+                if (!node.IsLeaf())
+                    node.SetAboveChild(node.AboveChild() + newNodeNum[i]);
+                else if (node.nPrimitives() > 1)
+                    node.primitiveIndicesOffset += primOffset;
+                nodes[nNodes++] = node;
+            }
+            primitiveIndices.insert(primitiveIndices.end(),
+                                    task->output.primitiveIndices.begin(),
+                                    task->output.primitiveIndices.end());
+            ++task;
+        } else
+            nodes[nNodes++] = top.nodes[i];
+    }
+    CHECK_EQ(nNodes, (int)totalNodes);
+    for (size_t i = 0; i < top.nodes.size(); ++i)
+        if (!top.nodes[i].IsLeaf())
+            nodes[newNodeNum[i]].SetAboveChild(
+                newNodeNum[top.nodes[i].AboveChild()]);
+    kdTreeBytes += nNodes * sizeof(KdAccelNode) +
+                   primitiveIndices.size() * sizeof(int) + sizeof(*this);
 }
 
 void KdAccelNode::InitLeaf(int *primNums, int np,
@@ -141,24 +248,28 @@ void KdTreeAccel::buildTree(int nodeNum, const Bounds3f &nodeBounds,
                             const std::vector<Bounds3f> &allPrimBounds,
                             int *primNums, int nPrimitives, int depth,
                             const std::unique_ptr<BoundEdge[]> edges[3],
-                            int *prims0, int *prims1, int badRefines) {
-    CHECK_EQ(nodeNum, nextFreeNode);
-    // Get next free node from _nodes_ array
-    if (nextFreeNode == nAllocedNodes) {
-        int nNewAllocNodes = std::max(2 * nAllocedNodes, 512);
-        KdAccelNode *n = AllocAligned<KdAccelNode>(nNewAllocNodes);
-        if (nAllocedNodes > 0) {
-            memcpy(n, nodes, nAllocedNodes * sizeof(KdAccelNode));
-            FreeAligned(nodes);
-        }
-        nodes = n;
-        nAllocedNodes = nNewAllocNodes;
-    }
-    ++nextFreeNode;
+                            int *prims0, int *prims1, int badRefines,
+                            KdBuildOutput *output,
+                            std::vector<KdSubtreeTask> *subtreeTasks,
+                            int parallelDepth) const {
+    CHECK_EQ(nodeNum, (int)output->nodes.size());
+    // Get next free node from _output_'s nodes
+    output->nodes.push_back(KdAccelNode());
+    KdAccelNode *node = &output->nodes.back();
 
     // Initialize leaf node if termination criteria met
     if (nPrimitives <= maxPrims || depth == 0) {
-        nodes[nodeNum].InitLeaf(primNums, nPrimitives, &primitiveIndices);
+        node->InitLeaf(primNums, nPrimitives, &output->primitiveIndices);
+        return;
+    }
+
+    // Defer the subtree's construction if it's at the parallel build depth
+    if (subtreeTasks && parallelDepth == 0) {
+        node->InitLeaf(nullptr, 0, &output->primitiveIndices);
+        subtreeTasks->push_back(
+            {nodeNum, nodeBounds,
+             std::vector<int>(primNums, primNums + nPrimitives), depth,
+             badRefines, KdBuildOutput()});
         return;
     }
 
@@ -185,14 +296,19 @@ retrySplit:
         edges[axis][2 * i + 1] = BoundEdge(bounds.pMax[axis], pn, false);
     }
 
-    // Sort _edges_ for _axis_
-    std::sort(&edges[axis][0], &edges[axis][2 * nPrimitives],
-              [](const BoundEdge &e0, const BoundEdge &e1) -> bool {
-                  if (e0.t == e1.t)
-                      return (int)e0.type < (int)e1.type;
-                  else
-                      return e0.t < e1.t;
-              });
+    // Sort _edges_ for _axis_; the large nodes at the top of the tree are
+    // sorted in parallel.
+    auto edgeLess = [](const BoundEdge &e0, const BoundEdge &e1) -> bool {
+        if (e0.t == e1.t)
+            return (int)e0.type < (int)e1.type;
+        else
+            return e0.t < e1.t;
+    };
+    if (subtreeTasks)
+        ParallelSort(&edges[axis][0], &edges[axis][2 * nPrimitives],
+                     edgeLess);
+    else
+        std::sort(&edges[axis][0], &edges[axis][2 * nPrimitives], edgeLess);
 
     // Compute cost of all splits for _axis_ to find best
     int nBelow = 0, nAbove = nPrimitives;
@@ -237,7 +353,7 @@ retrySplit:
     if (bestCost > oldCost) ++badRefines;
     if ((bestCost > 4 * oldCost && nPrimitives < 16) || bestAxis == -1 ||
         badRefines == 3) {
-        nodes[nodeNum].InitLeaf(primNums, nPrimitives, &primitiveIndices);
+        node->InitLeaf(primNums, nPrimitives, &output->primitiveIndices);
         return;
     }
 
@@ -255,11 +371,13 @@ retrySplit:
     Bounds3f bounds0 = nodeBounds, bounds1 = nodeBounds;
     bounds0.pMax[bestAxis] = bounds1.pMin[bestAxis] = tSplit;
     buildTree(nodeNum + 1, bounds0, allPrimBounds, prims0, n0, depth - 1, edges,
-              prims0, prims1 + nPrimitives, badRefines);
-    int aboveChild = nextFreeNode;
-    nodes[nodeNum].InitInterior(bestAxis, aboveChild, tSplit);
+              prims0, prims1 + nPrimitives, badRefines, output, subtreeTasks,
+              parallelDepth - 1);
+    int aboveChild = output->nodes.size();
+    output->nodes[nodeNum].InitInterior(bestAxis, aboveChild, tSplit);
     buildTree(aboveChild, bounds1, allPrimBounds, prims1, n1, depth - 1, edges,
-              prims0, prims1 + nPrimitives, badRefines);
+              prims0, prims1 + nPrimitives, badRefines, output, subtreeTasks,
+              parallelDepth - 1);
 }
 
 bool KdTreeAccel::Intersect(const Ray &ray, SurfaceInteraction *isect) const {
@@ -430,6 +548,163 @@ bool KdTreeAccel::IntersectP(const Ray &ray) const {
     return false;
 }
 
+static constexpr int MaxKdPacketSize = 32;
+
+// Rays traced together through the kd-tree, stored in SoA layout. All rays
+// in a packet have the same direction signs so that they agree on the
+// near-far order of every node's children.
+struct KdRayPacket {
+    // KdRayPacket Public Data
+    int n = 0;
+    int dirIsNeg[3];
+    int rayIndex[MaxKdPacketSize];
+    Float o[3][MaxKdPacketSize], invDir[3][MaxKdPacketSize];
+    Float tMin[MaxKdPacketSize], tMax[MaxKdPacketSize];
+};
+
+void KdTreeAccel::IntersectBatch(const Ray *rays, int nRays,
+                                 SurfaceInteraction *isects,
+                                 bool *hits) const {
+    ProfilePhase p(isects ? Prof::AccelIntersect : Prof::AccelIntersectP);
+    for (int i = 0; i < nRays; ++i) hits[i] = false;
+    // Gather rays into packets by the octant of their directions, tracing
+    // each packet when it fills up
+    KdRayPacket packets[8];
+    for (int i = 0; i < nRays; ++i) {
+        const Ray &r = rays[i];
+        Float tMin, tMax;
+        if (!bounds.IntersectP(r, &tMin, &tMax)) continue;
+        int octant = (r.d.x < 0) | ((r.d.y < 0) << 1) | ((r.d.z < 0) << 2);
+        KdRayPacket &packet = packets[octant];
+        int lane = packet.n++;
+        packet.rayIndex[lane] = i;
+        for (int c = 0; c < 3; ++c) {
+            packet.o[c][lane] = r.o[c];
+            packet.invDir[c][lane] = 1 / r.d[c];
+            packet.dirIsNeg[c] = (octant >> c) & 1;
+        }
+        packet.tMin[lane] = tMin;
+        packet.tMax[lane] = tMax;
+        if (packet.n == MaxKdPacketSize) {
+            intersectPacket(packet, rays, isects, hits);
+            packet.n = 0;
+        }
+    }
+    for (KdRayPacket &packet : packets)
+        if (packet.n > 0) intersectPacket(packet, rays, isects, hits);
+}
+
+void KdTreeAccel::IntersectPBatch(const Ray *rays, int nRays,
+                                  bool *occluded) const {
+    // _intersectPacket()_ only tests for occlusion when not given
+    // _SurfaceInteraction_s
+    IntersectBatch(rays, nRays, nullptr, occluded);
+}
+
+void KdTreeAccel::intersectPacket(KdRayPacket &packet, const Ray *rays,
+                                  SurfaceInteraction *isects,
+                                  bool *hits) const {
+    // Each deferred node carries the parametric range of each of its rays
+    struct KdPacketToDo {
+        const KdAccelNode *node;
+        uint32_t active;
+        Float tMin[MaxKdPacketSize], tMax[MaxKdPacketSize];
+    };
+    PBRT_CONSTEXPR int maxTodo = 64;
+    KdPacketToDo todo[maxTodo];
+    int todoPos = 0;
+    const int n = packet.n;
+    uint32_t active = n == 32 ? ~0u : ((1u << n) - 1);
+    // Shadow rays that have been found to be occluded
+    uint32_t done = 0;
+    Float *tMin = packet.tMin, *tMax = packet.tMax;
+    const KdAccelNode *node = &nodes[0];
+    while (true) {
+        // Drop rays that have found a hit closer than the current node; the
+        // ranges of inactive rays are meaningless here.
+        active &= ~done;
+        if (isects)
+            for (int i = 0; i < n; ++i)
+                if (rays[packet.rayIndex[i]].tMax < tMin[i])
+                    active &= ~(1u << i);
+
+        if (active && !node->IsLeaf()) {
+            // Compute parametric distances to the split plane for all rays
+            int axis = node->SplitAxis();
+            Float split = node->SplitPos();
+            Float tPlane[MaxKdPacketSize];
+            uint32_t nearMask = 0, farMask = 0;
+            for (int i = 0; i < n; ++i) {
+                tPlane[i] =
+                    (split - packet.o[axis][i]) * packet.invDir[axis][i];
+                // NaN _tPlane_ values, from rays in the split plane, only
+                // visit the near child
+                nearMask |= uint32_t(!(tPlane[i] < tMin[i])) << i;
+                farMask |= uint32_t(tPlane[i] <= tMax[i]) << i;
+            }
+            nearMask &= active;
+            farMask &= active;
+            const KdAccelNode *belowChild = node + 1;
+            const KdAccelNode *aboveChild = &nodes[node->AboveChild()];
+            const KdAccelNode *nearChild =
+                packet.dirIsNeg[axis] ? aboveChild : belowChild;
+            const KdAccelNode *farChild =
+                packet.dirIsNeg[axis] ? belowChild : aboveChild;
+
+            // Enqueue far child with the rays' ranges beyond the split
+            if (farMask) {
+                CHECK_LT(todoPos, maxTodo);
+                KdPacketToDo &t = todo[todoPos++];
+                t.node = farChild;
+                t.active = farMask;
+                for (int i = 0; i < n; ++i) {
+                    t.tMin[i] = std::max(tMin[i], tPlane[i]);
+                    t.tMax[i] = tMax[i];
+                }
+            }
+            if (nearMask) {
+                for (int i = 0; i < n; ++i)
+                    tMax[i] = std::min(tMax[i], tPlane[i]);
+                node = nearChild;
+                active = nearMask;
+                continue;
+            }
+        } else if (active) {
+            // Intersect each active ray with the primitives in the leaf
+            int nPrimitives = node->nPrimitives();
+            for (uint32_t m = active; m; m &= m - 1) {
+                int lane = CountTrailingZeros(m);
+                int r = packet.rayIndex[lane];
+                for (int i = 0; i < nPrimitives; ++i) {
+                    int index =
+                        nPrimitives == 1
+                            ? node->onePrimitive
+                            : primitiveIndices[node->primitiveIndicesOffset +
+                                               i];
+                    if (isects) {
+                        if (primitives[index]->Intersect(rays[r], &isects[r]))
+                            hits[r] = true;
+                    } else if (primitives[index]->IntersectP(rays[r])) {
+                        hits[r] = true;
+                        done |= 1u << lane;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Grab next node to process from todo list
+        if (todoPos == 0) break;
+        --todoPos;
+        node = todo[todoPos].node;
+        active = todo[todoPos].active;
+        for (int i = 0; i < n; ++i) {
+            tMin[i] = todo[todoPos].tMin[i];
+            tMax[i] = todo[todoPos].tMax[i];
+        }
+    }
+}
+
 std::shared_ptr<KdTreeAccel> CreateKdTreeAccelerator(
     const std::vector<std::shared_ptr<Primitive>> &prims, const ParamSet &ps) {
     int isectCost = ps.FindOneInt("intersectcost", 80);
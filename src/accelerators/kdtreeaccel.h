@@ -47,6 +47,9 @@ namespace pbrt {
 // KdTreeAccel Declarations
 struct KdAccelNode;
 struct BoundEdge;
+struct KdBuildOutput;
+struct KdSubtreeTask;
+struct KdRayPacket;
 class KdTreeAccel : public Aggregate {
   public:
     // KdTreeAccel Public Methods
@@ -57,6 +60,9 @@ class KdTreeAccel : public Aggregate {
     ~KdTreeAccel();
     bool Intersect(const Ray &ray, SurfaceInteraction *isect) const;
     bool IntersectP(const Ray &ray) const;
+    void IntersectBatch(const Ray *rays, int nRays, SurfaceInteraction *isects,
+                        bool *hits) const;
+    void IntersectPBatch(const Ray *rays, int nRays, bool *occluded) const;
 
   private:
     // KdTreeAccel Private Methods
@@ -64,15 +70,19 @@ class KdTreeAccel : public Aggregate {
                    const std::vector<Bounds3f> &primBounds, int *primNums,
                    int nprims, int depth,
                    const std::unique_ptr<BoundEdge[]> edges[3], int *prims0,
-                   int *prims1, int badRefines = 0);
+                   int *prims1, int badRefines, KdBuildOutput *output,
+                   std::vector<KdSubtreeTask> *subtreeTasks = nullptr,
+                   int parallelDepth = 0) const;
+    void intersectPacket(KdRayPacket &packet, const Ray *rays,
+                         SurfaceInteraction *isects, bool *hits) const;
 
     // KdTreeAccel Private Data
     const int isectCost, traversalCost, maxPrims;
     const Float emptyBonus;
     std::vector<std::shared_ptr<Primitive>> primitives;
     std::vector<int> primitiveIndices;
-    KdAccelNode *nodes;
-    int nAllocedNodes, nextFreeNode;
+    KdAccelNode *nodes = nullptr;
+    int nNodes = 0;
     Bounds3f bounds;
 };
 
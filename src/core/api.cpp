@@ -32,6 +32,7 @@
 
 // core/api.cpp*
 #include "api.h"
+#include "binaryscene.h"
 #include "parallel.h"
 #include "paramset.h"
 #include "spectrum.h"
@@ -42,6 +43,7 @@
 
 // API Additional Headers
 #include "accelerators/bvh.h"
+#include "accelerators/instancebvh.h"
 #include "accelerators/kdtreeaccel.h"
 #include "cameras/environment.h"
 #include "cameras/orthographic.h"
@@ -90,13 +92,16 @@
 #include "shapes/curve.h"
 #include "shapes/cylinder.h"
 #include "shapes/disk.h"
+#include "shapes/displacement.h"
 #include "shapes/heightfield.h"
 #include "shapes/hyperboloid.h"
 #include "shapes/loopsubdiv.h"
 #include "shapes/nurbs.h"
 #include "shapes/paraboloid.h"
+#include "shapes/particles.h"
 #include "shapes/sphere.h"
 #include "shapes/triangle.h"
+#include "shapes/compressedmesh.h"
 #include "shapes/plymesh.h"
 #include "textures/bilerp.h"
 #include "textures/checkerboard.h"
@@ -152,6 +157,49 @@ struct TransformSet {
     Transform t[MaxTransforms];
 };
 
+// The contents of an ObjectBegin/ObjectEnd block: its own primitives and the
+// static object instances used inside of it
+struct InstanceDefinition {
+    std::vector<std::shared_ptr<Primitive>> primitives;
+    std::vector<InstanceBVHAccel::Instance> instances;
+    // Index into _RenderOptions::instancePrototypes_ once the definition's
+    // aggregate has been created on first use
+    int prototype = -1;
+};
+
+// A static shape whose creation is deferred until the end of the world
+// block, or until enough shapes are pending, so that many shapes can be
+// created in parallel; see _LoadPendingShapes()_. Shapes that were created
+// immediately but follow pending ones are queued too, with their
+// primitives, to preserve the order of the scene description.
+struct PendingShape {
+    // Shape name, or empty if _prims_ and _areaLights_ are already created
+    std::string name;
+    ParamSet params;
+    Transform *ObjToWorld, *WorldToObj;
+    bool reverseOrientation;
+    std::map<std::string, std::shared_ptr<Texture<Float>>> floatTextures;
+    std::shared_ptr<Material> material;
+    MediumInterface mediumInterface;
+    bool compact;
+    std::string areaLight;
+    ParamSet areaLightParams;
+    Transform lightToWorld;
+    // Position of the _Shape_ statement in the scene file
+    std::string file;
+    int line;
+    std::vector<std::shared_ptr<Primitive>> prims;
+    std::vector<std::shared_ptr<AreaLight>> areaLights;
+    // Instance the shape belongs to, or nullptr for the world
+    InstanceDefinition *instance;
+};
+
+// Pending shapes are created once this many have been queued or their
+// parameter lists reach this size, so that the parameters of only a
+// bounded number of shapes are held along with the shapes created so far
+static PBRT_CONSTEXPR int MaxPendingShapes = 4096;
+static PBRT_CONSTEXPR size_t MaxPendingShapeBytes = size_t(256) << 20;
+
 struct RenderOptions {
     // RenderOptions Public Methods
     Integrator *MakeIntegrator() const;
@@ -177,8 +225,15 @@ struct RenderOptions {
     std::map<std::string, std::shared_ptr<Medium>> namedMedia;
     std::vector<std::shared_ptr<Light>> lights;
     std::vector<std::shared_ptr<Primitive>> primitives;
-    std::map<std::string, std::vector<std::shared_ptr<Primitive>>> instances;
-    std::vector<std::shared_ptr<Primitive>> *currentInstance = nullptr;
+    std::map<std::string, InstanceDefinition> instances;
+    InstanceDefinition *currentInstance = nullptr;
+    std::vector<std::shared_ptr<Primitive>> instancePrototypes;
+    std::vector<InstanceBVHAccel::Instance> worldInstances;
+    std::vector<PendingShape> pendingShapes;
+    size_t pendingShapeBytes = 0;
+    // Instance definitions whose prototype has been reserved in
+    // _instancePrototypes_ but not built yet
+    std::vector<InstanceDefinition *> pendingPrototypes;
     bool haveScatteringMedia = false;
 };
 
@@ -240,14 +295,19 @@ static std::vector<GraphicsState> pushedGraphicsStates;
 static std::vector<TransformSet> pushedTransforms;
 static std::vector<uint32_t> pushedActiveTransformBits;
 static TransformCache transformCache;
+static std::unique_ptr<BinarySceneWriter> binaryWriter;
 int catIndentCount = 0;
+extern PBRT_THREAD_LOCAL int line_num;
+extern PBRT_THREAD_LOCAL const char *current_file;
 
 // API Forward Declarations
-std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
-                                               const Transform *ObjectToWorld,
-                                               const Transform *WorldToObject,
-                                               bool reverseOrientation,
-                                               const ParamSet &paramSet);
+std::vector<std::shared_ptr<Shape>> MakeShapes(
+    const std::string &name, const Transform *ObjectToWorld,
+    const Transform *WorldToObject, bool reverseOrientation,
+    const ParamSet &paramSet,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    const SubdivisionView *subdivView = nullptr,
+    std::shared_ptr<TriangleMesh> *compressedMesh = nullptr);
 
 // API Macros
 #define VERIFY_INITIALIZED(func)                           \
@@ -279,6 +339,11 @@ std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
             func);                                           \
         return;                                              \
     } else /* swallow trailing semicolon */
+#define WRITE_BINARY(call)           \
+    if (binaryWriter) {              \
+        binaryWriter->call;          \
+        return;                      \
+    } else /* swallow trailing semicolon */
 #define FOR_ACTIVE_TRANSFORMS(expr)           \
     for (int i = 0; i < MaxTransforms; ++i)   \
         if (activeTransformBits & (1 << i)) { \
@@ -294,13 +359,19 @@ std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
     } while (false) /* swallow trailing semicolon */
 
 // Object Creation Function Definitions
-std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
-                                               const Transform *object2world,
-                                               const Transform *world2object,
-                                               bool reverseOrientation,
-                                               const ParamSet &paramSet) {
+std::vector<std::shared_ptr<Shape>> MakeShapes(
+    const std::string &name, const Transform *object2world,
+    const Transform *world2object, bool reverseOrientation,
+    const ParamSet &paramSet,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    const SubdivisionView *subdivView,
+    std::shared_ptr<TriangleMesh> *compressedMesh) {
     std::vector<std::shared_ptr<Shape>> shapes;
     std::shared_ptr<Shape> s;
+    // Displaced meshes are made from the mesh's _Triangle_s
+    bool displaced = (name == "trianglemesh" || name == "plymesh") &&
+                     paramSet.FindTexture("displacement") != "";
+    if (displaced) compressedMesh = nullptr;
     if (name == "sphere")
         s = CreateSphereShape(object2world, world2object, reverseOrientation,
                               paramSet);
@@ -386,21 +457,29 @@ std::vector<std::shared_ptr<Shape>> MakeShapes(const std::string &name,
         } else
             shapes = CreateTriangleMeshShape(object2world, world2object,
                                              reverseOrientation, paramSet,
-                                             &graphicsState.floatTextures);
+                                             floatTextures, compressedMesh);
     } else if (name == "plymesh")
         shapes = CreatePLYMesh(object2world, world2object, reverseOrientation,
-                               paramSet, &graphicsState.floatTextures);
+                               paramSet, floatTextures, compressedMesh);
     else if (name == "heightfield")
         shapes = CreateHeightfield(object2world, world2object,
                                    reverseOrientation, paramSet);
     else if (name == "loopsubdiv")
         shapes = CreateLoopSubdiv(object2world, world2object,
-                                  reverseOrientation, paramSet);
+                                  reverseOrientation, paramSet, subdivView);
+    else if (name == "particles")
+        shapes = CreateParticles(object2world, world2object,
+                                 reverseOrientation, paramSet);
     else if (name == "nurbs")
         shapes = CreateNURBS(object2world, world2object, reverseOrientation,
-                             paramSet);
+                             paramSet, compressedMesh);
     else
         Warning("Shape \"%s\" unknown.", name.c_str());
+
+    // Displace triangle meshes that have a displacement texture
+    if (displaced && !shapes.empty())
+        shapes = CreateDisplacedMesh(shapes, paramSet, floatTextures,
+                                     subdivView);
     paramSet.ReportUnused();
     return shapes;
 }
@@ -473,6 +552,20 @@ std::shared_ptr<Material> MakeMaterial(const std::string &name,
     return std::shared_ptr<Material>(material);
 }
 
+STAT_COUNTER("Scene/Textures simplified", nTexturesSimplified);
+
+// Replaces _tex_ with simpler equivalent textures, folding constants and
+// flattening scale and mix chains, until it can't be simplified further
+template <typename T>
+static std::shared_ptr<Texture<T>> SimplifyTexture(Texture<T> *tex) {
+    std::shared_ptr<Texture<T>> texture(tex);
+    while (std::shared_ptr<Texture<T>> simplified = texture->Simplify()) {
+        ++nTexturesSimplified;
+        texture = simplified;
+    }
+    return texture;
+}
+
 std::shared_ptr<Texture<Float>> MakeFloatTexture(const std::string &name,
                                                  const Transform &tex2world,
                                                  const TextureParams &tp) {
@@ -504,7 +597,15 @@ std::shared_ptr<Texture<Float>> MakeFloatTexture(const std::string &name,
     else
         Warning("Float texture \"%s\" unknown.", name.c_str());
     tp.ReportUnused();
-    return std::shared_ptr<Texture<Float>>(tex);
+    if (!tex) return nullptr;
+    std::shared_ptr<Texture<Float>> texture = SimplifyTexture(tex);
+
+    // Cache values of the more expensive textures at each intersection
+    Float value;
+    if (name != "scale" && name != "mix" && name != "uv" &&
+        name != "bilerp" && !texture->IsConstant(&value))
+        texture = std::make_shared<CachedFloatTexture>(texture);
+    return texture;
 }
 
 std::shared_ptr<Texture<Spectrum>> MakeSpectrumTexture(
@@ -538,7 +639,8 @@ std::shared_ptr<Texture<Spectrum>> MakeSpectrumTexture(
     else
         Warning("Spectrum texture \"%s\" unknown.", name.c_str());
     tp.ReportUnused();
-    return std::shared_ptr<Texture<Spectrum>>(tex);
+    if (!tex) return nullptr;
+    return SimplifyTexture(tex);
 }
 
 std::shared_ptr<Medium> MakeMedium(const std::string &name,
@@ -719,17 +821,30 @@ Extractor *MakeExtractor(const std::string &ExtractorName,
         return nullptr;
     }
 
+    // Write the extractor's film as a layer of an EXR image unless it was
+    // given its own output file
+    if (extractor && extractor->film && HasExtension(imageFilename, ".exr") &&
+        ExtractorParams.FindOneString("outputfile", "") == "")
+        extractor->layer = ExtractorName;
+
     ExtractorParams.ReportUnused();
     return extractor;
 }
 
-std::shared_ptr<ExtractorManager> MakeExtractorManager(std::vector<std::pair<std::string, ParamSet>> extractors, const Film &film) {
+std::shared_ptr<ExtractorManager> MakeExtractorManager(std::vector<std::pair<std::string, ParamSet>> extractors, Film *film) {
     ExtractorManager *extractorManager = new ExtractorManager();
+    std::map<std::string, int> layerCount;
 
     for(const auto& kv : extractors) {
-        Extractor *extractor = MakeExtractor(kv.first, kv.second, film.fullResolution, film.diagonal, film.filename);
-        if(extractor)
-            extractorManager->Add(extractor);
+        Extractor *extractor = MakeExtractor(kv.first, kv.second, film->fullResolution, film->diagonal, film->filename);
+        if(!extractor) continue;
+        if(!extractor->layer.empty()) {
+            // Number layers from repeated extractors: "path", "path2", ...
+            int n = ++layerCount[extractor->layer];
+            if(n > 1) extractor->layer += std::to_string(n);
+            film->AddLayer(extractor->layer, extractor->film);
+        }
+        extractorManager->Add(extractor);
     }
 
     return std::shared_ptr<ExtractorManager>(extractorManager);
@@ -778,6 +893,14 @@ void pbrtInit(const Options &opt) {
     renderOptions.reset(new RenderOptions);
     graphicsState = GraphicsState();
     catIndentCount = 0;
+    if (!PbrtOptions.toBinary.empty()) {
+        // Write the scene's statements to a binary scene file instead of
+        // running them
+        binaryWriter.reset(new BinarySceneWriter(PbrtOptions.toBinary));
+        if (!binaryWriter->IsValid())
+            Error("Unable to create binary scene file \"%s\"",
+                  PbrtOptions.toBinary.c_str());
+    }
 
     // General \pbrt Initialization
     SampledSpectrum::Init();
@@ -793,12 +916,17 @@ void pbrtCleanup() {
     else if (currentApiState == APIState::WorldBlock)
         Error("pbrtCleanup() called while inside world block.");
     currentApiState = APIState::Uninitialized;
+    if (binaryWriter && !binaryWriter->IsValid())
+        Error("Unable to write binary scene file \"%s\"",
+              PbrtOptions.toBinary.c_str());
+    binaryWriter.reset();
     ParallelCleanup();
     renderOptions.reset(nullptr);
     CleanupProfiler();
 }
 
 void pbrtIdentity() {
+    WRITE_BINARY(Identity());
     VERIFY_INITIALIZED("Identity");
     FOR_ACTIVE_TRANSFORMS(curTransform[i] = Transform();)
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -806,6 +934,7 @@ void pbrtIdentity() {
 }
 
 void pbrtTranslate(Float dx, Float dy, Float dz) {
+    WRITE_BINARY(Translate(dx, dy, dz));
     VERIFY_INITIALIZED("Translate");
     FOR_ACTIVE_TRANSFORMS(curTransform[i] = curTransform[i] *
                                             Translate(Vector3f(dx, dy, dz));)
@@ -815,6 +944,7 @@ void pbrtTranslate(Float dx, Float dy, Float dz) {
 }
 
 void pbrtTransform(Float tr[16]) {
+    WRITE_BINARY(Transform(tr));
     VERIFY_INITIALIZED("Transform");
     FOR_ACTIVE_TRANSFORMS(
         curTransform[i] = Transform(Matrix4x4(
@@ -828,6 +958,7 @@ void pbrtTransform(Float tr[16]) {
 }
 
 void pbrtConcatTransform(Float tr[16]) {
+    WRITE_BINARY(ConcatTransform(tr));
     VERIFY_INITIALIZED("ConcatTransform");
     FOR_ACTIVE_TRANSFORMS(
         curTransform[i] =
@@ -843,6 +974,7 @@ void pbrtConcatTransform(Float tr[16]) {
 }
 
 void pbrtRotate(Float angle, Float dx, Float dy, Float dz) {
+    WRITE_BINARY(Rotate(angle, dx, dy, dz));
     VERIFY_INITIALIZED("Rotate");
     FOR_ACTIVE_TRANSFORMS(curTransform[i] =
                               curTransform[i] *
@@ -853,6 +985,7 @@ void pbrtRotate(Float angle, Float dx, Float dy, Float dz) {
 }
 
 void pbrtScale(Float sx, Float sy, Float sz) {
+    WRITE_BINARY(Scale(sx, sy, sz));
     VERIFY_INITIALIZED("Scale");
     FOR_ACTIVE_TRANSFORMS(curTransform[i] =
                               curTransform[i] * Scale(sx, sy, sz);)
@@ -862,6 +995,7 @@ void pbrtScale(Float sx, Float sy, Float sz) {
 
 void pbrtLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz,
                 Float ux, Float uy, Float uz) {
+    WRITE_BINARY(LookAt(ex, ey, ez, lx, ly, lz, ux, uy, uz));
     VERIFY_INITIALIZED("LookAt");
     Transform lookAt =
         LookAt(Point3f(ex, ey, ez), Point3f(lx, ly, lz), Vector3f(ux, uy, uz));
@@ -875,6 +1009,7 @@ void pbrtLookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz,
 }
 
 void pbrtCoordinateSystem(const std::string &name) {
+    WRITE_BINARY(CoordinateSystem(name));
     VERIFY_INITIALIZED("CoordinateSystem");
     namedCoordinateSystems[name] = curTransform;
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -883,6 +1018,7 @@ void pbrtCoordinateSystem(const std::string &name) {
 }
 
 void pbrtCoordSysTransform(const std::string &name) {
+    WRITE_BINARY(CoordSysTransform(name));
     VERIFY_INITIALIZED("CoordSysTransform");
     if (namedCoordinateSystems.find(name) != namedCoordinateSystems.end())
         curTransform = namedCoordinateSystems[name];
@@ -894,24 +1030,28 @@ void pbrtCoordSysTransform(const std::string &name) {
 }
 
 void pbrtActiveTransformAll() {
+    WRITE_BINARY(ActiveTransformAll());
     activeTransformBits = AllTransformsBits;
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sActiveTransform All\n", catIndentCount, "");
 }
 
 void pbrtActiveTransformEndTime() {
+    WRITE_BINARY(ActiveTransformEndTime());
     activeTransformBits = EndTransformBits;
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sActiveTransform EndTime\n", catIndentCount, "");
 }
 
 void pbrtActiveTransformStartTime() {
+    WRITE_BINARY(ActiveTransformStartTime());
     activeTransformBits = StartTransformBits;
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sActiveTransform StartTime\n", catIndentCount, "");
 }
 
 void pbrtTransformTimes(Float start, Float end) {
+    WRITE_BINARY(TransformTimes(start, end));
     VERIFY_OPTIONS("TransformTimes");
     renderOptions->transformStartTime = start;
     renderOptions->transformEndTime = end;
@@ -921,6 +1061,7 @@ void pbrtTransformTimes(Float start, Float end) {
 }
 
 void pbrtPixelFilter(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(PixelFilter(name, params));
     VERIFY_OPTIONS("PixelFilter");
     renderOptions->FilterName = name;
     renderOptions->FilterParams = params;
@@ -932,6 +1073,7 @@ void pbrtPixelFilter(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtFilm(const std::string &type, const ParamSet &params) {
+    WRITE_BINARY(Film(type, params));
     VERIFY_OPTIONS("Film");
     renderOptions->FilmParams = params;
     renderOptions->FilmName = type;
@@ -943,6 +1085,7 @@ void pbrtFilm(const std::string &type, const ParamSet &params) {
 }
 
 void pbrtSampler(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(Sampler(name, params));
     VERIFY_OPTIONS("Sampler");
     renderOptions->SamplerName = name;
     renderOptions->SamplerParams = params;
@@ -954,6 +1097,7 @@ void pbrtSampler(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtAccelerator(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(Accelerator(name, params));
     VERIFY_OPTIONS("Accelerator");
     renderOptions->AcceleratorName = name;
     renderOptions->AcceleratorParams = params;
@@ -965,6 +1109,7 @@ void pbrtAccelerator(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtIntegrator(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(Integrator(name, params));
     VERIFY_OPTIONS("Integrator");
     renderOptions->IntegratorName = name;
     renderOptions->IntegratorParams = params;
@@ -976,6 +1121,7 @@ void pbrtIntegrator(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtCamera(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(Camera(name, params));
     VERIFY_OPTIONS("Camera");
     renderOptions->CameraName = name;
     renderOptions->CameraParams = params;
@@ -989,6 +1135,7 @@ void pbrtCamera(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtExtractor(const std::string &name, const ParamSet &params) {
+  WRITE_BINARY(Extractor(name, params));
   VERIFY_OPTIONS("Extractor");
   renderOptions->extractors.push_back({name, params});
   if (PbrtOptions.cat || PbrtOptions.toPly) {
@@ -999,6 +1146,7 @@ void pbrtExtractor(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtMakeNamedMedium(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(MakeNamedMedium(name, params));
     VERIFY_INITIALIZED("MakeNamedMedium");
     WARN_IF_ANIMATED_TRANSFORM("MakeNamedMedium");
     std::string type = params.FindOneString("type", "");
@@ -1018,6 +1166,7 @@ void pbrtMakeNamedMedium(const std::string &name, const ParamSet &params) {
 
 void pbrtMediumInterface(const std::string &insideName,
                          const std::string &outsideName) {
+    WRITE_BINARY(MediumInterface(insideName, outsideName));
     VERIFY_INITIALIZED("MediumInterface");
     graphicsState.currentInsideMedium = insideName;
     graphicsState.currentOutsideMedium = outsideName;
@@ -1028,6 +1177,7 @@ void pbrtMediumInterface(const std::string &insideName,
 }
 
 void pbrtWorldBegin() {
+    WRITE_BINARY(WorldBegin());
     VERIFY_OPTIONS("WorldBegin");
     currentApiState = APIState::WorldBlock;
     for (int i = 0; i < MaxTransforms; ++i) curTransform[i] = Transform();
@@ -1038,6 +1188,7 @@ void pbrtWorldBegin() {
 }
 
 void pbrtAttributeBegin() {
+    WRITE_BINARY(AttributeBegin());
     VERIFY_WORLD("AttributeBegin");
     pushedGraphicsStates.push_back(graphicsState);
     pushedTransforms.push_back(curTransform);
@@ -1049,6 +1200,7 @@ void pbrtAttributeBegin() {
 }
 
 void pbrtAttributeEnd() {
+    WRITE_BINARY(AttributeEnd());
     VERIFY_WORLD("AttributeEnd");
     if (!pushedGraphicsStates.size()) {
         Error(
@@ -1069,6 +1221,7 @@ void pbrtAttributeEnd() {
 }
 
 void pbrtTransformBegin() {
+    WRITE_BINARY(TransformBegin());
     VERIFY_WORLD("TransformBegin");
     pushedTransforms.push_back(curTransform);
     pushedActiveTransformBits.push_back(activeTransformBits);
@@ -1079,6 +1232,7 @@ void pbrtTransformBegin() {
 }
 
 void pbrtTransformEnd() {
+    WRITE_BINARY(TransformEnd());
     VERIFY_WORLD("TransformEnd");
     if (!pushedTransforms.size()) {
         Error(
@@ -1098,6 +1252,7 @@ void pbrtTransformEnd() {
 
 void pbrtTexture(const std::string &name, const std::string &type,
                  const std::string &texname, const ParamSet &params) {
+    WRITE_BINARY(Texture(name, type, texname, params));
     VERIFY_WORLD("Texture");
     TextureParams tp(params, params, graphicsState.floatTextures,
                      graphicsState.spectrumTextures);
@@ -1130,6 +1285,7 @@ void pbrtTexture(const std::string &name, const std::string &type,
 }
 
 void pbrtMaterial(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(Material(name, params));
     VERIFY_WORLD("Material");
     graphicsState.material = name;
     graphicsState.materialParams = params;
@@ -1142,6 +1298,7 @@ void pbrtMaterial(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtMakeNamedMaterial(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(MakeNamedMaterial(name, params));
     VERIFY_WORLD("MakeNamedMaterial");
     // error checking, warning if replace, what to use for transform?
     ParamSet emptyParams;
@@ -1167,6 +1324,7 @@ void pbrtMakeNamedMaterial(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtNamedMaterial(const std::string &name) {
+    WRITE_BINARY(NamedMaterial(name));
     VERIFY_WORLD("NamedMaterial");
     graphicsState.currentNamedMaterial = name;
     if (PbrtOptions.cat || PbrtOptions.toPly)
@@ -1174,6 +1332,7 @@ void pbrtNamedMaterial(const std::string &name) {
 }
 
 void pbrtLightSource(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(LightSource(name, params));
     VERIFY_WORLD("LightSource");
     WARN_IF_ANIMATED_TRANSFORM("LightSource");
     MediumInterface mi = graphicsState.CreateMediumInterface();
@@ -1190,6 +1349,7 @@ void pbrtLightSource(const std::string &name, const ParamSet &params) {
 }
 
 void pbrtAreaLightSource(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(AreaLightSource(name, params));
     VERIFY_WORLD("AreaLightSource");
     graphicsState.areaLight = name;
     graphicsState.areaLightParams = params;
@@ -1200,7 +1360,158 @@ void pbrtAreaLightSource(const std::string &name, const ParamSet &params) {
     }
 }
 
+// Creates the primitives and area lights for static _shapes_, or a
+// _CompressedTriangleMesh_ for _compressedMesh_ if MakeShapes() returned
+// the shape's triangle mesh there
+static void MakeStaticPrimitives(
+    const std::vector<std::shared_ptr<Shape>> &shapes,
+    const std::shared_ptr<TriangleMesh> &compressedMesh, bool flipNormals,
+    const std::shared_ptr<Material> &mtl, const MediumInterface &mi,
+    const std::string &areaLight, const ParamSet &areaLightParams,
+    const Transform &lightToWorld,
+    std::vector<std::shared_ptr<Primitive>> *prims,
+    std::vector<std::shared_ptr<AreaLight>> *areaLights) {
+    if (compressedMesh) {
+        prims->push_back(std::make_shared<CompressedTriangleMesh>(
+            *compressedMesh, flipNormals, mtl, mi));
+        return;
+    }
+    for (auto s : shapes) {
+        // Possibly create area light for shape
+        std::shared_ptr<AreaLight> area;
+        if (areaLight != "") {
+            area = MakeAreaLight(areaLight, lightToWorld, mi, areaLightParams,
+                                 s);
+            if (area) areaLights->push_back(area);
+        }
+        prims->push_back(
+            std::make_shared<GeometricPrimitive>(s, mtl, area, mi));
+    }
+}
+
+// Adds _prims_ and _areaLights_ to the scene or to _instance_
+static void AppendPrimitives(
+    InstanceDefinition *instance,
+    const std::vector<std::shared_ptr<Primitive>> &prims,
+    const std::vector<std::shared_ptr<AreaLight>> &areaLights) {
+    if (instance) {
+        if (areaLights.size())
+            Warning("Area lights not supported with object instancing");
+        instance->primitives.insert(instance->primitives.end(), prims.begin(),
+                                    prims.end());
+    } else {
+        renderOptions->primitives.insert(renderOptions->primitives.end(),
+                                         prims.begin(), prims.end());
+        if (areaLights.size())
+            renderOptions->lights.insert(renderOptions->lights.end(),
+                                         areaLights.begin(), areaLights.end());
+    }
+}
+
+// Adds _prims_ and _areaLights_ to the scene or to _instance_ after the
+// primitives of any pending shapes
+static void AddPrimitives(
+    InstanceDefinition *instance,
+    const std::vector<std::shared_ptr<Primitive>> &prims,
+    const std::vector<std::shared_ptr<AreaLight>> &areaLights) {
+    if (renderOptions->pendingShapes.empty()) {
+        AppendPrimitives(instance, prims, areaLights);
+        return;
+    }
+    PendingShape ps;
+    ps.prims = prims;
+    ps.areaLights = areaLights;
+    ps.instance = instance;
+    renderOptions->pendingShapes.push_back(std::move(ps));
+}
+
+// Returns the camera information that subdivision surfaces and displaced
+// meshes use to choose their tessellation level, if the camera is a
+// perspective camera.
+static bool GetSubdivisionView(SubdivisionView *view) {
+    if (renderOptions->CameraName != "perspective") return false;
+    const ParamSet &film = renderOptions->FilmParams;
+    const ParamSet &camera = renderOptions->CameraParams;
+    int xRes = film.FindOneInt("xresolution", 1280);
+    int yRes = film.FindOneInt("yresolution", 720);
+    if (PbrtOptions.quickRender) xRes = std::max(1, xRes / 4);
+    if (PbrtOptions.quickRender) yRes = std::max(1, yRes / 4);
+    // Find the screen window as _CreatePerspectiveCamera()_ does; the field
+    // of view spans $[-1,1]$ in screen space. The crop window only selects
+    // which of the pixels are rendered, so it doesn't change their size.
+    Float frame = camera.FindOneFloat("frameaspectratio", Float(xRes) / yRes);
+    Vector2f screen = frame > 1 ? Vector2f(2 * frame, 2)
+                                : Vector2f(2, 2 / frame);
+    int swi;
+    const Float *sw = camera.FindFloat("screenwindow", &swi);
+    if (sw && swi == 4)
+        screen = Vector2f(std::abs(sw[1] - sw[0]), std::abs(sw[3] - sw[2]));
+    Float fov = camera.FindOneFloat("fov", 90.);
+    Float halffov = camera.FindOneFloat("halffov", -1.f);
+    if (halffov > 0.f) fov = 2.f * halffov;
+    view->cameraPos = renderOptions->CameraToWorld[0](Point3f(0, 0, 0));
+    // Use the smaller pixel dimension if pixels aren't square
+    view->pixelSpread = std::tan(Radians(fov / 2)) *
+                        std::min(screen.x / xRes, screen.y / yRes);
+    return true;
+}
+
+// Creates the shapes in _RenderOptions::pendingShapes_ in parallel and adds
+// their primitives in the order of the scene description. Each PLY mesh's
+// file is read by the task that creates it, so only a few files' decoded
+// contents are in memory at once. Creating a shape may run parallel loops of
+// its own, which _ParallelFor()_ supports from within other loops.
+static void LoadPendingShapes() {
+    std::vector<PendingShape> pending;
+    std::swap(pending, renderOptions->pendingShapes);
+    renderOptions->pendingShapeBytes = 0;
+    if (pending.empty()) return;
+    std::vector<std::string> filenames;
+    for (const PendingShape &ps : pending)
+        if (ps.name == "plymesh")
+            filenames.push_back(ps.params.FindOneFilename("filename", ""));
+    SharePLYMeshes(filenames);
+    SubdivisionView view;
+    bool haveView = GetSubdivisionView(&view);
+
+    ParallelFor([&](int64_t i) {
+        PendingShape &ps = pending[i];
+        if (ps.name.empty()) return;
+        // Report errors at the position of the _Shape_ statement
+        int prevLine = line_num;
+        const char *prevFile = current_file;
+        line_num = ps.line;
+        current_file = ps.file.c_str();
+        std::shared_ptr<TriangleMesh> mesh;
+        bool compress = ps.compact && ps.areaLight == "";
+        std::vector<std::shared_ptr<Shape>> shapes =
+            MakeShapes(ps.name, ps.ObjToWorld, ps.WorldToObj,
+                       ps.reverseOrientation, ps.params, &ps.floatTextures,
+                       (haveView && !ps.instance) ? &view : nullptr,
+                       compress ? &mesh : nullptr);
+        if (!shapes.empty() || mesh)
+            MakeStaticPrimitives(
+                shapes, mesh,
+                ps.reverseOrientation ^ ps.ObjToWorld->SwapsHandedness(),
+                ps.material, ps.mediumInterface, ps.areaLight,
+                ps.areaLightParams, ps.lightToWorld, &ps.prims,
+                &ps.areaLights);
+        ps.params.ReportUnused();
+        // Release the shape's parameters now that it has been created
+        ps.params.Clear();
+        ps.floatTextures.clear();
+        line_num = prevLine;
+        current_file = prevFile;
+    }, pending.size());
+    // Release the contents of shared files that weren't used, e.g. due to
+    // errors in the shapes' parameters
+    ReleaseSharedPLYMeshes();
+    for (const PendingShape &ps : pending)
+        AppendPrimitives(ps.instance, ps.prims, ps.areaLights);
+}
+
 void pbrtShape(const std::string &name, const ParamSet &params) {
+    WRITE_BINARY(Shape(name, params));
     VERIFY_WORLD("Shape");
     std::vector<std::shared_ptr<Primitive>> prims;
     std::vector<std::shared_ptr<AreaLight>> areaLights;
@@ -1210,30 +1521,61 @@ void pbrtShape(const std::string &name, const ParamSet &params) {
         printf("\n");
     }
 
+    if (!curTransform.IsAnimated() && !PbrtOptions.cat && !PbrtOptions.toPly) {
+        // Defer creation of static shape so that it happens in parallel
+        PendingShape ps;
+        ps.name = name;
+        ps.params = params;
+        transformCache.Lookup(curTransform[0], &ps.ObjToWorld,
+                              &ps.WorldToObj);
+        ps.reverseOrientation = graphicsState.reverseOrientation;
+        for (const char *tex : {"alpha", "shadowalpha", "displacement"}) {
+            auto iter =
+                graphicsState.floatTextures.find(params.FindTexture(tex));
+            if (iter != graphicsState.floatTextures.end())
+                ps.floatTextures.insert(*iter);
+        }
+        ps.material = graphicsState.CreateMaterial(params);
+        ps.mediumInterface = graphicsState.CreateMediumInterface();
+        ps.compact = params.FindOneBool("compact", PbrtOptions.compactMeshes);
+        ps.areaLight = graphicsState.areaLight;
+        ps.areaLightParams = graphicsState.areaLightParams;
+        ps.lightToWorld = curTransform[0];
+        ps.file = current_file ? current_file : "";
+        ps.line = line_num;
+        ps.instance = renderOptions->currentInstance;
+        renderOptions->pendingShapeBytes += params.ValueBytes();
+        renderOptions->pendingShapes.push_back(std::move(ps));
+        if (int(renderOptions->pendingShapes.size()) >= MaxPendingShapes ||
+            renderOptions->pendingShapeBytes >= MaxPendingShapeBytes)
+            LoadPendingShapes();
+        return;
+    }
+
     if (!curTransform.IsAnimated()) {
         // Initialize _prims_ and _areaLights_ for static shape
 
         // Create shapes for shape _name_
         Transform *ObjToWorld, *WorldToObj;
         transformCache.Lookup(curTransform[0], &ObjToWorld, &WorldToObj);
+        std::shared_ptr<TriangleMesh> mesh;
+        bool compress =
+            params.FindOneBool("compact", PbrtOptions.compactMeshes) &&
+            graphicsState.areaLight == "";
         std::vector<std::shared_ptr<Shape>> shapes =
             MakeShapes(name, ObjToWorld, WorldToObj,
-                       graphicsState.reverseOrientation, params);
-        if (shapes.empty()) return;
+                       graphicsState.reverseOrientation, params,
+                       &graphicsState.floatTextures, nullptr,
+                       compress ? &mesh : nullptr);
+        if (shapes.empty() && !mesh) return;
         std::shared_ptr<Material> mtl = graphicsState.CreateMaterial(params);
         params.ReportUnused();
         MediumInterface mi = graphicsState.CreateMediumInterface();
-        for (auto s : shapes) {
-            // Possibly create area light for shape
-            std::shared_ptr<AreaLight> area;
-            if (graphicsState.areaLight != "") {
-                area = MakeAreaLight(graphicsState.areaLight, curTransform[0],
-                                     mi, graphicsState.areaLightParams, s);
-                if (area) areaLights.push_back(area);
-            }
-            prims.push_back(
-                std::make_shared<GeometricPrimitive>(s, mtl, area, mi));
-        }
+        MakeStaticPrimitives(
+            shapes, mesh,
+            graphicsState.reverseOrientation ^ ObjToWorld->SwapsHandedness(),
+            mtl, mi, graphicsState.areaLight, graphicsState.areaLightParams,
+            curTransform[0], &prims, &areaLights);
     } else {
         // Initialize _prims_ and _areaLights_ for animated shape
 
@@ -1244,8 +1586,10 @@ void pbrtShape(const std::string &name, const ParamSet &params) {
                 "animated shape");
         Transform *identity;
         transformCache.Lookup(Transform(), &identity, nullptr);
-        std::vector<std::shared_ptr<Shape>> shapes = MakeShapes(
-            name, identity, identity, graphicsState.reverseOrientation, params);
+        std::vector<std::shared_ptr<Shape>> shapes =
+            MakeShapes(name, identity, identity,
+                       graphicsState.reverseOrientation, params,
+                       &graphicsState.floatTextures);
         if (shapes.empty()) return;
 
         // Create _GeometricPrimitive_(s) for animated shape
@@ -1276,18 +1620,7 @@ void pbrtShape(const std::string &name, const ParamSet &params) {
             prims[0], animatedObjectToWorld);
     }
     // Add _prims_ and _areaLights_ to scene or current instance
-    if (renderOptions->currentInstance) {
-        if (areaLights.size())
-            Warning("Area lights not supported with object instancing");
-        renderOptions->currentInstance->insert(
-            renderOptions->currentInstance->end(), prims.begin(), prims.end());
-    } else {
-        renderOptions->primitives.insert(renderOptions->primitives.end(),
-                                         prims.begin(), prims.end());
-        if (areaLights.size())
-            renderOptions->lights.insert(renderOptions->lights.end(),
-                                         areaLights.begin(), areaLights.end());
-    }
+    AddPrimitives(renderOptions->currentInstance, prims, areaLights);
 }
 
 std::shared_ptr<Material> GraphicsState::CreateMaterial(
@@ -1332,18 +1665,89 @@ MediumInterface GraphicsState::CreateMediumInterface() {
 }
 
 void pbrtReverseOrientation() {
+    WRITE_BINARY(ReverseOrientation());
     VERIFY_WORLD("ReverseOrientation");
     graphicsState.reverseOrientation = !graphicsState.reverseOrientation;
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sReverseOrientation\n", catIndentCount, "");
 }
 
+// Returns an aggregate of _instances_, skipping those of empty instance
+// definitions, or nullptr if there are none.
+static std::shared_ptr<Primitive> MakeInstanceAggregate(
+    std::vector<InstanceBVHAccel::Instance> instances) {
+    const std::vector<std::shared_ptr<Primitive>> &prototypes =
+        renderOptions->instancePrototypes;
+    instances.erase(
+        std::remove_if(instances.begin(), instances.end(),
+                       [&](const InstanceBVHAccel::Instance &in) {
+                           return !prototypes[in.prototype];
+                       }),
+        instances.end());
+    if (instances.empty()) return nullptr;
+    return std::make_shared<InstanceBVHAccel>(prototypes,
+                                              std::move(instances));
+}
+
+// Creates the aggregate for the primitives and nested instances of _in_,
+// storing it in the prototype slot reserved for it
+static void BuildPrototype(InstanceDefinition &in) {
+    std::vector<std::shared_ptr<Primitive>> prims;
+    prims.swap(in.primitives);
+    if (!in.instances.empty()) {
+        std::shared_ptr<Primitive> instances =
+            MakeInstanceAggregate(std::move(in.instances));
+        in.instances.clear();
+        if (instances) prims.push_back(instances);
+    }
+    if (prims.empty()) return;
+    std::shared_ptr<Primitive> accel;
+    if (prims.size() > 1) {
+        accel = MakeAccelerator(renderOptions->AcceleratorName, prims,
+                                renderOptions->AcceleratorParams);
+        if (!accel) accel = std::make_shared<BVHAccel>(prims);
+    } else
+        accel = prims[0];
+    renderOptions->instancePrototypes[in.prototype] = accel;
+}
+
+// Creates all pending shapes and then the prototypes of the instance
+// definitions in _RenderOptions::pendingPrototypes_, in parallel. A
+// definition's prototype is reserved after those of the instances used
+// inside of it, so the prototypes are built in waves where each one only
+// uses prototypes from earlier waves. The accelerators built for them run
+// nested parallel loops.
+static void BuildPendingPrototypes() {
+    LoadPendingShapes();
+    std::vector<InstanceDefinition *> pending;
+    std::swap(pending, renderOptions->pendingPrototypes);
+    if (pending.empty()) return;
+    std::vector<int> prototypeWave(renderOptions->instancePrototypes.size(),
+                                   -1);
+    std::vector<std::vector<InstanceDefinition *>> waves;
+    for (InstanceDefinition *in : pending) {
+        int wave = 0;
+        for (const InstanceBVHAccel::Instance &inst : in->instances)
+            wave = std::max(wave, prototypeWave[inst.prototype] + 1);
+        prototypeWave[in->prototype] = wave;
+        if (wave == (int)waves.size()) waves.push_back({});
+        waves[wave].push_back(in);
+    }
+    for (const std::vector<InstanceDefinition *> &wave : waves)
+        ParallelFor([&](int64_t i) { BuildPrototype(*wave[i]); },
+                    wave.size());
+}
+
 void pbrtObjectBegin(const std::string &name) {
+    WRITE_BINARY(ObjectBegin(name));
     VERIFY_WORLD("ObjectBegin");
     pbrtAttributeBegin();
     if (renderOptions->currentInstance)
         Error("ObjectBegin called inside of instance definition");
-    renderOptions->instances[name] = std::vector<std::shared_ptr<Primitive>>();
+    // Finish pending work that refers to a definition that's being replaced
+    if (renderOptions->instances.find(name) != renderOptions->instances.end())
+        BuildPendingPrototypes();
+    renderOptions->instances[name] = InstanceDefinition();
     renderOptions->currentInstance = &renderOptions->instances[name];
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sObjectBegin \"%s\"\n", catIndentCount, "", name.c_str());
@@ -1352,6 +1756,7 @@ void pbrtObjectBegin(const std::string &name) {
 STAT_COUNTER("Scene/Object instances created", nObjectInstancesCreated);
 
 void pbrtObjectEnd() {
+    WRITE_BINARY(ObjectEnd());
     VERIFY_WORLD("ObjectEnd");
     if (!renderOptions->currentInstance)
         Error("ObjectEnd called outside of instance definition");
@@ -1365,31 +1770,50 @@ void pbrtObjectEnd() {
 STAT_COUNTER("Scene/Object instances used", nObjectInstancesUsed);
 
 void pbrtObjectInstance(const std::string &name) {
+    WRITE_BINARY(ObjectInstance(name));
     VERIFY_WORLD("ObjectInstance");
     // Perform object instance error checking
     if (PbrtOptions.cat || PbrtOptions.toPly)
         printf("%*sObjectInstance \"%s\"\n", catIndentCount, "", name.c_str());
-    if (renderOptions->currentInstance) {
-        Error("ObjectInstance can't be called inside instance definition");
+    auto iter = renderOptions->instances.find(name);
+    if (iter == renderOptions->instances.end()) {
+        Error("Unable to find instance named \"%s\"", name.c_str());
         return;
     }
-    if (renderOptions->instances.find(name) == renderOptions->instances.end()) {
-        Error("Unable to find instance named \"%s\"", name.c_str());
+    InstanceDefinition &in = iter->second;
+    if (&in == renderOptions->currentInstance) {
+        Error("ObjectInstance \"%s\" used inside its own definition",
+              name.c_str());
         return;
     }
-    std::vector<std::shared_ptr<Primitive>> &in =
-        renderOptions->instances[name];
-    if (in.empty()) return;
+    if (in.prototype == -1) {
+        // Reserve the definition's prototype; its aggregate is built along
+        // with those of other definitions by _BuildPendingPrototypes()_
+        in.prototype = renderOptions->instancePrototypes.size();
+        renderOptions->instancePrototypes.push_back(nullptr);
+        renderOptions->pendingPrototypes.push_back(&in);
+    }
     ++nObjectInstancesUsed;
-    if (in.size() > 1) {
-        // Create aggregate for instance _Primitive_s
-        std::shared_ptr<Primitive> accel(
-            MakeAccelerator(renderOptions->AcceleratorName, in,
-                            renderOptions->AcceleratorParams));
-        if (!accel) accel = std::make_shared<BVHAccel>(in);
-        in.erase(in.begin(), in.end());
-        in.push_back(accel);
+
+    // Add the instance to the current instance definition or the scene
+    std::vector<InstanceBVHAccel::Instance> &instances =
+        renderOptions->currentInstance
+            ? renderOptions->currentInstance->instances
+            : renderOptions->worldInstances;
+    if (!curTransform.IsAnimated() &&
+        CompactTransform::IsAffine(curTransform[0].GetMatrix())) {
+        // Static instances are stored compactly in an _InstanceBVHAccel_,
+        // bypassing the transform cache
+        instances.push_back(
+            {CompactTransform(curTransform[0].GetMatrix()), in.prototype});
+        return;
     }
+
+    // Other instances refer to the prototype's aggregate directly
+    BuildPendingPrototypes();
+    std::shared_ptr<Primitive> prototype =
+        renderOptions->instancePrototypes[in.prototype];
+    if (!prototype) return;
     static_assert(MaxTransforms == 2,
                   "TransformCache assumes only two transforms");
     // Create _animatedInstanceToWorld_ transform for instance
@@ -1400,11 +1824,13 @@ void pbrtObjectInstance(const std::string &name) {
         InstanceToWorld[0], renderOptions->transformStartTime,
         InstanceToWorld[1], renderOptions->transformEndTime);
     std::shared_ptr<Primitive> prim(
-        std::make_shared<TransformedPrimitive>(in[0], animatedInstanceToWorld));
-    renderOptions->primitives.push_back(prim);
+        std::make_shared<TransformedPrimitive>(prototype,
+                                               animatedInstanceToWorld));
+    AppendPrimitives(renderOptions->currentInstance, {prim}, {});
 }
 
 void pbrtWorldEnd() {
+    WRITE_BINARY(WorldEnd());
     VERIFY_WORLD("WorldEnd");
     // Ensure there are no pushed graphics states
     while (pushedGraphicsStates.size()) {
@@ -1421,6 +1847,9 @@ void pbrtWorldEnd() {
     if (PbrtOptions.cat || PbrtOptions.toPly) {
         printf("%*sWorldEnd\n", catIndentCount, "");
     } else {
+        // Finish building image textures before they're used
+        WaitForAsyncTasks();
+        BuildPendingPrototypes();
         std::unique_ptr<Integrator> integrator(renderOptions->MakeIntegrator());
         std::unique_ptr<Scene> scene(renderOptions->MakeScene());
 
@@ -1462,6 +1891,12 @@ void pbrtWorldEnd() {
 }
 
 Scene *RenderOptions::MakeScene() {
+    if (!worldInstances.empty()) {
+        std::shared_ptr<Primitive> instances =
+            MakeInstanceAggregate(std::move(worldInstances));
+        worldInstances.clear();
+        if (instances) primitives.push_back(instances);
+    }
     std::shared_ptr<Primitive> accelerator =
         MakeAccelerator(AcceleratorName, primitives, AcceleratorParams);
     if (!accelerator) accelerator = std::make_shared<BVHAccel>(primitives);
@@ -1486,7 +1921,7 @@ Integrator *RenderOptions::MakeIntegrator() const {
         return nullptr;
     }
 
-    std::shared_ptr<ExtractorManager> extractor = MakeExtractorManager(extractors, *camera->film);
+    std::shared_ptr<ExtractorManager> extractor = MakeExtractorManager(extractors, camera->film);
     if (!extractor) {
       Error("Unable to create extractor");
       return nullptr;
@@ -0,0 +1,650 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+
+// core/binaryscene.cpp*
+#include "binaryscene.h"
+#include "api.h"
+#include "paramset.h"
+#include "spectrum.h"
+#include <limits>
+
+namespace pbrt {
+
+// Binary Scene Local Definitions
+static const char binarySceneMagic[8] = {'P', 'B', 'R', 'T', 'B', 'I', 'N', 0};
+static const uint32_t binarySceneVersion = 1;
+static const uint32_t binarySceneByteOrder = 0x01020304;
+static const size_t binarySceneHeaderSize = 16;
+
+// Types of parameters in binary scene files
+enum BinaryParamType : uint32_t {
+    BINARY_PARAM_BOOL, BINARY_PARAM_INT, BINARY_PARAM_FLOAT,
+    BINARY_PARAM_POINT2, BINARY_PARAM_VECTOR2, BINARY_PARAM_POINT3,
+    BINARY_PARAM_VECTOR3, BINARY_PARAM_NORMAL, BINARY_PARAM_RGB,
+    BINARY_PARAM_STRING, BINARY_PARAM_TEXTURE
+};
+
+// BinarySceneWriter Method Definitions
+BinarySceneWriter::BinarySceneWriter(const std::string &filename) {
+    f = fopen(filename.c_str(), "wb");
+    if (!f) return;
+    Write(binarySceneMagic, sizeof(binarySceneMagic));
+    WriteU32(binarySceneVersion);
+    WriteU32(binarySceneByteOrder);
+}
+
+BinarySceneWriter::~BinarySceneWriter() {
+    if (f) fclose(f);
+}
+
+void BinarySceneWriter::Write(const void *data, size_t size) {
+    if (!f || failed) return;
+    // Pad all fields to a multiple of four bytes
+    static const char zeros[4] = {0, 0, 0, 0};
+    size_t padding = (4 - size % 4) % 4;
+    if (fwrite(data, 1, size, f) != size ||
+        fwrite(zeros, 1, padding, f) != padding)
+        failed = true;
+}
+
+void BinarySceneWriter::WriteFloats(const Float *v, size_t n) {
+    if (sizeof(Float) == sizeof(float)) {
+        Write(v, n * sizeof(float));
+        return;
+    }
+    std::vector<float> fv(v, v + n);
+    Write(fv.data(), n * sizeof(float));
+}
+
+void BinarySceneWriter::WriteString(const std::string &s) {
+    WriteU32(s.size());
+    Write(s.data(), s.size());
+}
+
+void BinarySceneWriter::WriteValues(const bool *v, int n) {
+    std::vector<uint32_t> values(v, v + n);
+    Write(values.data(), n * sizeof(uint32_t));
+}
+
+void BinarySceneWriter::WriteValues(const int *v, int n) {
+    Write(v, n * sizeof(int));
+}
+
+void BinarySceneWriter::WriteValues(const Float *v, int n) {
+    WriteFloats(v, n);
+}
+
+void BinarySceneWriter::WriteValues(const Spectrum *v, int n) {
+    // Spectra are stored as RGB, as with --cat
+    std::vector<Float> rgb(3 * n);
+    for (int i = 0; i < n; ++i) v[i].ToRGB(&rgb[3 * i]);
+    WriteFloats(rgb.data(), rgb.size());
+}
+
+void BinarySceneWriter::WriteValues(const std::string *v, int n) {
+    for (int i = 0; i < n; ++i) WriteString(v[i]);
+}
+
+template <typename T>
+void BinarySceneWriter::WriteItem(uint32_t type, const ParamSetItemBase *item) {
+    const ParamSetItem<T> *typed = static_cast<const ParamSetItem<T> *>(item);
+    WriteU32(type);
+    WriteString(typed->name);
+    WriteU32(typed->nValues);
+    WriteValues(typed->values.get(), typed->nValues);
+}
+
+void BinarySceneWriter::WriteParams(const ParamSet &ps) {
+    typedef ParamSet::ParamType ParamType;
+    WriteU32(ps.params.size());
+    for (const ParamSet::Param &p : ps.params) {
+        const ParamSetItemBase *item = p.item.get();
+        switch (p.type) {
+        case ParamType::Int:
+            WriteItem<int>(BINARY_PARAM_INT, item);
+            break;
+        case ParamType::Bool:
+            WriteItem<bool>(BINARY_PARAM_BOOL, item);
+            break;
+        case ParamType::Float:
+            WriteItem<Float>(BINARY_PARAM_FLOAT, item);
+            break;
+        case ParamType::Point2f:
+            WriteItem<Point2f>(BINARY_PARAM_POINT2, item);
+            break;
+        case ParamType::Vector2f:
+            WriteItem<Vector2f>(BINARY_PARAM_VECTOR2, item);
+            break;
+        case ParamType::Point3f:
+            WriteItem<Point3f>(BINARY_PARAM_POINT3, item);
+            break;
+        case ParamType::Vector3f:
+            WriteItem<Vector3f>(BINARY_PARAM_VECTOR3, item);
+            break;
+        case ParamType::Normal3f:
+            WriteItem<Normal3f>(BINARY_PARAM_NORMAL, item);
+            break;
+        case ParamType::String:
+            WriteItem<std::string>(BINARY_PARAM_STRING, item);
+            break;
+        case ParamType::Texture:
+            WriteItem<std::string>(BINARY_PARAM_TEXTURE, item);
+            break;
+        case ParamType::Spectrum:
+            WriteItem<Spectrum>(BINARY_PARAM_RGB, item);
+            break;
+        }
+    }
+}
+
+void BinarySceneWriter::Identity() { WriteOp(BinarySceneOp::Identity); }
+
+void BinarySceneWriter::Translate(Float dx, Float dy, Float dz) {
+    Float v[3] = {dx, dy, dz};
+    WriteOp(BinarySceneOp::Translate);
+    WriteFloats(v, 3);
+}
+
+void BinarySceneWriter::Rotate(Float angle, Float ax, Float ay, Float az) {
+    Float v[4] = {angle, ax, ay, az};
+    WriteOp(BinarySceneOp::Rotate);
+    WriteFloats(v, 4);
+}
+
+void BinarySceneWriter::Scale(Float sx, Float sy, Float sz) {
+    Float v[3] = {sx, sy, sz};
+    WriteOp(BinarySceneOp::Scale);
+    WriteFloats(v, 3);
+}
+
+void BinarySceneWriter::LookAt(Float ex, Float ey, Float ez, Float lx,
+                               Float ly, Float lz, Float ux, Float uy,
+                               Float uz) {
+    Float v[9] = {ex, ey, ez, lx, ly, lz, ux, uy, uz};
+    WriteOp(BinarySceneOp::LookAt);
+    WriteFloats(v, 9);
+}
+
+void BinarySceneWriter::ConcatTransform(const Float transform[16]) {
+    WriteOp(BinarySceneOp::ConcatTransform);
+    WriteFloats(transform, 16);
+}
+
+void BinarySceneWriter::Transform(const Float transform[16]) {
+    WriteOp(BinarySceneOp::Transform);
+    WriteFloats(transform, 16);
+}
+
+void BinarySceneWriter::CoordinateSystem(const std::string &name) {
+    WriteOp(BinarySceneOp::CoordinateSystem);
+    WriteString(name);
+}
+
+void BinarySceneWriter::CoordSysTransform(const std::string &name) {
+    WriteOp(BinarySceneOp::CoordSysTransform);
+    WriteString(name);
+}
+
+void BinarySceneWriter::ActiveTransformAll() {
+    WriteOp(BinarySceneOp::ActiveTransformAll);
+}
+
+void BinarySceneWriter::ActiveTransformEndTime() {
+    WriteOp(BinarySceneOp::ActiveTransformEndTime);
+}
+
+void BinarySceneWriter::ActiveTransformStartTime() {
+    WriteOp(BinarySceneOp::ActiveTransformStartTime);
+}
+
+void BinarySceneWriter::TransformTimes(Float start, Float end) {
+    Float v[2] = {start, end};
+    WriteOp(BinarySceneOp::TransformTimes);
+    WriteFloats(v, 2);
+}
+
+void BinarySceneWriter::PixelFilter(const std::string &name,
+                                    const ParamSet &params) {
+    WriteStatement(BinarySceneOp::PixelFilter, name, params);
+}
+
+void BinarySceneWriter::Film(const std::string &type,
+                             const ParamSet &params) {
+    WriteStatement(BinarySceneOp::Film, type, params);
+}
+
+void BinarySceneWriter::Sampler(const std::string &name,
+                                const ParamSet &params) {
+    WriteStatement(BinarySceneOp::Sampler, name, params);
+}
+
+void BinarySceneWriter::Extractor(const std::string &name,
+                                  const ParamSet &params) {
+    WriteStatement(BinarySceneOp::Extractor, name, params);
+}
+
+void BinarySceneWriter::Accelerator(const std::string &name,
+                                    const ParamSet &params) {
+    WriteStatement(BinarySceneOp::Accelerator, name, params);
+}
+
+void BinarySceneWriter::Integrator(const std::string &name,
+                                   const ParamSet &params) {
+    WriteStatement(BinarySceneOp::Integrator, name, params);
+}
+
+void BinarySceneWriter::Camera(const std::string &name,
+                               const ParamSet &params) {
+    WriteStatement(BinarySceneOp::Camera, name, params);
+}
+
+void BinarySceneWriter::MakeNamedMedium(const std::string &name,
+                                        const ParamSet &params) {
+    WriteStatement(BinarySceneOp::MakeNamedMedium, name, params);
+}
+
+void BinarySceneWriter::MediumInterface(const std::string &insideName,
+                                        const std::string &outsideName) {
+    WriteOp(BinarySceneOp::MediumInterface);
+    WriteString(insideName);
+    WriteString(outsideName);
+}
+
+void BinarySceneWriter::WorldBegin() { WriteOp(BinarySceneOp::WorldBegin); }
+
+void BinarySceneWriter::AttributeBegin() {
+    WriteOp(BinarySceneOp::AttributeBegin);
+}
+
+void BinarySceneWriter::AttributeEnd() {
+    WriteOp(BinarySceneOp::AttributeEnd);
+}
+
+void BinarySceneWriter::TransformBegin() {
+    WriteOp(BinarySceneOp::TransformBegin);
+}
+
+void BinarySceneWriter::TransformEnd() {
+    WriteOp(BinarySceneOp::TransformEnd);
+}
+
+void BinarySceneWriter::Texture(const std::string &name,
+                                const std::string &type,
+                                const std::string &texname,
+                                const ParamSet &params) {
+    WriteOp(BinarySceneOp::Texture);
+    WriteString(name);
+    WriteString(type);
+    WriteString(texname);
+    WriteParams(params);
+}
+
+void BinarySceneWriter::Material(const std::string &name,
+                                 const ParamSet &params) {
+    WriteStatement(BinarySceneOp::Material, name, params);
+}
+
+void BinarySceneWriter::MakeNamedMaterial(const std::string &name,
+                                          const ParamSet &params) {
+    WriteStatement(BinarySceneOp::MakeNamedMaterial, name, params);
+}
+
+void BinarySceneWriter::NamedMaterial(const std::string &name) {
+    WriteOp(BinarySceneOp::NamedMaterial);
+    WriteString(name);
+}
+
+void BinarySceneWriter::LightSource(const std::string &name,
+                                    const ParamSet &params) {
+    WriteStatement(BinarySceneOp::LightSource, name, params);
+}
+
+void BinarySceneWriter::AreaLightSource(const std::string &name,
+                                        const ParamSet &params) {
+    WriteStatement(BinarySceneOp::AreaLightSource, name, params);
+}
+
+void BinarySceneWriter::Shape(const std::string &name,
+                              const ParamSet &params) {
+    WriteStatement(BinarySceneOp::Shape, name, params);
+}
+
+void BinarySceneWriter::ReverseOrientation() {
+    WriteOp(BinarySceneOp::ReverseOrientation);
+}
+
+void BinarySceneWriter::ObjectBegin(const std::string &name) {
+    WriteOp(BinarySceneOp::ObjectBegin);
+    WriteString(name);
+}
+
+void BinarySceneWriter::ObjectEnd() { WriteOp(BinarySceneOp::ObjectEnd); }
+
+void BinarySceneWriter::ObjectInstance(const std::string &name) {
+    WriteOp(BinarySceneOp::ObjectInstance);
+    WriteString(name);
+}
+
+void BinarySceneWriter::WorldEnd() { WriteOp(BinarySceneOp::WorldEnd); }
+
+// BinarySceneReader reads the fields of a binary scene file, noting when
+// they run past its end.
+class BinarySceneReader {
+  public:
+    // BinarySceneReader Public Methods
+    BinarySceneReader(const char *ptr, const char *end)
+        : ptr(ptr), end(end) {}
+    bool AtEnd() const { return ptr == end; }
+    bool Failed() const { return failed; }
+    // Returns the next _size_ bytes of the file and skips over their
+    // padding, or returns nullptr if the file is too short.
+    const char *Read(size_t size) {
+        size_t padded = size + (4 - size % 4) % 4;
+        if (failed || padded < size || size_t(end - ptr) < padded) {
+            failed = true;
+            return nullptr;
+        }
+        const char *p = ptr;
+        ptr += padded;
+        return p;
+    }
+    uint32_t U32() {
+        uint32_t v = 0;
+        const char *p = Read(sizeof(v));
+        if (p) memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    std::string String() {
+        uint32_t size = U32();
+        const char *p = Read(size);
+        return p ? std::string(p, size) : std::string();
+    }
+    void Floats(Float *v, size_t n) {
+        const char *p = Read(n * sizeof(float));
+        if (!p) return;
+        if (sizeof(Float) == sizeof(float))
+            memcpy(v, p, n * sizeof(float));
+        else
+            for (size_t i = 0; i < n; ++i) {
+                float f;
+                memcpy(&f, p + i * sizeof(float), sizeof(float));
+                v[i] = f;
+            }
+    }
+    // Reads an array of _n_ values of type _T_, each made of _N_ _Float_s.
+    template <typename T, int N>
+    std::unique_ptr<T[]> FloatArray(size_t n) {
+        static_assert(sizeof(T) == N * sizeof(Float), "Unexpected padding");
+        std::unique_ptr<T[]> values(new T[n]);
+        Floats(reinterpret_cast<Float *>(values.get()), n * N);
+        return values;
+    }
+    void Params(ParamSet *ps);
+
+  private:
+    // BinarySceneReader Private Data
+    const char *ptr, *end;
+    bool failed = false;
+};
+
+void BinarySceneReader::Params(ParamSet *ps) {
+    uint32_t nParams = U32();
+    for (uint32_t i = 0; i < nParams && !failed; ++i) {
+        uint32_t type = U32();
+        std::string name = String();
+        uint32_t n = U32();
+        // Make sure that the values are in the file before allocating
+        // memory for them and that their count fits in an _int_
+        size_t nValues = type == BINARY_PARAM_RGB ? 3 * size_t(n) : n;
+        if (failed || size_t(end - ptr) / 4 < nValues ||
+            nValues > size_t(std::numeric_limits<int>::max())) {
+            failed = true;
+            return;
+        }
+        switch (type) {
+        case BINARY_PARAM_BOOL: {
+            std::unique_ptr<bool[]> values(new bool[n]);
+            for (uint32_t j = 0; j < n; ++j) values[j] = U32() != 0;
+            ps->AddBool(name, std::move(values), n);
+            break;
+        }
+        case BINARY_PARAM_INT: {
+            std::unique_ptr<int[]> values(new int[n]);
+            const char *p = Read(n * sizeof(int));
+            if (p) memcpy(values.get(), p, n * sizeof(int));
+            ps->AddInt(name, std::move(values), n);
+            break;
+        }
+        case BINARY_PARAM_FLOAT:
+            ps->AddFloat(name, FloatArray<Float, 1>(n), n);
+            break;
+        case BINARY_PARAM_POINT2:
+            ps->AddPoint2f(name, FloatArray<Point2f, 2>(n), n);
+            break;
+        case BINARY_PARAM_VECTOR2:
+            ps->AddVector2f(name, FloatArray<Vector2f, 2>(n), n);
+            break;
+        case BINARY_PARAM_POINT3:
+            ps->AddPoint3f(name, FloatArray<Point3f, 3>(n), n);
+            break;
+        case BINARY_PARAM_VECTOR3:
+            ps->AddVector3f(name, FloatArray<Vector3f, 3>(n), n);
+            break;
+        case BINARY_PARAM_NORMAL:
+            ps->AddNormal3f(name, FloatArray<Normal3f, 3>(n), n);
+            break;
+        case BINARY_PARAM_RGB:
+            ps->AddRGBSpectrum(name, FloatArray<Float, 1>(nValues), nValues);
+            break;
+        case BINARY_PARAM_STRING: {
+            std::unique_ptr<std::string[]> values(new std::string[n]);
+            for (uint32_t j = 0; j < n; ++j) values[j] = String();
+            ps->AddString(name, std::move(values), n);
+            break;
+        }
+        case BINARY_PARAM_TEXTURE:
+            if (n != 1) {
+                failed = true;
+                break;
+            }
+            ps->AddTexture(name, String());
+            break;
+        default:
+            failed = true;
+        }
+    }
+}
+
+// Binary Scene Function Definitions
+bool IsBinaryScene(const char *data, size_t size) {
+    return size >= binarySceneHeaderSize &&
+           memcmp(data, binarySceneMagic, sizeof(binarySceneMagic)) == 0;
+}
+
+bool ParseBinaryScene(const std::string &filename, const char *data,
+                      size_t size) {
+    extern PBRT_THREAD_LOCAL int line_num;
+    if (!IsBinaryScene(data, size)) return false;
+    BinarySceneReader header(data + sizeof(binarySceneMagic),
+                             data + binarySceneHeaderSize);
+    uint32_t version = header.U32();
+    if (header.U32() != binarySceneByteOrder) {
+        Error("Binary scene file \"%s\" was written with a different byte "
+              "order.", filename.c_str());
+        return false;
+    }
+    if (version != binarySceneVersion) {
+        Error("Binary scene file \"%s\" has unsupported version %d.",
+              filename.c_str(), int(version));
+        return false;
+    }
+
+    // Run the file's statements; errors report the number of the
+    // statement in place of a line number
+    BinarySceneReader r(data + binarySceneHeaderSize, data + size);
+    using ParamsFunc = void (*)(const std::string &, const ParamSet &);
+    for (line_num = 1; !r.AtEnd(); ++line_num) {
+        BinarySceneOp op = BinarySceneOp(r.U32());
+        if (r.Failed()) break;
+        ParamsFunc paramsFunc = nullptr;
+        switch (op) {
+        case BinarySceneOp::PixelFilter: paramsFunc = pbrtPixelFilter; break;
+        case BinarySceneOp::Film: paramsFunc = pbrtFilm; break;
+        case BinarySceneOp::Sampler: paramsFunc = pbrtSampler; break;
+        case BinarySceneOp::Extractor: paramsFunc = pbrtExtractor; break;
+        case BinarySceneOp::Accelerator: paramsFunc = pbrtAccelerator; break;
+        case BinarySceneOp::Integrator: paramsFunc = pbrtIntegrator; break;
+        case BinarySceneOp::Camera: paramsFunc = pbrtCamera; break;
+        case BinarySceneOp::MakeNamedMedium:
+            paramsFunc = pbrtMakeNamedMedium;
+            break;
+        case BinarySceneOp::Material: paramsFunc = pbrtMaterial; break;
+        case BinarySceneOp::MakeNamedMaterial:
+            paramsFunc = pbrtMakeNamedMaterial;
+            break;
+        case BinarySceneOp::LightSource: paramsFunc = pbrtLightSource; break;
+        case BinarySceneOp::AreaLightSource:
+            paramsFunc = pbrtAreaLightSource;
+            break;
+        case BinarySceneOp::Shape: paramsFunc = pbrtShape; break;
+        default: break;
+        }
+        if (paramsFunc) {
+            std::string name = r.String();
+            ParamSet params;
+            r.Params(&params);
+            if (r.Failed()) break;
+            paramsFunc(name, params);
+            continue;
+        }
+
+        Float v[16];
+        std::string s[3];
+        switch (op) {
+        case BinarySceneOp::Identity: pbrtIdentity(); break;
+        case BinarySceneOp::Translate:
+            r.Floats(v, 3);
+            if (!r.Failed()) pbrtTranslate(v[0], v[1], v[2]);
+            break;
+        case BinarySceneOp::Rotate:
+            r.Floats(v, 4);
+            if (!r.Failed()) pbrtRotate(v[0], v[1], v[2], v[3]);
+            break;
+        case BinarySceneOp::Scale:
+            r.Floats(v, 3);
+            if (!r.Failed()) pbrtScale(v[0], v[1], v[2]);
+            break;
+        case BinarySceneOp::LookAt:
+            r.Floats(v, 9);
+            if (!r.Failed())
+                pbrtLookAt(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+                           v[8]);
+            break;
+        case BinarySceneOp::ConcatTransform:
+            r.Floats(v, 16);
+            if (!r.Failed()) pbrtConcatTransform(v);
+            break;
+        case BinarySceneOp::Transform:
+            r.Floats(v, 16);
+            if (!r.Failed()) pbrtTransform(v);
+            break;
+        case BinarySceneOp::CoordinateSystem:
+            s[0] = r.String();
+            if (!r.Failed()) pbrtCoordinateSystem(s[0]);
+            break;
+        case BinarySceneOp::CoordSysTransform:
+            s[0] = r.String();
+            if (!r.Failed()) pbrtCoordSysTransform(s[0]);
+            break;
+        case BinarySceneOp::ActiveTransformAll:
+            pbrtActiveTransformAll();
+            break;
+        case BinarySceneOp::ActiveTransformEndTime:
+            pbrtActiveTransformEndTime();
+            break;
+        case BinarySceneOp::ActiveTransformStartTime:
+            pbrtActiveTransformStartTime();
+            break;
+        case BinarySceneOp::TransformTimes:
+            r.Floats(v, 2);
+            if (!r.Failed()) pbrtTransformTimes(v[0], v[1]);
+            break;
+        case BinarySceneOp::MediumInterface:
+            s[0] = r.String();
+            s[1] = r.String();
+            if (!r.Failed()) pbrtMediumInterface(s[0], s[1]);
+            break;
+        case BinarySceneOp::WorldBegin: pbrtWorldBegin(); break;
+        case BinarySceneOp::AttributeBegin: pbrtAttributeBegin(); break;
+        case BinarySceneOp::AttributeEnd: pbrtAttributeEnd(); break;
+        case BinarySceneOp::TransformBegin: pbrtTransformBegin(); break;
+        case BinarySceneOp::TransformEnd: pbrtTransformEnd(); break;
+        case BinarySceneOp::Texture: {
+            for (int i = 0; i < 3; ++i) s[i] = r.String();
+            ParamSet params;
+            r.Params(&params);
+            if (!r.Failed()) pbrtTexture(s[0], s[1], s[2], params);
+            break;
+        }
+        case BinarySceneOp::NamedMaterial:
+            s[0] = r.String();
+            if (!r.Failed()) pbrtNamedMaterial(s[0]);
+            break;
+        case BinarySceneOp::ReverseOrientation:
+            pbrtReverseOrientation();
+            break;
+        case BinarySceneOp::ObjectBegin:
+            s[0] = r.String();
+            if (!r.Failed()) pbrtObjectBegin(s[0]);
+            break;
+        case BinarySceneOp::ObjectEnd: pbrtObjectEnd(); break;
+        case BinarySceneOp::ObjectInstance:
+            s[0] = r.String();
+            if (!r.Failed()) pbrtObjectInstance(s[0]);
+            break;
+        case BinarySceneOp::WorldEnd: pbrtWorldEnd(); break;
+        default:
+            Error("Unknown statement type %d in binary scene file.", int(op));
+            return false;
+        }
+        if (r.Failed()) break;
+    }
+    if (r.Failed()) {
+        Error("Binary scene file \"%s\" is truncated.", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace pbrt
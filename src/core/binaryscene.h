@@ -0,0 +1,166 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_CORE_BINARYSCENE_H
+#define PBRT_CORE_BINARYSCENE_H
+
+// core/binaryscene.h*
+#include "pbrt.h"
+#include <stdio.h>
+#include <vector>
+
+namespace pbrt {
+
+// Binary scene files hold a sequence of statements that mirror the calls of
+// the pbrt API. After a 16-byte header, each statement is a 32-bit
+// _BinarySceneOp_ followed by the call's arguments: _Float_s are stored as
+// 32-bit floats, strings as a 32-bit length followed by the characters, and
+// parameter lists as a 32-bit count followed by typed, length-prefixed
+// arrays. Values are stored in the byte order of the machine that wrote the
+// file, which is recorded in the header, and every field starts at a
+// multiple of four bytes so that arrays can be copied directly out of a
+// memory-mapped file.
+enum class BinarySceneOp : uint32_t {
+    Identity, Translate, Rotate, Scale, LookAt, ConcatTransform, Transform,
+    CoordinateSystem, CoordSysTransform, ActiveTransformAll,
+    ActiveTransformEndTime, ActiveTransformStartTime, TransformTimes,
+    PixelFilter, Film, Sampler, Extractor, Accelerator, Integrator, Camera,
+    MakeNamedMedium, MediumInterface, WorldBegin, AttributeBegin,
+    AttributeEnd, TransformBegin, TransformEnd, Texture, Material,
+    MakeNamedMaterial, NamedMaterial, LightSource, AreaLightSource, Shape,
+    ReverseOrientation, ObjectBegin, ObjectEnd, ObjectInstance, WorldEnd
+};
+
+// BinarySceneWriter writes a binary scene file; each of its methods writes
+// the statement for the pbrt API function of the same name.
+class BinarySceneWriter {
+  public:
+    // BinarySceneWriter Public Methods
+    BinarySceneWriter(const std::string &filename);
+    ~BinarySceneWriter();
+    BinarySceneWriter(const BinarySceneWriter &) = delete;
+    BinarySceneWriter &operator=(const BinarySceneWriter &) = delete;
+    // Returns false if the file couldn't be created or written.
+    bool IsValid() const { return f != nullptr && !failed; }
+    void Identity();
+    void Translate(Float dx, Float dy, Float dz);
+    void Rotate(Float angle, Float ax, Float ay, Float az);
+    void Scale(Float sx, Float sy, Float sz);
+    void LookAt(Float ex, Float ey, Float ez, Float lx, Float ly, Float lz,
+                Float ux, Float uy, Float uz);
+    void ConcatTransform(const Float transform[16]);
+    void Transform(const Float transform[16]);
+    void CoordinateSystem(const std::string &name);
+    void CoordSysTransform(const std::string &name);
+    void ActiveTransformAll();
+    void ActiveTransformEndTime();
+    void ActiveTransformStartTime();
+    void TransformTimes(Float start, Float end);
+    void PixelFilter(const std::string &name, const ParamSet &params);
+    void Film(const std::string &type, const ParamSet &params);
+    void Sampler(const std::string &name, const ParamSet &params);
+    void Extractor(const std::string &name, const ParamSet &params);
+    void Accelerator(const std::string &name, const ParamSet &params);
+    void Integrator(const std::string &name, const ParamSet &params);
+    void Camera(const std::string &name, const ParamSet &params);
+    void MakeNamedMedium(const std::string &name, const ParamSet &params);
+    void MediumInterface(const std::string &insideName,
+                         const std::string &outsideName);
+    void WorldBegin();
+    void AttributeBegin();
+    void AttributeEnd();
+    void TransformBegin();
+    void TransformEnd();
+    void Texture(const std::string &name, const std::string &type,
+                 const std::string &texname, const ParamSet &params);
+    void Material(const std::string &name, const ParamSet &params);
+    void MakeNamedMaterial(const std::string &name, const ParamSet &params);
+    void NamedMaterial(const std::string &name);
+    void LightSource(const std::string &name, const ParamSet &params);
+    void AreaLightSource(const std::string &name, const ParamSet &params);
+    void Shape(const std::string &name, const ParamSet &params);
+    void ReverseOrientation();
+    void ObjectBegin(const std::string &name);
+    void ObjectEnd();
+    void ObjectInstance(const std::string &name);
+    void WorldEnd();
+
+  private:
+    // BinarySceneWriter Private Methods
+    void Write(const void *data, size_t size);
+    void WriteU32(uint32_t v) { Write(&v, sizeof(v)); }
+    void WriteOp(BinarySceneOp op) { WriteU32(uint32_t(op)); }
+    void WriteFloats(const Float *v, size_t n);
+    void WriteString(const std::string &s);
+    void WriteParams(const ParamSet &params);
+    template <typename T>
+    void WriteItem(uint32_t type, const ParamSetItemBase *item);
+    void WriteValues(const bool *v, int n);
+    void WriteValues(const int *v, int n);
+    void WriteValues(const Float *v, int n);
+    void WriteValues(const Spectrum *v, int n);
+    void WriteValues(const std::string *v, int n);
+    template <typename T>
+    void WriteValues(const T *v, int n) {
+        // Points, vectors and normals are stored as their _Float_s
+        WriteFloats(&v[0].x, n * (sizeof(T) / sizeof(Float)));
+    }
+    void WriteStatement(BinarySceneOp op, const std::string &name,
+                        const ParamSet &params) {
+        WriteOp(op);
+        WriteString(name);
+        WriteParams(params);
+    }
+
+    // BinarySceneWriter Private Data
+    FILE *f;
+    bool failed = false;
+};
+
+// Returns true if the _size_ bytes at _data_ start with the header of a
+// binary scene file.
+bool IsBinaryScene(const char *data, size_t size);
+
+// Runs the statements of the binary scene file _filename_, whose _size_
+// bytes of contents are at _data_. Returns false if the file is invalid.
+bool ParseBinaryScene(const std::string &filename, const char *data,
+                      size_t size);
+
+}  // namespace pbrt
+
+#endif  // PBRT_CORE_BINARYSCENE_H
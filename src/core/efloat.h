@@ -284,6 +284,88 @@ inline bool Quadratic(EFloat A, EFloat B, EFloat C, EFloat *t0, EFloat *t1) {
     return true;
 }
 
+// Solves for the _t_ values where the first _n_ coordinates of the ray
+// _o_ + _t_ _d_ are at distance _r_ from the origin: the quadratic of a
+// sphere for _n_ = 3 and of an infinite cylinder about $z$ for _n_ = 2.
+// The solve is done in plain floating point, several times faster than
+// with _EFloat_s, and computes the discriminant from the distance between
+// the ray and the origin, which doesn't suffer catastrophic cancellation
+// for small radii the way $b^2-4ac$ does. Error bounds for the roots
+// follow from _oErr_ and _dErr_ and the round-off in each step; they grow
+// without limit as the discriminant approaches zero, so there
+// _*degenerate_ is set and false is returned, and callers should solve
+// again with _EFloat_ arithmetic.
+template <int n, typename P, typename V>
+inline bool RadialQuadratic(const P &o, const V &oErr, const V &d,
+                            const V &dErr, Float r, Float *t0, Float *t1,
+                            Float *t0Err, Float *t1Err, bool *degenerate) {
+    // Compute quadratic coefficients $a$, $b/2$, and $c$ and their errors
+    Float a = 0, b = 0, c = -r * r, aErr = 0, bErr = 0, cErr = 0;
+    Float bAbs = 0, cAbs = r * r;
+    for (int i = 0; i < n; ++i) {
+        a += d[i] * d[i];
+        b += d[i] * o[i];
+        c += o[i] * o[i];
+        bAbs += std::abs(d[i] * o[i]);
+        cAbs += o[i] * o[i];
+        aErr += (2 * std::abs(d[i]) + dErr[i]) * dErr[i];
+        bErr += std::abs(d[i]) * oErr[i] + (std::abs(o[i]) + oErr[i]) * dErr[i];
+        cErr += (2 * std::abs(o[i]) + oErr[i]) * oErr[i];
+    }
+    aErr += gamma(n) * a;
+    bErr += gamma(n) * bAbs;
+    cErr += gamma(n + 1) * cAbs;
+    if (a <= aErr) {
+        *degenerate = true;
+        return false;
+    }
+
+    // Find the squared distance $l^2$ between the ray and the origin
+    Float s = b / a;
+    Float sErr =
+        (bErr + std::abs(s) * aErr) / (a - aErr) + gamma(1) * std::abs(s);
+    Float l2 = 0, l2Err = 0;
+    for (int i = 0; i < n; ++i) {
+        Float l = o[i] - s * d[i];
+        Float lErr = oErr[i] + sErr * std::abs(d[i]) +
+                     (std::abs(s) + sErr) * dErr[i] +
+                     gamma(2) * (std::abs(o[i]) + std::abs(s * d[i]));
+        l2 += l * l;
+        l2Err += (2 * std::abs(l) + lErr) * lErr;
+    }
+    l2Err += gamma(n) * l2;
+
+    // Compute the quarter discriminant $a(r^2-l^2)$ and its error bound
+    Float h = r * r - l2;
+    Float hErr = l2Err + gamma(2) * (r * r + l2);
+    Float discrim = a * h;
+    Float discrimErr = (a + aErr) * hErr + aErr * std::abs(h) +
+                       gamma(1) * std::abs(discrim);
+    *degenerate = std::abs(discrim) <= 4 * discrimErr;
+    if (discrim < 0 || *degenerate) return false;
+    Float rootDiscrim = std::sqrt(discrim);
+    Float rootDiscrimErr = discrimErr / rootDiscrim + gamma(1) * rootDiscrim;
+
+    // Compute quadratic _t_ values and their error bounds
+    Float q = (b < 0) ? rootDiscrim - b : -(b + rootDiscrim);
+    Float qErr = bErr + rootDiscrimErr + gamma(1) * std::abs(q);
+    if (std::abs(q) <= qErr) {
+        *degenerate = true;
+        return false;
+    }
+    *t0 = q / a;
+    *t1 = c / q;
+    *t0Err = (qErr + std::abs(*t0) * aErr) / (a - aErr) +
+             gamma(1) * std::abs(*t0);
+    *t1Err = (cErr + std::abs(*t1) * qErr) / (std::abs(q) - qErr) +
+             gamma(1) * std::abs(*t1);
+    if (*t0 > *t1) {
+        std::swap(*t0, *t1);
+        std::swap(*t0Err, *t1Err);
+    }
+    return true;
+}
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_EFLOAT_H
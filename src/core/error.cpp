@@ -61,6 +61,22 @@ static std::string StringVaprintf(const std::string &fmt, va_list args) {
     return str;
 }
 
+static PBRT_THREAD_LOCAL std::vector<BufferedError> *errorBuffer;
+
+static void printError(const std::string &errorString, bool warning) {
+    // Print the error message (but not more than one time).
+    static std::string lastError;
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (errorString != lastError) {
+        if (warning)
+            LOG(WARNING) << errorString;
+        else
+            LOG(ERROR) << errorString;
+        lastError = errorString;
+    }
+}
+
 static void processError(const char *format, va_list args,
                          const char *errorType) {
     // Build up an entire formatted error string and print it all at once;
@@ -69,26 +85,31 @@ static void processError(const char *format, va_list args,
     std::string errorString;
 
     // Print line and position in input file, if available
-    extern int line_num;
+    extern PBRT_THREAD_LOCAL int line_num;
     if (line_num != 0) {
-        extern std::string current_file;
-        errorString += current_file;
+        extern PBRT_THREAD_LOCAL const char *current_file;
+        if (current_file) errorString += current_file;
         errorString += StringPrintf("(%d): ", line_num);
     }
 
     errorString += StringVaprintf(format, args);
+    bool warning = !strcmp(errorType, "Warning");
+    if (errorBuffer)
+        errorBuffer->push_back({std::move(errorString), warning});
+    else
+        printError(errorString, warning);
+}
 
-    // Print the error message (but not more than one time).
-    static std::string lastError;
-    static std::mutex mutex;
-    std::lock_guard<std::mutex> lock(mutex);
-    if (errorString != lastError) {
-        if (!strcmp(errorType, "Warning"))
-            LOG(WARNING) << errorString;
-        else
-            LOG(ERROR) << errorString;
-        lastError = errorString;
-    }
+std::vector<BufferedError> *SetErrorBuffer(
+    std::vector<BufferedError> *buffer) {
+    std::vector<BufferedError> *prevBuffer = errorBuffer;
+    errorBuffer = buffer;
+    return prevBuffer;
+}
+
+void ReportErrors(const std::vector<BufferedError> &errors) {
+    for (const BufferedError &error : errors)
+        printError(error.message, error.warning);
 }
 
 void Warning(const char *format, ...) {
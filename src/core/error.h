@@ -54,6 +54,17 @@ namespace pbrt {
 void Warning(const char *, ...) PRINTF_FUNC;
 void Error(const char *, ...) PRINTF_FUNC;
 
+// While a thread has an error buffer, the errors and warnings it reports are
+// appended to the buffer instead of being printed, so that they can be
+// printed later with ReportErrors(). SetErrorBuffer() returns the thread's
+// previous buffer.
+struct BufferedError {
+    std::string message;
+    bool warning;
+};
+std::vector<BufferedError> *SetErrorBuffer(std::vector<BufferedError> *buffer);
+void ReportErrors(const std::vector<BufferedError> &errors);
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_ERROR_H
@@ -35,8 +35,13 @@
 #include "fileutil.h"
 #include <cstdlib>
 #include <climits>
+#include <cstdio>
 #ifndef PBRT_IS_WINDOWS
+#include <fcntl.h>
 #include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 namespace pbrt {
@@ -126,4 +131,51 @@ void SetSearchDirectory(const std::string &dirname) {
     searchDirectory = dirname;
 }
 
+// MappedFile Method Definitions
+MappedFile::MappedFile(const std::string &filename) {
+#ifndef PBRT_IS_WINDOWS
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+#endif
+            data = (const char *)ptr;
+            size = st.st_size;
+            mapped = true;
+        }
+    }
+    close(fd);
+    if (mapped) return;
+#endif
+    // Read the entire file into memory
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f) return;
+    std::string contents;
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) contents.append(buf, n);
+    bool failed = ferror(f);
+    fclose(f);
+    if (failed) return;
+    size = contents.size();
+    char *copy = new char[size + 1];
+    memcpy(copy, contents.data(), size);
+    copy[size] = '\0';
+    data = copy;
+}
+
+MappedFile::~MappedFile() {
+#ifndef PBRT_IS_WINDOWS
+    if (mapped) {
+        munmap((void *)data, size);
+        return;
+    }
+#endif
+    delete[] data;
+}
+
 }  // namespace pbrt
@@ -60,6 +60,26 @@ inline bool HasExtension(const std::string &value, const std::string &ending) {
         [](char a, char b) { return std::tolower(a) == std::tolower(b); });
 }
 
+// MappedFile provides read-only access to the contents of a file. The file
+// is memory-mapped where supported and read into memory otherwise.
+class MappedFile {
+  public:
+    // MappedFile Public Methods
+    MappedFile(const std::string &filename);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    bool IsValid() const { return data != nullptr; }
+    const char *Data() const { return data; }
+    size_t Size() const { return size; }
+
+  private:
+    // MappedFile Private Data
+    const char *data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+};
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_FILEUTIL_H
@@ -33,6 +33,7 @@
 
 // core/film.cpp*
 #include "film.h"
+#include "fileutil.h"
 #include "paramset.h"
 #include "imageio.h"
 #include "stats.h"
@@ -44,13 +45,15 @@ STAT_MEMORY_COUNTER("Memory/Film pixels", filmPixelMemory);
 // Film Method Definitions
 Film::Film(const Point2i &resolution, const Bounds2f &cropWindow,
            std::unique_ptr<Filter> filt, Float diagonal,
-           const std::string &filename, Float scale, Float maxSampleLuminance)
+           const std::string &filename, Float scale, Float maxSampleLuminance,
+           EXRCompression exrCompression)
     : fullResolution(resolution),
       diagonal(diagonal * .001),
       filter(std::move(filt)),
       filename(filename),
       scale(scale),
-      maxSampleLuminance(maxSampleLuminance) {
+      maxSampleLuminance(maxSampleLuminance),
+      exrCompression(exrCompression) {
     // Compute film image bounds
     croppedPixelBounds =
         Bounds2i(Point2i(std::ceil(fullResolution.x * cropWindow.pMin.x),
@@ -165,47 +168,81 @@ void Film::AddSplat(const Point2f &p, Spectrum v) {
     for (int i = 0; i < 3; ++i) pixel.splatXYZ[i].Add(xyz[i]);
 }
 
-void Film::WriteImage(Float splatScale) {
-    // Convert image to RGB and compute final pixel values
-    LOG(INFO) <<
-        "Converting image to RGB and computing final weighted pixel values";
-    std::unique_ptr<Float[]> rgb(new Float[3 * croppedPixelBounds.Area()]);
-    int offset = 0;
-    for (Point2i p : croppedPixelBounds) {
-        // Convert pixel XYZ color to RGB
-        Pixel &pixel = GetPixel(p);
-        XYZToRGB(pixel.xyz, &rgb[3 * offset]);
-
-        // Normalize pixel with weight sum
-        Float filterWeightSum = pixel.filterWeightSum;
-        if (filterWeightSum != 0) {
-            Float invWt = (Float)1 / filterWeightSum;
-            rgb[3 * offset] = std::max((Float)0, rgb[3 * offset] * invWt);
-            rgb[3 * offset + 1] =
-                std::max((Float)0, rgb[3 * offset + 1] * invWt);
-            rgb[3 * offset + 2] =
-                std::max((Float)0, rgb[3 * offset + 2] * invWt);
-        }
+void Film::AddLayer(const std::string &name, const Film *layer) {
+    // The layer must cover this film's pixels
+    CHECK(InsideExclusive(croppedPixelBounds.pMin, layer->croppedPixelBounds));
+    CHECK(InsideExclusive(croppedPixelBounds.pMax - Vector2i(1, 1),
+                          layer->croppedPixelBounds));
+    layers.push_back({name, layer});
+}
 
-        // Add splat value at pixel
-        Float splatRGB[3];
-        Float splatXYZ[3] = {pixel.splatXYZ[0], pixel.splatXYZ[1],
-                             pixel.splatXYZ[2]};
-        XYZToRGB(splatXYZ, splatRGB);
-        rgb[3 * offset] += splatScale * splatRGB[0];
-        rgb[3 * offset + 1] += splatScale * splatRGB[1];
-        rgb[3 * offset + 2] += splatScale * splatRGB[2];
-
-        // Scale pixel value by _scale_
-        rgb[3 * offset] *= scale;
-        rgb[3 * offset + 1] *= scale;
-        rgb[3 * offset + 2] *= scale;
-        ++offset;
-    }
+void Film::GetRGB(const Bounds2i &bounds, Float splatScale,
+                  Float *rgb) const {
+    // Convert the pixels in _bounds_ to RGB and compute final pixel values
+    int width = bounds.pMax.x - bounds.pMin.x;
+    ParallelFor([&](int64_t row) {
+        int offset = row * width;
+        for (int x = bounds.pMin.x; x < bounds.pMax.x; ++x, ++offset) {
+            // Convert pixel XYZ color to RGB
+            const Pixel &pixel = GetPixel(Point2i(x, bounds.pMin.y + row));
+            XYZToRGB(pixel.xyz, &rgb[3 * offset]);
+
+            // Normalize pixel with weight sum
+            Float filterWeightSum = pixel.filterWeightSum;
+            if (filterWeightSum != 0) {
+                Float invWt = (Float)1 / filterWeightSum;
+                rgb[3 * offset] =
+                    std::max((Float)0, rgb[3 * offset] * invWt);
+                rgb[3 * offset + 1] =
+                    std::max((Float)0, rgb[3 * offset + 1] * invWt);
+                rgb[3 * offset + 2] =
+                    std::max((Float)0, rgb[3 * offset + 2] * invWt);
+            }
+
+            // Add splat value at pixel
+            Float splatRGB[3];
+            Float splatXYZ[3] = {pixel.splatXYZ[0], pixel.splatXYZ[1],
+                                 pixel.splatXYZ[2]};
+            XYZToRGB(splatXYZ, splatRGB);
+            rgb[3 * offset] += splatScale * splatRGB[0];
+            rgb[3 * offset + 1] += splatScale * splatRGB[1];
+            rgb[3 * offset + 2] += splatScale * splatRGB[2];
+
+            // Scale pixel value by _scale_
+            rgb[3 * offset] *= scale;
+            rgb[3 * offset + 1] *= scale;
+            rgb[3 * offset + 2] *= scale;
+        }
+    }, bounds.pMax.y - bounds.pMin.y, 8);
+}
 
-    // Write RGB image
+void Film::WriteImage(Float splatScale) {
     LOG(INFO) << "Writing image " << filename << " with bounds " <<
         croppedPixelBounds;
+    if (HasExtension(filename, ".exr")) {
+        // Stream the image and its layers to the EXR file in blocks of rows
+        auto getRows = [=](const Film *film) {
+            return [=](int y0, int y1, Float *rgb) {
+                Bounds2i rows(
+                    Point2i(croppedPixelBounds.pMin.x,
+                            croppedPixelBounds.pMin.y + y0),
+                    Point2i(croppedPixelBounds.pMax.x,
+                            croppedPixelBounds.pMin.y + y1));
+                film->GetRGB(rows, splatScale, rgb);
+            };
+        };
+        std::vector<ImageLayer> imageLayers;
+        imageLayers.push_back({"", getRows(this)});
+        for (const auto &layer : layers)
+            imageLayers.push_back({layer.first, getRows(layer.second)});
+        WriteImageLayers(filename, imageLayers, croppedPixelBounds,
+                         fullResolution, exrCompression);
+        return;
+    }
+
+    // Convert image to RGB and write it
+    std::unique_ptr<Float[]> rgb(new Float[3 * croppedPixelBounds.Area()]);
+    GetRGB(croppedPixelBounds, splatScale, rgb.get());
     pbrt::WriteImage(filename, &rgb[0], croppedPixelBounds, fullResolution);
 }
 
@@ -244,8 +281,30 @@ Film *CreateFilm(const ParamSet &params, std::unique_ptr<Filter> filter) {
     Float diagonal = params.FindOneFloat("diagonal", 35.);
     Float maxSampleLuminance = params.FindOneFloat("maxsampleluminance",
                                                    Infinity);
+    std::string compressionName =
+        params.FindOneString("exrcompression", "zip");
+    EXRCompression compression = EXRCompression::ZIP;
+    if (compressionName == "none")
+        compression = EXRCompression::None;
+    else if (compressionName == "rle")
+        compression = EXRCompression::RLE;
+    else if (compressionName == "zips")
+        compression = EXRCompression::ZIPS;
+    else if (compressionName == "piz")
+        compression = EXRCompression::PIZ;
+    else if (compressionName == "pxr24")
+        compression = EXRCompression::PXR24;
+    else if (compressionName == "b44")
+        compression = EXRCompression::B44;
+    else if (compressionName == "dwaa")
+        compression = EXRCompression::DWAA;
+    else if (compressionName == "dwab")
+        compression = EXRCompression::DWAB;
+    else if (compressionName != "zip")
+        Error("EXR compression \"%s\" unknown; using ZIP.",
+              compressionName.c_str());
     return new Film(Point2i(xres, yres), crop, std::move(filter), diagonal,
-                    filename, scale, maxSampleLuminance);
+                    filename, scale, maxSampleLuminance, compression);
 }
 
 }  // namespace pbrt
@@ -43,6 +43,7 @@
 #include "geometry.h"
 #include "spectrum.h"
 #include "filter.h"
+#include "imageio.h"
 #include "stats.h"
 #include "parallel.h"
 
@@ -61,13 +62,16 @@ class Film {
     Film(const Point2i &resolution, const Bounds2f &cropWindow,
          std::unique_ptr<Filter> filter, Float diagonal,
          const std::string &filename, Float scale,
-         Float maxSampleLuminance = Infinity);
+         Float maxSampleLuminance = Infinity,
+         EXRCompression exrCompression = EXRCompression::ZIP);
     Bounds2i GetSampleBounds() const;
     Bounds2f GetPhysicalExtent() const;
     std::unique_ptr<FilmTile> GetFilmTile(const Bounds2i &sampleBounds);
     void MergeFilmTile(std::unique_ptr<FilmTile> tile);
     void SetImage(const Spectrum *img) const;
     void AddSplat(const Point2f &p, Spectrum v);
+    void AddLayer(const std::string &name, const Film *layer);
+    void GetRGB(const Bounds2i &bounds, Float splatScale, Float *rgb) const;
     void WriteImage(Float splatScale = 1);
     void Clear();
 
@@ -93,6 +97,9 @@ class Film {
     std::mutex mutex;
     const Float scale;
     const Float maxSampleLuminance;
+    const EXRCompression exrCompression;
+    // Films written as named layers of this film's EXR image
+    std::vector<std::pair<std::string, const Film *>> layers;
 
     // Film Private Methods
     Pixel &GetPixel(const Point2i &p) {
@@ -102,6 +109,9 @@ class Film {
                      (p.y - croppedPixelBounds.pMin.y) * width;
         return pixels[offset];
     }
+    const Pixel &GetPixel(const Point2i &p) const {
+        return const_cast<Film *>(this)->GetPixel(p);
+    }
 };
 
 class FilmTile {
@@ -35,20 +35,25 @@
 #include "ext/lodepng.h"
 #include "ext/targa.h"
 #include "fileutil.h"
+#include "parallel.h"
 #include "spectrum.h"
 
+#include <ImfChannelList.h>
+#include <ImfFrameBuffer.h>
+#include <ImfHeader.h>
+#include <ImfOutputFile.h>
 #include <ImfRgba.h>
 #include <ImfRgbaFile.h>
+#include <ImfThreading.h>
 
 namespace pbrt {
 
 // ImageIO Local Declarations
-static void WriteImageEXR(const std::string &name, const Float *pixels,
-                          int xRes, int yRes, int totalXRes, int totalYRes,
-                          int xOffset, int yOffset);
 static void WriteImageTGA(const std::string &name, const uint8_t *pixels,
                           int xRes, int yRes, int totalXRes, int totalYRes,
                           int xOffset, int yOffset);
+static uint8_t *ReadImageTGA8(const std::string &name, int *w, int *h);
+static uint8_t *ReadImagePNG8(const std::string &name, int *w, int *h);
 static RGBSpectrum *ReadImageTGA(const std::string &name, int *w, int *h);
 static RGBSpectrum *ReadImagePNG(const std::string &name, int *w, int *h);
 static bool WriteImagePFM(const std::string &filename, const Float *rgb,
@@ -78,13 +83,26 @@ std::unique_ptr<RGBSpectrum[]> ReadImage(const std::string &name,
     return nullptr;
 }
 
+std::unique_ptr<uint8_t[]> ReadImageRGB8(const std::string &name,
+                                         Point2i *resolution) {
+    if (HasExtension(name, ".tga"))
+        return std::unique_ptr<uint8_t[]>(
+            ReadImageTGA8(name, &resolution->x, &resolution->y));
+    else if (HasExtension(name, ".png"))
+        return std::unique_ptr<uint8_t[]>(
+            ReadImagePNG8(name, &resolution->x, &resolution->y));
+    return nullptr;
+}
+
 void WriteImage(const std::string &name, const Float *rgb,
                 const Bounds2i &outputBounds, const Point2i &totalResolution) {
     Vector2i resolution = outputBounds.Diagonal();
     if (HasExtension(name, ".exr")) {
-        WriteImageEXR(name, rgb, resolution.x, resolution.y, totalResolution.x,
-                      totalResolution.y, outputBounds.pMin.x,
-                      outputBounds.pMin.y);
+        ImageLayer layer{"", [&](int y0, int y1, Float *dst) {
+            std::copy(rgb + 3 * y0 * resolution.x,
+                      rgb + 3 * y1 * resolution.x, dst);
+        }};
+        WriteImageLayers(name, {layer}, outputBounds, totalResolution);
     } else if (HasExtension(name, ".pfm")) {
         WriteImagePFM(name, rgb, resolution.x, resolution.y);
     } else if (HasExtension(name, ".tga") || HasExtension(name, ".png")) {
@@ -161,31 +179,79 @@ RGBSpectrum *ReadImageEXR(const std::string &name, int *width, int *height,
     return NULL;
 }
 
-static void WriteImageEXR(const std::string &name, const Float *pixels,
-                          int xRes, int yRes, int totalXRes, int totalYRes,
-                          int xOffset, int yOffset) {
+void WriteImageLayers(const std::string &name,
+                      const std::vector<ImageLayer> &layers,
+                      const Bounds2i &outputBounds,
+                      const Point2i &totalResolution,
+                      EXRCompression compression) {
     using namespace Imf;
     using namespace Imath;
-
-    Rgba *hrgba = new Rgba[xRes * yRes];
-    for (int i = 0; i < xRes * yRes; ++i)
-        hrgba[i] = Rgba(pixels[3 * i], pixels[3 * i + 1], pixels[3 * i + 2]);
+    static const Compression exrCompression[] = {
+        NO_COMPRESSION,  RLE_COMPRESSION,   ZIPS_COMPRESSION,
+        ZIP_COMPRESSION, PIZ_COMPRESSION,   PXR24_COMPRESSION,
+        B44_COMPRESSION, DWAA_COMPRESSION,  DWAB_COMPRESSION};
+    Vector2i resolution = outputBounds.Diagonal();
 
     // OpenEXR uses inclusive pixel bounds.
-    Box2i displayWindow(V2i(0, 0), V2i(totalXRes - 1, totalYRes - 1));
-    Box2i dataWindow(V2i(xOffset, yOffset),
-                     V2i(xOffset + xRes - 1, yOffset + yRes - 1));
-
+    Box2i displayWindow(V2i(0, 0),
+                        V2i(totalResolution.x - 1, totalResolution.y - 1));
+    Box2i dataWindow(V2i(outputBounds.pMin.x, outputBounds.pMin.y),
+                     V2i(outputBounds.pMax.x - 1, outputBounds.pMax.y - 1));
+    Header header(displayWindow, dataWindow);
+    header.compression() = exrCompression[int(compression)];
+    const char *channelNames[3] = {"R", "G", "B"};
+    for (const ImageLayer &layer : layers)
+        for (int c = 0; c < 3; ++c)
+            header.channels().insert(
+                layer.name.empty() ? channelNames[c]
+                                   : layer.name + "." + channelNames[c],
+                Channel(HALF));
+
+    // Compress scanlines using OpenEXR's thread pool
+    if (globalThreadCount() != MaxThreadIndex())
+        setGlobalThreadCount(MaxThreadIndex());
+
+    // Stream the layers to the file a block of scanlines at a time
+    const int BlockRows = 64;
+    int nRows = std::min(BlockRows, resolution.y);
+    std::unique_ptr<Float[]> rgb(new Float[3 * resolution.x * nRows]);
+    std::vector<std::unique_ptr<half[]>> halfRGB;
+    for (size_t i = 0; i < layers.size(); ++i)
+        halfRGB.push_back(
+            std::unique_ptr<half[]>(new half[3 * resolution.x * nRows]));
     try {
-        RgbaOutputFile file(name.c_str(), displayWindow, dataWindow,
-                            WRITE_RGBA);
-        file.setFrameBuffer(hrgba - xOffset - yOffset * xRes, 1, xRes);
-        file.writePixels(yRes);
+        OutputFile file(name.c_str(), header);
+        for (int y0 = 0; y0 < resolution.y; y0 += BlockRows) {
+            int y1 = std::min(y0 + BlockRows, resolution.y);
+            FrameBuffer frameBuffer;
+            for (size_t i = 0; i < layers.size(); ++i) {
+                // Get the block's pixels for the layer and convert them to
+                // half precision
+                layers[i].getRows(y0, y1, rgb.get());
+                half *h = halfRGB[i].get();
+                for (int j = 0; j < 3 * resolution.x * (y1 - y0); ++j)
+                    h[j] = half(float(rgb[j]));
+
+                // Point the layer's channels at the block; the slices'
+                // base addresses are for pixel $(0,0)$ of the data window
+                size_t xStride = 3 * sizeof(half);
+                size_t yStride = resolution.x * xStride;
+                char *base = (char *)h - outputBounds.pMin.x * xStride -
+                             (outputBounds.pMin.y + y0) * yStride;
+                for (int c = 0; c < 3; ++c)
+                    frameBuffer.insert(
+                        layers[i].name.empty()
+                            ? channelNames[c]
+                            : layers[i].name + "." + channelNames[c],
+                        Slice(HALF, base + c * sizeof(half), xStride,
+                              yStride));
+            }
+            file.setFrameBuffer(frameBuffer);
+            file.writePixels(y1 - y0);
+        }
     } catch (const std::exception &exc) {
         Error("Error writing \"%s\": %s", name.c_str(), exc.what());
     }
-
-    delete[] hrgba;
 }
 
 // TGA Function Definitions
@@ -213,8 +279,8 @@ void WriteImageTGA(const std::string &name, const uint8_t *pixels, int xRes,
               name.c_str(), tga_error(result));
 }
 
-static RGBSpectrum *ReadImageTGA(const std::string &name, int *width,
-                                 int *height) {
+static uint8_t *ReadImageTGA8(const std::string &name, int *width,
+                              int *height) {
     tga_image img;
     tga_result result;
     if ((result = tga_read(&img, name.c_str())) != TGA_NOERR) {
@@ -222,41 +288,40 @@ static RGBSpectrum *ReadImageTGA(const std::string &name, int *width,
               name.c_str(), tga_error(result));
         return nullptr;
     }
-
-    if (tga_is_right_to_left(&img)) tga_flip_horiz(&img);
-    if (!tga_is_top_to_bottom(&img)) tga_flip_vert(&img);
     if (tga_is_colormapped(&img)) tga_color_unmap(&img);
 
     *width = img.width;
     *height = img.height;
 
-    // "Unpack" the pixels (origin in the lower left corner).
-    // TGA pixels are in BGRA format.
-    RGBSpectrum *ret = new RGBSpectrum[*width * *height];
-    RGBSpectrum *dst = ret;
-    for (int y = 0; y < *height; y++)
-        for (int x = 0; x < *width; x++) {
-            uint8_t *src = tga_find_pixel(&img, x, y);
-            if (tga_is_mono(&img))
-                *dst++ = RGBSpectrum(*src / 255.f);
-            else {
-                Float c[3];
-                c[2] = src[0] / 255.f;
-                c[1] = src[1] / 255.f;
-                c[0] = src[2] / 255.f;
-                *dst++ = RGBSpectrum::FromRGB(c);
+    // "Unpack" the pixels, top row first; rather than flipping the image
+    // in place, compute the row and pixel step that visit its pixels in
+    // that order. TGA pixels are in BGRA format.
+    uint8_t *ret = new uint8_t[3 * *width * *height];
+    int bytesPerPixel = img.pixel_depth / 8;
+    bool mono = tga_is_mono(&img);
+    int xStep = tga_is_right_to_left(&img) ? -bytesPerPixel : bytesPerPixel;
+    for (int y = 0; y < *height; ++y) {
+        const uint8_t *src = tga_find_pixel(&img, 0, y);
+        uint8_t *dst = ret + 3 * y * *width;
+        if (mono)
+            for (int x = 0; x < *width; ++x, src += xStep, dst += 3)
+                dst[0] = dst[1] = dst[2] = src[0];
+        else
+            for (int x = 0; x < *width; ++x, src += xStep, dst += 3) {
+                dst[0] = src[2];
+                dst[1] = src[1];
+                dst[2] = src[0];
             }
-        }
+    }
 
     tga_free_buffers(&img);
     LOG(INFO) << StringPrintf("Read TGA image %s (%d x %d)",
                               name.c_str(), *width, *height);
-
     return ret;
 }
 
-static RGBSpectrum *ReadImagePNG(const std::string &name, int *width,
-                                 int *height) {
+static uint8_t *ReadImagePNG8(const std::string &name, int *width,
+                              int *height) {
     unsigned char *rgb;
     unsigned w, h;
     unsigned int error = lodepng_decode24_file(&rgb, &w, &h, name.c_str());
@@ -268,24 +333,39 @@ static RGBSpectrum *ReadImagePNG(const std::string &name, int *width,
     *width = w;
     *height = h;
 
-    RGBSpectrum *ret = new RGBSpectrum[*width * *height];
-    unsigned char *src = rgb;
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x, src += 3) {
-            Float c[3];
-            c[0] = src[0] / 255.f;
-            c[1] = src[1] / 255.f;
-            c[2] = src[2] / 255.f;
-            ret[y * *width + x] = RGBSpectrum::FromRGB(c);
-        }
-    }
-
+    // Move the decoded pixels to memory allocated with _new_
+    uint8_t *ret = new uint8_t[3 * w * h];
+    memcpy(ret, rgb, 3 * w * h);
     free(rgb);
     LOG(INFO) << StringPrintf("Read PNG image %s (%d x %d)",
                               name.c_str(), *width, *height);
     return ret;
 }
 
+static RGBSpectrum *RGB8ToSpectrum(const uint8_t *rgb, int width,
+                                   int height) {
+    if (!rgb) return nullptr;
+    RGBSpectrum *ret = new RGBSpectrum[width * height];
+    for (int i = 0; i < width * height; ++i) {
+        Float c[3] = {rgb[3 * i] / 255.f, rgb[3 * i + 1] / 255.f,
+                      rgb[3 * i + 2] / 255.f};
+        ret[i] = RGBSpectrum::FromRGB(c);
+    }
+    return ret;
+}
+
+static RGBSpectrum *ReadImageTGA(const std::string &name, int *width,
+                                 int *height) {
+    std::unique_ptr<uint8_t[]> rgb(ReadImageTGA8(name, width, height));
+    return RGB8ToSpectrum(rgb.get(), *width, *height);
+}
+
+static RGBSpectrum *ReadImagePNG(const std::string &name, int *width,
+                                 int *height) {
+    std::unique_ptr<uint8_t[]> rgb(ReadImagePNG8(name, width, height));
+    return RGB8ToSpectrum(rgb.get(), *width, *height);
+}
+
 // PFM Function Definitions
 /*
  * PFM reader/writer code courtesy Jiawen "Kevin" Chen
@@ -388,35 +468,31 @@ static RGBSpectrum *ReadImagePFM(const std::string &filename, int *xres,
     // read the data
     nFloats = nChannels * width * height;
     data = new float[nFloats];
-    // Flip in Y, as P*M has the origin at the lower left.
-    for (int y = height - 1; y >= 0; --y) {
-        if (fread(&data[y * nChannels * width], sizeof(float),
-                  nChannels * width, fp) != nChannels * width)
-            goto fail;
-    }
+    if (fread(data, sizeof(float), nFloats, fp) != nFloats) goto fail;
 
-    // apply endian conversian and scale if appropriate
+    // apply endian conversian and scale if appropriate, and create RGBs,
+    // flipping in Y, as P*M has the origin at the lower left.
     fileLittleEndian = (scale < 0.f);
     if (hostLittleEndian ^ fileLittleEndian) {
-        uint8_t bytes[4];
-        for (unsigned int i = 0; i < nFloats; ++i) {
-            memcpy(bytes, &data[i], 4);
-            std::swap(bytes[0], bytes[3]);
-            std::swap(bytes[1], bytes[2]);
-            memcpy(&data[i], bytes, 4);
-        }
+        uint32_t *bits = reinterpret_cast<uint32_t *>(data);
+        for (unsigned int i = 0; i < nFloats; ++i)
+            bits[i] = (bits[i] >> 24) | ((bits[i] >> 8) & 0xff00) |
+                      ((bits[i] << 8) & 0xff0000) | (bits[i] << 24);
     }
-    if (std::abs(scale) != 1.f)
-        for (unsigned int i = 0; i < nFloats; ++i) data[i] *= std::abs(scale);
-
-    // create RGBs...
+    scale = std::abs(scale);
     rgb = new RGBSpectrum[width * height];
-    if (nChannels == 1) {
-        for (int i = 0; i < width * height; ++i) rgb[i] = RGBSpectrum(data[i]);
-    } else {
-        for (int i = 0; i < width * height; ++i) {
-            Float frgb[3] = {data[3 * i], data[3 * i + 1], data[3 * i + 2]};
-            rgb[i] = RGBSpectrum::FromRGB(frgb);
+    for (int y = 0; y < height; ++y) {
+        const float *src = &data[(height - 1 - y) * nChannels * width];
+        RGBSpectrum *dst = &rgb[y * width];
+        if (nChannels == 1) {
+            for (int x = 0; x < width; ++x)
+                dst[x] = RGBSpectrum(src[x] * scale);
+        } else {
+            for (int x = 0; x < width; ++x) {
+                Float frgb[3] = {src[3 * x] * scale, src[3 * x + 1] * scale,
+                                 src[3 * x + 2] * scale};
+                dst[x] = RGBSpectrum::FromRGB(frgb);
+            }
         }
     }
 
@@ -42,12 +42,17 @@
 #include "pbrt.h"
 #include "geometry.h"
 #include <cctype>
+#include <functional>
 
 namespace pbrt {
 
 // ImageIO Declarations
 std::unique_ptr<RGBSpectrum[]> ReadImage(const std::string &name,
                                          Point2i *resolution);
+// Returns the 8-bit RGB values of PNG and TGA images as they're stored,
+// top row first, or _nullptr_ for other formats
+std::unique_ptr<uint8_t[]> ReadImageRGB8(const std::string &name,
+                                         Point2i *resolution);
 RGBSpectrum *ReadImageEXR(const std::string &name, int *width,
                           int *height, Bounds2i *dataWindow = nullptr,
                           Bounds2i *displayWindow = nullptr);
@@ -55,6 +60,24 @@ RGBSpectrum *ReadImageEXR(const std::string &name, int *width,
 void WriteImage(const std::string &name, const Float *rgb,
                 const Bounds2i &outputBounds, const Point2i &totalResolution);
 
+// Compression schemes for EXR output
+enum class EXRCompression { None, RLE, ZIPS, ZIP, PIZ, PXR24, B44, DWAA, DWAB };
+
+// A layer of a multi-layer EXR image; _getRows_ fills in the RGB values of
+// rows $[y_0,y_1)$ of the output, numbered from the top of _outputBounds_.
+// The layer with an empty name holds the image's unprefixed R, G, B
+// channels.
+struct ImageLayer {
+    std::string name;
+    std::function<void(int y0, int y1, Float *rgb)> getRows;
+};
+
+void WriteImageLayers(const std::string &name,
+                      const std::vector<ImageLayer> &layers,
+                      const Bounds2i &outputBounds,
+                      const Point2i &totalResolution,
+                      EXRCompression compression = EXRCompression::ZIP);
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_IMAGEIO_H
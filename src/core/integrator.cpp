@@ -51,6 +51,27 @@ namespace pbrt {
 
 STAT_COUNTER("Integrator/Camera rays traced", nCameraRays);
 
+// Integrator Local Declarations
+// Camera rays that are traced together when batching them
+static PBRT_CONSTEXPR int MaxCameraRayBatch = 256;
+struct CameraRay {
+    Point2i pixel;
+    int64_t sampleIndex;
+    CameraSample cameraSample;
+    RayDifferential ray;
+    Float rayWeight;
+};
+
+// The hit of the camera ray being evaluated when camera rays are traced
+// in batches; SamplerIntegrator::Intersect() returns it for that ray
+struct CameraRayHit {
+    Point3f o;
+    Vector3f d;
+    bool hit;
+    const SurfaceInteraction *isect;
+};
+static PBRT_THREAD_LOCAL const CameraRayHit *cameraRayHit;
+
 // Integrator Method Definitions
 Integrator::~Integrator() {}
 
@@ -229,6 +250,69 @@ std::unique_ptr<Distribution1D> ComputeLightPowerDistribution(
 }
 
 // SamplerIntegrator Method Definitions
+bool SamplerIntegrator::Intersect(const Scene &scene, const Ray &ray,
+                                  SurfaceInteraction *isect) const {
+    const CameraRayHit *h = cameraRayHit;
+    if (h && ray.o == h->o && ray.d == h->d) {
+        // Render() has already set the ray's _tMax_ to the batched hit's
+        cameraRayHit = nullptr;
+        if (h->hit) *isect = *h->isect;
+        return h->hit;
+    }
+    return scene.Intersect(ray, isect);
+}
+
+void SamplerIntegrator::AddSample(const Scene &scene, const Point2i &pixel,
+                                  const CameraSample &cameraSample,
+                                  const RayDifferential &ray, Float rayWeight,
+                                  Sampler &sampler, MemoryArena &arena,
+                                  FilmTile &filmTile,
+                                  ExtractorTileManager &extractorTiles) const {
+    std::unique_ptr<Containers> container =
+        extractor->GetNewContainer(cameraSample.pFilm);
+
+    // Evaluate radiance along camera ray
+    Spectrum L(0.f);
+    if (rayWeight > 0) L = Li(ray, scene, sampler, arena, *container);
+
+    // Issue warning if unexpected radiance value returned
+    if (L.HasNaNs()) {
+        LOG(ERROR) << StringPrintf(
+            "Not-a-number radiance value returned "
+            "for pixel (%d, %d), sample %d. Setting to black.",
+            pixel.x, pixel.y,
+            (int)sampler.CurrentSampleNumber());
+        L = Spectrum(0.f);
+    } else if (L.y() < -1e-5) {
+        LOG(ERROR) << StringPrintf(
+            "Negative luminance value, %f, returned "
+            "for pixel (%d, %d), sample %d. Setting to black.",
+            L.y(), pixel.x, pixel.y,
+            (int)sampler.CurrentSampleNumber());
+        L = Spectrum(0.f);
+    } else if (std::isinf(L.y())) {
+          LOG(ERROR) << StringPrintf(
+            "Infinite luminance value returned "
+            "for pixel (%d, %d), sample %d. Setting to black.",
+            pixel.x, pixel.y,
+            (int)sampler.CurrentSampleNumber());
+        L = Spectrum(0.f);
+    }
+    VLOG(1) << "Camera sample: " << cameraSample << " -> ray: " <<
+        ray << " -> L = " << L;
+
+    // Add camera ray's contribution to image
+    filmTile.AddSample(cameraSample.pFilm, L, rayWeight);
+
+    // Add extractor contribution to extractor film
+    extractorTiles.AddSamples(cameraSample.pFilm, std::move(container),
+                              rayWeight);
+
+    // Free _MemoryArena_ memory from computing image sample
+    // value
+    arena.Reset();
+}
+
 void SamplerIntegrator::Render(const Scene &scene) {
     Preprocess(scene, *sampler);
     // Render image tiles in parallel
@@ -268,74 +352,111 @@ void SamplerIntegrator::Render(const Scene &scene) {
                     extractor->GetNewExtractorTile(tileBounds);
 
             // Loop over pixels in tile to render them
-            for (Point2i pixel : tileBounds) {
-                {
-                    ProfilePhase pp(Prof::StartPixel);
-                    tileSampler->StartPixel(pixel);
-                }
-
-                // Do this check after the StartPixel() call; this keeps
-                // the usage of RNG values from (most) Samplers that use
-                // RNGs consistent, which improves reproducability /
-                // debugging.
-                if (!InsideExclusive(pixel, pixelBounds))
-                    continue;
-
-                do {
-                    // Initialize _CameraSample_ for current sample
-                    CameraSample cameraSample =
-                        tileSampler->GetCameraSample(pixel);
-
-                    // Generate camera ray for current sample
-                    RayDifferential ray;
-                    Float rayWeight =
-                        camera->GenerateRayDifferential(cameraSample, &ray);
-                    ray.ScaleDifferentials(
-                        1 / std::sqrt((Float)tileSampler->samplesPerPixel));
-                    ++nCameraRays;
-
-                    std::unique_ptr<Containers> container = extractor->GetNewContainer(cameraSample.pFilm);
-
-                    // Evaluate radiance along camera ray
-                    Spectrum L(0.f);
-                    if (rayWeight > 0) L = Li(ray, scene, *tileSampler, arena, *container);
-
-                    // Issue warning if unexpected radiance value returned
-                    if (L.HasNaNs()) {
-                        LOG(ERROR) << StringPrintf(
-                            "Not-a-number radiance value returned "
-                            "for pixel (%d, %d), sample %d. Setting to black.",
-                            pixel.x, pixel.y,
-                            (int)tileSampler->CurrentSampleNumber());
-                        L = Spectrum(0.f);
-                    } else if (L.y() < -1e-5) {
-                        LOG(ERROR) << StringPrintf(
-                            "Negative luminance value, %f, returned "
-                            "for pixel (%d, %d), sample %d. Setting to black.",
-                            L.y(), pixel.x, pixel.y,
-                            (int)tileSampler->CurrentSampleNumber());
-                        L = Spectrum(0.f);
-                    } else if (std::isinf(L.y())) {
-                          LOG(ERROR) << StringPrintf(
-                            "Infinite luminance value returned "
-                            "for pixel (%d, %d), sample %d. Setting to black.",
-                            pixel.x, pixel.y,
-                            (int)tileSampler->CurrentSampleNumber());
-                        L = Spectrum(0.f);
+            Float diffScale =
+                1 / std::sqrt((Float)tileSampler->samplesPerPixel);
+            if (!batchRays) {
+                for (Point2i pixel : tileBounds) {
+                    {
+                        ProfilePhase pp(Prof::StartPixel);
+                        tileSampler->StartPixel(pixel);
                     }
-                    VLOG(1) << "Camera sample: " << cameraSample << " -> ray: " <<
-                        ray << " -> L = " << L;
-
-                    // Add camera ray's contribution to image
-                    filmTile->AddSample(cameraSample.pFilm, L, rayWeight);
 
-                    // Add extractor contribution to extractor film
-                    extractorTiles->AddSamples(cameraSample.pFilm, std::move(container), rayWeight);
-
-                    // Free _MemoryArena_ memory from computing image sample
-                    // value
-                    arena.Reset();
-                } while (tileSampler->StartNextSample());
+                    // Do this check after the StartPixel() call; this keeps
+                    // the usage of RNG values from (most) Samplers that use
+                    // RNGs consistent, which improves reproducability /
+                    // debugging.
+                    if (!InsideExclusive(pixel, pixelBounds))
+                        continue;
+
+                    do {
+                        // Initialize _CameraSample_ for current sample
+                        CameraSample cameraSample =
+                            tileSampler->GetCameraSample(pixel);
+
+                        // Generate camera ray for current sample
+                        RayDifferential ray;
+                        Float rayWeight =
+                            camera->GenerateRayDifferential(cameraSample, &ray);
+                        ray.ScaleDifferentials(diffScale);
+                        ++nCameraRays;
+                        AddSample(scene, pixel, cameraSample, ray, rayWeight,
+                                  *tileSampler, arena, *filmTile,
+                                  *extractorTiles);
+                    } while (tileSampler->StartNextSample());
+                }
+            } else {
+                // Trace the camera rays of groups of whole pixels together,
+                // then evaluate each sample using the hit found for its ray
+                std::vector<Point2i> pixels;
+                for (Point2i pixel : tileBounds) pixels.push_back(pixel);
+                std::vector<CameraRay> cameraRays;
+                std::vector<Ray> rays;
+                std::vector<SurfaceInteraction> isects;
+                std::unique_ptr<bool[]> hits;
+                size_t groupStart = 0;
+                while (groupStart < pixels.size()) {
+                    // Generate the camera rays of the next group of pixels
+                    size_t groupEnd = groupStart;
+                    cameraRays.clear();
+                    do {
+                        Point2i pixel = pixels[groupEnd++];
+                        {
+                            ProfilePhase pp(Prof::StartPixel);
+                            tileSampler->StartPixel(pixel);
+                        }
+                        if (!InsideExclusive(pixel, pixelBounds)) continue;
+                        do {
+                            CameraRay cr;
+                            cr.pixel = pixel;
+                            cr.sampleIndex = tileSampler->CurrentSampleNumber();
+                            cr.cameraSample =
+                                tileSampler->GetCameraSample(pixel);
+                            cr.rayWeight = camera->GenerateRayDifferential(
+                                cr.cameraSample, &cr.ray);
+                            cr.ray.ScaleDifferentials(diffScale);
+                            ++nCameraRays;
+                            cameraRays.push_back(cr);
+                        } while (tileSampler->StartNextSample());
+                    } while (groupEnd < pixels.size() &&
+                             int64_t(cameraRays.size()) +
+                                     tileSampler->samplesPerPixel <=
+                                 MaxCameraRayBatch);
+
+                    // Trace the group's camera rays
+                    int nRays = cameraRays.size();
+                    rays.clear();
+                    for (const CameraRay &cr : cameraRays)
+                        rays.push_back(cr.ray);
+                    isects.resize(nRays);
+                    hits.reset(new bool[nRays]);
+                    if (nRays > 0)
+                        scene.IntersectBatch(&rays[0], nRays, &isects[0],
+                                             hits.get());
+
+                    // Evaluate the group's samples. Samplers that draw random
+                    // samples in StartPixel() draw them again here, so the
+                    // camera sample and the sample's other dimensions come
+                    // from separate draws.
+                    for (int i = 0; i < nRays; ++i) {
+                        CameraRay &cr = cameraRays[i];
+                        if (i == 0 || cr.pixel != cameraRays[i - 1].pixel) {
+                            ProfilePhase pp(Prof::StartPixel);
+                            tileSampler->StartPixel(cr.pixel);
+                        }
+                        tileSampler->SetSampleNumber(cr.sampleIndex);
+                        // Advance the sampler past the camera sample
+                        (void)tileSampler->GetCameraSample(cr.pixel);
+                        cr.ray.tMax = rays[i].tMax;
+                        CameraRayHit hit{cr.ray.o, cr.ray.d, hits[i],
+                                         hits[i] ? &isects[i] : nullptr};
+                        cameraRayHit = &hit;
+                        AddSample(scene, cr.pixel, cr.cameraSample, cr.ray,
+                                  cr.rayWeight, *tileSampler, arena,
+                                  *filmTile, *extractorTiles);
+                        cameraRayHit = nullptr;
+                    }
+                    groupStart = groupEnd;
+                }
             }
             LOG(INFO) << "Finished image tile " << tileBounds;
 
@@ -81,8 +81,12 @@ class SamplerIntegrator : public Integrator {
     SamplerIntegrator(std::shared_ptr<const Camera> camera,
                       std::shared_ptr<Sampler> sampler,
                       std::shared_ptr<ExtractorManager> extractor,
-                      const Bounds2i &pixelBounds)
-        : camera(camera), sampler(sampler), extractor(extractor), pixelBounds(pixelBounds) {}
+                      const Bounds2i &pixelBounds, bool batchRays = false)
+        : camera(camera),
+          sampler(sampler),
+          extractor(extractor),
+          pixelBounds(pixelBounds),
+          batchRays(batchRays) {}
     virtual void Preprocess(const Scene &scene, Sampler &sampler) {}
     void Render(const Scene &scene);
     virtual Spectrum Li(const RayDifferential &ray, const Scene &scene,
@@ -101,14 +105,29 @@ class SamplerIntegrator : public Integrator {
                               MemoryArena &arena, Containers &container, int depth) const;
 
   protected:
+    // SamplerIntegrator Protected Methods
+    // Finds the closest intersection of _ray_ with the scene. If Render()
+    // traced the camera rays as a batch, the hit it found for the camera
+    // ray that's being evaluated is returned instead of tracing it again.
+    bool Intersect(const Scene &scene, const Ray &ray,
+                   SurfaceInteraction *isect) const;
+
     // SamplerIntegrator Protected Data
     std::shared_ptr<const Camera> camera;
 
   private:
+    // SamplerIntegrator Private Methods
+    void AddSample(const Scene &scene, const Point2i &pixel,
+                   const CameraSample &cameraSample,
+                   const RayDifferential &ray, Float rayWeight,
+                   Sampler &sampler, MemoryArena &arena, FilmTile &filmTile,
+                   ExtractorTileManager &extractorTiles) const;
+
     // SamplerIntegrator Private Data
     std::shared_ptr<Sampler> sampler;
     std::shared_ptr<ExtractorManager> extractor;
     const Bounds2i pixelBounds;
+    const bool batchRays;
 };
 
 }  // namespace pbrt
@@ -113,6 +113,37 @@ class MediumInteraction : public Interaction {
     const PhaseFunction *phase;
 };
 
+// TextureValueCache Declarations
+class TextureValueCache {
+  public:
+    // TextureValueCache Public Methods
+    bool Lookup(const Texture<Float> *tex, Float *value) const {
+        for (int i = 0; i < CacheSize; ++i)
+            if (textures[i] == tex) {
+                *value = values[i];
+                return true;
+            }
+        return false;
+    }
+    void Insert(const Texture<Float> *tex, Float value) {
+        textures[next] = tex;
+        values[next] = value;
+        next = (next + 1) % CacheSize;
+    }
+    void Clear() {
+        for (int i = 0; i < CacheSize; ++i) textures[i] = nullptr;
+        next = 0;
+    }
+
+  private:
+    // TextureValueCache Private Data
+    static PBRT_CONSTEXPR int CacheSize = 4;
+    const Texture<Float> *textures[CacheSize] = {nullptr, nullptr, nullptr,
+                                                  nullptr};
+    Float values[CacheSize];
+    int next = 0;
+};
+
 // SurfaceInteraction Declarations
 class SurfaceInteraction : public Interaction {
   public:
@@ -148,6 +179,8 @@ class SurfaceInteraction : public Interaction {
     BSSRDF *bssrdf = nullptr;
     mutable Vector3f dpdx, dpdy;
     mutable Float dudx = 0, dvdx = 0, dudy = 0, dvdy = 0;
+    // Values of cached float textures evaluated at this point
+    mutable TextureValueCache textureValues;
 };
 
 }  // namespace pbrt
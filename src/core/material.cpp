@@ -47,6 +47,7 @@ void Material::Bump(const std::shared_ptr<Texture<Float>> &d,
                     SurfaceInteraction *si) {
     // Compute offset positions and evaluate displacement texture
     SurfaceInteraction siEval = *si;
+    siEval.textureValues.Clear();
 
     // Shift _siEval_ _du_ in the $u$ direction
     Float du = .5f * (std::abs(si->dudx) + std::abs(si->dudy));
@@ -60,6 +61,7 @@ void Material::Bump(const std::shared_ptr<Texture<Float>> &d,
     siEval.n = Normalize((Normal3f)Cross(si->shading.dpdu, si->shading.dpdv) +
                          du * si->dndu);
     Float uDisplace = d->Evaluate(siEval);
+    siEval.textureValues.Clear();
 
     // Shift _siEval_ _dv_ in the $v$ direction
     Float dv = .5f * (std::abs(si->dvdx) + std::abs(si->dvdy));
@@ -69,6 +71,9 @@ void Material::Bump(const std::shared_ptr<Texture<Float>> &d,
     siEval.n = Normalize((Normal3f)Cross(si->shading.dpdu, si->shading.dpdv) +
                          dv * si->dndv);
     Float vDisplace = d->Evaluate(siEval);
+
+    // The displacement at _si_ itself is cached for the material's own
+    // lookups of the same texture
     Float displace = d->Evaluate(*si);
 
     // Compute bump-mapped differential geometry
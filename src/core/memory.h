@@ -42,6 +42,7 @@
 #include "pbrt.h"
 #include "port.h"
 #include <list>
+#include <type_traits>
 
 namespace pbrt {
 
@@ -179,6 +180,102 @@ class BlockedArray {
     const int uRes, vRes, uBlocks;
 };
 
+template <typename T, int N>
+class InlinedVector {
+  public:
+    // InlinedVector Public Methods
+    InlinedVector() {}
+    InlinedVector(const InlinedVector &v) {
+        reserve(v.nStored);
+        for (const T &item : v) push_back(item);
+    }
+    InlinedVector(InlinedVector &&v) noexcept { TakeFrom(v); }
+    ~InlinedVector() {
+        clear();
+        if (!IsInline()) free(ptr);
+    }
+    InlinedVector &operator=(const InlinedVector &v) {
+        if (this == &v) return *this;
+        clear();
+        reserve(v.nStored);
+        for (const T &item : v) push_back(item);
+        return *this;
+    }
+    InlinedVector &operator=(InlinedVector &&v) noexcept {
+        if (this == &v) return *this;
+        clear();
+        if (!IsInline()) free(ptr);
+        ptr = (T *)inlineStorage;
+        capacity = N;
+        TakeFrom(v);
+        return *this;
+    }
+    size_t size() const { return nStored; }
+    bool empty() const { return nStored == 0; }
+    T *begin() { return ptr; }
+    T *end() { return ptr + nStored; }
+    const T *begin() const { return ptr; }
+    const T *end() const { return ptr + nStored; }
+    T &operator[](size_t i) { return ptr[i]; }
+    const T &operator[](size_t i) const { return ptr[i]; }
+    void reserve(size_t n) {
+        if (n <= capacity) return;
+        T *newPtr = (T *)malloc(n * sizeof(T));
+        for (size_t i = 0; i < nStored; ++i) {
+            new (&newPtr[i]) T(std::move(ptr[i]));
+            ptr[i].~T();
+        }
+        if (!IsInline()) free(ptr);
+        ptr = newPtr;
+        capacity = n;
+    }
+    void push_back(const T &value) {
+        if (nStored == capacity) {
+            // _value_ may refer to an element of this vector
+            T copy(value);
+            reserve(2 * capacity);
+            new (&ptr[nStored++]) T(std::move(copy));
+        } else
+            new (&ptr[nStored++]) T(value);
+    }
+    void push_back(T &&value) {
+        if (nStored == capacity) reserve(2 * capacity);
+        new (&ptr[nStored++]) T(std::move(value));
+    }
+    T *erase(T *pos) {
+        for (T *p = pos; p + 1 < end(); ++p) *p = std::move(p[1]);
+        ptr[--nStored].~T();
+        return pos;
+    }
+    void clear() {
+        for (size_t i = 0; i < nStored; ++i) ptr[i].~T();
+        nStored = 0;
+    }
+
+  private:
+    // InlinedVector Private Methods
+    bool IsInline() const { return ptr == (const T *)inlineStorage; }
+    void TakeFrom(InlinedVector &v) {
+        if (v.IsInline()) {
+            for (size_t i = 0; i < v.nStored; ++i) push_back(std::move(v[i]));
+            v.clear();
+        } else {
+            // Steal _v_'s heap allocation
+            ptr = v.ptr;
+            nStored = v.nStored;
+            capacity = v.capacity;
+            v.ptr = (T *)v.inlineStorage;
+            v.nStored = 0;
+            v.capacity = N;
+        }
+    }
+
+    // InlinedVector Private Data
+    T *ptr = (T *)inlineStorage;
+    size_t nStored = 0, capacity = N;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type inlineStorage[N];
+};
+
 }  // namespace pbrt
 
 #endif  // PBRT_CORE_MEMORY_H
@@ -44,31 +44,174 @@
 #include "texture.h"
 #include "stats.h"
 #include "parallel.h"
+#include "texcache.h"
+#include <mutex>
 
 namespace pbrt {
 
 STAT_COUNTER("Texture/EWA lookups", nEWALookups);
 STAT_COUNTER("Texture/Trilinear lookups", nTrilerpLookups);
+STAT_COUNTER("Texture/Multi-probe lookups", nMultiProbeLookups);
 STAT_MEMORY_COUNTER("Memory/Texture MIP maps", mipMapMemory);
 
 // MIPMap Helper Declarations
 enum class ImageWrap { Repeat, Black, Clamp };
+// Filters for anisotropic lookups: EWA filtering of the texels in the
+// footprint's ellipse, a single isotropic trilinear lookup, or a series of
+// trilinear lookups along the ellipse's major axis
+enum class MIPFilter { EWA, Trilinear, MultiProbe };
 struct ResampleWeight {
     int firstTexel;
     Float weight[4];
 };
 
+// Texel Encoding Functions
+inline int TexelChannels(const Float *texels, int nTexels) { return 1; }
+inline int TexelChannels(const RGBSpectrum *texels, int nTexels) {
+    // Store greyscale images with a single channel
+    for (int i = 0; i < nTexels; ++i)
+        if (texels[i][0] != texels[i][1] || texels[i][0] != texels[i][2])
+            return 3;
+    return 1;
+}
+
+inline void EncodeTexel(const TexelFormat &format, Float v, uint8_t *texel) {
+    EncodeTexelComponent(format.encoding, v, texel, 0);
+}
+
+inline void EncodeTexel(const TexelFormat &format, const RGBSpectrum &v,
+                        uint8_t *texel) {
+    for (int c = 0; c < format.nChannels; ++c)
+        EncodeTexelComponent(format.encoding, v[c], texel, c);
+}
+
+inline void DecodeTexel(const TexelFormat &format, const uint8_t *texel,
+                        Float *v) {
+    if (format.nChannels == 1)
+        *v = DecodeTexelComponent(format.encoding, texel, 0);
+    else {
+        Float rgb[3];
+        for (int c = 0; c < 3; ++c)
+            rgb[c] = DecodeTexelComponent(format.encoding, texel, c);
+        *v = RGBSpectrum::FromRGB(rgb).y();
+    }
+}
+
+inline void DecodeTexel(const TexelFormat &format, const uint8_t *texel,
+                        RGBSpectrum *v) {
+    if (format.nChannels == 1)
+        *v = RGBSpectrum(DecodeTexelComponent(format.encoding, texel, 0));
+    else
+        for (int c = 0; c < 3; ++c)
+            (*v)[c] = DecodeTexelComponent(format.encoding, texel, c);
+}
+
+// Decodes _n_ consecutive texels, dispatching on their encoding once
+template <TexelEncoding encoding>
+inline void DecodeTexels(int nChannels, const uint8_t *texels, int n,
+                         Float *v) {
+    if (nChannels == 1)
+        for (int i = 0; i < n; ++i)
+            v[i] = DecodeTexelComponent<encoding>(texels, i);
+    else
+        for (int i = 0; i < n; ++i) {
+            Float rgb[3];
+            for (int c = 0; c < 3; ++c)
+                rgb[c] = DecodeTexelComponent<encoding>(texels, 3 * i + c);
+            v[i] = RGBSpectrum::FromRGB(rgb).y();
+        }
+}
+
+template <TexelEncoding encoding>
+inline void DecodeTexels(int nChannels, const uint8_t *texels, int n,
+                         RGBSpectrum *v) {
+    if (nChannels == 1)
+        for (int i = 0; i < n; ++i)
+            v[i] = RGBSpectrum(DecodeTexelComponent<encoding>(texels, i));
+    else
+        for (int i = 0; i < n; ++i)
+            for (int c = 0; c < 3; ++c)
+                v[i][c] = DecodeTexelComponent<encoding>(texels, 3 * i + c);
+}
+
+template <typename T>
+inline void DecodeTexels(const TexelFormat &format, const uint8_t *texels,
+                         int n, T *v) {
+    switch (format.encoding) {
+    case TexelEncoding::sRGB8:
+        DecodeTexels<TexelEncoding::sRGB8>(format.nChannels, texels, n, v);
+        break;
+    case TexelEncoding::Linear8:
+        DecodeTexels<TexelEncoding::Linear8>(format.nChannels, texels, n, v);
+        break;
+    case TexelEncoding::Half:
+        DecodeTexels<TexelEncoding::Half>(format.nChannels, texels, n, v);
+        break;
+    default:
+        DecodeTexels<TexelEncoding::Float>(format.nChannels, texels, n, v);
+        break;
+    }
+}
+
+inline bool EncodedExactly(TexelEncoding encoding, Float v) {
+    uint8_t texel[4];
+    EncodeTexelComponent(encoding, v, texel, 0);
+    return DecodeTexelComponent(encoding, texel, 0) == v;
+}
+
+inline bool EncodedExactly(TexelEncoding encoding, const RGBSpectrum &v) {
+    return EncodedExactly(encoding, v[0]) && EncodedExactly(encoding, v[1]) &&
+           EncodedExactly(encoding, v[2]);
+}
+
+// Returns the most compact encoding that represents all of the given
+// texels exactly.
+template <typename T>
+TexelEncoding CompactTexelEncoding(const T *texels, int nTexels) {
+    const int ChunkSize = 4096;
+    for (TexelEncoding encoding : {TexelEncoding::sRGB8, TexelEncoding::Linear8,
+                                   TexelEncoding::Half}) {
+        std::atomic<bool> exact{true};
+        ParallelFor([&](int64_t chunk) {
+            int end = std::min<int64_t>(nTexels, (chunk + 1) * ChunkSize);
+            for (int i = chunk * ChunkSize; i < end && exact; ++i)
+                if (!EncodedExactly(encoding, texels[i])) exact = false;
+        }, (nTexels + ChunkSize - 1) / ChunkSize);
+        if (exact) return encoding;
+    }
+    return TexelEncoding::Float;
+}
+
 // MIPMap Declarations
 template <typename T>
 class MIPMap {
   public:
     // MIPMap Public Methods
-    MIPMap(const Point2i &resolution, const T *data, bool doTri = false,
-           Float maxAniso = 8.f, ImageWrap wrapMode = ImageWrap::Repeat);
+    // Images with non-power-of-two resolutions are resampled; their texels
+    // are then stored in _encoding_ only if it represents the resampled
+    // ones exactly
+    MIPMap(const Point2i &resolution, const T *data,
+           MIPFilter filter = MIPFilter::EWA, Float maxAniso = 8.f,
+           ImageWrap wrapMode = ImageWrap::Repeat,
+           bool useTextureCache = false,
+           TexelEncoding encoding = TexelEncoding::Float);
+    MIPMap(const std::vector<Point2i> &levelResolution,
+           const std::vector<std::unique_ptr<T[]>> &levels, MIPFilter filter,
+           Float maxAniso, ImageWrap wrapMode, bool useTextureCache = false,
+           TexelEncoding encoding = TexelEncoding::Float);
+    MIPMap(std::shared_ptr<const TiledMIPMapFile> mipFile, MIPFilter filter,
+           Float maxAniso, ImageWrap wrapMode, bool useTextureCache = false);
+    ~MIPMap() {
+        if (cachedTexture != -1) textureCache.RemoveTexture(cachedTexture);
+    }
     int Width() const { return resolution[0]; }
     int Height() const { return resolution[1]; }
-    int Levels() const { return pyramid.size(); }
-    const T &Texel(int level, int s, int t) const;
+    int Levels() const { return levels.Levels(); }
+    Point2i LevelResolution(int level) const {
+        return levels.levelResolution[level];
+    }
+    const TexelFormat &Format() const { return format; }
+    T Texel(int level, int s, int t) const;
     T Lookup(const Point2f &st, Float width = 0.f) const;
     T Lookup(const Point2f &st, Vector2f dstdx, Vector2f dstdy) const;
 
@@ -99,27 +242,67 @@ class MIPMap {
     SampledSpectrum clamp(const SampledSpectrum &v) {
         return v.Clamp(0.f, Infinity);
     }
+    bool WrapTexel(const Point2i &res, int *s, int *t) const {
+        // Remap texel $(s,t)$ according to the wrap mode
+        switch (wrapMode) {
+        case ImageWrap::Repeat:
+            *s = Mod(*s, res.x);
+            *t = Mod(*t, res.y);
+            break;
+        case ImageWrap::Clamp:
+            *s = Clamp(*s, 0, res.x - 1);
+            *t = Clamp(*t, 0, res.y - 1);
+            break;
+        case ImageWrap::Black:
+            if (*s < 0 || *s >= res.x || *t < 0 || *t >= res.y) return false;
+            break;
+        }
+        return true;
+    }
+    const uint8_t *TileTexels(int level, int s, int t) const {
+        // Return the texels of the tile holding texel $(s,t)$
+        const int LogTileRes = TiledLevels::LogTileRes;
+        int tx = s >> LogTileRes, ty = t >> LogTileRes;
+        if (texels)
+            return texels.get() + levels.TileOffset(level, tx, ty, nullptr);
+        else if (cachedTexture != -1)
+            return textureCache.Tile(cachedTexture, level, tx, ty);
+        else
+            return mipFile->Tile(level, tx, ty);
+    }
+    void TexelRow(int level, int s, int t, int n, T *row) const;
+    void StoreLevel(int level, const T *data);
+    void Initialize(bool useTextureCache);
     T triangle(int level, const Point2f &st) const;
     T EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const;
 
     // MIPMap Private Data
-    const bool doTrilinear;
+    const MIPFilter filter;
     const Float maxAnisotropy;
     const ImageWrap wrapMode;
     Point2i resolution;
-    std::vector<std::unique_ptr<BlockedArray<T>>> pyramid;
+    // Each level is stored as tiles of texels in _format_; they're held in
+    // _texels_, read from _mipFile_ when it's mapped, or paged in from the
+    // _TextureCache_ if the MIP map has a _cachedTexture_ there
+    TexelFormat format;
+    TiledLevels levels;
+    std::unique_ptr<uint8_t[]> texels;
+    std::shared_ptr<const TiledMIPMapFile> mipFile;
+    int cachedTexture = -1;
     static PBRT_CONSTEXPR int WeightLUTSize = 128;
     static Float weightLut[WeightLUTSize];
 };
 
 // MIPMap Method Definitions
 template <typename T>
-MIPMap<T>::MIPMap(const Point2i &res, const T *img, bool doTrilinear,
-                  Float maxAnisotropy, ImageWrap wrapMode)
-    : doTrilinear(doTrilinear),
+MIPMap<T>::MIPMap(const Point2i &res, const T *img, MIPFilter filter,
+                  Float maxAnisotropy, ImageWrap wrapMode,
+                  bool useTextureCache, TexelEncoding encoding)
+    : filter(filter),
       maxAnisotropy(maxAnisotropy),
       wrapMode(wrapMode),
-      resolution(res) {
+      resolution(res),
+      format(encoding, TexelChannels(img, res.x * res.y)) {
     ProfilePhase _(Prof::MIPMapCreation);
 
     std::unique_ptr<T[]> resampledImage = nullptr;
@@ -180,65 +363,198 @@ MIPMap<T>::MIPMap(const Point2i &res, const T *img, bool doTrilinear,
         }, resPow2[0], 32);
         for (auto ptr : resampleBufs) delete[] ptr;
         resolution = resPow2;
+
+        // The requested encoding may not represent the resampled texels
+        // exactly, so use the most compact one that does
+        if (encoding != TexelEncoding::Float)
+            format = TexelFormat(
+                CompactTexelEncoding(resampledImage.get(),
+                                     resolution.x * resolution.y),
+                format.nChannels);
     }
     // Initialize levels of MIPMap from image
     int nLevels = 1 + Log2Int(std::max(resolution[0], resolution[1]));
-    pyramid.resize(nLevels);
-
-    // Initialize most detailed level of MIPMap
-    pyramid[0].reset(
-        new BlockedArray<T>(resolution[0], resolution[1],
-                            resampledImage ? resampledImage.get() : img));
+    std::vector<Point2i> levelResolution(nLevels, resolution);
+    for (int i = 1; i < nLevels; ++i)
+        levelResolution[i] =
+            Point2i(std::max(1, levelResolution[i - 1].x / 2),
+                    std::max(1, levelResolution[i - 1].y / 2));
+    levels = TiledLevels(levelResolution, format.texelBytes);
+    texels.reset(new uint8_t[levels.TotalBytes()]);
+
+    // Store most detailed level of MIPMap
+    const T *prevLevel = resampledImage ? resampledImage.get() : img;
+    StoreLevel(0, prevLevel);
+    std::unique_ptr<T[]> levelTexels;
     for (int i = 1; i < nLevels; ++i) {
-        // Initialize $i$th MIPMap level from $i-1$st level
-        int sRes = std::max(1, pyramid[i - 1]->uSize() / 2);
-        int tRes = std::max(1, pyramid[i - 1]->vSize() / 2);
-        pyramid[i].reset(new BlockedArray<T>(sRes, tRes));
-
-        // Filter four texels from finer level of pyramid
+        // Filter four texels from finer level of pyramid for $i$th level
+        const Point2i &prevRes = levelResolution[i - 1];
+        auto prevTexel = [&](int s, int t) {
+            if (!WrapTexel(prevRes, &s, &t)) return T(0.f);
+            return prevLevel[t * prevRes.x + s];
+        };
+        int sRes = levelResolution[i].x, tRes = levelResolution[i].y;
+        std::unique_ptr<T[]> level(new T[sRes * tRes]);
         ParallelFor([&](int t) {
             for (int s = 0; s < sRes; ++s)
-                (*pyramid[i])(s, t) =
-                    .25f * (Texel(i - 1, 2 * s, 2 * t) +
-                            Texel(i - 1, 2 * s + 1, 2 * t) +
-                            Texel(i - 1, 2 * s, 2 * t + 1) +
-                            Texel(i - 1, 2 * s + 1, 2 * t + 1));
+                level[t * sRes + s] =
+                    .25f * (prevTexel(2 * s, 2 * t) +
+                            prevTexel(2 * s + 1, 2 * t) +
+                            prevTexel(2 * s, 2 * t + 1) +
+                            prevTexel(2 * s + 1, 2 * t + 1));
         }, tRes, 16);
+        StoreLevel(i, level.get());
+        levelTexels = std::move(level);
+        prevLevel = levelTexels.get();
     }
+    Initialize(useTextureCache);
+}
+
+template <typename T>
+MIPMap<T>::MIPMap(const std::vector<Point2i> &levelResolution,
+                  const std::vector<std::unique_ptr<T[]>> &levelTexels,
+                  MIPFilter filter, Float maxAnisotropy, ImageWrap wrapMode,
+                  bool useTextureCache, TexelEncoding encoding)
+    : filter(filter),
+      maxAnisotropy(maxAnisotropy),
+      wrapMode(wrapMode),
+      resolution(levelResolution[0]),
+      format(encoding, TexelChannels(levelTexels[0].get(),
+                                     resolution.x * resolution.y)),
+      levels(levelResolution, format.texelBytes),
+      texels(new uint8_t[levels.TotalBytes()]) {
+    for (int i = 0; i < Levels(); ++i) StoreLevel(i, levelTexels[i].get());
+    Initialize(useTextureCache);
+}
+
+template <typename T>
+MIPMap<T>::MIPMap(std::shared_ptr<const TiledMIPMapFile> mipFile,
+                  MIPFilter filter, Float maxAnisotropy, ImageWrap wrapMode,
+                  bool useTextureCache)
+    : filter(filter),
+      maxAnisotropy(maxAnisotropy),
+      wrapMode(wrapMode),
+      resolution(mipFile->Levels().levelResolution[0]),
+      format(TexelEncoding::Float, mipFile->Channels()),
+      levels(mipFile->Levels()),
+      mipFile(mipFile) {
+    Initialize(useTextureCache);
+}
+
+template <typename T>
+void MIPMap<T>::StoreLevel(int level, const T *data) {
+    // Encode the level's texels into its tiles
+    const int TileRes = TiledLevels::TileRes;
+    const Point2i &res = levels.levelResolution[level];
+    Point2i nTiles = levels.TileCount(level);
+    ParallelFor([&](int ty) {
+        int t0 = ty * TileRes, t1 = std::min(t0 + TileRes, res.y);
+        for (int tx = 0; tx < nTiles.x; ++tx) {
+            int s0 = tx * TileRes, s1 = std::min(s0 + TileRes, res.x);
+            uint8_t *tile =
+                texels.get() + levels.TileOffset(level, tx, ty, nullptr);
+            for (int t = t0; t < t1; ++t)
+                for (int s = s0; s < s1; ++s) {
+                    EncodeTexel(format, data[t * res.x + s], tile);
+                    tile += format.texelBytes;
+                }
+        }
+    }, nTiles.y);
+}
 
-    // Initialize EWA filter weights if needed
-    if (weightLut[0] == 0.) {
+template <typename T>
+void MIPMap<T>::Initialize(bool useTextureCache) {
+    // Initialize EWA filter weights once; MIP maps may be built by several
+    // threads at once
+    static std::once_flag weightLutInitialized;
+    std::call_once(weightLutInitialized, []() {
         for (int i = 0; i < WeightLUTSize; ++i) {
             Float alpha = 2;
             Float r2 = Float(i) / Float(WeightLUTSize - 1);
             weightLut[i] = std::exp(-alpha * r2) - std::exp(-alpha);
         }
+    });
+
+    if (mipFile) {
+        // Page tiles from the MIP map file if requested; otherwise they're
+        // read from its mapping
+        if (useTextureCache && TextureCache::Enabled()) {
+            cachedTexture = textureCache.AddTexture(
+                mipFile->Filename(), mipFile->DataOffset(), mipFile->Levels());
+            if (cachedTexture != -1) mipFile.reset();
+        }
+        return;
+    }
+
+    // Move the levels' tiles to the texture cache if requested
+    if (useTextureCache && TextureCache::Enabled()) {
+        cachedTexture = textureCache.AddTexture(
+            levels.levelResolution, format.texelBytes,
+            [&](int level, int tx, int ty, uint8_t *dst) {
+                size_t bytes;
+                int64_t offset = levels.TileOffset(level, tx, ty, &bytes);
+                memcpy(dst, texels.get() + offset, bytes);
+            });
+        if (cachedTexture != -1) {
+            texels.reset();
+            return;
+        }
     }
-    mipMapMemory += (4 * resolution[0] * resolution[1] * sizeof(T)) / 3;
+    mipMapMemory += levels.TotalBytes();
 }
 
 template <typename T>
-const T &MIPMap<T>::Texel(int level, int s, int t) const {
-    CHECK_LT(level, pyramid.size());
-    const BlockedArray<T> &l = *pyramid[level];
+T MIPMap<T>::Texel(int level, int s, int t) const {
+    CHECK_LT(level, Levels());
+    const Point2i &res = levels.levelResolution[level];
     // Compute texel $(s,t)$ accounting for boundary conditions
-    switch (wrapMode) {
-    case ImageWrap::Repeat:
-        s = Mod(s, l.uSize());
-        t = Mod(t, l.vSize());
-        break;
-    case ImageWrap::Clamp:
-        s = Clamp(s, 0, l.uSize() - 1);
-        t = Clamp(t, 0, l.vSize() - 1);
-        break;
-    case ImageWrap::Black: {
-        static const T black = 0.f;
-        if (s < 0 || s >= (int)l.uSize() || t < 0 || t >= (int)l.vSize())
-            return black;
-        break;
+    if (!WrapTexel(res, &s, &t)) return T(0.f);
+
+    // Find the tile holding texel $(s,t)$ and decode the texel
+    const int TileRes = TiledLevels::TileRes;
+    int tileWidth = std::min(TileRes, res.x - (s & ~(TileRes - 1)));
+    int offset = (t & (TileRes - 1)) * tileWidth + (s & (TileRes - 1));
+    T texel;
+    DecodeTexel(format, TileTexels(level, s, t) + offset * format.texelBytes,
+                &texel);
+    return texel;
+}
+
+template <typename T>
+void MIPMap<T>::TexelRow(int level, int s, int t, int n, T *row) const {
+    // Decode texels $s$ through $s+n-1$ of row $t$, applying the wrap mode
+    // once per contiguous run of texels rather than per texel
+    const Point2i &res = levels.levelResolution[level];
+    int s0 = 0;
+    if ((t < 0 || t >= res.y) && !WrapTexel(res, &s0, &t)) {
+        for (int i = 0; i < n; ++i) row[i] = T(0.f);
+        return;
     }
+    const int TileRes = TiledLevels::TileRes;
+    while (n > 0) {
+        int ws = s;
+        if (ws < 0 || ws >= res.x) {
+            if (wrapMode == ImageWrap::Repeat)
+                ws = Mod(s, res.x);
+            else {
+                // Handle texels outside the level one at a time
+                *row++ = Texel(level, s++, t);
+                --n;
+                continue;
+            }
+        }
+        // Decode the run of texels up to the end of the level or its tile
+        int tileStart = ws & ~(TileRes - 1);
+        int tileWidth = std::min(TileRes, res.x - tileStart);
+        int count = std::min(n, tileStart + tileWidth - ws);
+        int offset = (t & (TileRes - 1)) * tileWidth + (ws - tileStart);
+        DecodeTexels(format,
+                     TileTexels(level, ws, t) + offset * format.texelBytes,
+                     count, row);
+        row += count;
+        s += count;
+        n -= count;
     }
-    return l(s, t);
 }
 
 template <typename T>
@@ -263,25 +579,30 @@ T MIPMap<T>::Lookup(const Point2f &st, Float width) const {
 template <typename T>
 T MIPMap<T>::triangle(int level, const Point2f &st) const {
     level = Clamp(level, 0, Levels() - 1);
-    Float s = st[0] * pyramid[level]->uSize() - 0.5f;
-    Float t = st[1] * pyramid[level]->vSize() - 0.5f;
+    Float s = st[0] * levels.levelResolution[level].x - 0.5f;
+    Float t = st[1] * levels.levelResolution[level].y - 0.5f;
     int s0 = std::floor(s), t0 = std::floor(t);
     Float ds = s - s0, dt = t - t0;
-    return (1 - ds) * (1 - dt) * Texel(level, s0, t0) +
-           (1 - ds) * dt * Texel(level, s0, t0 + 1) +
-           ds * (1 - dt) * Texel(level, s0 + 1, t0) +
-           ds * dt * Texel(level, s0 + 1, t0 + 1);
+    T v[4];
+    TexelRow(level, s0, t0, 2, &v[0]);
+    TexelRow(level, s0, t0 + 1, 2, &v[2]);
+    return (1 - ds) * (1 - dt) * v[0] + (1 - ds) * dt * v[2] +
+           ds * (1 - dt) * v[1] + ds * dt * v[3];
 }
 
 template <typename T>
 T MIPMap<T>::Lookup(const Point2f &st, Vector2f dst0, Vector2f dst1) const {
-    if (doTrilinear) {
+    if (filter == MIPFilter::Trilinear) {
         Float width = std::max(std::max(std::abs(dst0[0]), std::abs(dst0[1])),
                                std::max(std::abs(dst1[0]), std::abs(dst1[1])));
         return Lookup(st, 2 * width);
     }
-    ++nEWALookups;
-    ProfilePhase p(Prof::TexFiltEWA);
+    bool multiProbe = filter == MIPFilter::MultiProbe;
+    if (multiProbe)
+        ++nMultiProbeLookups;
+    else
+        ++nEWALookups;
+    ProfilePhase p(multiProbe ? Prof::TexFiltMultiProbe : Prof::TexFiltEWA);
     // Compute ellipse minor and major axes
     if (dst0.LengthSquared() < dst1.LengthSquared()) std::swap(dst0, dst1);
     Float majorLength = dst0.Length();
@@ -295,6 +616,22 @@ T MIPMap<T>::Lookup(const Point2f &st, Vector2f dst0, Vector2f dst1) const {
     }
     if (minorLength == 0) return triangle(0, st);
 
+    if (multiProbe) {
+        // Filter trilinear probes spaced along the ellipse's major axis
+        int nProbes = std::ceil(majorLength / minorLength);
+        T sum(0.f);
+        Float sumWts = 0;
+        for (int i = 0; i < nProbes; ++i) {
+            Float u = 2 * (i + .5f) / nProbes - 1;
+            int index =
+                std::min((int)(u * u * WeightLUTSize), WeightLUTSize - 1);
+            Float weight = weightLut[index];
+            sum += Lookup(st + u * dst0, minorLength) * weight;
+            sumWts += weight;
+        }
+        return sum / sumWts;
+    }
+
     // Choose level of detail for EWA lookup and perform EWA filtering
     Float lod = std::max((Float)0, Levels() - (Float)1 + Log2(minorLength));
     int ilod = std::floor(lod);
@@ -306,12 +643,13 @@ template <typename T>
 T MIPMap<T>::EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const {
     if (level >= Levels()) return Texel(Levels() - 1, 0, 0);
     // Convert EWA coordinates to appropriate scale for level
-    st[0] = st[0] * pyramid[level]->uSize() - 0.5f;
-    st[1] = st[1] * pyramid[level]->vSize() - 0.5f;
-    dst0[0] *= pyramid[level]->uSize();
-    dst0[1] *= pyramid[level]->vSize();
-    dst1[0] *= pyramid[level]->uSize();
-    dst1[1] *= pyramid[level]->vSize();
+    const Point2i &res = levels.levelResolution[level];
+    st[0] = st[0] * res.x - 0.5f;
+    st[1] = st[1] * res.y - 0.5f;
+    dst0[0] *= res.x;
+    dst0[1] *= res.y;
+    dst1[0] *= res.x;
+    dst1[1] *= res.y;
 
     // Compute ellipse coefficients to bound EWA filter region
     Float A = dst0[1] * dst0[1] + dst1[1] * dst1[1] + 1;
@@ -331,21 +669,47 @@ T MIPMap<T>::EWA(int level, Point2f st, Vector2f dst0, Vector2f dst1) const {
     int t0 = std::ceil(st[1] - 2 * invDet * vSqrt);
     int t1 = std::floor(st[1] + 2 * invDet * vSqrt);
 
-    // Scan over ellipse bound and compute quadratic equation
+    // Filter the texels inside the ellipse a row at a time
+    const int MaxRun = 32;
+    Float weights[MaxRun];
+    T texels[MaxRun];
     T sum(0.f);
     Float sumWts = 0;
+    Float inv2A = 1 / (2 * A);
     for (int it = t0; it <= t1; ++it) {
         Float tt = it - st[1];
-        for (int is = s0; is <= s1; ++is) {
-            Float ss = is - st[0];
-            // Compute squared radius and filter texel if inside ellipse
-            Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
-            if (r2 < 1) {
-                int index =
-                    std::min((int)(r2 * WeightLUTSize), WeightLUTSize - 1);
-                Float weight = weightLut[index];
-                sum += Texel(level, is, it) * weight;
-                sumWts += weight;
+        // Find the span of the row's texels that may be inside the ellipse;
+        // truncation plus a margin of two texels bounds the roots
+        Float b = B * tt, c = C * tt * tt - 1;
+        Float discrim = b * b - 4 * A * c;
+        if (discrim < 0) continue;
+        Float rootDiscrim = std::sqrt(discrim);
+        int rs0 = std::max(s0, (int)(st[0] + (-b - rootDiscrim) * inv2A) - 2);
+        int rs1 = std::min(s1, (int)(st[0] + (-b + rootDiscrim) * inv2A) + 2);
+
+        for (int is = rs0; is <= rs1; is += MaxRun) {
+            int n = std::min(MaxRun, rs1 - is + 1);
+            // Compute filter weights for the run of texels; texels outside
+            // the ellipse map to the table's last entry, which is zero, so
+            // the loop doesn't branch
+            for (int i = 0; i < n; ++i) {
+                Float ss = is + i - st[0];
+                Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+                weights[i] = weightLut[std::min(
+                    (int)(std::min(r2, (Float)1) * WeightLUTSize),
+                    WeightLUTSize - 1)];
+            }
+
+            // Accumulate the run's weighted texels, skipping the zero
+            // weights at its ends
+            int i0 = 0, i1 = n;
+            while (i0 < i1 && weights[i0] == 0) ++i0;
+            while (i1 > i0 && weights[i1 - 1] == 0) --i1;
+            if (i0 == i1) continue;
+            TexelRow(level, is + i0, it, i1 - i0, texels);
+            for (int i = i0; i < i1; ++i) {
+                sum += texels[i - i0] * weights[i];
+                sumWts += weights[i];
             }
         }
     }
@@ -35,6 +35,7 @@
 #include "parallel.h"
 #include "memory.h"
 #include "stats.h"
+#include <deque>
 #include <list>
 #include <thread>
 #include <condition_variable>
@@ -47,6 +48,12 @@ static bool shutdownThreads = false;
 class ParallelForLoop;
 static ParallelForLoop *workList = nullptr;
 static std::mutex workListMutex;
+struct AsyncTask {
+    std::function<void()> func;
+    uint64_t profilerState;
+};
+static std::deque<AsyncTask> asyncTasks;
+static int nPendingAsyncTasks = 0;
 
 // Bookkeeping variables to help with the implementation of
 // MergeWorkerThreadStats().
@@ -109,6 +116,33 @@ void Barrier::Wait() {
 
 static std::condition_variable workListCondition;
 
+// Removes _loop_ from _workList_ once all of its iterations have been
+// handed out. Several threads may run parallel loops at once, so the loop
+// isn't necessarily at the head of the list; _workListMutex_ must be held.
+static void unlinkLoop(ParallelForLoop *loop) {
+    for (ParallelForLoop **p = &workList; *p; p = &(*p)->next)
+        if (*p == loop) {
+            *p = loop->next;
+            loop->next = nullptr;
+            return;
+        }
+}
+
+static void runAsyncTask(std::unique_lock<std::mutex> &lock) {
+    // Remove the oldest task from _asyncTasks_ and run it without the lock
+    AsyncTask task = std::move(asyncTasks.front());
+    asyncTasks.pop_front();
+    lock.unlock();
+    uint64_t oldState = ProfilerState;
+    ProfilerState = task.profilerState;
+    task.func();
+    ProfilerState = oldState;
+    lock.lock();
+
+    // Wake up threads waiting in _WaitForAsyncTasks()_ after the last task
+    if (--nPendingAsyncTasks == 0) workListCondition.notify_all();
+}
+
 static void workerThreadFunc(int tIndex, std::shared_ptr<Barrier> barrier) {
     LOG(INFO) << "Started execution in worker thread " << tIndex;
     ThreadIndex = tIndex;
@@ -136,9 +170,13 @@ static void workerThreadFunc(int tIndex, std::shared_ptr<Barrier> barrier) {
                 reportDoneCondition.notify_one();
             // Now sleep again.
             workListCondition.wait(lock);
-        } else if (!workList) {
+        } else if (!workList && asyncTasks.empty()) {
             // Sleep until there are more tasks to run
             workListCondition.wait(lock);
+        } else if (!workList) {
+            // Run an asynchronous task; parallel loops take priority since
+            // running tasks may be waiting for them
+            runAsyncTask(lock);
         } else {
             // Get work from _workList_ and run loop iterations
             ParallelForLoop &loop = *workList;
@@ -152,7 +190,7 @@ static void workerThreadFunc(int tIndex, std::shared_ptr<Barrier> barrier) {
 
             // Update _loop_ to reflect iterations this thread will run
             loop.nextIndex = indexEnd;
-            if (loop.nextIndex == loop.maxIndex) workList = loop.next;
+            if (loop.nextIndex == loop.maxIndex) unlinkLoop(&loop);
             loop.activeWorkers++;
 
             // Run loop indices in _[indexStart, indexEnd)_
@@ -180,31 +218,23 @@ static void workerThreadFunc(int tIndex, std::shared_ptr<Barrier> barrier) {
     LOG(INFO) << "Exiting worker thread " << tIndex;
 }
 
-// Parallel Definitions
-void ParallelFor(std::function<void(int64_t)> func, int64_t count,
-                 int chunkSize) {
-    CHECK(threads.size() > 0 || MaxThreadIndex() == 1);
-
-    // Run iterations immediately if not using threads or if _count_ is small
-    if (threads.empty() || count < chunkSize) {
-        for (int64_t i = 0; i < count; ++i) func(i);
-        return;
-    }
-
-    // Create and enqueue _ParallelForLoop_ for this loop
-    ParallelForLoop loop(std::move(func), count, chunkSize,
-                         CurrentProfilerState());
-    workListMutex.lock();
+// Enqueues _loop_ and runs its iterations in the calling thread along with
+// the worker threads, returning once all of them have finished. Loops may
+// be run from several threads at once, including from within other loops'
+// iterations.
+static void runLoop(ParallelForLoop &loop) {
+    std::unique_lock<std::mutex> lock(workListMutex);
     loop.next = workList;
     workList = &loop;
-    workListMutex.unlock();
-
-    // Notify worker threads of work to be done
-    std::unique_lock<std::mutex> lock(workListMutex);
     workListCondition.notify_all();
 
     // Help out with parallel loop iterations in the current thread
     while (!loop.Finished()) {
+        if (loop.nextIndex >= loop.maxIndex) {
+            // Wait for the threads running the last iterations to finish
+            workListCondition.wait(lock);
+            continue;
+        }
         // Run a chunk of loop iterations for _loop_
 
         // Find the set of loop iterations to run next
@@ -213,7 +243,7 @@ void ParallelFor(std::function<void(int64_t)> func, int64_t count,
 
         // Update _loop_ to reflect iterations this thread will run
         loop.nextIndex = indexEnd;
-        if (loop.nextIndex == loop.maxIndex) workList = loop.next;
+        if (loop.nextIndex == loop.maxIndex) unlinkLoop(&loop);
         loop.activeWorkers++;
 
         // Run loop indices in _[indexStart, indexEnd)_
@@ -238,6 +268,23 @@ void ParallelFor(std::function<void(int64_t)> func, int64_t count,
     }
 }
 
+// Parallel Definitions
+void ParallelFor(std::function<void(int64_t)> func, int64_t count,
+                 int chunkSize) {
+    CHECK(threads.size() > 0 || MaxThreadIndex() == 1);
+
+    // Run iterations immediately if not using threads or if _count_ is small
+    if (threads.empty() || count < chunkSize) {
+        for (int64_t i = 0; i < count; ++i) func(i);
+        return;
+    }
+
+    // Create and enqueue _ParallelForLoop_ for this loop
+    ParallelForLoop loop(std::move(func), count, chunkSize,
+                         CurrentProfilerState());
+    runLoop(loop);
+}
+
 PBRT_THREAD_LOCAL int ThreadIndex;
 
 int MaxThreadIndex() {
@@ -254,47 +301,30 @@ void ParallelFor2D(std::function<void(Point2i)> func, const Point2i &count) {
     }
 
     ParallelForLoop loop(std::move(func), count, CurrentProfilerState());
-    {
-        std::lock_guard<std::mutex> lock(workListMutex);
-        loop.next = workList;
-        workList = &loop;
-    }
-
-    std::unique_lock<std::mutex> lock(workListMutex);
-    workListCondition.notify_all();
-
-    // Help out with parallel loop iterations in the current thread
-    while (!loop.Finished()) {
-        // Run a chunk of loop iterations for _loop_
-
-        // Find the set of loop iterations to run next
-        int64_t indexStart = loop.nextIndex;
-        int64_t indexEnd = std::min(indexStart + loop.chunkSize, loop.maxIndex);
+    runLoop(loop);
+}
 
-        // Update _loop_ to reflect iterations this thread will run
-        loop.nextIndex = indexEnd;
-        if (loop.nextIndex == loop.maxIndex) workList = loop.next;
-        loop.activeWorkers++;
+void RunAsync(std::function<void()> func) {
+    // Run _func_ immediately if not using threads
+    if (threads.empty()) {
+        func();
+        return;
+    }
 
-        // Run loop indices in _[indexStart, indexEnd)_
-        lock.unlock();
-        for (int64_t index = indexStart; index < indexEnd; ++index) {
-            uint64_t oldState = ProfilerState;
-            ProfilerState = loop.profilerState;
-            if (loop.func1D) {
-                loop.func1D(index);
-            }
-            // Handle other types of loops
-            else {
-                CHECK(loop.func2D);
-                loop.func2D(Point2i(index % loop.nX, index / loop.nX));
-            }
-            ProfilerState = oldState;
-        }
-        lock.lock();
+    std::lock_guard<std::mutex> lock(workListMutex);
+    asyncTasks.push_back({std::move(func), CurrentProfilerState()});
+    ++nPendingAsyncTasks;
+    workListCondition.notify_one();
+}
 
-        // Update _loop_ to reflect completion of iterations
-        loop.activeWorkers--;
+void WaitForAsyncTasks() {
+    std::unique_lock<std::mutex> lock(workListMutex);
+    while (nPendingAsyncTasks > 0) {
+        // Help out with tasks that haven't started yet
+        if (!asyncTasks.empty())
+            runAsyncTask(lock);
+        else
+            workListCondition.wait(lock);
     }
 }
 
@@ -323,6 +353,7 @@ void ParallelInit() {
 
 void ParallelCleanup() {
     if (threads.empty()) return;
+    WaitForAsyncTasks();
 
     {
         std::lock_guard<std::mutex> lock(workListMutex);
@@ -102,6 +102,11 @@ void ParallelFor(std::function<void(int64_t)> func, int64_t count,
                  int chunkSize = 1);
 extern PBRT_THREAD_LOCAL int ThreadIndex;
 void ParallelFor2D(std::function<void(Point2i)> func, const Point2i &count);
+// Asynchronous tasks run on the worker threads when they have no parallel
+// loop iterations to run; _WaitForAsyncTasks()_ returns once all of the
+// tasks queued so far have finished, helping run them in the meantime.
+void RunAsync(std::function<void()> func);
+void WaitForAsyncTasks();
 int MaxThreadIndex();
 int NumSystemCores();
 
@@ -35,106 +35,127 @@
 #include "paramset.h"
 #include "floatfile.h"
 #include "textures/constant.h"
+#include <mutex>
 
 namespace pbrt {
 
-// ParamSet Macros
-#define ADD_PARAM_TYPE(T, vec) \
-    (vec).emplace_back(new ParamSetItem<T>(name, std::move(values), nValues));
-#define LOOKUP_PTR(vec)             \
-    for (const auto &v : vec)       \
-        if (v->name == name) {      \
-            *nValues = v->nValues;  \
-            v->lookedUp = true;     \
-            return v->values.get(); \
-        }                           \
-    return nullptr
-#define LOOKUP_ONE(vec)                           \
-    for (const auto &v : vec)                     \
-        if (v->name == name && v->nValues == 1) { \
-            v->lookedUp = true;                   \
-            return v->values[0];                  \
-        }                                         \
-    return d
-
-// ParamSet Methods
+// ParamSet Method Definitions
+uint32_t HashParamName(const std::string &name) {
+    // 32-bit FNV-1a
+    uint32_t hash = 2166136261u;
+    for (char c : name) hash = (hash ^ (uint8_t)c) * 16777619u;
+    return hash;
+}
+
+template <typename T>
+void ParamSet::Add(ParamType type, const std::string &name,
+                   std::unique_ptr<T[]> v, int nValues) {
+    Erase(type, name);
+    params.push_back(
+        Param{std::make_shared<ParamSetItem<T>>(name, std::move(v), nValues),
+              HashParamName(name), type});
+}
+
+bool ParamSet::Erase(ParamType type, const std::string &name) {
+    uint32_t hash = HashParamName(name);
+    for (Param *p = params.begin(); p != params.end(); ++p)
+        if (p->nameHash == hash && p->type == type && p->item->name == name) {
+            params.erase(p);
+            return true;
+        }
+    return false;
+}
+
+template <typename T>
+const ParamSetItem<T> *ParamSet::Lookup(ParamType type,
+                                        const std::string &name) const {
+    uint32_t hash = HashParamName(name);
+    for (const Param &p : params)
+        if (p.nameHash == hash && p.type == type && p.item->name == name)
+            return static_cast<const ParamSetItem<T> *>(p.item.get());
+    return nullptr;
+}
+
+template <typename T>
+const T *ParamSet::LookupPtr(ParamType type, const std::string &name,
+                             int *nValues) const {
+    const ParamSetItem<T> *item = Lookup<T>(type, name);
+    if (!item) return nullptr;
+    *nValues = item->nValues;
+    item->lookedUp = true;
+    return item->values.get();
+}
+
+template <typename T>
+T ParamSet::LookupOne(ParamType type, const std::string &name,
+                      const T &d) const {
+    const ParamSetItem<T> *item = Lookup<T>(type, name);
+    if (!item || item->nValues != 1) return d;
+    item->lookedUp = true;
+    return item->values[0];
+}
+
 void ParamSet::AddFloat(const std::string &name,
                         std::unique_ptr<Float[]> values, int nValues) {
-    EraseFloat(name);
-    floats.emplace_back(
-        new ParamSetItem<Float>(name, std::move(values), nValues));
+    Add(ParamType::Float, name, std::move(values), nValues);
 }
 
 void ParamSet::AddInt(const std::string &name, std::unique_ptr<int[]> values,
                       int nValues) {
-    EraseInt(name);
-    ADD_PARAM_TYPE(int, ints);
+    Add(ParamType::Int, name, std::move(values), nValues);
 }
 
 void ParamSet::AddBool(const std::string &name, std::unique_ptr<bool[]> values,
                        int nValues) {
-    EraseBool(name);
-    ADD_PARAM_TYPE(bool, bools);
+    Add(ParamType::Bool, name, std::move(values), nValues);
 }
 
 void ParamSet::AddPoint2f(const std::string &name,
                           std::unique_ptr<Point2f[]> values, int nValues) {
-    ErasePoint2f(name);
-    ADD_PARAM_TYPE(Point2f, point2fs);
+    Add(ParamType::Point2f, name, std::move(values), nValues);
 }
 
 void ParamSet::AddVector2f(const std::string &name,
                            std::unique_ptr<Vector2f[]> values, int nValues) {
-    EraseVector2f(name);
-    ADD_PARAM_TYPE(Vector2f, vector2fs);
+    Add(ParamType::Vector2f, name, std::move(values), nValues);
 }
 
 void ParamSet::AddPoint3f(const std::string &name,
                           std::unique_ptr<Point3f[]> values, int nValues) {
-    ErasePoint3f(name);
-    ADD_PARAM_TYPE(Point3f, point3fs);
+    Add(ParamType::Point3f, name, std::move(values), nValues);
 }
 
 void ParamSet::AddVector3f(const std::string &name,
                            std::unique_ptr<Vector3f[]> values, int nValues) {
-    EraseVector3f(name);
-    ADD_PARAM_TYPE(Vector3f, vector3fs);
+    Add(ParamType::Vector3f, name, std::move(values), nValues);
 }
 
 void ParamSet::AddNormal3f(const std::string &name,
                            std::unique_ptr<Normal3f[]> values, int nValues) {
-    EraseNormal3f(name);
-    ADD_PARAM_TYPE(Normal3f, normals);
+    Add(ParamType::Normal3f, name, std::move(values), nValues);
 }
 
 void ParamSet::AddRGBSpectrum(const std::string &name,
                               std::unique_ptr<Float[]> values, int nValues) {
-    EraseSpectrum(name);
     CHECK_EQ(nValues % 3, 0);
     nValues /= 3;
     std::unique_ptr<Spectrum[]> s(new Spectrum[nValues]);
     for (int i = 0; i < nValues; ++i) s[i] = Spectrum::FromRGB(&values[3 * i]);
-    std::shared_ptr<ParamSetItem<Spectrum>> psi(
-        new ParamSetItem<Spectrum>(name, std::move(s), nValues));
-    spectra.push_back(psi);
+    Add(ParamType::Spectrum, name, std::move(s), nValues);
 }
 
 void ParamSet::AddXYZSpectrum(const std::string &name,
                               std::unique_ptr<Float[]> values, int nValues) {
-    EraseSpectrum(name);
     CHECK_EQ(nValues % 3, 0);
     nValues /= 3;
     std::unique_ptr<Spectrum[]> s(new Spectrum[nValues]);
     for (int i = 0; i < nValues; ++i) s[i] = Spectrum::FromXYZ(&values[3 * i]);
-    std::shared_ptr<ParamSetItem<Spectrum>> psi(
-        new ParamSetItem<Spectrum>(name, std::move(s), nValues));
-    spectra.push_back(psi);
+    Add(ParamType::Spectrum, name, std::move(s), nValues);
 }
 
 void ParamSet::AddBlackbodySpectrum(const std::string &name,
                                     std::unique_ptr<Float[]> values,
                                     int nValues) {
-    EraseSpectrum(name);
     CHECK_EQ(nValues % 2, 0);  // temperature (K), scale, ...
     nValues /= 2;
     std::unique_ptr<Spectrum[]> s(new Spectrum[nValues]);
@@ -144,15 +165,12 @@ void ParamSet::AddBlackbodySpectrum(const std::string &name,
         s[i] = values[2 * i + 1] *
                Spectrum::FromSampled(CIE_lambda, v.get(), nCIESamples);
     }
-    std::shared_ptr<ParamSetItem<Spectrum>> psi(
-        new ParamSetItem<Spectrum>(name, std::move(s), nValues));
-    spectra.push_back(psi);
+    Add(ParamType::Spectrum, name, std::move(s), nValues);
 }
 
 void ParamSet::AddSampledSpectrum(const std::string &name,
                                   std::unique_ptr<Float[]> values,
                                   int nValues) {
-    EraseSpectrum(name);
     CHECK_EQ(nValues % 2, 0);
     nValues /= 2;
     std::unique_ptr<Float[]> wl(new Float[nValues]);
@@ -163,20 +181,23 @@ void ParamSet::AddSampledSpectrum(const std::string &name,
     }
     std::unique_ptr<Spectrum[]> s(new Spectrum[1]);
     s[0] = Spectrum::FromSampled(wl.get(), v.get(), nValues);
-    std::shared_ptr<ParamSetItem<Spectrum>> psi(
-        new ParamSetItem<Spectrum>(name, std::move(s), 1));
-    spectra.push_back(psi);
+    Add(ParamType::Spectrum, name, std::move(s), 1);
 }
 
+// Scene files may be parsed on multiple threads; see parser.cpp
+static std::mutex cachedSpectraMutex;
+
 void ParamSet::AddSampledSpectrumFiles(const std::string &name,
                                        const char **names, int nValues) {
-    EraseSpectrum(name);
     std::unique_ptr<Spectrum[]> s(new Spectrum[nValues]);
     for (int i = 0; i < nValues; ++i) {
         std::string fn = AbsolutePath(ResolveFilename(names[i]));
-        if (cachedSpectra.find(fn) != cachedSpectra.end()) {
-            s[i] = cachedSpectra[fn];
-            continue;
+        {
+            std::lock_guard<std::mutex> lock(cachedSpectraMutex);
+            if (cachedSpectra.find(fn) != cachedSpectra.end()) {
+                s[i] = cachedSpectra[fn];
+                continue;
+            }
         }
 
         std::vector<Float> vals;
@@ -199,232 +220,161 @@ void ParamSet::AddSampledSpectrumFiles(const std::string &name,
             }
             s[i] = Spectrum::FromSampled(&wls[0], &v[0], wls.size());
         }
+        std::lock_guard<std::mutex> lock(cachedSpectraMutex);
         cachedSpectra[fn] = s[i];
     }
 
-    std::shared_ptr<ParamSetItem<Spectrum>> psi(
-        new ParamSetItem<Spectrum>(name, std::move(s), nValues));
-    spectra.push_back(psi);
+    Add(ParamType::Spectrum, name, std::move(s), nValues);
 }
 
 std::map<std::string, Spectrum> ParamSet::cachedSpectra;
 void ParamSet::AddString(const std::string &name,
                          std::unique_ptr<std::string[]> values, int nValues) {
-    EraseString(name);
-    ADD_PARAM_TYPE(std::string, strings);
+    Add(ParamType::String, name, std::move(values), nValues);
 }
 
 void ParamSet::AddTexture(const std::string &name, const std::string &value) {
-    EraseTexture(name);
     std::unique_ptr<std::string[]> str(new std::string[1]);
     str[0] = value;
-    std::shared_ptr<ParamSetItem<std::string>> psi(
-        new ParamSetItem<std::string>(name, std::move(str), 1));
-    textures.push_back(psi);
+    Add(ParamType::Texture, name, std::move(str), 1);
 }
 
 bool ParamSet::EraseInt(const std::string &n) {
-    for (size_t i = 0; i < ints.size(); ++i)
-        if (ints[i]->name == n) {
-            ints.erase(ints.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Int, n);
 }
 
 bool ParamSet::EraseBool(const std::string &n) {
-    for (size_t i = 0; i < bools.size(); ++i)
-        if (bools[i]->name == n) {
-            bools.erase(bools.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Bool, n);
 }
 
 bool ParamSet::EraseFloat(const std::string &n) {
-    for (size_t i = 0; i < floats.size(); ++i)
-        if (floats[i]->name == n) {
-            floats.erase(floats.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Float, n);
 }
 
 bool ParamSet::ErasePoint2f(const std::string &n) {
-    for (size_t i = 0; i < point2fs.size(); ++i)
-        if (point2fs[i]->name == n) {
-            point2fs.erase(point2fs.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Point2f, n);
 }
 
 bool ParamSet::EraseVector2f(const std::string &n) {
-    for (size_t i = 0; i < vector2fs.size(); ++i)
-        if (vector2fs[i]->name == n) {
-            vector2fs.erase(vector2fs.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Vector2f, n);
 }
 
 bool ParamSet::ErasePoint3f(const std::string &n) {
-    for (size_t i = 0; i < point3fs.size(); ++i)
-        if (point3fs[i]->name == n) {
-            point3fs.erase(point3fs.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Point3f, n);
 }
 
 bool ParamSet::EraseVector3f(const std::string &n) {
-    for (size_t i = 0; i < vector3fs.size(); ++i)
-        if (vector3fs[i]->name == n) {
-            vector3fs.erase(vector3fs.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Vector3f, n);
 }
 
 bool ParamSet::EraseNormal3f(const std::string &n) {
-    for (size_t i = 0; i < normals.size(); ++i)
-        if (normals[i]->name == n) {
-            normals.erase(normals.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Normal3f, n);
 }
 
 bool ParamSet::EraseSpectrum(const std::string &n) {
-    for (size_t i = 0; i < spectra.size(); ++i)
-        if (spectra[i]->name == n) {
-            spectra.erase(spectra.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Spectrum, n);
 }
 
 bool ParamSet::EraseString(const std::string &n) {
-    for (size_t i = 0; i < strings.size(); ++i)
-        if (strings[i]->name == n) {
-            strings.erase(strings.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::String, n);
 }
 
 bool ParamSet::EraseTexture(const std::string &n) {
-    for (size_t i = 0; i < textures.size(); ++i)
-        if (textures[i]->name == n) {
-            textures.erase(textures.begin() + i);
-            return true;
-        }
-    return false;
+    return Erase(ParamType::Texture, n);
 }
 
 Float ParamSet::FindOneFloat(const std::string &name, Float d) const {
-    for (const auto &f : floats)
-        if (f->name == name && f->nValues == 1) {
-            f->lookedUp = true;
-            return f->values[0];
-        }
-    return d;
+    return LookupOne(ParamType::Float, name, d);
 }
 
 const Float *ParamSet::FindFloat(const std::string &name, int *n) const {
-    for (const auto &f : floats)
-        if (f->name == name) {
-            *n = f->nValues;
-            f->lookedUp = true;
-            return f->values.get();
-        }
-    return nullptr;
+    return LookupPtr<Float>(ParamType::Float, name, n);
 }
 
 const int *ParamSet::FindInt(const std::string &name, int *nValues) const {
-    LOOKUP_PTR(ints);
+    return LookupPtr<int>(ParamType::Int, name, nValues);
 }
 
 const bool *ParamSet::FindBool(const std::string &name, int *nValues) const {
-    LOOKUP_PTR(bools);
+    return LookupPtr<bool>(ParamType::Bool, name, nValues);
 }
 
 int ParamSet::FindOneInt(const std::string &name, int d) const {
-    LOOKUP_ONE(ints);
+    return LookupOne(ParamType::Int, name, d);
 }
 
 bool ParamSet::FindOneBool(const std::string &name, bool d) const {
-    LOOKUP_ONE(bools);
+    return LookupOne(ParamType::Bool, name, d);
 }
 
 const Point2f *ParamSet::FindPoint2f(const std::string &name,
                                      int *nValues) const {
-    LOOKUP_PTR(point2fs);
+    return LookupPtr<Point2f>(ParamType::Point2f, name, nValues);
 }
 
 Point2f ParamSet::FindOnePoint2f(const std::string &name,
                                  const Point2f &d) const {
-    LOOKUP_ONE(point2fs);
+    return LookupOne(ParamType::Point2f, name, d);
 }
 
 const Vector2f *ParamSet::FindVector2f(const std::string &name,
                                        int *nValues) const {
-    LOOKUP_PTR(vector2fs);
+    return LookupPtr<Vector2f>(ParamType::Vector2f, name, nValues);
 }
 
 Vector2f ParamSet::FindOneVector2f(const std::string &name,
                                    const Vector2f &d) const {
-    LOOKUP_ONE(vector2fs);
+    return LookupOne(ParamType::Vector2f, name, d);
 }
 
 const Point3f *ParamSet::FindPoint3f(const std::string &name,
                                      int *nValues) const {
-    LOOKUP_PTR(point3fs);
+    return LookupPtr<Point3f>(ParamType::Point3f, name, nValues);
 }
 
 Point3f ParamSet::FindOnePoint3f(const std::string &name,
                                  const Point3f &d) const {
-    LOOKUP_ONE(point3fs);
+    return LookupOne(ParamType::Point3f, name, d);
 }
 
 const Vector3f *ParamSet::FindVector3f(const std::string &name,
                                        int *nValues) const {
-    LOOKUP_PTR(vector3fs);
+    return LookupPtr<Vector3f>(ParamType::Vector3f, name, nValues);
 }
 
 Vector3f ParamSet::FindOneVector3f(const std::string &name,
                                    const Vector3f &d) const {
-    LOOKUP_ONE(vector3fs);
+    return LookupOne(ParamType::Vector3f, name, d);
 }
 
 const Normal3f *ParamSet::FindNormal3f(const std::string &name,
                                        int *nValues) const {
-    LOOKUP_PTR(normals);
+    return LookupPtr<Normal3f>(ParamType::Normal3f, name, nValues);
 }
 
 Normal3f ParamSet::FindOneNormal3f(const std::string &name,
                                    const Normal3f &d) const {
-    LOOKUP_ONE(normals);
+    return LookupOne(ParamType::Normal3f, name, d);
 }
 
 const Spectrum *ParamSet::FindSpectrum(const std::string &name,
                                        int *nValues) const {
-    LOOKUP_PTR(spectra);
+    return LookupPtr<Spectrum>(ParamType::Spectrum, name, nValues);
 }
 
 Spectrum ParamSet::FindOneSpectrum(const std::string &name,
                                    const Spectrum &d) const {
-    LOOKUP_ONE(spectra);
+    return LookupOne(ParamType::Spectrum, name, d);
 }
 
 const std::string *ParamSet::FindString(const std::string &name,
                                         int *nValues) const {
-    LOOKUP_PTR(strings);
+    return LookupPtr<std::string>(ParamType::String, name, nValues);
 }
 
 std::string ParamSet::FindOneString(const std::string &name,
                                     const std::string &d) const {
-    LOOKUP_ONE(strings);
+    return LookupOne(ParamType::String, name, d);
 }
 
 std::string ParamSet::FindOneFilename(const std::string &name,
@@ -437,211 +387,107 @@ std::string ParamSet::FindOneFilename(const std::string &name,
 
 std::string ParamSet::FindTexture(const std::string &name) const {
     std::string d = "";
-    LOOKUP_ONE(textures);
+    return LookupOne(ParamType::Texture, name, d);
 }
 
 void ParamSet::ReportUnused() const {
-#define CHECK_UNUSED(v)              \
-    for (i = 0; i < (v).size(); ++i) \
-        if (!(v)[i]->lookedUp)       \
-    Warning("Parameter \"%s\" not used", (v)[i]->name.c_str())
-    size_t i;
-    CHECK_UNUSED(ints);
-    CHECK_UNUSED(bools);
-    CHECK_UNUSED(floats);
-    CHECK_UNUSED(point2fs);
-    CHECK_UNUSED(vector2fs);
-    CHECK_UNUSED(point3fs);
-    CHECK_UNUSED(vector3fs);
-    CHECK_UNUSED(normals);
-    CHECK_UNUSED(spectra);
-    CHECK_UNUSED(strings);
-    CHECK_UNUSED(textures);
-}
-
-void ParamSet::Clear() {
-#define DEL_PARAMS(name) (name).erase((name).begin(), (name).end())
-    DEL_PARAMS(ints);
-    DEL_PARAMS(bools);
-    DEL_PARAMS(floats);
-    DEL_PARAMS(point2fs);
-    DEL_PARAMS(vector2fs);
-    DEL_PARAMS(point3fs);
-    DEL_PARAMS(vector3fs);
-    DEL_PARAMS(normals);
-    DEL_PARAMS(spectra);
-    DEL_PARAMS(strings);
-    DEL_PARAMS(textures);
-#undef DEL_PARAMS
+    for (const Param &p : params)
+        if (!p.item->lookedUp)
+            Warning("Parameter \"%s\" not used", p.item->name.c_str());
+}
+
+void ParamSet::Clear() { params.clear(); }
+
+size_t ParamSet::ValueBytes() const {
+    size_t bytes = 0;
+    for (const Param &p : params) {
+        size_t valueSize = 0;
+        switch (p.type) {
+        case ParamType::Int:
+            valueSize = sizeof(int);
+            break;
+        case ParamType::Bool:
+            valueSize = sizeof(bool);
+            break;
+        case ParamType::Float:
+            valueSize = sizeof(Float);
+            break;
+        case ParamType::Point2f:
+        case ParamType::Vector2f:
+            valueSize = sizeof(Point2f);
+            break;
+        case ParamType::Point3f:
+        case ParamType::Vector3f:
+        case ParamType::Normal3f:
+            valueSize = sizeof(Point3f);
+            break;
+        case ParamType::String:
+        case ParamType::Texture:
+            valueSize = sizeof(std::string);
+            break;
+        case ParamType::Spectrum:
+            valueSize = sizeof(Spectrum);
+            break;
+        }
+        bytes += p.item->nValues * valueSize;
+    }
+    return bytes;
+}
+
+static std::string toString(int i) { return StringPrintf("%d ", i); }
+static std::string toString(bool v) {
+    return StringPrintf("\"%s\" ", v ? "true" : "false");
+}
+static std::string toString(Float f) { return StringPrintf("%.8g ", f); }
+static std::string toString(const Point2f &p) {
+    return StringPrintf("%.8g %.8g ", p.x, p.y);
+}
+static std::string toString(const Vector2f &v) {
+    return StringPrintf("%.8g %.8g ", v.x, v.y);
+}
+static std::string toString(const Point3f &p) {
+    return StringPrintf("%.8g %.8g %.8g ", p.x, p.y, p.z);
+}
+static std::string toString(const Vector3f &v) {
+    return StringPrintf("%.8g %.8g %.8g ", v.x, v.y, v.z);
+}
+static std::string toString(const Normal3f &n) {
+    return StringPrintf("%.8g %.8g %.8g ", n.x, n.y, n.z);
+}
+static std::string toString(const std::string &s) {
+    return StringPrintf("\"%s\" ", s.c_str());
+}
+static std::string toString(const Spectrum &s) {
+    Float rgb[3];
+    s.ToRGB(rgb);
+    return StringPrintf("%.8g %.8g %.8g ", rgb[0], rgb[1], rgb[2]);
+}
+
+template <typename T>
+static std::string itemToString(const char *type, const ParamSetItem<T> &item) {
+    std::string ret = StringPrintf("\"%s %s\" [", type, item.name.c_str());
+    for (int i = 0; i < item.nValues; ++i) ret += toString(item.values[i]);
+    return ret + "] ";
 }
 
 std::string ParamSet::ToString() const {
     std::string ret;
-    size_t i;
-    int j;
-    std::string typeString;
-    for (i = 0; i < ints.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<int>> &item = ints[i];
-        typeString = "integer ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("%d ", item->values[j]);
-        ret += std::string("] ");
-    }
-    for (i = 0; i < bools.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<bool>> &item = bools[i];
-        typeString = "bool ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("\"%s\" ", item->values[j] ? "true" : "false");
-        ret += std::string("] ");
-    }
-    for (i = 0; i < floats.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<Float>> &item = floats[i];
-        typeString = "float ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("%.8g ", item->values[j]);
-        ret += std::string("] ");
-    }
-    for (i = 0; i < point2fs.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<Point2f>> &item = point2fs[i];
-        typeString = "point2 ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("%.8g %.8g ", item->values[j].x,
-                                item->values[j].y);
-        ret += std::string("] ");
-    }
-    for (i = 0; i < vector2fs.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<Vector2f>> &item = vector2fs[i];
-        typeString = "vector2 ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("%.8g %.8g ", item->values[j].x,
-                                item->values[j].y);
-        ret += std::string("] ");
-    }
-    for (i = 0; i < point3fs.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<Point3f>> &item = point3fs[i];
-        typeString = "point3 ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("%.8g %.8g %.8g ", item->values[j].x,
-                                item->values[j].y, item->values[j].z);
-        ret += std::string("] ");
-    }
-    for (i = 0; i < vector3fs.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<Vector3f>> &item = vector3fs[i];
-        typeString = "vector3 ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("%.8g %.8g %.8g ", item->values[j].x,
-                                item->values[j].y, item->values[j].z);
-        ret += std::string("] ");
-    }
-    for (i = 0; i < normals.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<Normal3f>> &item = normals[i];
-        typeString = "normal ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("%.8g %.8g %.8g ", item->values[j].x,
-                                item->values[j].y, item->values[j].z);
-        ret += std::string("] ");
-    }
-    for (i = 0; i < strings.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<std::string>> &item = strings[i];
-        typeString = "string ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("\"%s\" ", item->values[j].c_str());
-        ret += std::string("] ");
-    }
-    for (i = 0; i < textures.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<std::string>> &item = textures[i];
-        typeString = "texture ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j)
-            ret += StringPrintf("\"%s\" ", item->values[j].c_str());
-        ret += std::string("] ");
-    }
-    for (i = 0; i < spectra.size(); ++i) {
-        const std::shared_ptr<ParamSetItem<Spectrum>> &item = spectra[i];
-        typeString = "color ";
-        // Print _ParamSetItem_ declaration, determine how many to print
-        int nPrint = item->nValues;
-        ret += std::string("\"");
-        ret += typeString;
-        ret += item->name;
-        ret += std::string("\"");
-        ret += std::string(" [");
-        for (j = 0; j < nPrint; ++j) {
-            Float rgb[3];
-            item->values[j].ToRGB(rgb);
-            ret += StringPrintf("%.8g %.8g %.8g ", rgb[0], rgb[1], rgb[2]);
-        }
-        ret += std::string("] ");
-    }
+#define TO_STRING(T, type, typeString)                              \
+    ForEachItem<T>(type, [&](const ParamSetItem<T> &item) {         \
+        ret += itemToString(typeString, item);                      \
+    })
+    TO_STRING(int, ParamType::Int, "integer");
+    TO_STRING(bool, ParamType::Bool, "bool");
+    TO_STRING(Float, ParamType::Float, "float");
+    TO_STRING(Point2f, ParamType::Point2f, "point2");
+    TO_STRING(Vector2f, ParamType::Vector2f, "vector2");
+    TO_STRING(Point3f, ParamType::Point3f, "point3");
+    TO_STRING(Vector3f, ParamType::Vector3f, "vector3");
+    TO_STRING(Normal3f, ParamType::Normal3f, "normal");
+    TO_STRING(std::string, ParamType::String, "string");
+    TO_STRING(std::string, ParamType::Texture, "texture");
+    TO_STRING(Spectrum, ParamType::Spectrum, "color");
+#undef TO_STRING
     return ret;
 }
 
@@ -688,33 +534,35 @@ static int print(const Spectrum &s) {
 }
 
 template <typename T>
-static void printItems(
-    const char *type, int indent,
-    const std::vector<std::shared_ptr<ParamSetItem<T>>> &items) {
-    for (const auto &item : items) {
-        int np = printf("\n%*s\"%s %s\" [ ", indent + 8, "", type,
-                        item->name.c_str());
-        for (int i = 0; i < item->nValues; ++i) {
-            np += print(item->values[i]);
-            if (np > 80 && i < item->nValues - 1)
-                np = printf("\n%*s", indent + 8, "");
-        }
-        printf("] ");
+static void printItem(const char *type, int indent,
+                      const ParamSetItem<T> &item) {
+    int np = printf("\n%*s\"%s %s\" [ ", indent + 8, "", type,
+                    item.name.c_str());
+    for (int i = 0; i < item.nValues; ++i) {
+        np += print(item.values[i]);
+        if (np > 80 && i < item.nValues - 1)
+            np = printf("\n%*s", indent + 8, "");
     }
+    printf("] ");
 }
 
 void ParamSet::Print(int indent) const {
-    printItems("integer", indent, ints);
-    printItems("boolean", indent, bools);
-    printItems("float", indent, floats);
-    printItems("point2", indent, point2fs);
-    printItems("vector2", indent, vector2fs);
-    printItems("point", indent, point3fs);
-    printItems("vector", indent, vector3fs);
-    printItems("normal", indent, normals);
-    printItems("string", indent, strings);
-    printItems("texture", indent, textures);
-    printItems("rgb", indent, spectra);
+#define PRINT_ITEMS(T, type, typeString)                    \
+    ForEachItem<T>(type, [&](const ParamSetItem<T> &item) { \
+        printItem(typeString, indent, item);                \
+    })
+    PRINT_ITEMS(int, ParamType::Int, "integer");
+    PRINT_ITEMS(bool, ParamType::Bool, "boolean");
+    PRINT_ITEMS(Float, ParamType::Float, "float");
+    PRINT_ITEMS(Point2f, ParamType::Point2f, "point2");
+    PRINT_ITEMS(Vector2f, ParamType::Vector2f, "vector2");
+    PRINT_ITEMS(Point3f, ParamType::Point3f, "point");
+    PRINT_ITEMS(Vector3f, ParamType::Vector3f, "vector");
+    PRINT_ITEMS(Normal3f, ParamType::Normal3f, "normal");
+    PRINT_ITEMS(std::string, ParamType::String, "string");
+    PRINT_ITEMS(std::string, ParamType::Texture, "texture");
+    PRINT_ITEMS(Spectrum, ParamType::Spectrum, "rgb");
+#undef PRINT_ITEMS
 }
 
 // TextureParams Method Definitions
@@ -44,7 +44,9 @@
 #include "geometry.h"
 #include "texture.h"
 #include "spectrum.h"
+#include "memory.h"
 #include <stdio.h>
+#include <atomic>
 #include <map>
 
 namespace pbrt {
@@ -117,43 +119,91 @@ class ParamSet {
     const std::string *FindString(const std::string &, int *nValues) const;
     void ReportUnused() const;
     void Clear();
+    // Returns the approximate number of bytes taken by the parameters'
+    // values
+    size_t ValueBytes() const;
     std::string ToString() const;
     void Print(int indent) const;
 
   private:
+    friend class BinarySceneWriter;
+    // ParamSet Private Declarations
+    enum class ParamType : uint8_t {
+        Int,
+        Bool,
+        Float,
+        Point2f,
+        Vector2f,
+        Point3f,
+        Vector3f,
+        Normal3f,
+        String,
+        Texture,
+        Spectrum
+    };
+    struct Param {
+        std::shared_ptr<ParamSetItemBase> item;
+        uint32_t nameHash;
+        ParamType type;
+    };
+
+    // ParamSet Private Methods
+    template <typename T>
+    void Add(ParamType type, const std::string &name, std::unique_ptr<T[]> v,
+             int nValues);
+    bool Erase(ParamType type, const std::string &name);
+    template <typename T>
+    const ParamSetItem<T> *Lookup(ParamType type,
+                                  const std::string &name) const;
+    template <typename T>
+    const T *LookupPtr(ParamType type, const std::string &name,
+                       int *nValues) const;
+    template <typename T>
+    T LookupOne(ParamType type, const std::string &name, const T &d) const;
+    template <typename T, typename F>
+    void ForEachItem(ParamType type, F func) const {
+        for (const Param &p : params)
+            if (p.type == type)
+                func(*static_cast<const ParamSetItem<T> *>(p.item.get()));
+    }
+
     // ParamSet Private Data
-    std::vector<std::shared_ptr<ParamSetItem<bool>>> bools;
-    std::vector<std::shared_ptr<ParamSetItem<int>>> ints;
-    std::vector<std::shared_ptr<ParamSetItem<Float>>> floats;
-    std::vector<std::shared_ptr<ParamSetItem<Point2f>>> point2fs;
-    std::vector<std::shared_ptr<ParamSetItem<Vector2f>>> vector2fs;
-    std::vector<std::shared_ptr<ParamSetItem<Point3f>>> point3fs;
-    std::vector<std::shared_ptr<ParamSetItem<Vector3f>>> vector3fs;
-    std::vector<std::shared_ptr<ParamSetItem<Normal3f>>> normals;
-    std::vector<std::shared_ptr<ParamSetItem<Spectrum>>> spectra;
-    std::vector<std::shared_ptr<ParamSetItem<std::string>>> strings;
-    std::vector<std::shared_ptr<ParamSetItem<std::string>>> textures;
+    // Most parameter lists have only a handful of entries, so they are
+    // stored inline without a separate allocation
+    InlinedVector<Param, 4> params;
     static std::map<std::string, Spectrum> cachedSpectra;
 };
 
+uint32_t HashParamName(const std::string &name);
+
+struct ParamSetItemBase {
+    // ParamSetItemBase Public Methods
+    ParamSetItemBase(const std::string &name, int nValues)
+        : name(name), nValues(nValues) {}
+
+    // ParamSetItemBase Data
+    const std::string name;
+    const int nValues;
+    // Atomic, since scene objects sharing a _ParamSet_ may be created in
+    // parallel
+    mutable std::atomic<bool> lookedUp{false};
+};
+
 template <typename T>
-struct ParamSetItem {
+struct ParamSetItem : public ParamSetItemBase {
     // ParamSetItem Public Methods
     ParamSetItem(const std::string &name, std::unique_ptr<T[]> val,
                  int nValues = 1);
 
     // ParamSetItem Data
-    const std::string name;
     const std::unique_ptr<T[]> values;
-    const int nValues;
-    mutable bool lookedUp = false;
 };
 
 // ParamSetItem Methods
 template <typename T>
 ParamSetItem<T>::ParamSetItem(const std::string &name, std::unique_ptr<T[]> v,
                               int nValues)
-    : name(name), values(std::move(v)), nValues(nValues) {}
+    : ParamSetItemBase(name, nValues), values(std::move(v)) {}
 
 // TextureParams Declarations
 class TextureParams {
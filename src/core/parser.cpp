@@ -33,40 +33,955 @@
 
 // core/parser.cpp*
 #include "parser.h"
+#include "api.h"
+#include "binaryscene.h"
 #include "fileutil.h"
-
-extern FILE *yyin;
-extern int yyparse(void);
-extern int yydebug;
+#include "paramset.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
 
 namespace pbrt {
 
-// Parsing Global Interface
-bool ParseFile(const std::string &filename) {
-    extern std::string current_file;
-    extern int line_num;
+// Current position of the parser, reported by Error() and Warning(); kept
+// per thread so that files parsed ahead of time report their own positions
+PBRT_THREAD_LOCAL int line_num = 0;
+PBRT_THREAD_LOCAL const char *current_file = nullptr;
+extern int catIndentCount;
 
-    LOG(INFO) << "Starting to parse input file " << filename;
+// Tokenizer Declarations
+struct Token {
+    enum Type { Number, String, Identifier, LBracket, RBracket, End };
+    Type type;
+    // Token text in the scene file; quotes are excluded from strings and
+    // escape sequences haven't been processed
+    const char *begin, *end;
+    // Set for strings that contain escape sequences
+    bool hasEscapes;
+    bool Is(const char *text) const {
+        size_t len = strlen(text);
+        return size_t(end - begin) == len && memcmp(begin, text, len) == 0;
+    }
+};
+
+// Tokenizer splits the contents of a scene file into _Token_s that refer
+// directly to the file's memory, tracking _line_num_ as it goes.
+class Tokenizer {
+  public:
+    // Tokenizer Public Methods
+    Tokenizer(const char *begin, const char *end) : ptr(begin), end(end) {}
+    Token Next();
+    const Token &Peek() {
+        if (!havePeeked) {
+            peeked = Next();
+            havePeeked = true;
+        }
+        return peeked;
+    }
+    // Returns the number of consecutive number tokens starting at _start_.
+    size_t CountNumbers(const char *start) const;
 
-    if (getenv("PBRT_YYDEBUG") != nullptr) yydebug = 1;
+  private:
+    // Tokenizer Private Data
+    const char *ptr, *end;
+    bool havePeeked = false;
+    Token peeked;
+};
 
-    if (filename == "-")
-        yyin = stdin;
+// Tokenizer Method Definitions
+static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+static bool IsIdentifierStart(char c) {
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Returns the end of the number starting at _p_, or _p_ if there isn't one.
+// Numbers follow the regular expression
+// [-+]?([0-9]+|(([0-9]+\.[0-9]*)|(\.[0-9]+)))([eE][-+]?[0-9]+)?
+static const char *MatchNumber(const char *p, const char *end) {
+    const char *start = p;
+    if (p < end && (*p == '-' || *p == '+')) ++p;
+    const char *digits = p;
+    while (p < end && IsDigit(*p)) ++p;
+    bool haveDigits = p > digits;
+    if (p < end && *p == '.') {
+        const char *fraction = ++p;
+        while (p < end && IsDigit(*p)) ++p;
+        if (!haveDigits && p == fraction) return start;
+    } else if (!haveDigits)
+        return start;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p++;
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+        const char *expDigits = p;
+        while (p < end && IsDigit(*p)) ++p;
+        if (p == expDigits) return e;
+    }
+    return p;
+}
+
+Token Tokenizer::Next() {
+    if (havePeeked) {
+        havePeeked = false;
+        return peeked;
+    }
+    Token tok;
+    tok.hasEscapes = false;
+    while (ptr < end) {
+        char c = *ptr;
+        if (c == ' ' || c == '\t' || c == '\r') {
+            ++ptr;
+        } else if (c == '\n') {
+            ++line_num;
+            ++ptr;
+        } else if (c == '#') {
+            // Skip comment, echoing it with --cat and --toply
+            const char *eol = (const char *)memchr(ptr, '\n', end - ptr);
+            if (!eol) eol = end;
+            if (PbrtOptions.cat || PbrtOptions.toPly) {
+                printf("%*s%.*s", catIndentCount, "", int(eol - ptr), ptr);
+                if (eol < end) putchar('\n');
+            }
+            ptr = eol;
+        } else if (c == '"') {
+            // Find the end of the string
+            tok.type = Token::String;
+            tok.begin = ++ptr;
+            while (ptr < end && *ptr != '"') {
+                if (*ptr == '\\') {
+                    tok.hasEscapes = true;
+                    if (++ptr < end && *ptr == '\n') ++line_num;
+                } else if (*ptr == '\n') {
+                    Error("Unterminated string!");
+                    tok.hasEscapes = true;
+                    ++line_num;
+                }
+                ++ptr;
+            }
+            tok.end = std::min(ptr, end);
+            ptr = std::min(ptr + 1, end);
+            return tok;
+        } else if (c == '[' || c == ']') {
+            tok.type = c == '[' ? Token::LBracket : Token::RBracket;
+            tok.begin = ptr++;
+            tok.end = ptr;
+            return tok;
+        } else if (IsIdentifierStart(c)) {
+            tok.type = Token::Identifier;
+            tok.begin = ptr;
+            while (ptr < end && (IsIdentifierStart(*ptr) || IsDigit(*ptr)))
+                ++ptr;
+            tok.end = ptr;
+            return tok;
+        } else {
+            const char *numEnd = MatchNumber(ptr, end);
+            if (numEnd > ptr) {
+                tok.type = Token::Number;
+                tok.begin = ptr;
+                tok.end = ptr = numEnd;
+                return tok;
+            }
+            Error("Illegal character: %c (0x%x)", c, int(c));
+            ++ptr;
+        }
+    }
+    tok.type = Token::End;
+    tok.begin = tok.end = end;
+    return tok;
+}
+
+size_t Tokenizer::CountNumbers(const char *p) const {
+    size_t count = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            ++p;
+        else if (c == '#') {
+            p = (const char *)memchr(p, '\n', end - p);
+            if (!p) break;
+        } else {
+            const char *numEnd = MatchNumber(p, end);
+            if (numEnd == p) break;
+            ++count;
+            p = numEnd;
+        }
+    }
+    return count;
+}
+
+// Parsing Local Definitions
+static void SyntaxError(const Token &tok) {
+    // Print the errors buffered while parsing ahead of time before exiting
+    std::vector<BufferedError> *buffered = SetErrorBuffer(nullptr);
+    if (buffered) ReportErrors(*buffered);
+    if (tok.type == Token::End)
+        Error("Parsing error: syntax error, unexpected end of file");
+    else
+        Error("Parsing error: syntax error, unexpected \"%.*s\"",
+              int(tok.end - tok.begin), tok.begin);
+    exit(1);
+}
+
+// Converts a number token to a _double_, giving the same result as
+// _atof()_. Numbers with at most 15 significant digits and small exponents
+// are converted exactly with a single multiplication or division by an
+// exactly-representable power of ten; others fall back to _strtod()_.
+static double ParseNumber(const Token &tok) {
+    static const double powersOf10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *p = tok.begin, *end = tok.end;
+    bool negative = false;
+    if (*p == '-' || *p == '+') negative = (*p++ == '-');
+    uint64_t mantissa = 0;
+    int nDigits = 0, exponent = 0;
+    for (; p < end && IsDigit(*p); ++p)
+        if (mantissa > 0 || *p != '0') {
+            mantissa = 10 * mantissa + (*p - '0');
+            ++nDigits;
+        }
+    if (p < end && *p == '.')
+        for (++p; p < end && IsDigit(*p); ++p) {
+            if (mantissa > 0 || *p != '0') {
+                mantissa = 10 * mantissa + (*p - '0');
+                ++nDigits;
+            }
+            --exponent;
+            if (nDigits > 15) break;
+        }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        bool negExp = false;
+        if (*++p == '-' || *p == '+') negExp = (*p++ == '-');
+        int e = 0;
+        for (; p < end && IsDigit(*p) && e < 10000; ++p)
+            e = 10 * e + (*p - '0');
+        exponent += negExp ? -e : e;
+    }
+
+    if (p == end && nDigits <= 15 && exponent >= -22 && exponent <= 22) {
+        double v = double(mantissa);
+        v = exponent < 0 ? v / powersOf10[-exponent] : v * powersOf10[exponent];
+        return negative ? -v : v;
+    }
+    std::string str(tok.begin, tok.end);
+    return strtod(str.c_str(), nullptr);
+}
+
+// Returns the contents of a string token with escape sequences processed.
+static std::string ParseString(const Token &tok) {
+    if (!tok.hasEscapes) return std::string(tok.begin, tok.end);
+    std::string str;
+    str.reserve(tok.end - tok.begin);
+    for (const char *p = tok.begin; p < tok.end; ++p) {
+        if (*p == '\n') continue;
+        if (*p != '\\' || p + 1 == tok.end) {
+            str.push_back(*p);
+            continue;
+        }
+        switch (*++p) {
+        case 'n':
+            str.push_back('\n');
+            break;
+        case 't':
+            str.push_back('\t');
+            break;
+        case 'r':
+            str.push_back('\r');
+            break;
+        case 'b':
+            str.push_back('\b');
+            break;
+        case 'f':
+            str.push_back('\f');
+            break;
+        case '\n':
+            break;
+        default:
+            if (tok.end - p >= 3 && IsDigit(p[0]) && IsDigit(p[1]) &&
+                IsDigit(p[2])) {
+                int val = 100 * (p[0] - '0') + 10 * (p[1] - '0') + (p[2] - '0');
+                while (val > 256) val -= 256;
+                str.push_back(char(val));
+                p += 2;
+            } else
+                str.push_back(*p);
+        }
+    }
+    return str;
+}
+
+static std::string ExpectString(Tokenizer &t) {
+    Token tok = t.Next();
+    if (tok.type != Token::String) SyntaxError(tok);
+    return ParseString(tok);
+}
+
+static double ExpectNumber(Tokenizer &t) {
+    Token tok = t.Next();
+    if (tok.type != Token::Number) SyntaxError(tok);
+    return ParseNumber(tok);
+}
+
+enum { PARAM_TYPE_INT, PARAM_TYPE_BOOL, PARAM_TYPE_FLOAT,
+    PARAM_TYPE_POINT2, PARAM_TYPE_VECTOR2, PARAM_TYPE_POINT3,
+    PARAM_TYPE_VECTOR3, PARAM_TYPE_NORMAL, PARAM_TYPE_RGB, PARAM_TYPE_XYZ,
+    PARAM_TYPE_BLACKBODY, PARAM_TYPE_SPECTRUM,
+    PARAM_TYPE_STRING, PARAM_TYPE_TEXTURE };
+
+static const char *paramTypeToName(int type) {
+    switch (type) {
+    case PARAM_TYPE_INT: return "int";
+    case PARAM_TYPE_BOOL: return "bool";
+    case PARAM_TYPE_FLOAT: return "float";
+    case PARAM_TYPE_POINT2: return "point2";
+    case PARAM_TYPE_VECTOR2: return "vector2";
+    case PARAM_TYPE_POINT3: return "point3";
+    case PARAM_TYPE_VECTOR3: return "vector3";
+    case PARAM_TYPE_NORMAL: return "normal";
+    case PARAM_TYPE_RGB: return "rgb/color";
+    case PARAM_TYPE_XYZ: return "xyz";
+    case PARAM_TYPE_BLACKBODY: return "blackbody";
+    case PARAM_TYPE_SPECTRUM: return "spectrum";
+    case PARAM_TYPE_STRING: return "string";
+    case PARAM_TYPE_TEXTURE: return "texture";
+    default: LOG(FATAL) << "Error in paramTypeToName"; return nullptr;
+    }
+}
+
+static bool lookupType(const char *name, int *type, std::string &sname) {
+    CHECK_NOTNULL(name);
+    *type = 0;
+    const char *strp = name;
+    while (*strp && isspace(*strp))
+        ++strp;
+    if (!*strp) {
+        Error("Parameter \"%s\" doesn't have a type declaration?!", name);
+        return false;
+    }
+#define TRY_DECODING_TYPE(name, mask) \
+        if (strncmp(name, strp, strlen(name)) == 0) { \
+            *type = mask; strp += strlen(name); \
+        }
+         TRY_DECODING_TYPE("float",     PARAM_TYPE_FLOAT)
+    else TRY_DECODING_TYPE("integer",   PARAM_TYPE_INT)
+    else TRY_DECODING_TYPE("bool",      PARAM_TYPE_BOOL)
+    else TRY_DECODING_TYPE("point2",    PARAM_TYPE_POINT2)
+    else TRY_DECODING_TYPE("vector2",   PARAM_TYPE_VECTOR2)
+    else TRY_DECODING_TYPE("point3",    PARAM_TYPE_POINT3)
+    else TRY_DECODING_TYPE("vector3",   PARAM_TYPE_VECTOR3)
+    else TRY_DECODING_TYPE("point",     PARAM_TYPE_POINT3)
+    else TRY_DECODING_TYPE("vector",    PARAM_TYPE_VECTOR3)
+    else TRY_DECODING_TYPE("normal",    PARAM_TYPE_NORMAL)
+    else TRY_DECODING_TYPE("string",    PARAM_TYPE_STRING)
+    else TRY_DECODING_TYPE("texture",   PARAM_TYPE_TEXTURE)
+    else TRY_DECODING_TYPE("color",     PARAM_TYPE_RGB)
+    else TRY_DECODING_TYPE("rgb",       PARAM_TYPE_RGB)
+    else TRY_DECODING_TYPE("xyz",       PARAM_TYPE_XYZ)
+    else TRY_DECODING_TYPE("blackbody", PARAM_TYPE_BLACKBODY)
+    else TRY_DECODING_TYPE("spectrum",  PARAM_TYPE_SPECTRUM)
     else {
-        yyin = fopen(filename.c_str(), "r");
-        SetSearchDirectory(DirectoryContaining(filename));
+        Error("Unable to decode type for name \"%s\"", name);
+        return false;
+    }
+#undef TRY_DECODING_TYPE
+    while (*strp && isspace(*strp))
+        ++strp;
+    sname = std::string(strp);
+    return true;
+}
+
+// Reads _count_ number tokens, storing the first _nStored_ of them in
+// _values_.
+template <typename T>
+static void ReadNumbers(Tokenizer &t, size_t count, T *values,
+                        size_t nStored) {
+    for (size_t i = 0; i < count; ++i) {
+        double v = ExpectNumber(t);
+        if (i < nStored) values[i] = T(v);
+    }
+}
+
+// Reads _count_ numbers into a new array of _count_ / _N_ values of type
+// _T_, each made of _N_ _Float_s.
+template <typename T, int N>
+static std::unique_ptr<T[]> ReadFloatTuples(Tokenizer &t, size_t count) {
+    static_assert(sizeof(T) == N * sizeof(Float), "Unexpected padding");
+    std::unique_ptr<T[]> values(new T[count / N]);
+    ReadNumbers(t, count, reinterpret_cast<Float *>(values.get()),
+                count / N * N);
+    return values;
+}
+
+// Reads _count_ numbers, returning the first _nStored_ of them.
+static std::unique_ptr<Float[]> ReadFloats(Tokenizer &t, size_t count,
+                                           size_t nStored) {
+    std::unique_ptr<Float[]> values(new Float[nStored]);
+    ReadNumbers(t, count, values.get(), nStored);
+    return values;
+}
+
+// Adds the numeric values of parameter _name_ with type _type_ to _ps_,
+// reading them directly from the tokenizer into the arrays handed to the
+// _ParamSet_.
+static void AddNumericParam(Tokenizer &t, size_t count, int type,
+                            const std::string &decl, const std::string &name,
+                            ParamSet *ps) {
+    int nItems = count;
+    switch (type) {
+    case PARAM_TYPE_INT: {
+        std::unique_ptr<int[]> ints(new int[nItems]);
+        ReadNumbers(t, count, ints.get(), count);
+        ps->AddInt(name, std::move(ints), nItems);
+        break;
     }
-    if (yyin != nullptr) {
-        current_file = filename;
-        if (yyin == stdin) current_file = "<standard input>";
-        line_num = 1;
-        yyparse();
-        if (yyin != stdin) fclose(yyin);
+    case PARAM_TYPE_FLOAT:
+        ps->AddFloat(name, ReadFloats(t, count, nItems), nItems);
+        break;
+    case PARAM_TYPE_POINT2:
+    case PARAM_TYPE_VECTOR2:
+        if ((nItems % 2) != 0)
+            Warning("Excess values given with %s parameter \"%s\". "
+                    "Ignoring last one of them.", paramTypeToName(type),
+                    decl.c_str());
+        if (type == PARAM_TYPE_POINT2)
+            ps->AddPoint2f(name, ReadFloatTuples<Point2f, 2>(t, count),
+                           nItems / 2);
+        else
+            ps->AddVector2f(name, ReadFloatTuples<Vector2f, 2>(t, count),
+                            nItems / 2);
+        break;
+    case PARAM_TYPE_POINT3:
+    case PARAM_TYPE_VECTOR3:
+    case PARAM_TYPE_NORMAL:
+        if ((nItems % 3) != 0)
+            Warning("Excess values given with %s parameter \"%s\". "
+                    "Ignoring last %d of them.",
+                    type == PARAM_TYPE_NORMAL ? "\"normal\""
+                                              : paramTypeToName(type),
+                    decl.c_str(), nItems % 3);
+        if (type == PARAM_TYPE_POINT3)
+            ps->AddPoint3f(name, ReadFloatTuples<Point3f, 3>(t, count),
+                           nItems / 3);
+        else if (type == PARAM_TYPE_VECTOR3)
+            ps->AddVector3f(name, ReadFloatTuples<Vector3f, 3>(t, count),
+                            nItems / 3);
+        else
+            ps->AddNormal3f(name, ReadFloatTuples<Normal3f, 3>(t, count),
+                            nItems / 3);
+        break;
+    case PARAM_TYPE_RGB:
+    case PARAM_TYPE_XYZ:
+        if ((nItems % 3) != 0) {
+            Warning("Excess %s values given with parameter \"%s\". "
+                    "Ignoring last %d of them",
+                    type == PARAM_TYPE_RGB ? "RGB" : "XYZ", decl.c_str(),
+                    nItems % 3);
+            nItems -= nItems % 3;
+        }
+        if (type == PARAM_TYPE_RGB)
+            ps->AddRGBSpectrum(name, ReadFloats(t, count, nItems),
+                               nItems);
+        else
+            ps->AddXYZSpectrum(name, ReadFloats(t, count, nItems),
+                               nItems);
+        break;
+    case PARAM_TYPE_BLACKBODY:
+        if ((nItems % 2) != 0) {
+            Warning("Excess value given with blackbody parameter \"%s\". "
+                    "Ignoring extra one.", decl.c_str());
+            nItems -= nItems % 2;
+        }
+        ps->AddBlackbodySpectrum(name, ReadFloats(t, count, nItems),
+                                 nItems);
+        break;
+    case PARAM_TYPE_SPECTRUM:
+        if ((nItems % 2) != 0) {
+            Warning("Non-even number of values given with sampled spectrum "
+                    "parameter \"%s\". Ignoring extra.", decl.c_str());
+            nItems -= nItems % 2;
+        }
+        ps->AddSampledSpectrum(name, ReadFloats(t, count, nItems),
+                               nItems);
+        break;
+    default:
+        Error("Expected string parameter value for parameter "
+              "\"%s\" with type \"%s\". Ignoring.",
+              name.c_str(), paramTypeToName(type));
+        ReadNumbers<Float>(t, count, nullptr, 0);
+    }
+}
+
+// Adds the string values of parameter _name_ with type _type_ to _ps_.
+static void AddStringParam(const std::vector<std::string> &strings, int type,
+                           const std::string &decl, const std::string &name,
+                           ParamSet *ps) {
+    int nItems = strings.size();
+    switch (type) {
+    case PARAM_TYPE_BOOL: {
+        std::unique_ptr<bool[]> bdata(new bool[nItems]);
+        for (int j = 0; j < nItems; ++j) {
+            if (strings[j] == "true") bdata[j] = true;
+            else if (strings[j] == "false") bdata[j] = false;
+            else {
+                Warning("Value \"%s\" unknown for Boolean parameter \"%s\"."
+                    "Using \"false\".", strings[j].c_str(), decl.c_str());
+                bdata[j] = false;
+            }
+        }
+        ps->AddBool(name, std::move(bdata), nItems);
+        break;
+    }
+    case PARAM_TYPE_SPECTRUM: {
+        std::vector<const char *> names;
+        for (const std::string &s : strings) names.push_back(s.c_str());
+        ps->AddSampledSpectrumFiles(name, names.data(), nItems);
+        break;
+    }
+    case PARAM_TYPE_STRING: {
+        std::unique_ptr<std::string[]> values(new std::string[nItems]);
+        std::copy(strings.begin(), strings.end(), values.get());
+        ps->AddString(name, std::move(values), nItems);
+        break;
+    }
+    case PARAM_TYPE_TEXTURE:
+        if (nItems == 1)
+            ps->AddTexture(name, strings[0]);
+        else
+            Error("Only one string allowed for \"texture\" parameter \"%s\"",
+                  name.c_str());
+        break;
+    default:
+        Error("Expected numeric parameter value for parameter "
+              "\"%s\" with type \"%s\".  Ignoring.",
+              name.c_str(), paramTypeToName(type));
+    }
+}
+
+// Parses the parameter list following a directive into _ps_.
+static void ParseParams(Tokenizer &t, ParamSet *ps) {
+    while (t.Peek().type == Token::String) {
+        std::string decl = ParseString(t.Next());
+        int type;
+        std::string name;
+        bool known = lookupType(decl.c_str(), &type, name);
+        if (!known)
+            Warning("Type of parameter \"%s\" is unknown", decl.c_str());
+
+        // Parse parameter values, which are either a single number or
+        // string or a bracketed array of either
+        Token first = t.Next();
+        bool bracketed = first.type == Token::LBracket;
+        const Token &value = bracketed ? t.Peek() : first;
+        if (value.type == Token::String) {
+            std::vector<std::string> strings;
+            if (!bracketed) strings.push_back(ParseString(first));
+            while (bracketed && t.Peek().type != Token::RBracket)
+                strings.push_back(ExpectString(t));
+            if (bracketed) t.Next();
+            if (known) AddStringParam(strings, type, decl, name, ps);
+        } else if (value.type == Token::Number) {
+            if (!bracketed) {
+                // Read the single value through a _Tokenizer_ of its own
+                Tokenizer single(first.begin, first.end);
+                if (known) AddNumericParam(single, 1, type, decl, name, ps);
+            } else {
+                size_t count = t.CountNumbers(value.begin);
+                if (known)
+                    AddNumericParam(t, count, type, decl, name, ps);
+                else
+                    ReadNumbers<Float>(t, count, nullptr, 0);
+                Token close = t.Next();
+                if (close.type != Token::RBracket) SyntaxError(close);
+            }
+        } else
+            SyntaxError(value);
+    }
+}
+
+// A statement of an included file that was parsed ahead of time, recorded
+// so that it can be run when the parser reaches the _Include_
+struct RecordedStatement {
+    int line;
+    std::function<void()> run;
+};
+
+// An included scene file parsed ahead of time by _ParseIncludesAhead()_
+struct ParsedFile {
+    std::string filename;
+    int includeDepth;
+    // False if the file is to be parsed when the _Include_ is reached:
+    // binary scene files, since they're already fast to load, files past
+    // the parse-ahead size budget, and files that couldn't be opened
+    bool parsed = false;
+    std::vector<RecordedStatement> statements;
+    // Errors and warnings reported while parsing the file that haven't
+    // been recorded as statements yet
+    std::vector<BufferedError> errors;
+    // Files included by this one, to be parsed ahead of time as well
+    std::vector<std::string> includes;
+    // Number of _Include_s of the file that haven't been reached yet
+    int uses = 0;
+};
+
+// Files parsed ahead of time, indexed by absolute filename
+static std::map<std::string, std::shared_ptr<ParsedFile>> parsedFiles;
+
+// Set if an included binary scene file turns out to be truncated or corrupt
+static bool includeFailed = false;
+
+// Records the errors reported so far while parsing _ahead_ as a statement
+// that reports them, so that they're printed in order with the errors of
+// the files that include it.
+static void RecordErrors(ParsedFile *ahead) {
+    if (ahead->errors.empty()) return;
+    std::vector<BufferedError> errors;
+    errors.swap(ahead->errors);
+    ahead->statements.push_back(
+        {line_num, [errors]() { ReportErrors(errors); }});
+}
+
+// Runs the API call _f_ for a statement that was just parsed or, if the
+// file is being parsed ahead of time, records it to be run later.
+template <typename F>
+static void Run(ParsedFile *ahead, F &&f) {
+    if (ahead) {
+        RecordErrors(ahead);
+        ahead->statements.push_back({line_num, std::forward<F>(f)});
+    } else
+        f();
+}
+
+static bool ParseFileContents(const std::string &filename, const char *begin,
+                              const char *end, int includeDepth,
+                              ParsedFile *ahead);
+static void IncludeFile(const std::string &filename, int includeDepth);
+
+// Parses the statements in _t_ until the end of the file.
+static void ParseStatements(Tokenizer &t, int includeDepth,
+                            ParsedFile *ahead) {
+    while (true) {
+        Token tok = t.Next();
+        if (tok.type == Token::End) return;
+        if (tok.type != Token::Identifier) SyntaxError(tok);
+
+        // Handle directives that take a name and parameter list
+        using ParamsFunc = void (*)(const std::string &, const ParamSet &);
+        static const struct {
+            const char *name;
+            ParamsFunc func;
+        } paramDirectives[] = {{"Shape", pbrtShape},
+                               {"Material", pbrtMaterial},
+                               {"MakeNamedMaterial", pbrtMakeNamedMaterial},
+                               {"LightSource", pbrtLightSource},
+                               {"AreaLightSource", pbrtAreaLightSource},
+                               {"Camera", pbrtCamera},
+                               {"Film", pbrtFilm},
+                               {"Sampler", pbrtSampler},
+                               {"PixelFilter", pbrtPixelFilter},
+                               {"Integrator", pbrtIntegrator},
+                               {"Accelerator", pbrtAccelerator},
+                               {"MakeNamedMedium", pbrtMakeNamedMedium},
+                               {"Extractor", pbrtExtractor}};
+        ParamsFunc paramsFunc = nullptr;
+        for (const auto &d : paramDirectives)
+            if (tok.Is(d.name)) {
+                paramsFunc = d.func;
+                break;
+            }
+        if (paramsFunc) {
+            std::string name = ExpectString(t);
+            ParamSet params;
+            ParseParams(t, &params);
+            if (ahead)
+                Run(ahead, std::bind(paramsFunc, name, std::move(params)));
+            else
+                paramsFunc(name, params);
+            continue;
+        }
+
+        if (tok.Is("AttributeBegin"))
+            Run(ahead, []() { pbrtAttributeBegin(); });
+        else if (tok.Is("AttributeEnd"))
+            Run(ahead, []() { pbrtAttributeEnd(); });
+        else if (tok.Is("TransformBegin"))
+            Run(ahead, []() { pbrtTransformBegin(); });
+        else if (tok.Is("TransformEnd"))
+            Run(ahead, []() { pbrtTransformEnd(); });
+        else if (tok.Is("Translate")) {
+            Float v[3];
+            for (int i = 0; i < 3; ++i) v[i] = ExpectNumber(t);
+            Run(ahead, [=]() { pbrtTranslate(v[0], v[1], v[2]); });
+        } else if (tok.Is("Scale")) {
+            Float v[3];
+            for (int i = 0; i < 3; ++i) v[i] = ExpectNumber(t);
+            Run(ahead, [=]() { pbrtScale(v[0], v[1], v[2]); });
+        } else if (tok.Is("Rotate")) {
+            Float v[4];
+            for (int i = 0; i < 4; ++i) v[i] = ExpectNumber(t);
+            Run(ahead, [=]() { pbrtRotate(v[0], v[1], v[2], v[3]); });
+        } else if (tok.Is("LookAt")) {
+            Float v[9];
+            for (int i = 0; i < 9; ++i) v[i] = ExpectNumber(t);
+            Run(ahead, [=]() {
+                pbrtLookAt(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+                           v[8]);
+            });
+        } else if (tok.Is("Transform") || tok.Is("ConcatTransform")) {
+            const char *directive =
+                tok.Is("Transform") ? "Transform" : "ConcatTransform";
+            Token first = t.Next();
+            size_t count = 1;
+            Float m[16];
+            if (first.type == Token::LBracket) {
+                count = t.CountNumbers(t.Peek().begin);
+                ReadNumbers(t, count, m, count == 16 ? 16 : 0);
+                Token close = t.Next();
+                if (close.type != Token::RBracket) SyntaxError(close);
+            } else if (first.type != Token::Number)
+                SyntaxError(first);
+            if (count != 16)
+                Error("\"%s\" requires a %d element array! (%d found)",
+                      directive, 16, int(count));
+            else if (tok.Is("Transform"))
+                Run(ahead, [=]() mutable { pbrtTransform(m); });
+            else
+                Run(ahead, [=]() mutable { pbrtConcatTransform(m); });
+        } else if (tok.Is("Identity"))
+            Run(ahead, []() { pbrtIdentity(); });
+        else if (tok.Is("CoordinateSystem")) {
+            std::string name = ExpectString(t);
+            Run(ahead, [=]() { pbrtCoordinateSystem(name); });
+        } else if (tok.Is("CoordSysTransform")) {
+            std::string name = ExpectString(t);
+            Run(ahead, [=]() { pbrtCoordSysTransform(name); });
+        } else if (tok.Is("ActiveTransform")) {
+            Token which = t.Next();
+            if (which.Is("All"))
+                Run(ahead, []() { pbrtActiveTransformAll(); });
+            else if (which.Is("EndTime"))
+                Run(ahead, []() { pbrtActiveTransformEndTime(); });
+            else if (which.Is("StartTime"))
+                Run(ahead, []() { pbrtActiveTransformStartTime(); });
+            else
+                SyntaxError(which);
+        } else if (tok.Is("TransformTimes")) {
+            Float start = ExpectNumber(t);
+            Float end = ExpectNumber(t);
+            Run(ahead, [=]() { pbrtTransformTimes(start, end); });
+        } else if (tok.Is("ReverseOrientation"))
+            Run(ahead, []() { pbrtReverseOrientation(); });
+        else if (tok.Is("Texture")) {
+            std::string name = ExpectString(t);
+            std::string type = ExpectString(t);
+            std::string texname = ExpectString(t);
+            ParamSet params;
+            ParseParams(t, &params);
+            if (ahead)
+                Run(ahead, std::bind(pbrtTexture, name, type, texname,
+                                     std::move(params)));
+            else
+                pbrtTexture(name, type, texname, params);
+        } else if (tok.Is("NamedMaterial")) {
+            std::string name = ExpectString(t);
+            Run(ahead, [=]() { pbrtNamedMaterial(name); });
+        } else if (tok.Is("MediumInterface")) {
+            std::string inside = ExpectString(t);
+            std::string outside = inside;
+            if (t.Peek().type == Token::String) outside = ExpectString(t);
+            Run(ahead, [=]() { pbrtMediumInterface(inside, outside); });
+        } else if (tok.Is("ObjectBegin")) {
+            std::string name = ExpectString(t);
+            Run(ahead, [=]() { pbrtObjectBegin(name); });
+        } else if (tok.Is("ObjectEnd"))
+            Run(ahead, []() { pbrtObjectEnd(); });
+        else if (tok.Is("ObjectInstance")) {
+            std::string name = ExpectString(t);
+            Run(ahead, [=]() { pbrtObjectInstance(name); });
+        } else if (tok.Is("WorldBegin"))
+            Run(ahead, []() { pbrtWorldBegin(); });
+        else if (tok.Is("WorldEnd"))
+            Run(ahead, []() { pbrtWorldEnd(); });
+        else if (tok.Is("Include")) {
+            std::string filename =
+                AbsolutePath(ResolveFilename(ExpectString(t)));
+            if (ahead) ahead->includes.push_back(filename);
+            Run(ahead, [=]() { IncludeFile(filename, includeDepth + 1); });
+        } else
+            SyntaxError(tok);
+    }
+}
+
+// Returns the absolute names of the files included by the scene file in
+// [_begin_, _end_).
+static std::vector<std::string> FindIncludes(const char *begin,
+                                             const char *end) {
+    // Most scene files have no _Include_s; only tokenize those that might
+    std::vector<std::string> includes;
+    const char include[] = "Include";
+    if (std::search(begin, end, include, include + 7) == end) return includes;
+    int prevLine = line_num;
+    Tokenizer t(begin, end);
+    for (Token tok = t.Next(); tok.type != Token::End; tok = t.Next())
+        if (tok.type == Token::Identifier && tok.Is("Include") &&
+            t.Peek().type == Token::String)
+            includes.push_back(
+                AbsolutePath(ResolveFilename(ParseString(t.Next()))));
+    line_num = prevLine;
+    return includes;
+}
+
+// Included files are parsed ahead of time only up to this total size, which
+// bounds the memory taken by their recorded statements and parameter
+// lists; the remaining files are parsed when their _Include_ is reached.
+static PBRT_CONSTEXPR int64_t MaxParseAheadBytes = int64_t(256) << 20;
+
+// Parses the files included by the scene file in [_begin_, _end_) and, in
+// turn, the files they include, in parallel. Their statements are recorded
+// and then run in order by _IncludeFile()_ when the parser reaches each
+// _Include_, so the graphics state they see is exactly the one they would
+// have seen had they been parsed in place. Errors and warnings are recorded
+// along with the statements, except for syntax errors, which are fatal and
+// reported immediately.
+static void ParseIncludesAhead(const char *begin, const char *end) {
+    if (PbrtOptions.cat || PbrtOptions.toPly) return;
+    std::vector<std::string> includes = FindIncludes(begin, end);
+    std::atomic<int64_t> bytesLeft(MaxParseAheadBytes);
+    for (int depth = 1; !includes.empty() && depth <= 32; ++depth) {
+        // Find the files of this level of inclusion that are new
+        std::vector<std::shared_ptr<ParsedFile>> files;
+        for (const std::string &filename : includes) {
+            std::shared_ptr<ParsedFile> &pf = parsedFiles[filename];
+            if (!pf) {
+                pf = std::make_shared<ParsedFile>();
+                pf->filename = filename;
+                pf->includeDepth = depth;
+                files.push_back(pf);
+            }
+            ++pf->uses;
+        }
+
+        ParallelFor([&](int64_t i) {
+            ParsedFile &pf = *files[i];
+            MappedFile file(pf.filename);
+            if (!file.IsValid() || IsBinaryScene(file.Data(), file.Size()))
+                return;
+            if ((bytesLeft -= int64_t(file.Size())) < 0) return;
+            pf.parsed = true;
+            std::vector<BufferedError> *prevBuffer =
+                SetErrorBuffer(&pf.errors);
+            ParseFileContents(pf.filename, file.Data(),
+                              file.Data() + file.Size(), pf.includeDepth,
+                              &pf);
+            RecordErrors(&pf);
+            SetErrorBuffer(prevBuffer);
+        }, files.size());
+
+        includes.clear();
+        for (const std::shared_ptr<ParsedFile> &pf : files) {
+            includes.insert(includes.end(), pf->includes.begin(),
+                            pf->includes.end());
+            pf->includes.clear();
+        }
+    }
+}
+
+// Runs the statements of the included file _filename_, parsing it now if
+// it wasn't parsed ahead of time.
+static void IncludeFile(const std::string &filename, int includeDepth) {
+    if (includeDepth > 32) {
+        Error("Only 32 levels of nested Include allowed in scene files.");
+        exit(1);
+    }
+    auto iter = parsedFiles.find(filename);
+    std::shared_ptr<ParsedFile> pf;
+    bool lastUse = false;
+    if (iter != parsedFiles.end()) {
+        pf = iter->second;
+        if (--pf->uses == 0) {
+            parsedFiles.erase(iter);
+            lastUse = true;
+        }
+    }
+    if (!pf || !pf->parsed) {
+        MappedFile file(filename);
+        if (!file.IsValid())
+            Error("Unable to open included scene file \"%s\"",
+                  filename.c_str());
+        else if (!ParseFileContents(filename, file.Data(),
+                                    file.Data() + file.Size(), includeDepth,
+                                    nullptr))
+            includeFailed = true;
+        return;
+    }
+
+    // Run the statements recorded for _filename_, releasing them and their
+    // parameter lists after the file's last use
+    const char *prevFile = current_file;
+    int prevLine = line_num;
+    current_file = pf->filename.c_str();
+    for (RecordedStatement &s : pf->statements) {
+        line_num = s.line;
+        s.run();
+        if (lastUse) s.run = nullptr;
+    }
+    current_file = prevFile;
+    line_num = prevLine;
+}
+
+// Returns false if _filename_ is a binary scene file that couldn't be
+// parsed; errors in text files are reported as they're found.
+static bool ParseFileContents(const std::string &filename, const char *begin,
+                              const char *end, int includeDepth,
+                              ParsedFile *ahead) {
+    bool binary = IsBinaryScene(begin, end - begin);
+    if (includeDepth == 0 && !binary) ParseIncludesAhead(begin, end);
+    const char *prevFile = current_file;
+    int prevLine = line_num;
+    current_file = filename.c_str();
+    line_num = 1;
+    bool success = true;
+    if (binary) {
+        CHECK(!ahead);
+        success = ParseBinaryScene(filename, begin, end - begin);
+    } else {
+        Tokenizer t(begin, end);
+        ParseStatements(t, includeDepth, ahead);
+    }
+    current_file = prevFile;
+    line_num = prevLine;
+    return success;
+}
+
+// Parsing Global Interface
+bool ParseFile(const std::string &filename) {
+    LOG(INFO) << "Starting to parse input file " << filename;
+    bool success = true;
+    includeFailed = false;
+    if (filename == "-") {
+        // Read all of standard input
+        std::string contents;
+        char buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
+            contents.append(buf, n);
+        success = ParseFileContents("<standard input>", contents.data(),
+                                    contents.data() + contents.size(), 0,
+                                    nullptr);
+    } else {
+        SetSearchDirectory(DirectoryContaining(filename));
+        MappedFile file(filename);
+        success = file.IsValid() &&
+                  ParseFileContents(filename, file.Data(),
+                                    file.Data() + file.Size(), 0, nullptr);
     }
-    current_file = "";
+    if (includeFailed) success = false;
+    parsedFiles.clear();
+    current_file = nullptr;
     line_num = 0;
     LOG(INFO) << "Done parsing input file " << filename;
-    return (yyin != nullptr);
+    return success;
 }
 
 }  // namespace pbrt
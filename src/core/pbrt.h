@@ -148,6 +148,7 @@ template <typename T, int logBlockSize = 2>
 class BlockedArray;
 struct Matrix4x4;
 class ParamSet;
+struct ParamSetItemBase;
 template <typename T>
 struct ParamSetItem;
 struct Options {
@@ -155,7 +156,16 @@ struct Options {
     bool quickRender = false;
     bool quiet = false;
     bool cat = false, toPly = false;
+    bool compactMeshes = false;
+    // Memory budget for cached tessellations of subdivision surfaces and
+    // displaced meshes, in MiB
+    int subdivCacheMB = 1024;
+    // Memory budget for image texture tiles, in MiB; 0 keeps image textures
+    // entirely in memory
+    int textureCacheMB = 0;
     std::string imageFile;
+    // Binary scene file to write the scene to instead of rendering it
+    std::string toBinary;
 };
 
 extern Options PbrtOptions;
@@ -236,6 +246,43 @@ inline double BitsToFloat(uint64_t ui) {
     return f;
 }
 
+// Converts to and from IEEE 754 half precision, rounding to nearest even.
+inline uint16_t FloatToHalf(float v) {
+    uint32_t ui = FloatToBits(v);
+    uint32_t sign = ui & 0x80000000u;
+    ui ^= sign;
+    uint16_t h;
+    if (ui >= 0x47800000u)
+        // Overflow to infinity, or NaN
+        h = ui > 0x7f800000u ? 0x7e00 : 0x7c00;
+    else if (ui < 0x38800000u)
+        // Denormalized half; let floating-point addition do the rounding
+        h = FloatToBits(BitsToFloat(ui) + 0.5f) - 0x3f000000u;
+    else {
+        // Rebias the exponent and round the mantissa to nearest even
+        uint32_t mantissaOdd = (ui >> 13) & 1;
+        ui += 0xc8000fffu + mantissaOdd;
+        h = ui >> 13;
+    }
+    return h | (sign >> 16);
+}
+
+inline float HalfToFloat(uint16_t h) {
+    const uint32_t shiftedExp = 0x7c00u << 13;
+    uint32_t ui = uint32_t(h & 0x7fff) << 13;
+    uint32_t exp = ui & shiftedExp;
+    ui += (127 - 15) << 23;
+    if (exp == shiftedExp)
+        // Infinity or NaN
+        ui += (128 - 16) << 23;
+    else if (exp == 0) {
+        // Zero or denormalized half
+        ui += 1 << 23;
+        ui = FloatToBits(BitsToFloat(ui) - BitsToFloat(113u << 23));
+    }
+    return BitsToFloat(ui | (uint32_t(h & 0x8000) << 16));
+}
+
 inline float NextFloatUp(float v) {
     // Handle infinity and negative zero for _NextFloatUp()_
     if (std::isinf(v) && v > 0.) return v;
@@ -41,6 +41,22 @@ namespace pbrt {
 
 // Primitive Method Definitions
 Primitive::~Primitive() {}
+void Primitive::WorldBoundKeys(Float time0, Float time1, int nKeys,
+                               Bounds3f *bounds) const {
+    Bounds3f b = WorldBound();
+    for (int i = 0; i < nKeys; ++i) bounds[i] = b;
+}
+
+void Primitive::IntersectBatch(const Ray *rays, int nRays,
+                               SurfaceInteraction *isects, bool *hits) const {
+    for (int i = 0; i < nRays; ++i) hits[i] = Intersect(rays[i], &isects[i]);
+}
+
+void Primitive::IntersectPBatch(const Ray *rays, int nRays,
+                                bool *occluded) const {
+    for (int i = 0; i < nRays; ++i) occluded[i] = IntersectP(rays[i]);
+}
+
 const AreaLight *Aggregate::GetAreaLight() const {
     LOG(FATAL) <<
         "Aggregate::GetAreaLight() method"
@@ -90,6 +106,11 @@ bool TransformedPrimitive::IntersectP(const Ray &r) const {
 // GeometricPrimitive Method Definitions
 Bounds3f GeometricPrimitive::WorldBound() const { return shape->WorldBound(); }
 
+void GeometricPrimitive::WorldBoundKeys(Float time0, Float time1, int nKeys,
+                                        Bounds3f *bounds) const {
+    shape->WorldBoundKeys(time0, time1, nKeys, bounds);
+}
+
 bool GeometricPrimitive::IntersectP(const Ray &r) const {
     return shape->IntersectP(r);
 }
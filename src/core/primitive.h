@@ -52,8 +52,21 @@ class Primitive {
     // Primitive Interface
     virtual ~Primitive();
     virtual Bounds3f WorldBound() const = 0;
+    // Fills _bounds_ with world-space bounds at _nKeys_ evenly spaced times
+    // over [_time0_, _time1_]; linear interpolation between consecutive
+    // keys must bound the primitive at any intermediate time.
+    virtual void WorldBoundKeys(Float time0, Float time1, int nKeys,
+                                Bounds3f *bounds) const;
     virtual bool Intersect(const Ray &r, SurfaceInteraction *) const = 0;
     virtual bool IntersectP(const Ray &r) const = 0;
+    // Batched intersection of _nRays_ independent rays; _hits_ and
+    // _occluded_ receive one result per ray. The default implementations
+    // trace each ray separately; aggregates may override them to
+    // traverse coherent ray batches together.
+    virtual void IntersectBatch(const Ray *rays, int nRays,
+                                SurfaceInteraction *isects, bool *hits) const;
+    virtual void IntersectPBatch(const Ray *rays, int nRays,
+                                 bool *occluded) const;
     virtual const AreaLight *GetAreaLight() const = 0;
     virtual const Material *GetMaterial() const = 0;
     virtual void ComputeScatteringFunctions(SurfaceInteraction *isect,
@@ -67,6 +80,8 @@ class GeometricPrimitive : public Primitive {
   public:
     // GeometricPrimitive Public Methods
     virtual Bounds3f WorldBound() const;
+    void WorldBoundKeys(Float time0, Float time1, int nKeys,
+                        Bounds3f *bounds) const;
     virtual bool Intersect(const Ray &r, SurfaceInteraction *isect) const;
     virtual bool IntersectP(const Ray &r) const;
     GeometricPrimitive(const std::shared_ptr<Shape> &shape,
@@ -112,6 +127,11 @@ class TransformedPrimitive : public Primitive {
     Bounds3f WorldBound() const {
         return PrimitiveToWorld.MotionBounds(primitive->WorldBound());
     }
+    void WorldBoundKeys(Float time0, Float time1, int nKeys,
+                        Bounds3f *bounds) const {
+        PrimitiveToWorld.MotionBoundKeys(primitive->WorldBound(), time0,
+                                         time1, nKeys, bounds);
+    }
 
   private:
     // TransformedPrimitive Private Data
@@ -59,6 +59,17 @@ bool Scene::IntersectP(const Ray &ray) const {
     return aggregate->IntersectP(ray);
 }
 
+void Scene::IntersectBatch(const Ray *rays, int nRays,
+                           SurfaceInteraction *isects, bool *hits) const {
+    nIntersectionTests += nRays;
+    aggregate->IntersectBatch(rays, nRays, isects, hits);
+}
+
+void Scene::IntersectPBatch(const Ray *rays, int nRays, bool *occluded) const {
+    nShadowTests += nRays;
+    aggregate->IntersectPBatch(rays, nRays, occluded);
+}
+
 bool Scene::IntersectTr(Ray ray, Sampler &sampler, SurfaceInteraction *isect,
                         Spectrum *Tr) const {
     *Tr = Spectrum(1.f);
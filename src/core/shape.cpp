@@ -53,6 +53,12 @@ Shape::Shape(const Transform *ObjectToWorld, const Transform *WorldToObject,
 
 Bounds3f Shape::WorldBound() const { return (*ObjectToWorld)(ObjectBound()); }
 
+void Shape::WorldBoundKeys(Float time0, Float time1, int nKeys,
+                           Bounds3f *bounds) const {
+    Bounds3f b = WorldBound();
+    for (int i = 0; i < nKeys; ++i) bounds[i] = b;
+}
+
 Interaction Shape::Sample(const Interaction &ref, const Point2f &u,
                           Float *pdf) const {
     Interaction intr = Sample(u, pdf);
@@ -56,6 +56,11 @@ class Shape {
     virtual ~Shape();
     virtual Bounds3f ObjectBound() const = 0;
     virtual Bounds3f WorldBound() const;
+    // Bounds at _nKeys_ evenly spaced times over [_time0_, _time1_] for
+    // shapes that deform over the shutter interval; see
+    // Primitive::WorldBoundKeys().
+    virtual void WorldBoundKeys(Float time0, Float time1, int nKeys,
+                                Bounds3f *bounds) const;
     virtual bool Intersect(const Ray &ray, Float *tHit,
                            SurfaceInteraction *isect,
                            bool testAlphaTexture = true) const = 0;
@@ -181,6 +181,7 @@ enum class Prof {
     GetSample,
     TexFiltTrilerp,
     TexFiltEWA,
+    TexFiltMultiProbe,
     ExtractorInit,
     ExtractorReport,
     PathExtractorRegexTest,
@@ -244,6 +245,7 @@ static const char *ProfNames[] = {
     "Sampler::GetSample[12]D()",
     "MIPMap::Lookup() (trilinear)",
     "MIPMap::Lookup() (EWA)",
+    "MIPMap::Lookup() (multi-probe)",
     "Extractor::Init()",
     "Extractor::ReportValue()",
     "PathExtractor::isValidPath()",
@@ -0,0 +1,411 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// core/texcache.cpp*
+#include "texcache.h"
+#include "stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace pbrt {
+
+STAT_PERCENT("Texture/Tile cache misses", nTilesRead, nTileLookups);
+STAT_COUNTER("Texture/Tiles evicted from cache", nTilesEvicted);
+STAT_MEMORY_COUNTER("Memory/Texture tile cache", tileCacheMemory);
+
+// TexelFormat Definitions
+Float sRGB8ToLinear[256], linear8ToLinear[256];
+// First entry of _sRGB8ToLinear_ that's at least as large as the smallest
+// float with the given upper 16 bits, for floats in $[0,1]$
+static uint8_t sRGB8Lookup[1 << 14];
+
+static bool InitTexelTables() {
+    // Match the values image textures compute from 8-bit images
+    for (int i = 0; i < 256; ++i) {
+        sRGB8ToLinear[i] = InverseGammaCorrect(i / 255.f);
+        linear8ToLinear[i] = i / 255.f;
+    }
+    for (int i = 0; i < (1 << 14); ++i) {
+        Float v = BitsToFloat(uint32_t(i) << 16);
+        sRGB8Lookup[i] = std::min<int>(
+            std::lower_bound(sRGB8ToLinear, sRGB8ToLinear + 256, v) -
+                sRGB8ToLinear,
+            255);
+    }
+    return true;
+}
+
+static bool texelTablesInitialized = InitTexelTables();
+
+uint8_t LinearToSRGB8(Float v) {
+    if (!(v > 0)) return 0;
+    if (v >= sRGB8ToLinear[255]) return 255;
+    // Find the first table entry that's at least _v_, starting from the
+    // entry for its upper bits, and return the nearer of it and its
+    // predecessor
+    int i = sRGB8Lookup[FloatToBits(float(v)) >> 16];
+    while (i > 0 && sRGB8ToLinear[i - 1] >= v) --i;
+    while (sRGB8ToLinear[i] < v) ++i;
+    return v - sRGB8ToLinear[i - 1] < sRGB8ToLinear[i] - v ? i - 1 : i;
+}
+
+// MIP Map File Local Definitions
+static const char mipMapFileMagic[8] = {'P', 'B', 'R', 'T', 'M', 'I', 'P', 0};
+static const uint32_t mipMapFileVersion = 1;
+static const uint32_t mipMapFileByteOrder = 0x01020304;
+static const int mipMapFileAlignment = 64;
+
+// TiledLevels Method Definitions
+TiledLevels::TiledLevels(const std::vector<Point2i> &levelResolution,
+                         size_t texelBytes)
+    : levelResolution(levelResolution), texelBytes(texelBytes) {
+    for (const Point2i &res : levelResolution) {
+        levelOffset.push_back(totalBytes);
+        totalBytes += int64_t(res.x) * int64_t(res.y) * texelBytes;
+    }
+}
+
+// TiledMIPMapFile Method Definitions
+std::unique_ptr<TiledMIPMapFile> TiledMIPMapFile::Read(
+    const std::string &filename) {
+    std::unique_ptr<TiledMIPMapFile> mip(new TiledMIPMapFile(filename));
+    if (!mip->file.IsValid()) {
+        Error("Unable to read MIP map file \"%s\".", filename.c_str());
+        return nullptr;
+    }
+    const char *data = mip->file.Data();
+    size_t size = mip->file.Size();
+    // Read the header and level resolutions
+    auto u32 = [&](size_t i) {
+        uint32_t v;
+        memcpy(&v, data + sizeof(mipMapFileMagic) + 4 * i, 4);
+        return v;
+    };
+    size_t headerSize = sizeof(mipMapFileMagic) + 4 * 4;
+    if (size < headerSize ||
+        memcmp(data, mipMapFileMagic, sizeof(mipMapFileMagic)) != 0) {
+        Error("\"%s\" is not a MIP map file.", filename.c_str());
+        return nullptr;
+    }
+    if (u32(1) != mipMapFileByteOrder) {
+        Error("MIP map file \"%s\" was written on a machine with a "
+              "different byte order.", filename.c_str());
+        return nullptr;
+    }
+    if (u32(0) != mipMapFileVersion) {
+        Error("MIP map file \"%s\" has unsupported version %d.",
+              filename.c_str(), int(u32(0)));
+        return nullptr;
+    }
+    mip->nChannels = u32(2);
+    uint32_t nLevels = u32(3);
+    if ((mip->nChannels != 1 && mip->nChannels != 3) || nLevels > 32 ||
+        size < headerSize + 8 * nLevels) {
+        Error("MIP map file \"%s\" is corrupt.", filename.c_str());
+        return nullptr;
+    }
+    std::vector<Point2i> levelResolution;
+    for (uint32_t i = 0; i < nLevels; ++i)
+        levelResolution.push_back(Point2i(u32(4 + 2 * i), u32(5 + 2 * i)));
+    mip->levels =
+        TiledLevels(levelResolution, mip->nChannels * sizeof(float));
+    headerSize += 8 * nLevels;
+    mip->dataOffset = (headerSize + mipMapFileAlignment - 1) /
+                      mipMapFileAlignment * mipMapFileAlignment;
+    if (int64_t(size) < mip->dataOffset + mip->levels.TotalBytes()) {
+        Error("MIP map file \"%s\" is truncated.", filename.c_str());
+        return nullptr;
+    }
+    mip->data = (const uint8_t *)data + mip->dataOffset;
+    return mip;
+}
+
+bool WriteTiledMIPMapFile(
+    const std::string &filename, const std::vector<Point2i> &levelResolution,
+    int nChannels,
+    const std::function<void(int level, int tx, int ty, float *dst)>
+        &copyTile) {
+    FILE *f = fopen(filename.c_str(), "wb");
+    if (!f) {
+        Error("Unable to open MIP map file \"%s\" for writing.",
+              filename.c_str());
+        return false;
+    }
+    // Write the header, padded so that the texels are aligned
+    std::vector<uint32_t> header = {mipMapFileVersion, mipMapFileByteOrder,
+                                    uint32_t(nChannels),
+                                    uint32_t(levelResolution.size())};
+    for (const Point2i &res : levelResolution) {
+        header.push_back(res.x);
+        header.push_back(res.y);
+    }
+    size_t headerSize = sizeof(mipMapFileMagic) + 4 * header.size();
+    std::vector<char> padding((mipMapFileAlignment -
+                               headerSize % mipMapFileAlignment) %
+                                  mipMapFileAlignment,
+                              0);
+    bool ok = fwrite(mipMapFileMagic, sizeof(mipMapFileMagic), 1, f) == 1 &&
+              fwrite(header.data(), 4, header.size(), f) == header.size() &&
+              fwrite(padding.data(), 1, padding.size(), f) == padding.size();
+
+    // Write the tiles of each level
+    TiledLevels levels(levelResolution, nChannels * sizeof(float));
+    std::vector<float> tile(TiledLevels::TileRes * TiledLevels::TileRes *
+                            nChannels);
+    for (int level = 0; level < levels.Levels() && ok; ++level) {
+        Point2i nTiles = levels.TileCount(level);
+        for (int ty = 0; ty < nTiles.y && ok; ++ty)
+            for (int tx = 0; tx < nTiles.x && ok; ++tx) {
+                size_t bytes;
+                levels.TileOffset(level, tx, ty, &bytes);
+                copyTile(level, tx, ty, tile.data());
+                ok = fwrite(tile.data(), 1, bytes, f) == bytes;
+            }
+    }
+    if (fclose(f) != 0) ok = false;
+    if (!ok) Error("Error writing MIP map file \"%s\".", filename.c_str());
+    return ok;
+}
+
+// TextureCache::CachedTexture Definition
+// Tiles are read with a single call to fread() from _file_, which holds
+// the texture's levels in the _TiledLevels_ layout starting at _offset_.
+struct TextureCache::CachedTexture {
+    ~CachedTexture() {
+        if (file) fclose(file);
+    }
+    FILE *file = nullptr;
+    std::mutex mutex;
+    TiledLevels levels;
+    int64_t offset = 0;
+};
+
+// Bytes of all tiles in memory, including evicted ones that threads are
+// still holding on to
+static std::atomic<size_t> liveTileBytes{0};
+
+// TextureTile Method Definitions
+TextureTile::TextureTile(size_t bytes)
+    : texels(new uint8_t[bytes]), bytes(bytes) {
+    liveTileBytes += bytes;
+}
+
+TextureTile::~TextureTile() { liveTileBytes -= bytes; }
+
+TextureCache textureCache;
+PBRT_THREAD_LOCAL TextureCache::ThreadTiles *TextureCache::threadTiles;
+
+// TextureCache Method Definitions
+TextureCache::~TextureCache() {}
+
+int TextureCache::AddTexture(
+    const std::vector<Point2i> &levelResolution, size_t texelBytes,
+    const std::function<void(int level, int tx, int ty, uint8_t *dst)>
+        &copyTile) {
+    ProfilePhase _(Prof::TextureLoading);
+    // Write the texture's tiles to a temporary backing file
+    std::unique_ptr<CachedTexture> tex(new CachedTexture);
+    tex->file = tmpfile();
+    if (!tex->file) {
+        Warning("Unable to create a temporary file for the texture cache. "
+                "Keeping the texture in memory.");
+        return -1;
+    }
+    tex->levels = TiledLevels(levelResolution, texelBytes);
+    std::vector<uint8_t> buf(TiledLevels::TileRes * TiledLevels::TileRes *
+                             texelBytes);
+    for (int level = 0; level < tex->levels.Levels(); ++level) {
+        Point2i nTiles = tex->levels.TileCount(level);
+        for (int ty = 0; ty < nTiles.y; ++ty)
+            for (int tx = 0; tx < nTiles.x; ++tx) {
+                size_t bytes;
+                tex->levels.TileOffset(level, tx, ty, &bytes);
+                copyTile(level, tx, ty, buf.data());
+                if (fwrite(buf.data(), 1, bytes, tex->file) != bytes) {
+                    Warning("Unable to write the texture cache's temporary "
+                            "file. Keeping the texture in memory.");
+                    return -1;
+                }
+            }
+    }
+    fflush(tex->file);
+    return Register(std::move(tex));
+}
+
+int TextureCache::AddTexture(const std::string &filename, int64_t offset,
+                             const TiledLevels &levels) {
+    std::unique_ptr<CachedTexture> tex(new CachedTexture);
+    tex->file = fopen(filename.c_str(), "rb");
+    if (!tex->file) {
+        Warning("Unable to open \"%s\" for the texture cache. Keeping "
+                "the texture in memory.", filename.c_str());
+        return -1;
+    }
+    tex->levels = levels;
+    tex->offset = offset;
+    return Register(std::move(tex));
+}
+
+int TextureCache::Register(std::unique_ptr<CachedTexture> tex) {
+    // Make sure that tile coordinates fit in tile keys
+    for (const Point2i &res : tex->levels.levelResolution) {
+        CHECK_LE(res.x, TiledLevels::TileRes << 18);
+        CHECK_LE(res.y, TiledLevels::TileRes << 18);
+    }
+    std::lock_guard<std::mutex> lock(texturesMutex);
+    CHECK_LT(textures.size(), 1 << 22);
+    textures.push_back(std::move(tex));
+    return textures.size() - 1;
+}
+
+void TextureCache::RemoveTexture(int texture) {
+    {
+        std::lock_guard<std::mutex> lock(clockMutex);
+        for (size_t i = 0; i < clock.size();) {
+            if (int(clock[i].key >> 42) == texture)
+                RemoveClockEntry(i);
+            else
+                ++i;
+        }
+    }
+    std::lock_guard<std::mutex> lock(texturesMutex);
+    textures[texture].reset();
+    // Have each thread release the texture's tiles it's still holding on to
+    // the next time it looks up a tile that it doesn't have
+    ++generation;
+}
+
+size_t TextureCache::BytesUsed() { return liveTileBytes; }
+
+const uint8_t *TextureCache::LookupTile(uint64_t key, uint64_t hash,
+                                        int slot) {
+    ++nTileLookups;
+    ThreadTiles *tt = threadTiles;
+    if (!tt) {
+        tt = threadTiles = new ThreadTiles;
+        std::lock_guard<std::mutex> lock(threadTilesMutex);
+        allThreadTiles.push_back(std::unique_ptr<ThreadTiles>(tt));
+    }
+    int gen = generation;
+    if (tt->generation != gen) {
+        *tt = ThreadTiles();
+        tt->generation = gen;
+    }
+
+    // Find the tile in the shared cache, reading it if it isn't present
+    Shard &shard = shards[(hash >> 32) % NumShards];
+    std::shared_ptr<const TextureTile> tile;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto iter = shard.tiles.find(key);
+        if (iter != shard.tiles.end()) tile = iter->second;
+    }
+    if (tile)
+        tile->referenced.store(true, std::memory_order_relaxed);
+    else {
+        // Read the tile outside the lock; if another thread reads it
+        // concurrently, the first copy stored is used
+        std::shared_ptr<const TextureTile> newTile = ReadTile(key);
+        bool inserted = false;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto result = shard.tiles.insert(std::make_pair(key, newTile));
+            tile = result.first->second;
+            inserted = result.second;
+        }
+        if (inserted) Insert(key, tile.get());
+    }
+    tt->keys[slot] = key;
+    tt->tiles[slot] = std::move(tile);
+    return tt->tiles[slot]->texels.get();
+}
+
+std::shared_ptr<const TextureTile> TextureCache::ReadTile(uint64_t key) {
+    ProfilePhase _(Prof::TextureLoading);
+    ++nTilesRead;
+    int texture = key >> 42, level = (key >> 36) & 63;
+    int ty = (key >> 18) & ((1 << 18) - 1), tx = key & ((1 << 18) - 1);
+    CachedTexture *tex;
+    {
+        std::lock_guard<std::mutex> lock(texturesMutex);
+        tex = textures[texture].get();
+    }
+    CHECK(tex != nullptr);
+    size_t bytes;
+    int64_t offset =
+        tex->offset + tex->levels.TileOffset(level, tx, ty, &bytes);
+    std::shared_ptr<TextureTile> tile = std::make_shared<TextureTile>(bytes);
+    std::lock_guard<std::mutex> lock(tex->mutex);
+    if (fseek(tex->file, offset, SEEK_SET) != 0 ||
+        fread(tile->texels.get(), 1, bytes, tex->file) != bytes)
+        LOG(FATAL) << "Unable to read a tile from the texture cache's "
+                      "temporary file";
+    return tile;
+}
+
+void TextureCache::Insert(uint64_t key, const TextureTile *tile) {
+    std::lock_guard<std::mutex> lock(clockMutex);
+    clock.push_back({key, tile});
+    tileCacheMemory += tile->bytes;
+
+    // Evict tiles until all tiles in memory, including the ones that
+    // threads hold on to, are within the budget
+    size_t maxBytes = size_t(PbrtOptions.textureCacheMB) << 20;
+    while (liveTileBytes > maxBytes && clock.size() > 1) {
+        if (hand >= clock.size()) hand = 0;
+        const ClockEntry &entry = clock[hand];
+        if (entry.key == key ||
+            entry.tile->referenced.exchange(false, std::memory_order_relaxed)) {
+            ++hand;
+            continue;
+        }
+        // Threads still using the tile keep it alive until they're done
+        // with it
+        RemoveClockEntry(hand);
+        ++nTilesEvicted;
+    }
+}
+
+void TextureCache::RemoveClockEntry(size_t index) {
+    ClockEntry entry = clock[index];
+    tileCacheMemory -= entry.tile->bytes;
+    clock[index] = clock.back();
+    clock.pop_back();
+    uint64_t hash = entry.key * 0x9e3779b97f4a7c15ull;
+    Shard &shard = shards[(hash >> 32) % NumShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.tiles.erase(entry.key);
+}
+
+}  // namespace pbrt
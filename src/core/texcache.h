@@ -0,0 +1,321 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_CORE_TEXCACHE_H
+#define PBRT_CORE_TEXCACHE_H
+
+// core/texcache.h*
+#include "pbrt.h"
+#include "geometry.h"
+#include "fileutil.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace pbrt {
+
+// TexelFormat Declarations
+// 8-bit components are decoded through a table, either as sRGB-encoded
+// values or as linear values in $[0,1]$.
+enum class TexelEncoding { sRGB8, Linear8, Half, Float };
+extern Float sRGB8ToLinear[256], linear8ToLinear[256];
+uint8_t LinearToSRGB8(Float v);
+
+struct TexelFormat {
+    TexelFormat() {}
+    TexelFormat(TexelEncoding encoding, int nChannels)
+        : encoding(encoding),
+          nChannels(nChannels),
+          texelBytes(nChannels * ComponentBytes(encoding)) {}
+    static int ComponentBytes(TexelEncoding encoding) {
+        switch (encoding) {
+        case TexelEncoding::sRGB8:
+        case TexelEncoding::Linear8:
+            return 1;
+        case TexelEncoding::Half:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+    TexelEncoding encoding = TexelEncoding::Float;
+    int nChannels = 1;
+    int texelBytes = 4;
+};
+
+template <TexelEncoding encoding>
+inline Float DecodeTexelComponent(const uint8_t *texel, int c);
+
+template <>
+inline Float DecodeTexelComponent<TexelEncoding::sRGB8>(const uint8_t *texel,
+                                                        int c) {
+    return sRGB8ToLinear[texel[c]];
+}
+
+template <>
+inline Float DecodeTexelComponent<TexelEncoding::Linear8>(
+    const uint8_t *texel, int c) {
+    return linear8ToLinear[texel[c]];
+}
+
+template <>
+inline Float DecodeTexelComponent<TexelEncoding::Half>(const uint8_t *texel,
+                                                       int c) {
+    return HalfToFloat(((const uint16_t *)texel)[c]);
+}
+
+template <>
+inline Float DecodeTexelComponent<TexelEncoding::Float>(const uint8_t *texel,
+                                                        int c) {
+    return ((const float *)texel)[c];
+}
+
+inline Float DecodeTexelComponent(TexelEncoding encoding,
+                                  const uint8_t *texel, int c) {
+    switch (encoding) {
+    case TexelEncoding::sRGB8:
+        return DecodeTexelComponent<TexelEncoding::sRGB8>(texel, c);
+    case TexelEncoding::Linear8:
+        return DecodeTexelComponent<TexelEncoding::Linear8>(texel, c);
+    case TexelEncoding::Half:
+        return DecodeTexelComponent<TexelEncoding::Half>(texel, c);
+    default:
+        return DecodeTexelComponent<TexelEncoding::Float>(texel, c);
+    }
+}
+
+inline void EncodeTexelComponent(TexelEncoding encoding, Float v,
+                                 uint8_t *texel, int c) {
+    switch (encoding) {
+    case TexelEncoding::sRGB8:
+        texel[c] = LinearToSRGB8(v);
+        break;
+    case TexelEncoding::Linear8:
+        texel[c] = Clamp(255 * v + 0.5f, 0.f, 255.f);
+        break;
+    case TexelEncoding::Half:
+        ((uint16_t *)texel)[c] = FloatToHalf(v);
+        break;
+    default:
+        ((float *)texel)[c] = v;
+        break;
+    }
+}
+
+// TiledLevels Declarations
+// Layout of MIP map levels stored one after another as rows of square
+// tiles, each of which holds its texels contiguously in scanline order.
+// Tiles at the right and top edges of a level are clipped to its
+// resolution.
+struct TiledLevels {
+    // TiledLevels Public Constants
+    static PBRT_CONSTEXPR int LogTileRes = 6;
+    static PBRT_CONSTEXPR int TileRes = 1 << LogTileRes;
+
+    // TiledLevels Public Methods
+    TiledLevels() {}
+    TiledLevels(const std::vector<Point2i> &levelResolution,
+                size_t texelBytes);
+    int Levels() const { return levelResolution.size(); }
+    Point2i TileCount(int level) const {
+        const Point2i &res = levelResolution[level];
+        return Point2i((res.x + TileRes - 1) >> LogTileRes,
+                       (res.y + TileRes - 1) >> LogTileRes);
+    }
+    int64_t TileOffset(int level, int tx, int ty, size_t *bytes) const {
+        const Point2i &res = levelResolution[level];
+        int x0 = tx << LogTileRes, y0 = ty << LogTileRes;
+        int tw = std::min(res.x - x0, int(TileRes));
+        int th = std::min(res.y - y0, int(TileRes));
+        if (bytes) *bytes = size_t(tw) * size_t(th) * texelBytes;
+        return levelOffset[level] +
+               (int64_t(y0) * res.x + int64_t(x0) * th) * texelBytes;
+    }
+    int64_t TotalBytes() const { return totalBytes; }
+
+    // TiledLevels Public Data
+    std::vector<Point2i> levelResolution;
+    std::vector<int64_t> levelOffset;
+    size_t texelBytes = 0;
+    int64_t totalBytes = 0;
+};
+
+// TiledMIPMapFile Declarations
+// Provides access to the prefiltered MIP map stored in a ".mip" file, as
+// written by "imgtool maketx". Texels are linear and have one or three
+// 32-bit float channels; the levels follow the _TiledLevels_ layout, so
+// the texture cache can page tiles from the file directly.
+class TiledMIPMapFile {
+  public:
+    // TiledMIPMapFile Public Methods
+    static std::unique_ptr<TiledMIPMapFile> Read(const std::string &filename);
+    const std::string &Filename() const { return filename; }
+    int Channels() const { return nChannels; }
+    const TiledLevels &Levels() const { return levels; }
+    int64_t DataOffset() const { return dataOffset; }
+    const uint8_t *Tile(int level, int tx, int ty) const {
+        return data + levels.TileOffset(level, tx, ty, nullptr);
+    }
+    const float *Texel(int level, int s, int t) const {
+        const int LogTileRes = TiledLevels::LogTileRes;
+        const int TileRes = TiledLevels::TileRes;
+        const float *tile =
+            (const float *)Tile(level, s >> LogTileRes, t >> LogTileRes);
+        int tileWidth = std::min(TileRes, levels.levelResolution[level].x -
+                                              (s & ~(TileRes - 1)));
+        return tile + nChannels * ((t & (TileRes - 1)) * tileWidth +
+                                   (s & (TileRes - 1)));
+    }
+
+  private:
+    // TiledMIPMapFile Private Methods
+    TiledMIPMapFile(const std::string &filename) : filename(filename),
+                                                   file(filename) {}
+
+    // TiledMIPMapFile Private Data
+    const std::string filename;
+    MappedFile file;
+    int nChannels;
+    TiledLevels levels;
+    int64_t dataOffset;
+    const uint8_t *data;
+};
+
+bool WriteTiledMIPMapFile(
+    const std::string &filename, const std::vector<Point2i> &levelResolution,
+    int nChannels,
+    const std::function<void(int level, int tx, int ty, float *dst)>
+        &copyTile);
+
+// TextureTile Declarations
+struct TextureTile {
+    TextureTile(size_t bytes);
+    ~TextureTile();
+    std::unique_ptr<uint8_t[]> texels;
+    const size_t bytes;
+    mutable std::atomic<bool> referenced{true};
+};
+
+// TextureCache Declarations
+// Holds the levels of cached MIP maps as square tiles that are read from
+// a backing file the first time they're used. The backing file is the MIP
+// map's own .mip file if it's used as is; otherwise the levels are built in
+// memory and copied to a temporary file, so the budget given by
+// --texturecache only bounds memory during loading for .mip inputs. Once
+// the tiles use more than the budget, ones that haven't been used
+// recently are evicted following the CLOCK algorithm. Each thread keeps
+// the tiles it used last in a small direct-mapped cache of its own, so
+// most lookups don't touch any shared state; those tiles count against
+// the budget too, even after they've been evicted.
+class TextureCache {
+  public:
+    // TextureCache Public Methods
+    ~TextureCache();
+    static bool Enabled() { return PbrtOptions.textureCacheMB > 0; }
+    int AddTexture(
+        const std::vector<Point2i> &levelResolution, size_t texelBytes,
+        const std::function<void(int level, int tx, int ty, uint8_t *dst)>
+            &copyTile);
+    int AddTexture(const std::string &filename, int64_t offset,
+                   const TiledLevels &levels);
+    void RemoveTexture(int texture);
+    const uint8_t *Tile(int texture, int level, int tx, int ty) {
+        // Look for the tile in the calling thread's tiles
+        uint64_t key = ((uint64_t)texture << 42) | ((uint64_t)level << 36) |
+                       ((uint64_t)ty << 18) | (uint64_t)tx;
+        uint64_t hash = key * 0x9e3779b97f4a7c15ull;
+        int slot = hash >> (64 - LogThreadTiles);
+        ThreadTiles *tt = threadTiles;
+        if (tt && tt->keys[slot] == key) {
+            const TextureTile *tile = tt->tiles[slot].get();
+            if (!tile->referenced.load(std::memory_order_relaxed))
+                tile->referenced.store(true, std::memory_order_relaxed);
+            return tile->texels.get();
+        }
+        return LookupTile(key, hash, slot);
+    }
+    size_t BytesUsed();
+
+  private:
+    // TextureCache Private Declarations
+    static PBRT_CONSTEXPR int LogThreadTiles = 4;
+    static PBRT_CONSTEXPR int NumShards = 64;
+    struct ThreadTiles {
+        ThreadTiles() {
+            for (uint64_t &key : keys) key = ~uint64_t(0);
+        }
+        uint64_t keys[1 << LogThreadTiles];
+        std::shared_ptr<const TextureTile> tiles[1 << LogThreadTiles];
+        int generation = 0;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::shared_ptr<const TextureTile>>
+            tiles;
+    };
+    struct CachedTexture;
+    struct ClockEntry {
+        uint64_t key;
+        const TextureTile *tile;
+    };
+
+    // TextureCache Private Methods
+    int Register(std::unique_ptr<CachedTexture> tex);
+    const uint8_t *LookupTile(uint64_t key, uint64_t hash, int slot);
+    std::shared_ptr<const TextureTile> ReadTile(uint64_t key);
+    void Insert(uint64_t key, const TextureTile *tile);
+    void RemoveClockEntry(size_t index);
+
+    // TextureCache Private Data
+    static PBRT_THREAD_LOCAL ThreadTiles *threadTiles;
+    Shard shards[NumShards];
+    std::mutex texturesMutex;
+    std::vector<std::unique_ptr<CachedTexture>> textures;
+    std::atomic<int> generation{0};
+    std::mutex threadTilesMutex;
+    std::vector<std::unique_ptr<ThreadTiles>> allThreadTiles;
+    std::mutex clockMutex;
+    std::vector<ClockEntry> clock;
+    size_t hand = 0;
+};
+
+extern TextureCache textureCache;
+
+}  // namespace pbrt
+
+#endif  // PBRT_CORE_TEXCACHE_H
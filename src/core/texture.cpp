@@ -44,7 +44,7 @@ inline Float SmoothStep(Float min, Float max, Float value) {
 }
 
 // Texture Forward Declarations
-inline Float Grad(int x, int y, int z, Float dx, Float dy, Float dz);
+inline Float Grad(int h, Float dx, Float dy, Float dz);
 inline Float NoiseWeight(Float t);
 
 // Perlin Noise Data
@@ -84,6 +84,18 @@ static int NoisePerm[2 * NoisePermSize] = {
     121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93, 222, 114, 67, 29, 24, 72,
     243, 141, 128, 195, 78, 66, 215, 61, 156, 180};
 
+// Gradient directions for the low four bits of a noise hash, stored as
+// separate components so that they can be gathered independently
+static const Float NoiseGradX[16] = {1, -1, 1, -1, 1, -1, 1, -1,
+                                     0, 0,  0, 0,  1, -1, 0, 0};
+static const Float NoiseGradY[16] = {1, 1,  -1, -1, 0, 0, 0, 0,
+                                     1, -1, 1,  -1, 1, 1, 1, -1};
+static const Float NoiseGradZ[16] = {0, 0, 0,  0,  1, 1, -1, -1,
+                                     1, 1, -1, -1, 0, 0, -1, -1};
+
+// Number of points _Noise()_ evaluates together
+static PBRT_CONSTEXPR int NoiseBatchSize = 8;
+
 // Texture Method Definitions
 TextureMapping2D::~TextureMapping2D() { }
 TextureMapping3D::~TextureMapping3D() { }
@@ -161,42 +173,72 @@ Point3f IdentityMapping3D::Map(const SurfaceInteraction &si, Vector3f *dpdx,
     return WorldToTexture(si.p);
 }
 
+void Noise(int n, const Point3f *p, Float *noise) {
+    for (int start = 0; start < n; start += NoiseBatchSize) {
+        int count = std::min(n - start, NoiseBatchSize);
+        const Point3f *pb = p + start;
+
+        // Compute noise cell coordinates and offsets for the batch
+        int ix[NoiseBatchSize], iy[NoiseBatchSize], iz[NoiseBatchSize];
+        Float dx[NoiseBatchSize], dy[NoiseBatchSize], dz[NoiseBatchSize];
+        for (int i = 0; i < count; ++i) {
+            // Round toward negative infinity without calling _std::floor()_
+            // so that the loop vectorizes
+            ix[i] = int(pb[i].x) - (pb[i].x < int(pb[i].x));
+            iy[i] = int(pb[i].y) - (pb[i].y < int(pb[i].y));
+            iz[i] = int(pb[i].z) - (pb[i].z < int(pb[i].z));
+            dx[i] = pb[i].x - ix[i];
+            dy[i] = pb[i].y - iy[i];
+            dz[i] = pb[i].z - iz[i];
+        }
+
+        // Compute gradient weights at the cell corners
+        Float w[8][NoiseBatchSize];
+        for (int i = 0; i < count; ++i) {
+            // Hash the corners, sharing the lookups common to several
+            int x = ix[i] & (NoisePermSize - 1);
+            int y = iy[i] & (NoisePermSize - 1);
+            int z = iz[i] & (NoisePermSize - 1);
+            int hx0 = NoisePerm[x] + y, hx1 = NoisePerm[x + 1] + y;
+            int h00 = NoisePerm[hx0] + z, h10 = NoisePerm[hx1] + z;
+            int h01 = NoisePerm[hx0 + 1] + z, h11 = NoisePerm[hx1 + 1] + z;
+            Float dx1 = dx[i] - 1, dy1 = dy[i] - 1, dz1 = dz[i] - 1;
+            w[0][i] = Grad(NoisePerm[h00], dx[i], dy[i], dz[i]);
+            w[1][i] = Grad(NoisePerm[h10], dx1, dy[i], dz[i]);
+            w[2][i] = Grad(NoisePerm[h01], dx[i], dy1, dz[i]);
+            w[3][i] = Grad(NoisePerm[h11], dx1, dy1, dz[i]);
+            w[4][i] = Grad(NoisePerm[h00 + 1], dx[i], dy[i], dz1);
+            w[5][i] = Grad(NoisePerm[h10 + 1], dx1, dy[i], dz1);
+            w[6][i] = Grad(NoisePerm[h01 + 1], dx[i], dy1, dz1);
+            w[7][i] = Grad(NoisePerm[h11 + 1], dx1, dy1, dz1);
+        }
+
+        // Compute trilinear interpolation of weights
+        for (int i = 0; i < count; ++i) {
+            Float wx = NoiseWeight(dx[i]), wy = NoiseWeight(dy[i]),
+                  wz = NoiseWeight(dz[i]);
+            Float x00 = Lerp(wx, w[0][i], w[1][i]);
+            Float x10 = Lerp(wx, w[2][i], w[3][i]);
+            Float x01 = Lerp(wx, w[4][i], w[5][i]);
+            Float x11 = Lerp(wx, w[6][i], w[7][i]);
+            Float y0 = Lerp(wy, x00, x10);
+            Float y1 = Lerp(wy, x01, x11);
+            noise[start + i] = Lerp(wz, y0, y1);
+        }
+    }
+}
+
 Float Noise(Float x, Float y, Float z) {
-    // Compute noise cell coordinates and offsets
-    int ix = std::floor(x), iy = std::floor(y), iz = std::floor(z);
-    Float dx = x - ix, dy = y - iy, dz = z - iz;
-
-    // Compute gradient weights
-    ix &= NoisePermSize - 1;
-    iy &= NoisePermSize - 1;
-    iz &= NoisePermSize - 1;
-    Float w000 = Grad(ix, iy, iz, dx, dy, dz);
-    Float w100 = Grad(ix + 1, iy, iz, dx - 1, dy, dz);
-    Float w010 = Grad(ix, iy + 1, iz, dx, dy - 1, dz);
-    Float w110 = Grad(ix + 1, iy + 1, iz, dx - 1, dy - 1, dz);
-    Float w001 = Grad(ix, iy, iz + 1, dx, dy, dz - 1);
-    Float w101 = Grad(ix + 1, iy, iz + 1, dx - 1, dy, dz - 1);
-    Float w011 = Grad(ix, iy + 1, iz + 1, dx, dy - 1, dz - 1);
-    Float w111 = Grad(ix + 1, iy + 1, iz + 1, dx - 1, dy - 1, dz - 1);
-
-    // Compute trilinear interpolation of weights
-    Float wx = NoiseWeight(dx), wy = NoiseWeight(dy), wz = NoiseWeight(dz);
-    Float x00 = Lerp(wx, w000, w100);
-    Float x10 = Lerp(wx, w010, w110);
-    Float x01 = Lerp(wx, w001, w101);
-    Float x11 = Lerp(wx, w011, w111);
-    Float y0 = Lerp(wy, x00, x10);
-    Float y1 = Lerp(wy, x01, x11);
-    return Lerp(wz, y0, y1);
+    Point3f p(x, y, z);
+    Float noise;
+    Noise(1, &p, &noise);
+    return noise;
 }
 
 Float Noise(const Point3f &p) { return Noise(p.x, p.y, p.z); }
-inline Float Grad(int x, int y, int z, Float dx, Float dy, Float dz) {
-    int h = NoisePerm[NoisePerm[NoisePerm[x] + y] + z];
+inline Float Grad(int h, Float dx, Float dy, Float dz) {
     h &= 15;
-    Float u = h < 8 || h == 12 || h == 13 ? dx : dy;
-    Float v = h < 4 || h == 12 || h == 13 ? dy : dz;
-    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+    return NoiseGradX[h] * dx + NoiseGradY[h] * dy + NoiseGradZ[h] * dz;
 }
 
 inline Float NoiseWeight(Float t) {
@@ -205,6 +247,17 @@ inline Float NoiseWeight(Float t) {
     return 6 * t4 * t - 15 * t4 + 10 * t3;
 }
 
+// Evaluates noise at _p_ scaled by the frequency of each octave
+static void OctaveNoise(const Point3f &p, int nOctaves, Float *noise) {
+    Point3f *octaveP = ALLOCA(Point3f, nOctaves);
+    Float lambda = 1;
+    for (int i = 0; i < nOctaves; ++i) {
+        octaveP[i] = lambda * p;
+        lambda *= 1.99f;
+    }
+    Noise(nOctaves, octaveP, noise);
+}
+
 Float FBm(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy,
           Float omega, int maxOctaves) {
     // Compute number of octaves for antialiased FBm
@@ -212,15 +265,18 @@ Float FBm(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy,
     Float n = Clamp(-1 - .5f * Log2(len2), 0, maxOctaves);
     int nInt = std::floor(n);
 
+    // Evaluate noise for all octaves at once
+    Float *noise = ALLOCA(Float, nInt + 1);
+    OctaveNoise(p, nInt + 1, noise);
+
     // Compute sum of octaves of noise for FBm
-    Float sum = 0, lambda = 1, o = 1;
+    Float sum = 0, o = 1;
     for (int i = 0; i < nInt; ++i) {
-        sum += o * Noise(lambda * p);
-        lambda *= 1.99f;
+        sum += o * noise[i];
         o *= omega;
     }
     Float nPartial = n - nInt;
-    sum += o * SmoothStep(.3f, .7f, nPartial) * Noise(lambda * p);
+    sum += o * SmoothStep(.3f, .7f, nPartial) * noise[nInt];
     return sum;
 }
 
@@ -231,18 +287,21 @@ Float Turbulence(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy,
     Float n = Clamp(-1 - .5f * Log2(len2), 0, maxOctaves);
     int nInt = std::floor(n);
 
+    // Evaluate noise for all octaves at once
+    Float *noise = ALLOCA(Float, nInt + 1);
+    OctaveNoise(p, nInt + 1, noise);
+
     // Compute sum of octaves of noise for turbulence
-    Float sum = 0, lambda = 1, o = 1;
+    Float sum = 0, o = 1;
     for (int i = 0; i < nInt; ++i) {
-        sum += o * std::abs(Noise(lambda * p));
-        lambda *= 1.99f;
+        sum += o * std::abs(noise[i]);
         o *= omega;
     }
 
     // Account for contributions of clamped octaves in turbulence
     Float nPartial = n - nInt;
     sum += o * Lerp(SmoothStep(.3f, .7f, nPartial), 0.2,
-                    std::abs(Noise(lambda * p)));
+                    std::abs(noise[nInt]));
     for (int i = nInt; i < maxOctaves; ++i) {
         sum += o * 0.2f;
         o *= omega;
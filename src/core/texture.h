@@ -44,6 +44,7 @@
 #include "geometry.h"
 #include "transform.h"
 #include "memory.h"
+#include "interaction.h"
 
 namespace pbrt {
 
@@ -137,11 +138,41 @@ class Texture {
     // Texture Interface
     virtual T Evaluate(const SurfaceInteraction &) const = 0;
     virtual ~Texture() {}
+
+    // Returns true and sets _*value_ if the texture has the same value
+    // everywhere
+    virtual bool IsConstant(T *value) const { return false; }
+
+    // Returns an equivalent texture that is cheaper to evaluate, or
+    // _nullptr_ if the texture can't be simplified
+    virtual std::shared_ptr<Texture<T>> Simplify() const { return nullptr; }
+};
+
+// Float texture that reuses values already computed at the same
+// _SurfaceInteraction_, so that a texture shared between bump mapping and
+// shading is only evaluated once per intersection
+class CachedFloatTexture : public Texture<Float> {
+  public:
+    // CachedFloatTexture Public Methods
+    CachedFloatTexture(const std::shared_ptr<Texture<Float>> &tex)
+        : tex(tex) {}
+    Float Evaluate(const SurfaceInteraction &si) const {
+        Float value;
+        if (si.textureValues.Lookup(this, &value)) return value;
+        value = tex->Evaluate(si);
+        si.textureValues.Insert(this, value);
+        return value;
+    }
+
+  private:
+    // CachedFloatTexture Private Data
+    std::shared_ptr<Texture<Float>> tex;
 };
 
 Float Lanczos(Float, Float tau = 2);
 Float Noise(Float x, Float y = .5f, Float z = .5f);
 Float Noise(const Point3f &p);
+void Noise(int n, const Point3f *p, Float *noise);
 Float FBm(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy,
           Float omega, int octaves);
 Float Turbulence(const Point3f &p, const Vector3f &dpdx, const Vector3f &dpdy,
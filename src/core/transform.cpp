@@ -1220,18 +1220,42 @@ Bounds3f AnimatedTransform::MotionBounds(const Bounds3f &b) const {
     return bounds;
 }
 
+Bounds3f AnimatedTransform::MotionBounds(const Bounds3f &b, Float time0,
+                                         Float time1) const {
+    if (!actuallyAnimated) return (*startTransform)(b);
+    Transform t0, t1;
+    Interpolate(time0, &t0);
+    Interpolate(time1, &t1);
+    if (hasRotation == false) return Union(t0(b), t1(b));
+    // Return motion bounds over the time range accounting for rotation
+    Bounds3f bounds;
+    for (int corner = 0; corner < 8; ++corner)
+        bounds =
+            Union(bounds, BoundPointMotion(b.Corner(corner), time0, time1));
+    return bounds;
+}
+
 Bounds3f AnimatedTransform::BoundPointMotion(const Point3f &p) const {
+    return BoundPointMotion(p, startTime, endTime);
+}
+
+Bounds3f AnimatedTransform::BoundPointMotion(const Point3f &p, Float time0,
+                                             Float time1) const {
     if (!actuallyAnimated) return Bounds3f((*startTransform)(p));
-    Bounds3f bounds((*startTransform)(p), (*endTransform)(p));
+    Bounds3f bounds((*this)(time0, p), (*this)(time1, p));
     Float cosTheta = Dot(R[0], R[1]);
     Float theta = std::acos(Clamp(cosTheta, -1, 1));
+    // Map the time range to the $[0,1]$ parameterization used for the
+    // derivative terms
+    Float u0 = Clamp((time0 - startTime) / (endTime - startTime), 0, 1);
+    Float u1 = Clamp((time1 - startTime) / (endTime - startTime), 0, 1);
     for (int c = 0; c < 3; ++c) {
         // Find any motion derivative zeros for the component _c_
         Float zeros[8];
         int nZeros = 0;
         IntervalFindZeros(c1[c].Eval(p), c2[c].Eval(p), c3[c].Eval(p),
-                          c4[c].Eval(p), c5[c].Eval(p), theta, Interval(0., 1.),
-                          zeros, &nZeros);
+                          c4[c].Eval(p), c5[c].Eval(p), theta,
+                          Interval(u0, u1), zeros, &nZeros);
         CHECK_LE(nZeros, sizeof(zeros) / sizeof(zeros[0]));
 
         // Expand bounding box for any motion derivative zeros found
@@ -1243,4 +1267,37 @@ Bounds3f AnimatedTransform::BoundPointMotion(const Point3f &p) const {
     return bounds;
 }
 
+void AnimatedTransform::MotionBoundKeys(const Bounds3f &b, Float time0,
+                                        Float time1, int nKeys,
+                                        Bounds3f *keys) const {
+    CHECK_GE(nKeys, 2);
+    if (!actuallyAnimated) {
+        for (int i = 0; i < nKeys; ++i) keys[i] = (*startTransform)(b);
+        return;
+    }
+    auto keyTime = [&](int i) {
+        return Lerp(Float(i) / Float(nKeys - 1), time0, time1);
+    };
+    // Without rotation, the corners of _b_ move linearly between the key
+    // times, so the extent of their bounds is a concave (minimum) or
+    // convex (maximum) function of time and the keys alone are
+    // conservative.
+    for (int i = 0; i < nKeys; ++i) {
+        Transform t;
+        Interpolate(keyTime(i), &t);
+        keys[i] = t(b);
+    }
+    // Otherwise, bound the segment's motion and have both of its keys
+    // include it
+    for (int i = 0; i < nKeys - 1; ++i) {
+        Float t0 = keyTime(i), t1 = keyTime(i + 1);
+        bool linear = !hasRotation && !(t0 < startTime && startTime < t1) &&
+                      !(t0 < endTime && endTime < t1);
+        if (linear) continue;
+        Bounds3f segmentBounds = MotionBounds(b, t0, t1);
+        keys[i] = Union(keys[i], segmentBounds);
+        keys[i + 1] = Union(keys[i + 1], segmentBounds);
+    }
+}
+
 }  // namespace pbrt
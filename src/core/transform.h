@@ -425,7 +425,15 @@ class AnimatedTransform {
         return startTransform->HasScale() || endTransform->HasScale();
     }
     Bounds3f MotionBounds(const Bounds3f &b) const;
+    Bounds3f MotionBounds(const Bounds3f &b, Float time0, Float time1) const;
     Bounds3f BoundPointMotion(const Point3f &p) const;
+    Bounds3f BoundPointMotion(const Point3f &p, Float time0,
+                              Float time1) const;
+    // Computes bounds of _b_ at _nKeys_ evenly spaced times over
+    // [_time0_, _time1_] such that linearly interpolating consecutive keys
+    // conservatively bounds _b_ at any time in between.
+    void MotionBoundKeys(const Bounds3f &b, Float time0, Float time1,
+                         int nKeys, Bounds3f *keys) const;
 
   private:
     // AnimatedTransform Private Data
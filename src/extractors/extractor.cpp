@@ -175,7 +175,7 @@ void ExtractorManager::WriteOutput(Float splatScale) {
   for(uint i = 0; i < extractors.size(); ++i) {
     if(dispatchtable[i].first)
       paths[dispatchtable[i].second]->WriteFile();
-    else
+    else if(extractors[i]->layer.empty())
       films[dispatchtable[i].second]->WriteImage(splatScale);
   }
 }
@@ -51,6 +51,7 @@ class Extractor {
     const ExtractorFunc *f;
     Film *film;
     PathOutput *p;
+    std::string layer; // Non-empty if _film_ is written as a layer of the image
 };
 
 class Containers {
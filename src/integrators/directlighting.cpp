@@ -68,7 +68,7 @@ Spectrum DirectLightingIntegrator::Li(const RayDifferential &ray,
     Spectrum L(0.f);
     // Find closest ray intersection or return background radiance
     SurfaceInteraction isect;
-    if (!scene.Intersect(ray, &isect)) {
+    if (!Intersect(scene, ray, &isect)) {
         for (const auto &light : scene.lights) L += light->Le(ray);
         return L;
     }
@@ -134,8 +134,9 @@ DirectLightingIntegrator *CreateDirectLightingIntegrator(
                 Error("Degenerate \"pixelbounds\" specified.");
         }
     }
+    bool batchRays = params.FindOneBool("batchrays", false);
     return new DirectLightingIntegrator(strategy, maxDepth, camera, sampler,
-                                        extractor, pixelBounds);
+                                        extractor, pixelBounds, batchRays);
 }
 
 }  // namespace pbrt
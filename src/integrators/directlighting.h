@@ -56,8 +56,10 @@ class DirectLightingIntegrator : public SamplerIntegrator {
                              std::shared_ptr<const Camera> camera,
                              std::shared_ptr<Sampler> sampler,
                              std::shared_ptr<ExtractorManager> extractor,
-                             const Bounds2i &pixelBounds)
-        : SamplerIntegrator(camera, sampler, extractor, pixelBounds),
+                             const Bounds2i &pixelBounds,
+                             bool batchRays = false)
+        : SamplerIntegrator(camera, sampler, extractor, pixelBounds,
+                            batchRays),
           strategy(strategy),
           maxDepth(maxDepth) {}
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
@@ -51,8 +51,9 @@ PathIntegrator::PathIntegrator(int maxDepth,
                                std::shared_ptr<Sampler> sampler,
                                std::shared_ptr<ExtractorManager> extractor,
                                const Bounds2i &pixelBounds, Float rrThreshold,
-                               const std::string &lightSampleStrategy)
-    : SamplerIntegrator(camera, sampler, extractor, pixelBounds),
+                               const std::string &lightSampleStrategy,
+                               bool batchRays)
+    : SamplerIntegrator(camera, sampler, extractor, pixelBounds, batchRays),
       maxDepth(maxDepth),
       rrThreshold(rrThreshold),
       lightSampleStrategy(lightSampleStrategy) {}
@@ -87,7 +88,7 @@ Spectrum PathIntegrator::Li(const RayDifferential &r, const Scene &scene,
 
         // Intersect _ray_ with scene and store intersection in _isect_
         SurfaceInteraction isect;
-        bool foundIntersection = scene.Intersect(ray, &isect);
+        bool foundIntersection = Intersect(scene, ray, &isect);
 
 
 
@@ -221,8 +222,9 @@ PathIntegrator *CreatePathIntegrator(const ParamSet &params,
     Float rrThreshold = params.FindOneFloat("rrthreshold", 1.);
     std::string lightStrategy =
         params.FindOneString("lightsamplestrategy", "spatial");
+    bool batchRays = params.FindOneBool("batchrays", false);
     return new PathIntegrator(maxDepth, camera, sampler, extractor, pixelBounds,
-                              rrThreshold, lightStrategy);
+                              rrThreshold, lightStrategy, batchRays);
 }
 
 }  // namespace pbrt
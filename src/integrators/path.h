@@ -53,7 +53,8 @@ class PathIntegrator : public SamplerIntegrator {
                    std::shared_ptr<Sampler> sampler,
                    std::shared_ptr<ExtractorManager> extractor,
                    const Bounds2i &pixelBounds, Float rrThreshold = 1,
-                   const std::string &lightSampleStrategy = "spatial");
+                   const std::string &lightSampleStrategy = "spatial",
+                   bool batchRays = false);
 
     void Preprocess(const Scene &scene, Sampler &sampler);
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
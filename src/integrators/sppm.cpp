@@ -147,18 +147,57 @@ void SPPMIntegrator::Render(const Scene &scene) {
                 int y0 = pixelBounds.pMin.y + tile.y * tileSize;
                 int y1 = std::min(y0 + tileSize, pixelBounds.pMax.y);
                 Bounds2i tileBounds(Point2i(x0, y0), Point2i(x1, y1));
+
+                // Optionally trace the tile's camera rays as a single batch
+                int nTilePixels = tileBounds.Area();
+                std::vector<RayDifferential> cameraRays;
+                std::vector<Float> cameraWeights;
+                std::vector<SurfaceInteraction> primaryIsects;
+                std::unique_ptr<bool[]> primaryHits;
+                if (batchRays) {
+                    cameraRays.resize(nTilePixels);
+                    cameraWeights.reserve(nTilePixels);
+                    std::vector<Ray> rays;
+                    rays.reserve(nTilePixels);
+                    for (Point2i pPixel : tileBounds) {
+                        tileSampler->StartPixel(pPixel);
+                        tileSampler->SetSampleNumber(iter);
+                        CameraSample cameraSample =
+                            tileSampler->GetCameraSample(pPixel);
+                        RayDifferential &ray = cameraRays[rays.size()];
+                        cameraWeights.push_back(camera->GenerateRayDifferential(
+                            cameraSample, &ray));
+                        ray.ScaleDifferentials(invSqrtSPP);
+                        rays.push_back(ray);
+                    }
+                    primaryIsects.resize(nTilePixels);
+                    primaryHits.reset(new bool[nTilePixels]);
+                    scene.IntersectBatch(&rays[0], nTilePixels,
+                                         &primaryIsects[0], primaryHits.get());
+                    for (int i = 0; i < nTilePixels; ++i)
+                        cameraRays[i].tMax = rays[i].tMax;
+                }
+                int tilePixelIndex = 0;
                 for (Point2i pPixel : tileBounds) {
                     // Prepare _tileSampler_ for _pPixel_
                     tileSampler->StartPixel(pPixel);
                     tileSampler->SetSampleNumber(iter);
 
-                    // Generate camera ray for pixel for SPPM
+                    // Generate camera ray for pixel for SPPM, or use the one
+                    // that was traced in the batch; the camera sample is
+                    // still taken so that the sampler's dimensions line up
                     CameraSample cameraSample =
                         tileSampler->GetCameraSample(pPixel);
                     RayDifferential ray;
-                    Spectrum beta =
-                        camera->GenerateRayDifferential(cameraSample, &ray);
-                    ray.ScaleDifferentials(invSqrtSPP);
+                    Spectrum beta;
+                    if (batchRays) {
+                        ray = cameraRays[tilePixelIndex];
+                        beta = cameraWeights[tilePixelIndex];
+                    } else {
+                        beta =
+                            camera->GenerateRayDifferential(cameraSample, &ray);
+                        ray.ScaleDifferentials(invSqrtSPP);
+                    }
 
                     // Follow camera ray path until a visible point is created
 
@@ -169,10 +208,21 @@ void SPPMIntegrator::Render(const Scene &scene) {
                         pPixelO.y * (pixelBounds.pMax.x - pixelBounds.pMin.x);
                     SPPMPixel &pixel = pixels[pixelOffset];
                     bool specularBounce = false;
+                    bool usePrimaryHit = batchRays;
+                    int primaryIndex = tilePixelIndex++;
                     for (int depth = 0; depth < maxDepth; ++depth) {
                         SurfaceInteraction isect;
                         ++totalPhotonSurfaceInteractions;
-                        if (!scene.Intersect(ray, &isect)) {
+                        bool foundIntersection;
+                        if (usePrimaryHit) {
+                            // Reuse the batched camera ray intersection
+                            usePrimaryHit = false;
+                            foundIntersection = primaryHits[primaryIndex];
+                            if (foundIntersection)
+                                isect = primaryIsects[primaryIndex];
+                        } else
+                            foundIntersection = scene.Intersect(ray, &isect);
+                        if (!foundIntersection) {
                             // Accumulate light contributions for ray with no
                             // intersection
                             for (const auto &light : scene.lights)
@@ -506,9 +556,10 @@ Integrator *CreateSPPMIntegrator(const ParamSet &params,
     int photonsPerIter = params.FindOneInt("photonsperiteration", -1);
     int writeFreq = params.FindOneInt("imagewritefrequency", 1 << 31);
     Float radius = params.FindOneFloat("radius", 1.f);
+    bool batchRays = params.FindOneBool("batchrays", false);
     if (PbrtOptions.quickRender) nIterations = std::max(1, nIterations / 16);
     return new SPPMIntegrator(camera, nIterations, photonsPerIter, maxDepth,
-                              radius, writeFreq);
+                              radius, writeFreq, batchRays);
 }
 
 }  // namespace pbrt
@@ -52,7 +52,8 @@ class SPPMIntegrator : public Integrator {
     // SPPMIntegrator Public Methods
     SPPMIntegrator(std::shared_ptr<const Camera> &camera, int nIterations,
                    int photonsPerIteration, int maxDepth,
-                   Float initialSearchRadius, int writeFrequency)
+                   Float initialSearchRadius, int writeFrequency,
+                   bool batchRays = false)
         : camera(camera),
           initialSearchRadius(initialSearchRadius),
           nIterations(nIterations),
@@ -60,7 +61,8 @@ class SPPMIntegrator : public Integrator {
           photonsPerIteration(photonsPerIteration > 0
                                   ? photonsPerIteration
                                   : camera->film->croppedPixelBounds.Area()),
-          writeFrequency(writeFrequency) {}
+          writeFrequency(writeFrequency),
+          batchRays(batchRays) {}
     void Render(const Scene &scene);
 
   private:
@@ -71,6 +73,7 @@ class SPPMIntegrator : public Integrator {
     const int maxDepth;
     const int photonsPerIteration;
     const int writeFrequency;
+    const bool batchRays;
 };
 
 Integrator *CreateSPPMIntegrator(const ParamSet &params,
@@ -73,7 +73,7 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
       container.Init(ray, bounces, scene);
         // Intersect _ray_ with scene and store intersection in _isect_
         SurfaceInteraction isect;
-        bool foundIntersection = scene.Intersect(ray, &isect);
+        bool foundIntersection = Intersect(scene, ray, &isect);
 
 
         // Sample the participating medium, if present
@@ -215,8 +215,9 @@ VolPathIntegrator *CreateVolPathIntegrator(
     Float rrThreshold = params.FindOneFloat("rrthreshold", 1.);
     std::string lightStrategy =
         params.FindOneString("lightsamplestrategy", "spatial");
+    bool batchRays = params.FindOneBool("batchrays", false);
     return new VolPathIntegrator(maxDepth, camera, sampler, extractor, pixelBounds,
-                                 rrThreshold, lightStrategy);
+                                 rrThreshold, lightStrategy, batchRays);
 }
 
 }  // namespace pbrt
@@ -53,8 +53,10 @@ class VolPathIntegrator : public SamplerIntegrator {
                       std::shared_ptr<Sampler> sampler,
                       std::shared_ptr<ExtractorManager> extractor,
                       const Bounds2i &pixelBounds, Float rrThreshold = 1,
-                      const std::string &lightSampleStrategy = "spatial")
-        : SamplerIntegrator(camera, sampler, extractor, pixelBounds),
+                      const std::string &lightSampleStrategy = "spatial",
+                      bool batchRays = false)
+        : SamplerIntegrator(camera, sampler, extractor, pixelBounds,
+                            batchRays),
           maxDepth(maxDepth),
           rrThreshold(rrThreshold),
           lightSampleStrategy(lightSampleStrategy) { }
@@ -48,7 +48,7 @@ Spectrum WhittedIntegrator::Li(const RayDifferential &ray, const Scene &scene,
     container.Init(ray, depth, scene);
     // Find closest ray intersection or return background radiance
     SurfaceInteraction isect;
-    if (!scene.Intersect(ray, &isect)) {
+    if (!Intersect(scene, ray, &isect)) {
         for (const auto &light : scene.lights) L += light->Le(ray);
         return L;
     }
@@ -111,7 +111,9 @@ WhittedIntegrator *CreateWhittedIntegrator(
                 Error("Degenerate \"pixelbounds\" specified.");
         }
     }
-    return new WhittedIntegrator(maxDepth, camera, sampler, extractor, pixelBounds);
+    bool batchRays = params.FindOneBool("batchrays", false);
+    return new WhittedIntegrator(maxDepth, camera, sampler, extractor,
+                                 pixelBounds, batchRays);
 }
 
 }  // namespace pbrt
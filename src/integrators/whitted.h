@@ -52,8 +52,10 @@ class WhittedIntegrator : public SamplerIntegrator {
     WhittedIntegrator(int maxDepth, std::shared_ptr<const Camera> camera,
                       std::shared_ptr<Sampler> sampler,
                       std::shared_ptr<ExtractorManager> extractor,
-                      const Bounds2i &pixelBounds)
-        : SamplerIntegrator(camera, sampler, extractor, pixelBounds), maxDepth(maxDepth) {}
+                      const Bounds2i &pixelBounds, bool batchRays = false)
+        : SamplerIntegrator(camera, sampler, extractor, pixelBounds,
+                            batchRays),
+          maxDepth(maxDepth) {}
     Spectrum Li(const RayDifferential &ray, const Scene &scene,
                 Sampler &sampler, MemoryArena &arena, Containers &container, int depth) const;
 
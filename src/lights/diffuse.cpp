@@ -48,8 +48,7 @@ DiffuseAreaLight::DiffuseAreaLight(const Transform &LightToWorld,
     : AreaLight(LightToWorld, mediumInterface, nSamples),
       Lemit(Lemit),
       shape(shape),
-      twoSided(twoSided),
-      area(shape->Area()) {
+      twoSided(twoSided) {
     // Warn if light has transformation with non-uniform scale, though not
     // for Triangles, since this doesn't matter for them.
     if (WorldToLight.HasScale() &&
@@ -62,7 +61,9 @@ DiffuseAreaLight::DiffuseAreaLight(const Transform &LightToWorld,
 }
 
 Spectrum DiffuseAreaLight::Power() const {
-    return (twoSided ? 2 : 1) * Lemit * area * Pi;
+    // The area is found when it's needed, since shapes that are tessellated
+    // lazily must be tessellated to compute it
+    return (twoSided ? 2 : 1) * Lemit * shape->Area() * Pi;
 }
 
 Spectrum DiffuseAreaLight::Sample_Li(const Interaction &ref, const Point2f &u,
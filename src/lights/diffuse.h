@@ -74,7 +74,6 @@ class DiffuseAreaLight : public AreaLight {
     // only emit in the hemimsphere around the surface normal.  However,
     // this behavior can now be overridden to give emission on both sides.
     const bool twoSided;
-    const Float area;
 };
 
 std::shared_ptr<AreaLight> CreateDiffuseAreaLight(
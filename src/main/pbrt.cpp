@@ -46,12 +46,25 @@ static void usage(const char *msg = nullptr) {
 
     fprintf(stderr, R"(usage: pbrt [<options>] <filename.pbrt...>
 Rendering options:
+  --compactmeshes      Store triangle meshes in a compressed format that uses
+                       less memory but is slightly slower to intersect.
   --help               Print this help text.
   --nthreads <num>     Use specified number of threads for rendering.
   --outfile <filename> Write the final image to the given filename.
   --quick              Automatically reduce a number of quality settings to
                        render more quickly.
   --quiet              Suppress all text output other than error messages.
+  --subdivcache <MB>   Memory budget for subdivision surface and displaced
+                       mesh tessellations, which are created as rays reach
+                       them. Default: 1024.
+  --texturecache <MB>  Memory budget for image texture tiles, which are read
+                       from disk as lookups reach them. Only .mip files
+                       (see "imgtool maketx") are read this way without
+                       being loaded first; other images are loaded and
+                       their MIP maps built in memory before they're
+                       copied to a temporary file, so the budget doesn't
+                       bound memory while they load. Default: 0, which
+                       keeps image textures entirely in memory.
 
 Logging options:
   --logdir <dir>       Specify directory that log files should be written to.
@@ -67,6 +80,10 @@ Reformatting options:
   --toply              Print a reformatted version of the input file(s) to
                        standard output and convert all triangle meshes to
                        PLY files. Does not render an image.
+  --tobinary <filename>
+                       Write the input file(s) to the given binary scene
+                       file, which pbrt loads much faster than text. Does not
+                       render an image.
 )");
 }
 
@@ -104,6 +121,23 @@ int main(int argc, char *argv[]) {
             FLAGS_minloglevel = atoi(argv[++i]);
         } else if (!strncmp(argv[i], "--minloglevel=", 14)) {
             FLAGS_minloglevel = atoi(&argv[i][14]);
+        } else if (!strcmp(argv[i], "--compactmeshes") ||
+                   !strcmp(argv[i], "-compactmeshes")) {
+            options.compactMeshes = true;
+        } else if (!strcmp(argv[i], "--subdivcache") ||
+                   !strcmp(argv[i], "-subdivcache")) {
+            if (i + 1 == argc)
+                usage("missing value after --subdivcache argument");
+            options.subdivCacheMB = atoi(argv[++i]);
+        } else if (!strncmp(argv[i], "--subdivcache=", 14)) {
+            options.subdivCacheMB = atoi(&argv[i][14]);
+        } else if (!strcmp(argv[i], "--texturecache") ||
+                   !strcmp(argv[i], "-texturecache")) {
+            if (i + 1 == argc)
+                usage("missing value after --texturecache argument");
+            options.textureCacheMB = atoi(argv[++i]);
+        } else if (!strncmp(argv[i], "--texturecache=", 15)) {
+            options.textureCacheMB = atoi(&argv[i][15]);
         } else if (!strcmp(argv[i], "--quick") || !strcmp(argv[i], "-quick")) {
             options.quickRender = true;
         } else if (!strcmp(argv[i], "--quiet") || !strcmp(argv[i], "-quiet")) {
@@ -112,6 +146,13 @@ int main(int argc, char *argv[]) {
             options.cat = true;
         } else if (!strcmp(argv[i], "--toply") || !strcmp(argv[i], "-toply")) {
             options.toPly = true;
+        } else if (!strcmp(argv[i], "--tobinary") ||
+                   !strcmp(argv[i], "-tobinary")) {
+            if (i + 1 == argc)
+                usage("missing value after --tobinary argument");
+            options.toBinary = argv[++i];
+        } else if (!strncmp(argv[i], "--tobinary=", 11)) {
+            options.toBinary = &argv[i][11];
         } else if (!strcmp(argv[i], "--v") || !strcmp(argv[i], "-v")) {
             if (i + 1 == argc)
                 usage("missing value after --v argument");
@@ -130,7 +171,8 @@ int main(int argc, char *argv[]) {
     }
 
     // Print welcome banner
-    if (!options.quiet && !options.cat && !options.toPly) {
+    if (!options.quiet && !options.cat && !options.toPly &&
+        options.toBinary.empty()) {
         printf("pbrt version 3 (built %s at %s) [Detected %d cores]\n",
                __DATE__, __TIME__, NumSystemCores());
 #ifndef NDEBUG
@@ -155,7 +197,7 @@ int main(int argc, char *argv[]) {
         // Parse scene from input files
         for (const std::string &f : filenames)
             if (!ParseFile(f))
-                Error("Couldn't open scene file \"%s\"", f.c_str());
+                Error("Couldn't read scene file \"%s\"", f.c_str());
     }
     pbrtCleanup();
     return 0;
@@ -0,0 +1,535 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+
+// shapes/compressedmesh.cpp*
+#include "shapes/compressedmesh.h"
+#include "interaction.h"
+#include "material.h"
+#include "stats.h"
+#include <algorithm>
+#include <numeric>
+
+namespace pbrt {
+
+STAT_MEMORY_COUNTER("Memory/Compressed triangle meshes", compressedMeshBytes);
+STAT_COUNTER("Scene/Compressed triangles", nCompressedTriangles);
+
+// CompressedTriangleMesh Local Definitions
+static PBRT_CONSTEXPR int MaxTrianglesInLeaf = 4;
+
+static uint16_t QuantizeUnit(Float v) {
+    return uint16_t(std::round(Clamp(v * .5f + .5f, 0, 1) * 65535));
+}
+
+// Octahedral encoding of a direction in 16 bits per component
+static uint32_t EncodeOctahedral(Vector3f v) {
+    Float len = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if (len == 0) return EncodeOctahedral(Vector3f(0, 0, 1));
+    v /= len;
+    Float x = v.x, y = v.y;
+    if (v.z < 0) {
+        x = (1 - std::abs(v.y)) * (v.x >= 0 ? 1 : -1);
+        y = (1 - std::abs(v.x)) * (v.y >= 0 ? 1 : -1);
+    }
+    return uint32_t(QuantizeUnit(x)) | (uint32_t(QuantizeUnit(y)) << 16);
+}
+
+static Vector3f DecodeOctahedral(uint32_t e) {
+    Float x = Float(e & 0xffff) / 65535 * 2 - 1;
+    Float y = Float(e >> 16) / 65535 * 2 - 1;
+    Vector3f v(x, y, 1 - std::abs(x) - std::abs(y));
+    if (v.z < 0) {
+        v.x = (1 - std::abs(y)) * (x >= 0 ? 1 : -1);
+        v.y = (1 - std::abs(x)) * (y >= 0 ? 1 : -1);
+    }
+    return Normalize(v);
+}
+
+// CompressedTriangleMesh Method Definitions
+CompressedTriangleMesh::CompressedTriangleMesh(
+    const TriangleMesh &mesh, bool flipNormals,
+    const std::shared_ptr<Material> &material,
+    const MediumInterface &mediumInterface)
+    : flipNormals(flipNormals),
+      material(material),
+      mediumInterface(mediumInterface) {
+    ProfilePhase _(Prof::AccelConstruction);
+    CHECK(Supports(mesh));
+    nCompressedTriangles += mesh.nTriangles;
+
+    // Build BVH over the mesh's triangles
+    std::vector<Bounds3f> triBounds(mesh.nTriangles);
+    for (int i = 0; i < mesh.nTriangles; ++i) {
+        const int *v = &mesh.vertexIndices[3 * i];
+        triBounds[i] =
+            Union(Bounds3f(mesh.p[v[0]], mesh.p[v[1]]), mesh.p[v[2]]);
+    }
+    std::vector<int> triangles(mesh.nTriangles);
+    std::iota(triangles.begin(), triangles.end(), 0);
+    nodes.reserve(2 * mesh.nTriangles / MaxTrianglesInLeaf + 1);
+    buildBVH(triangles, triBounds, 0, mesh.nTriangles);
+
+    // Group the leaves' triangles into meshlets in depth-first order,
+    // assigning meshlet-local vertex indices. Leaves temporarily store the
+    // offset of their first triangle in _triangles_ in _meshlet_.
+    std::vector<int> vertexMeshlet(mesh.nVertices, -1);
+    std::vector<int> localIndex(mesh.nVertices);
+    std::vector<int> meshletVertices;
+    indices.reserve(3 * mesh.nTriangles);
+    int nMeshletTriangles = MaxMeshletTriangles;
+    for (Node &node : nodes) {
+        if (node.nTriangles == 0) continue;
+        if (nMeshletTriangles + node.nTriangles > MaxMeshletTriangles) {
+            meshlets.push_back({Point3f(), Vector3f(),
+                                int(meshletVertices.size()),
+                                int(indices.size() / 3)});
+            nMeshletTriangles = 0;
+        }
+        int m = meshlets.size() - 1;
+        int start = node.meshlet;
+        node.meshlet = m;
+        node.firstTriangle = nMeshletTriangles;
+        nMeshletTriangles += node.nTriangles;
+        for (int i = start; i < start + node.nTriangles; ++i) {
+            const int *v = &mesh.vertexIndices[3 * triangles[i]];
+            for (int j = 0; j < 3; ++j) {
+                if (vertexMeshlet[v[j]] != m) {
+                    vertexMeshlet[v[j]] = m;
+                    localIndex[v[j]] =
+                        meshletVertices.size() - meshlets[m].firstVertex;
+                    meshletVertices.push_back(v[j]);
+                }
+                indices.push_back(localIndex[v[j]]);
+            }
+        }
+    }
+    static_assert(3 * MaxMeshletTriangles <= 65536,
+                  "Meshlet vertex indices must fit in 16 bits");
+
+    // Quantize vertex positions relative to their meshlet's origin on a
+    // grid chosen per meshlet so that the meshlet's extent fits in 16
+    // bits. Grid spacings are powers of two, anchored at the world origin
+    // and no finer than the floating-point spacing of the meshlet's
+    // coordinates, so grid points decode exactly. A vertex shared between
+    // meshlets is snapped to the coarsest of their grids, which the finer
+    // ones include, so that it decodes identically from each meshlet.
+    auto meshletEnd = [&](size_t m) {
+        return m + 1 < meshlets.size() ? meshlets[m + 1].firstVertex
+                                       : int(meshletVertices.size());
+    };
+    std::vector<int> meshletExponent(3 * meshlets.size());
+    for (size_t m = 0; m < meshlets.size(); ++m) {
+        Bounds3f b;
+        for (int i = meshlets[m].firstVertex; i < meshletEnd(m); ++i)
+            b = Union(b, mesh.p[meshletVertices[i]]);
+        for (int c = 0; c < 3; ++c) {
+            int exponent;
+            std::frexp(std::max(std::abs(b.pMin[c]), std::abs(b.pMax[c])),
+                       &exponent);
+            exponent -= 23;
+            while (std::ldexp(Float(65533), exponent) < b.Diagonal()[c])
+                ++exponent;
+            meshletExponent[3 * m + c] = exponent;
+        }
+    }
+    std::vector<int> vertexExponent(3 * mesh.nVertices,
+                                    std::numeric_limits<int>::min());
+    std::vector<Point3f> snapped(meshletVertices.size());
+    bool coarsened = true;
+    while (coarsened) {
+        coarsened = false;
+        for (size_t m = 0; m < meshlets.size(); ++m)
+            for (int i = meshlets[m].firstVertex; i < meshletEnd(m); ++i)
+                for (int c = 0; c < 3; ++c) {
+                    int &e = vertexExponent[3 * meshletVertices[i] + c];
+                    e = std::max(e, meshletExponent[3 * m + c]);
+                }
+        // Snap the vertices and coarsen the grids of meshlets whose snapped
+        // extent no longer fits
+        for (size_t m = 0; m < meshlets.size(); ++m) {
+            Bounds3f b;
+            for (int i = meshlets[m].firstVertex; i < meshletEnd(m); ++i) {
+                int v = meshletVertices[i];
+                for (int c = 0; c < 3; ++c) {
+                    int e = vertexExponent[3 * v + c];
+                    Float units = std::round(std::ldexp(mesh.p[v][c], -e));
+                    snapped[i][c] = std::ldexp(units, e);
+                }
+                b = Union(b, snapped[i]);
+            }
+            for (int c = 0; c < 3; ++c)
+                while (std::ldexp(Float(65533),
+                                  meshletExponent[3 * m + c]) <
+                       b.Diagonal()[c]) {
+                    ++meshletExponent[3 * m + c];
+                    coarsened = true;
+                }
+            meshlets[m].origin = b.pMin;
+        }
+    }
+    positions.resize(3 * meshletVertices.size());
+    for (size_t m = 0; m < meshlets.size(); ++m) {
+        Meshlet &meshlet = meshlets[m];
+        for (int c = 0; c < 3; ++c) {
+            int e = meshletExponent[3 * m + c];
+            meshlet.scale[c] = std::ldexp(Float(1), e);
+            for (int i = meshlet.firstVertex; i < meshletEnd(m); ++i) {
+                Float local =
+                    std::ldexp(snapped[i][c] - meshlet.origin[c], -e);
+                CHECK(local >= 0 && local <= 65535);
+                positions[3 * i + c] = uint16_t(local);
+            }
+        }
+    }
+
+    // Encode shading normals, tangents, and $(u,v)$s
+    if (mesh.n) {
+        normals.resize(meshletVertices.size());
+        for (size_t i = 0; i < meshletVertices.size(); ++i)
+            normals[i] =
+                EncodeOctahedral(Vector3f(mesh.n[meshletVertices[i]]));
+    }
+    if (mesh.s) {
+        tangents.resize(meshletVertices.size());
+        for (size_t i = 0; i < meshletVertices.size(); ++i)
+            tangents[i] = EncodeOctahedral(mesh.s[meshletVertices[i]]);
+    }
+    if (mesh.uv) {
+        uvs.resize(2 * meshletVertices.size());
+        for (size_t i = 0; i < meshletVertices.size(); ++i) {
+            Point2f uv = mesh.uv[meshletVertices[i]];
+            uvs[2 * i] = FloatToHalf(uv[0]);
+            uvs[2 * i + 1] = FloatToHalf(uv[1]);
+        }
+    }
+
+    // Recompute node bounds from the quantized positions; children always
+    // follow their parents
+    for (int i = int(nodes.size()) - 1; i >= 0; --i) {
+        Node &node = nodes[i];
+        if (node.nTriangles > 0) {
+            const Meshlet &m = meshlets[node.meshlet];
+            node.bounds = Bounds3f();
+            for (int t = 0; t < node.nTriangles; ++t) {
+                Point3f p[3];
+                GetPositions(m.firstTriangle + node.firstTriangle + t, m, p);
+                node.bounds =
+                    Union(Union(Bounds3f(p[0], p[1]), p[2]), node.bounds);
+            }
+        } else
+            node.bounds = Union(nodes[i + 1].bounds,
+                                nodes[node.secondChildOffset].bounds);
+    }
+    compressedMeshBytes +=
+        sizeof(*this) + nodes.size() * sizeof(Node) +
+        meshlets.size() * sizeof(Meshlet) +
+        (positions.size() + uvs.size() + indices.size()) * sizeof(uint16_t) +
+        (normals.size() + tangents.size()) * sizeof(uint32_t);
+}
+
+bool CompressedTriangleMesh::Supports(const TriangleMesh &mesh) {
+    return mesh.nTimeSamples == 1 && !mesh.alphaMask &&
+           !mesh.shadowAlphaMask && mesh.nTriangles > 0;
+}
+
+int CompressedTriangleMesh::buildBVH(std::vector<int> &triangles,
+                                     const std::vector<Bounds3f> &triBounds,
+                                     int start, int end) {
+    int nodeIndex = nodes.size();
+    nodes.push_back(Node());
+    Bounds3f centroidBounds;
+    for (int i = start; i < end; ++i)
+        centroidBounds =
+            Union(centroidBounds, triBounds[triangles[i]].Lerp(
+                                      Point3f(.5f, .5f, .5f)));
+    int nTriangles = end - start;
+    if (nTriangles <= MaxTrianglesInLeaf) {
+        // Create leaf _Node_; bounds are computed after quantization
+        nodes[nodeIndex].meshlet = start;
+        nodes[nodeIndex].nTriangles = nTriangles;
+        return nodeIndex;
+    }
+
+    // Partition triangles using binned SAH, falling back to equal counts
+    int dim = centroidBounds.MaximumExtent();
+    int mid = (start + end) / 2;
+    auto centroid = [&](int tri) {
+        return .5f * (triBounds[tri].pMin[dim] + triBounds[tri].pMax[dim]);
+    };
+    bool split = false;
+    if (centroidBounds.pMax[dim] > centroidBounds.pMin[dim]) {
+        PBRT_CONSTEXPR int nBuckets = 12;
+        int count[nBuckets] = {0};
+        Bounds3f bucketBounds[nBuckets];
+        Float cMin = centroidBounds.pMin[dim],
+              cExtent = centroidBounds.pMax[dim] - cMin;
+        auto bucketIndex = [&](int tri) {
+            int b = nBuckets * ((centroid(tri) - cMin) / cExtent);
+            return std::min(b, nBuckets - 1);
+        };
+        for (int i = start; i < end; ++i) {
+            int b = bucketIndex(triangles[i]);
+            ++count[b];
+            bucketBounds[b] = Union(bucketBounds[b], triBounds[triangles[i]]);
+        }
+        Float minCost = Infinity;
+        int minCostSplitBucket = -1;
+        for (int i = 0; i < nBuckets - 1; ++i) {
+            Bounds3f b0, b1;
+            int count0 = 0, count1 = 0;
+            for (int j = 0; j <= i; ++j) {
+                b0 = Union(b0, bucketBounds[j]);
+                count0 += count[j];
+            }
+            for (int j = i + 1; j < nBuckets; ++j) {
+                b1 = Union(b1, bucketBounds[j]);
+                count1 += count[j];
+            }
+            if (count0 == 0 || count1 == 0) continue;
+            Float cost = count0 * b0.SurfaceArea() + count1 * b1.SurfaceArea();
+            if (cost < minCost) {
+                minCost = cost;
+                minCostSplitBucket = i;
+            }
+        }
+        if (minCostSplitBucket != -1) {
+            int *pmid = std::partition(
+                &triangles[start], &triangles[end - 1] + 1, [&](int tri) {
+                    return bucketIndex(tri) <= minCostSplitBucket;
+                });
+            mid = pmid - &triangles[0];
+            split = true;
+        }
+    }
+    if (!split)
+        std::nth_element(&triangles[start], &triangles[mid],
+                         &triangles[end - 1] + 1, [&](int a, int b) {
+                             return centroid(a) < centroid(b);
+                         });
+
+    // Create interior _Node_; its first child immediately follows it
+    buildBVH(triangles, triBounds, start, mid);
+    int secondChild = buildBVH(triangles, triBounds, mid, end);
+    nodes[nodeIndex].secondChildOffset = secondChild;
+    nodes[nodeIndex].nTriangles = 0;
+    nodes[nodeIndex].axis = dim;
+    return nodeIndex;
+}
+
+Bounds3f CompressedTriangleMesh::WorldBound() const {
+    return nodes.empty() ? Bounds3f() : nodes[0].bounds;
+}
+
+template <typename Func>
+void CompressedTriangleMesh::traverse(const Ray &ray, Func func) const {
+    // Visit the leaves that _ray_ passes through until _func_ returns true
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    int nodesToVisit[64];
+    int toVisitOffset = 0, currentNodeIndex = 0;
+    while (true) {
+        const Node &node = nodes[currentNodeIndex];
+        if (node.bounds.IntersectP(ray, invDir, dirIsNeg)) {
+            if (node.nTriangles > 0) {
+                if (func(node)) return;
+                if (toVisitOffset == 0) break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            } else {
+                if (dirIsNeg[node.axis]) {
+                    nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
+                    currentNodeIndex = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset++] = node.secondChildOffset;
+                    currentNodeIndex = currentNodeIndex + 1;
+                }
+            }
+        } else {
+            if (toVisitOffset == 0) break;
+            currentNodeIndex = nodesToVisit[--toVisitOffset];
+        }
+    }
+}
+
+bool CompressedTriangleMesh::Intersect(const Ray &ray,
+                                       SurfaceInteraction *isect) const {
+    ProfilePhase prof(Prof::TriIntersect);
+    // Find the closest triangle hit
+    int hitTriangle = -1, hitMeshlet = -1;
+    Float b0, b1, b2;
+    traverse(ray, [&](const Node &node) {
+        const Meshlet &m = meshlets[node.meshlet];
+        for (int i = 0; i < node.nTriangles; ++i) {
+            int tri = m.firstTriangle + node.firstTriangle + i;
+            Point3f p[3];
+            GetPositions(tri, m, p);
+            Float t, tb0, tb1, tb2;
+            if (IntersectTriangle(ray, p[0], p[1], p[2], &t, &tb0, &tb1,
+                                  &tb2)) {
+                ray.tMax = t;
+                hitTriangle = tri;
+                hitMeshlet = node.meshlet;
+                b0 = tb0;
+                b1 = tb1;
+                b2 = tb2;
+            }
+        }
+        return false;
+    });
+    if (hitTriangle == -1) return false;
+
+    // Decode the vertex data of the hit triangle
+    const Meshlet &m = meshlets[hitMeshlet];
+    Point3f p[3];
+    GetPositions(hitTriangle, m, p);
+    int v[3];
+    for (int i = 0; i < 3; ++i)
+        v[i] = m.firstVertex + indices[3 * hitTriangle + i];
+    Point2f uv[3];
+    if (uvs.empty()) {
+        uv[0] = Point2f(0, 0);
+        uv[1] = Point2f(1, 0);
+        uv[2] = Point2f(1, 1);
+    } else
+        for (int i = 0; i < 3; ++i)
+            uv[i] = Point2f(HalfToFloat(uvs[2 * v[i]]),
+                            HalfToFloat(uvs[2 * v[i] + 1]));
+
+    // Compute triangle partial derivatives
+    Vector3f dpdu, dpdv;
+    Vector2f duv02 = uv[0] - uv[2], duv12 = uv[1] - uv[2];
+    Vector3f dp02 = p[0] - p[2], dp12 = p[1] - p[2];
+    Float determinant = duv02[0] * duv12[1] - duv02[1] * duv12[0];
+    bool degenerateUV = std::abs(determinant) < 1e-8;
+    if (!degenerateUV) {
+        Float invdet = 1 / determinant;
+        dpdu = (duv12[1] * dp02 - duv02[1] * dp12) * invdet;
+        dpdv = (-duv12[0] * dp02 + duv02[0] * dp12) * invdet;
+    }
+    if (degenerateUV || Cross(dpdu, dpdv).LengthSquared() == 0)
+        CoordinateSystem(Normalize(Cross(p[2] - p[0], p[1] - p[0])), &dpdu,
+                         &dpdv);
+
+    // Compute error bounds, hit point, and $(u,v)$ for triangle intersection
+    Point3f pAbsSum = Abs(b0 * p[0]) + Abs(b1 * p[1]) + Abs(b2 * p[2]);
+    Vector3f pError = gamma(7) * Vector3f(pAbsSum.x, pAbsSum.y, pAbsSum.z);
+    Point3f pHit = b0 * p[0] + b1 * p[1] + b2 * p[2];
+    Point2f uvHit = b0 * uv[0] + b1 * uv[1] + b2 * uv[2];
+    *isect = SurfaceInteraction(pHit, pError, uvHit, -ray.d, dpdu, dpdv,
+                                Normal3f(0, 0, 0), Normal3f(0, 0, 0), ray.time,
+                                nullptr);
+    isect->n = isect->shading.n = Normal3f(Normalize(Cross(dp02, dp12)));
+
+    if (!normals.empty() || !tangents.empty()) {
+        // Initialize shading geometry as _Triangle_ does
+        Normal3f n[3];
+        Normal3f ns = isect->n;
+        if (!normals.empty()) {
+            for (int i = 0; i < 3; ++i)
+                n[i] = Normal3f(DecodeOctahedral(normals[v[i]]));
+            Normal3f nsInterp = b0 * n[0] + b1 * n[1] + b2 * n[2];
+            if (nsInterp.LengthSquared() > 0) ns = Normalize(nsInterp);
+        }
+        Vector3f ss = Normalize(isect->dpdu);
+        if (!tangents.empty()) {
+            Vector3f ssInterp = b0 * DecodeOctahedral(tangents[v[0]]) +
+                                b1 * DecodeOctahedral(tangents[v[1]]) +
+                                b2 * DecodeOctahedral(tangents[v[2]]);
+            if (ssInterp.LengthSquared() > 0) ss = Normalize(ssInterp);
+        }
+        Vector3f ts = Cross(ss, ns);
+        if (ts.LengthSquared() > 0.f) {
+            ts = Normalize(ts);
+            ss = Cross(ts, ns);
+        } else
+            CoordinateSystem((Vector3f)ns, &ss, &ts);
+
+        // Compute $\dndu$ and $\dndv$ for triangle shading geometry
+        Normal3f dndu(0, 0, 0), dndv(0, 0, 0);
+        if (!normals.empty() && !degenerateUV) {
+            Normal3f dn1 = n[0] - n[2], dn2 = n[1] - n[2];
+            Float invDet = 1 / determinant;
+            dndu = (duv12[1] * dn1 - duv02[1] * dn2) * invDet;
+            dndv = (-duv12[0] * dn1 + duv02[0] * dn2) * invDet;
+        }
+        isect->SetShadingGeometry(ss, ts, dndu, dndv, true);
+        // There's no _Shape_ for _SetShadingGeometry()_ to take the
+        // orientation from
+        if (flipNormals) {
+            isect->shading.n = -isect->shading.n;
+            isect->n = -isect->n;
+        }
+    }
+
+    // Ensure correct orientation of the geometric normal
+    if (!normals.empty())
+        isect->n = Faceforward(isect->n, isect->shading.n);
+    else if (flipNormals)
+        isect->n = isect->shading.n = -isect->n;
+    isect->primitive = this;
+    CHECK_GE(Dot(isect->n, isect->shading.n), 0.);
+    if (mediumInterface.IsMediumTransition())
+        isect->mediumInterface = mediumInterface;
+    else
+        isect->mediumInterface = MediumInterface(ray.medium);
+    return true;
+}
+
+bool CompressedTriangleMesh::IntersectP(const Ray &ray) const {
+    ProfilePhase prof(Prof::TriIntersectP);
+    bool hit = false;
+    traverse(ray, [&](const Node &node) {
+        const Meshlet &m = meshlets[node.meshlet];
+        for (int i = 0; i < node.nTriangles; ++i) {
+            Point3f p[3];
+            GetPositions(m.firstTriangle + node.firstTriangle + i, m, p);
+            Float t, b0, b1, b2;
+            if (IntersectTriangle(ray, p[0], p[1], p[2], &t, &b0, &b1, &b2))
+                return hit = true;
+        }
+        return false;
+    });
+    return hit;
+}
+
+void CompressedTriangleMesh::ComputeScatteringFunctions(
+    SurfaceInteraction *isect, MemoryArena &arena, TransportMode mode,
+    bool allowMultipleLobes) const {
+    ProfilePhase p(Prof::ComputeScatteringFuncs);
+    if (material)
+        material->ComputeScatteringFunctions(isect, arena, mode,
+                                             allowMultipleLobes);
+    CHECK_GE(Dot(isect->n, isect->shading.n), 0.);
+}
+
+}  // namespace pbrt
@@ -0,0 +1,128 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_SHAPES_COMPRESSEDMESH_H
+#define PBRT_SHAPES_COMPRESSEDMESH_H
+
+// shapes/compressedmesh.h*
+#include "pbrt.h"
+#include "primitive.h"
+#include "shapes/triangle.h"
+
+namespace pbrt {
+
+// CompressedTriangleMesh Declarations
+// A triangle mesh stored as a single primitive with its own BVH, where
+// triangles are only referenced implicitly by index. Triangles are grouped
+// into meshlets of up to _MaxMeshletTriangles_ with 16-bit local vertex
+// indices. Positions are quantized to 16 bits relative to the meshlet on a
+// grid fit to the meshlet; vertices shared between meshlets are snapped to
+// the coarsest of their grids so that they decode identically and the mesh
+// stays watertight. Normals and tangents are octahedral-encoded in 32 bits
+// and $(u,v)$s are stored as halfs.
+class CompressedTriangleMesh : public Primitive {
+  public:
+    // CompressedTriangleMesh Public Methods
+    CompressedTriangleMesh(const TriangleMesh &mesh, bool flipNormals,
+                           const std::shared_ptr<Material> &material,
+                           const MediumInterface &mediumInterface);
+    Bounds3f WorldBound() const;
+    bool Intersect(const Ray &r, SurfaceInteraction *isect) const;
+    bool IntersectP(const Ray &r) const;
+    const AreaLight *GetAreaLight() const { return nullptr; }
+    const Material *GetMaterial() const { return material.get(); }
+    void ComputeScatteringFunctions(SurfaceInteraction *isect,
+                                    MemoryArena &arena, TransportMode mode,
+                                    bool allowMultipleLobes) const;
+    // Returns true if _mesh_ can be represented by a
+    // _CompressedTriangleMesh_.
+    static bool Supports(const TriangleMesh &mesh);
+    static PBRT_CONSTEXPR int MaxMeshletTriangles = 256;
+
+  private:
+    // CompressedTriangleMesh Private Types
+    struct Meshlet {
+        // Origin of the meshlet's vertices and the power-of-two spacing of
+        // its quantization grid
+        Point3f origin;
+        Vector3f scale;
+        int firstVertex, firstTriangle;
+    };
+    struct Node {
+        Bounds3f bounds;
+        union {
+            int meshlet;            // leaf
+            int secondChildOffset;  // interior
+        };
+        uint16_t firstTriangle;  // leaf, relative to the meshlet
+        uint8_t nTriangles;      // 0 -> interior node
+        uint8_t axis;            // interior node: xyz
+    };
+
+    // CompressedTriangleMesh Private Methods
+    int buildBVH(std::vector<int> &triangles,
+                 const std::vector<Bounds3f> &triBounds, int start, int end);
+    Point3f P(const Meshlet &m, int vertex) const {
+        const uint16_t *q = &positions[3 * (m.firstVertex + vertex)];
+        return Point3f(m.origin.x + Float(q[0]) * m.scale.x,
+                       m.origin.y + Float(q[1]) * m.scale.y,
+                       m.origin.z + Float(q[2]) * m.scale.z);
+    }
+    void GetPositions(int triangle, const Meshlet &m, Point3f p[3]) const {
+        const uint16_t *v = &indices[3 * triangle];
+        for (int i = 0; i < 3; ++i) p[i] = P(m, v[i]);
+    }
+    template <typename Func>
+    void traverse(const Ray &ray, Func func) const;
+
+    // CompressedTriangleMesh Private Data
+    std::vector<Node> nodes;
+    std::vector<Meshlet> meshlets;
+    // Per-vertex data, grouped by meshlet
+    std::vector<uint16_t> positions, uvs;
+    std::vector<uint32_t> normals, tangents;
+    // Per-triangle meshlet-local vertex indices
+    std::vector<uint16_t> indices;
+    const bool flipNormals;
+    std::shared_ptr<Material> material;
+    MediumInterface mediumInterface;
+};
+
+}  // namespace pbrt
+
+#endif  // PBRT_SHAPES_COMPRESSEDMESH_H
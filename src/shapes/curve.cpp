@@ -71,6 +71,44 @@ static Point3f EvalBezier(const Point3f cp[4], Float u,
     return Lerp(u, cp2[0], cp2[1]);
 }
 
+// Returns a mask with bit $i$ set if the bounds of the $i$th ray-space
+// curve segment, expanded by half of its maximum width, overlap the ray.
+template <int N>
+static uint32_t OverlappingSegments(const Point3f *const cps[],
+                                    const Float *maxWidth, Float zMax) {
+    // Gather the control points in SoA form so that the segments are all
+    // tested together without data-dependent branches
+    Float x[4][N], y[4][N], z[4][N];
+    for (int i = 0; i < N; ++i)
+        for (int j = 0; j < 4; ++j) {
+            x[j][i] = cps[i][j].x;
+            y[j][i] = cps[i][j].y;
+            z[j][i] = cps[i][j].z;
+        }
+    uint32_t mask = 0;
+    for (int i = 0; i < N; ++i) {
+        Float xMin = std::min(std::min(x[0][i], x[1][i]),
+                              std::min(x[2][i], x[3][i]));
+        Float xMax = std::max(std::max(x[0][i], x[1][i]),
+                              std::max(x[2][i], x[3][i]));
+        Float yMin = std::min(std::min(y[0][i], y[1][i]),
+                              std::min(y[2][i], y[3][i]));
+        Float yMax = std::max(std::max(y[0][i], y[1][i]),
+                              std::max(y[2][i], y[3][i]));
+        Float zMin = std::min(std::min(z[0][i], z[1][i]),
+                              std::min(z[2][i], z[3][i]));
+        Float zMaxSeg = std::max(std::max(z[0][i], z[1][i]),
+                                 std::max(z[2][i], z[3][i]));
+        double halfWidth = 0.5 * maxWidth[i];
+        bool overlaps = !(yMax + halfWidth < 0) & !(yMin - halfWidth > 0) &
+                        !(xMax + halfWidth < 0) & !(xMin - halfWidth > 0) &
+                        !(zMaxSeg + halfWidth < 0) &
+                        !(zMin - halfWidth > zMax);
+        mask |= uint32_t(overlaps) << i;
+    }
+    return mask;
+}
+
 // Curve Method Definitions
 CurveCommon::CurveCommon(const Point3f c[4], Float width0, Float width1,
                          CurveType type, const Normal3f *norm)
@@ -88,6 +126,63 @@ CurveCommon::CurveCommon(const Point3f c[4], Float width0, Float width1,
     ++nCurves;
 }
 
+Curve::Curve(const Transform *ObjectToWorld, const Transform *WorldToObject,
+             bool reverseOrientation,
+             const std::shared_ptr<CurveCommon> &common, Float uMin,
+             Float uMax)
+    : Shape(ObjectToWorld, WorldToObject, reverseOrientation),
+      common(common),
+      uMin(uMin),
+      uMax(uMax) {
+    Point3f cpObj[4];
+    segmentControlPoints(cpObj);
+
+    // Transform the capsule to world space, scaling its radius by a bound
+    // on the largest singular value of _ObjectToWorld_'s linear part
+    const Matrix4x4 &m = ObjectToWorld->GetMatrix();
+    Float maxRowSum = 0;
+    for (int i = 0; i < 3; ++i) {
+        Float rowSum = 0;
+        for (int j = 0; j < 3; ++j) {
+            Float mtm = 0;
+            for (int k = 0; k < 3; ++k) mtm += m.m[k][i] * m.m[k][j];
+            rowSum += std::abs(mtm);
+        }
+        maxRowSum = std::max(maxRowSum, rowSum);
+    }
+    capsuleAxis[0] = (*ObjectToWorld)(cpObj[0]);
+    capsuleAxis[1] = (*ObjectToWorld)(cpObj[3]);
+    capsuleRadius =
+        objectCapsuleRadius(cpObj) * std::sqrt(maxRowSum) * (1 + gamma(8)) +
+        gamma(8) * (MaxComponent(Abs(Vector3f(capsuleAxis[0]))) +
+                    MaxComponent(Abs(Vector3f(capsuleAxis[1]))));
+}
+
+Float Curve::objectCapsuleRadius(const Point3f cpObj[4]) const {
+    // Compute the radius of the segment's bounding capsule around its chord
+    // in object space; the curve lies within the convex hull of its control
+    // points
+    Float maxDist = 0;
+    Vector3f chord = cpObj[3] - cpObj[0];
+    for (int i = 1; i < 3; ++i) {
+        Vector3f v = cpObj[i] - cpObj[0];
+        Float len2 = chord.LengthSquared();
+        Float t = len2 > 0 ? Clamp(Dot(v, chord) / len2, 0, 1) : 0;
+        maxDist = std::max(maxDist, (v - t * chord).Length());
+    }
+    Float maxWidth = std::max(Lerp(uMin, common->width[0], common->width[1]),
+                              Lerp(uMax, common->width[0], common->width[1]));
+    return maxDist + 0.5f * maxWidth;
+}
+
+void Curve::segmentControlPoints(Point3f cpObj[4]) const {
+    // Compute object-space control points for curve segment, _cpObj_
+    cpObj[0] = BlossomBezier(common->cpObj, uMin, uMin, uMin);
+    cpObj[1] = BlossomBezier(common->cpObj, uMin, uMin, uMax);
+    cpObj[2] = BlossomBezier(common->cpObj, uMin, uMax, uMax);
+    cpObj[3] = BlossomBezier(common->cpObj, uMax, uMax, uMax);
+}
+
 std::vector<std::shared_ptr<Shape>> CreateCurve(
     const Transform *o2w, const Transform *w2o, bool reverseOrientation,
     const Point3f c[4], Float w0, Float w1, CurveType type,
@@ -109,33 +204,51 @@ std::vector<std::shared_ptr<Shape>> CreateCurve(
 }
 
 Bounds3f Curve::ObjectBound() const {
-    // Compute object-space control points for curve segment, _cpObj_
     Point3f cpObj[4];
-    cpObj[0] = BlossomBezier(common->cpObj, uMin, uMin, uMin);
-    cpObj[1] = BlossomBezier(common->cpObj, uMin, uMin, uMax);
-    cpObj[2] = BlossomBezier(common->cpObj, uMin, uMax, uMax);
-    cpObj[3] = BlossomBezier(common->cpObj, uMax, uMax, uMax);
+    segmentControlPoints(cpObj);
     Bounds3f b =
         Union(Bounds3f(cpObj[0], cpObj[1]), Bounds3f(cpObj[2], cpObj[3]));
     Float width[2] = {Lerp(uMin, common->width[0], common->width[1]),
                       Lerp(uMax, common->width[0], common->width[1])};
-    return Expand(b, std::max(width[0], width[1]) * 0.5f);
+    b = Expand(b, std::max(width[0], width[1]) * 0.5f);
+    // The bounding capsule's box bounds the segment as well, and neither box
+    // contains the other in general
+    Bounds3f capsule = Expand(Bounds3f(cpObj[0], cpObj[3]),
+                              objectCapsuleRadius(cpObj) * (1 + gamma(4)));
+    return pbrt::Intersect(b, capsule);
+}
+
+Bounds3f Curve::WorldBound() const {
+    // Transforming the object-space bounds loosens them for rotated
+    // segments; the world-space capsule's box doesn't suffer from that
+    Bounds3f capsule =
+        Expand(Bounds3f(capsuleAxis[0], capsuleAxis[1]), capsuleRadius);
+    return pbrt::Intersect(Shape::WorldBound(), capsule);
 }
 
 bool Curve::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
                       bool testAlphaTexture) const {
     ProfilePhase p(isect ? Prof::CurveIntersect : Prof::CurveIntersectP);
     ++nTests;
+    // Reject rays that miss the segment's bounding capsule before
+    // transforming them to object space. Only the distance from the ray's
+    // line to the capsule's axis is needed, which is the distance from the
+    // origin to the axis projected onto the plane perpendicular to the ray.
+    Vector3f dn = Normalize(r.d);
+    Vector3f w0 = capsuleAxis[0] - r.o, w1 = capsuleAxis[1] - r.o;
+    Vector3f p0 = w0 - Dot(w0, dn) * dn, p01 = w1 - Dot(w1, dn) * dn - p0;
+    Float len2 = p01.LengthSquared();
+    Float t = len2 > 0 ? Clamp(-Dot(p0, p01) / len2, 0, 1) : 0;
+    // Allow for rounding error in the projection
+    Float rMax = capsuleRadius +
+                 gamma(16) * (MaxComponent(Abs(w0)) + MaxComponent(Abs(w1)));
+    if ((p0 + t * p01).LengthSquared() > rMax * rMax) return false;
+
     // Transform _Ray_ to object space
     Vector3f oErr, dErr;
     Ray ray = (*WorldToObject)(r, &oErr, &dErr);
-
-    // Compute object-space control points for curve segment, _cpObj_
     Point3f cpObj[4];
-    cpObj[0] = BlossomBezier(common->cpObj, uMin, uMin, uMin);
-    cpObj[1] = BlossomBezier(common->cpObj, uMin, uMin, uMax);
-    cpObj[2] = BlossomBezier(common->cpObj, uMin, uMax, uMax);
-    cpObj[3] = BlossomBezier(common->cpObj, uMax, uMax, uMax);
+    segmentControlPoints(cpObj);
 
     // Project curve control points to plane perpendicular to ray
 
@@ -221,149 +334,157 @@ bool Curve::recursiveIntersect(const Ray &ray, Float *tHit,
                                SurfaceInteraction *isect, const Point3f cp[4],
                                const Transform &rayToObject, Float u0, Float u1,
                                int depth) const {
+    if (depth == 0)
+        return intersectSegment(ray, tHit, isect, cp, rayToObject, u0, u1);
     Float rayLength = ray.d.Length();
+    Float zMax = rayLength * ray.tMax;
 
-    if (depth > 0) {
-        // Split curve segment into sub-segments and test for intersection
-        Point3f cpSplit[7];
-        SubdivideBezier(cp, cpSplit);
-
-        // For each of the two segments, see if the ray's bounding box
-        // overlaps the segment before recursively checking for
-        // intersection with it.
-        bool hit = false;
-        Float u[3] = {u0, (u0 + u1) / 2.f, u1};
-        // Pointer to the 4 control poitns for the current segment.
-        const Point3f *cps = cpSplit;
-        for (int seg = 0; seg < 2; ++seg, cps += 3) {
-            Float maxWidth =
-                std::max(Lerp(u[seg], common->width[0], common->width[1]),
-                         Lerp(u[seg + 1], common->width[0], common->width[1]));
-
-            // As above, check y first, since it most commonly lets us exit
-            // out early.
-            if (std::max(std::max(cps[0].y, cps[1].y),
-                         std::max(cps[2].y, cps[3].y)) +
-                        0.5 * maxWidth < 0 ||
-                std::min(std::min(cps[0].y, cps[1].y),
-                         std::min(cps[2].y, cps[3].y)) -
-                        0.5 * maxWidth > 0)
-                continue;
-
-            if (std::max(std::max(cps[0].x, cps[1].x),
-                         std::max(cps[2].x, cps[3].x)) +
-                        0.5 * maxWidth < 0 ||
-                std::min(std::min(cps[0].x, cps[1].x),
-                         std::min(cps[2].x, cps[3].x)) -
-                        0.5 * maxWidth > 0)
-                continue;
-
-            Float zMax = rayLength * ray.tMax;
-            if (std::max(std::max(cps[0].z, cps[1].z),
-                         std::max(cps[2].z, cps[3].z)) +
-                        0.5 * maxWidth < 0 ||
-                std::min(std::min(cps[0].z, cps[1].z),
-                         std::min(cps[2].z, cps[3].z)) -
-                        0.5 * maxWidth > zMax)
-                continue;
-
-            hit |= recursiveIntersect(ray, tHit, isect, cps, rayToObject,
-                                      u[seg], u[seg + 1], depth - 1);
-            // If we found an intersection and this is a shadow ray,
-            // we can exit out immediately.
-            if (hit && !tHit) return true;
-        }
-        return hit;
-    } else {
-        // Intersect ray with curve segment
-
-        // Test ray against segment endpoint boundaries
-
-        // Test sample point against tangent perpendicular at curve start
-        Float edge =
-            (cp[1].y - cp[0].y) * -cp[0].y + cp[0].x * (cp[0].x - cp[1].x);
-        if (edge < 0) return false;
-
-        // Test sample point against tangent perpendicular at curve end
-        edge = (cp[2].y - cp[3].y) * -cp[3].y + cp[3].x * (cp[3].x - cp[2].x);
-        if (edge < 0) return false;
-
-        // Compute line $w$ that gives minimum distance to sample point
-        Vector2f segmentDirection = Point2f(cp[3]) - Point2f(cp[0]);
-        Float denom = segmentDirection.LengthSquared();
-        if (denom == 0) return false;
-        Float w = Dot(-Vector2f(cp[0]), segmentDirection) / denom;
-
-        // Compute $u$ coordinate of curve intersection point and _hitWidth_
-        Float u = Clamp(Lerp(w, u0, u1), u0, u1);
-        Float hitWidth = Lerp(u, common->width[0], common->width[1]);
-        Normal3f nHit;
-        if (common->type == CurveType::Ribbon) {
-            // Scale _hitWidth_ based on ribbon orientation
-            Float sin0 = std::sin((1 - u) * common->normalAngle) *
-                         common->invSinNormalAngle;
-            Float sin1 =
-                std::sin(u * common->normalAngle) * common->invSinNormalAngle;
-            nHit = sin0 * common->n[0] + sin1 * common->n[1];
-            hitWidth *= AbsDot(nHit, ray.d) / rayLength;
+    // Split curve segment into sub-segments and find those whose bounds
+    // overlap the ray. When at least two more levels of refinement remain,
+    // the halves are split again and the bounds of all six sub-segments
+    // are tested together; a quarter is only visited if its half also
+    // overlaps the ray, as when refining one level at a time.
+    Point3f cpSplit[7], cpQuarter[14];
+    SubdivideBezier(cp, cpSplit);
+    const Point3f *cps[6] = {cpSplit,       cpSplit + 3,    cpQuarter,
+                             cpQuarter + 3, cpQuarter + 7, cpQuarter + 10};
+    Float u[3] = {u0, (u0 + u1) / 2.f, u1};
+    Float uQuarter[2][3];
+    Float maxWidth[6];
+    for (int half = 0; half < 2; ++half)
+        maxWidth[half] =
+            std::max(Lerp(u[half], common->width[0], common->width[1]),
+                     Lerp(u[half + 1], common->width[0], common->width[1]));
+    uint32_t overlap;
+    if (depth == 1)
+        overlap = OverlappingSegments<2>(cps, maxWidth, zMax);
+    else {
+        SubdivideBezier(cpSplit, cpQuarter);
+        SubdivideBezier(cpSplit + 3, cpQuarter + 7);
+        for (int half = 0; half < 2; ++half) {
+            Float *uq = uQuarter[half];
+            uq[0] = u[half];
+            uq[1] = (u[half] + u[half + 1]) / 2.f;
+            uq[2] = u[half + 1];
+            for (int q = 0; q < 2; ++q)
+                maxWidth[2 + 2 * half + q] =
+                    std::max(Lerp(uq[q], common->width[0], common->width[1]),
+                             Lerp(uq[q + 1], common->width[0],
+                                  common->width[1]));
         }
+        overlap = OverlappingSegments<6>(cps, maxWidth, zMax);
+    }
+
+    // Recursively intersect the overlapping sub-segments in order
+    bool hit = false;
+    for (int half = 0; half < 2; ++half) {
+        if (!(overlap & (1 << half))) continue;
+        if (depth == 1)
+            hit |= intersectSegment(ray, tHit, isect, cps[half], rayToObject,
+                                    u[half], u[half + 1]);
+        else
+            for (int q = 0; q < 2; ++q) {
+                int seg = 2 + 2 * half + q;
+                if (!(overlap & (1 << seg))) continue;
+                hit |= recursiveIntersect(ray, tHit, isect, cps[seg],
+                                          rayToObject, uQuarter[half][q],
+                                          uQuarter[half][q + 1], depth - 2);
+                if (hit && !tHit) return true;
+            }
+        // If we found an intersection and this is a shadow ray,
+        // we can exit out immediately.
+        if (hit && !tHit) return true;
+    }
+    return hit;
+}
+
+bool Curve::intersectSegment(const Ray &ray, Float *tHit,
+                             SurfaceInteraction *isect, const Point3f cp[4],
+                             const Transform &rayToObject, Float u0,
+                             Float u1) const {
+    Float rayLength = ray.d.Length();
+
+    // Test ray against segment endpoint boundaries
+
+    // Test sample point against tangent perpendicular at curve start
+    Float edge =
+        (cp[1].y - cp[0].y) * -cp[0].y + cp[0].x * (cp[0].x - cp[1].x);
+    if (edge < 0) return false;
+
+    // Test sample point against tangent perpendicular at curve end
+    edge = (cp[2].y - cp[3].y) * -cp[3].y + cp[3].x * (cp[3].x - cp[2].x);
+    if (edge < 0) return false;
+
+    // Compute line $w$ that gives minimum distance to sample point
+    Vector2f segmentDirection = Point2f(cp[3]) - Point2f(cp[0]);
+    Float denom = segmentDirection.LengthSquared();
+    if (denom == 0) return false;
+    Float w = Dot(-Vector2f(cp[0]), segmentDirection) / denom;
+
+    // Compute $u$ coordinate of curve intersection point and _hitWidth_
+    Float u = Clamp(Lerp(w, u0, u1), u0, u1);
+    Float hitWidth = Lerp(u, common->width[0], common->width[1]);
+    Normal3f nHit;
+    if (common->type == CurveType::Ribbon) {
+        // Scale _hitWidth_ based on ribbon orientation
+        Float sin0 = std::sin((1 - u) * common->normalAngle) *
+                     common->invSinNormalAngle;
+        Float sin1 =
+            std::sin(u * common->normalAngle) * common->invSinNormalAngle;
+        nHit = sin0 * common->n[0] + sin1 * common->n[1];
+        hitWidth *= AbsDot(nHit, ray.d) / rayLength;
+    }
 
-        // Test intersection point against curve width
-        Vector3f dpcdw;
-        Point3f pc = EvalBezier(cp, Clamp(w, 0, 1), &dpcdw);
-        Float ptCurveDist2 = pc.x * pc.x + pc.y * pc.y;
-        if (ptCurveDist2 > hitWidth * hitWidth * .25) return false;
-        Float zMax = rayLength * ray.tMax;
-        if (pc.z < 0 || pc.z > zMax) return false;
-
-        // Compute $v$ coordinate of curve intersection point
-        Float ptCurveDist = std::sqrt(ptCurveDist2);
-        Float edgeFunc = dpcdw.x * -pc.y + pc.x * dpcdw.y;
-        Float v = (edgeFunc > 0) ? 0.5f + ptCurveDist / hitWidth
-                                 : 0.5f - ptCurveDist / hitWidth;
-
-        // Compute hit _t_ and partial derivatives for curve intersection
-        if (tHit != nullptr) {
-            // FIXME: this tHit isn't quite right for ribbons...
-            *tHit = pc.z / rayLength;
-            // Compute error bounds for curve intersection
-            Vector3f pError(2 * hitWidth, 2 * hitWidth, 2 * hitWidth);
-
-            // Compute $\dpdu$ and $\dpdv$ for curve intersection
-            Vector3f dpdu, dpdv;
-            EvalBezier(common->cpObj, u, &dpdu);
-            if (common->type == CurveType::Ribbon)
-                dpdv = Normalize(Cross(nHit, dpdu)) * hitWidth;
-            else {
-                // Compute curve $\dpdv$ for flat and cylinder curves
-                Vector3f dpduPlane = (Inverse(rayToObject))(dpdu);
-                Vector3f dpdvPlane =
-                    Normalize(Vector3f(-dpduPlane.y, dpduPlane.x, 0)) *
-                    hitWidth;
-                if (common->type == CurveType::Cylinder) {
-                    // Rotate _dpdvPlane_ to give cylindrical appearance
-                    Float theta = Lerp(v, -90., 90.);
-                    Transform rot = Rotate(-theta, dpduPlane);
-                    dpdvPlane = rot(dpdvPlane);
-                }
-                dpdv = rayToObject(dpdvPlane);
+    // Test intersection point against curve width
+    Vector3f dpcdw;
+    Point3f pc = EvalBezier(cp, Clamp(w, 0, 1), &dpcdw);
+    Float ptCurveDist2 = pc.x * pc.x + pc.y * pc.y;
+    if (ptCurveDist2 > hitWidth * hitWidth * .25) return false;
+    Float zMax = rayLength * ray.tMax;
+    if (pc.z < 0 || pc.z > zMax) return false;
+
+    // Compute $v$ coordinate of curve intersection point
+    Float ptCurveDist = std::sqrt(ptCurveDist2);
+    Float edgeFunc = dpcdw.x * -pc.y + pc.x * dpcdw.y;
+    Float v = (edgeFunc > 0) ? 0.5f + ptCurveDist / hitWidth
+                             : 0.5f - ptCurveDist / hitWidth;
+
+    // Compute hit _t_ and partial derivatives for curve intersection
+    if (tHit != nullptr) {
+        // FIXME: this tHit isn't quite right for ribbons...
+        *tHit = pc.z / rayLength;
+        // Compute error bounds for curve intersection
+        Vector3f pError(2 * hitWidth, 2 * hitWidth, 2 * hitWidth);
+
+        // Compute $\dpdu$ and $\dpdv$ for curve intersection
+        Vector3f dpdu, dpdv;
+        EvalBezier(common->cpObj, u, &dpdu);
+        if (common->type == CurveType::Ribbon)
+            dpdv = Normalize(Cross(nHit, dpdu)) * hitWidth;
+        else {
+            // Compute curve $\dpdv$ for flat and cylinder curves
+            Vector3f dpduPlane = (Inverse(rayToObject))(dpdu);
+            Vector3f dpdvPlane =
+                Normalize(Vector3f(-dpduPlane.y, dpduPlane.x, 0)) * hitWidth;
+            if (common->type == CurveType::Cylinder) {
+                // Rotate _dpdvPlane_ to give cylindrical appearance
+                Float theta = Lerp(v, -90., 90.);
+                Transform rot = Rotate(-theta, dpduPlane);
+                dpdvPlane = rot(dpdvPlane);
             }
-            *isect = (*ObjectToWorld)(SurfaceInteraction(
-                ray(pc.z), pError, Point2f(u, v), -ray.d, dpdu, dpdv,
-                Normal3f(0, 0, 0), Normal3f(0, 0, 0), ray.time, this));
+            dpdv = rayToObject(dpdvPlane);
         }
-        ++nHits;
-        return true;
+        *isect = (*ObjectToWorld)(SurfaceInteraction(
+            ray(pc.z), pError, Point2f(u, v), -ray.d, dpdu, dpdv,
+            Normal3f(0, 0, 0), Normal3f(0, 0, 0), ray.time, this));
     }
+    ++nHits;
+    return true;
 }
 
 Float Curve::Area() const {
-    // Compute object-space control points for curve segment, _cpObj_
     Point3f cpObj[4];
-    cpObj[0] = BlossomBezier(common->cpObj, uMin, uMin, uMin);
-    cpObj[1] = BlossomBezier(common->cpObj, uMin, uMin, uMax);
-    cpObj[2] = BlossomBezier(common->cpObj, uMin, uMax, uMax);
-    cpObj[3] = BlossomBezier(common->cpObj, uMax, uMax, uMax);
+    segmentControlPoints(cpObj);
     Float width0 = Lerp(uMin, common->width[0], common->width[1]);
     Float width1 = Lerp(uMax, common->width[0], common->width[1]);
     Float avgWidth = (width0 + width1) * 0.5f;
@@ -64,12 +64,9 @@ class Curve : public Shape {
     // Curve Public Methods
     Curve(const Transform *ObjectToWorld, const Transform *WorldToObject,
           bool reverseOrientation, const std::shared_ptr<CurveCommon> &common,
-          Float uMin, Float uMax)
-        : Shape(ObjectToWorld, WorldToObject, reverseOrientation),
-          common(common),
-          uMin(uMin),
-          uMax(uMax) {}
+          Float uMin, Float uMax);
     Bounds3f ObjectBound() const;
+    Bounds3f WorldBound() const;
     bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
                    bool testAlphaTexture) const;
     Float Area() const;
@@ -81,10 +78,20 @@ class Curve : public Shape {
                             SurfaceInteraction *isect, const Point3f cp[4],
                             const Transform &rayToObject, Float u0, Float u1,
                             int depth) const;
+    bool intersectSegment(const Ray &r, Float *tHit,
+                          SurfaceInteraction *isect, const Point3f cp[4],
+                          const Transform &rayToObject, Float u0,
+                          Float u1) const;
+    void segmentControlPoints(Point3f cpObj[4]) const;
+    Float objectCapsuleRadius(const Point3f cpObj[4]) const;
 
     // Curve Private Data
     const std::shared_ptr<CurveCommon> common;
     const Float uMin, uMax;
+    // World-space capsule around the segment's chord that bounds it,
+    // including its width
+    Point3f capsuleAxis[2];
+    Float capsuleRadius;
 };
 
 std::vector<std::shared_ptr<Shape>> CreateCurveShape(const Transform *o2w,
@@ -0,0 +1,371 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// shapes/displacement.cpp*
+#include "shapes/displacement.h"
+#include "shapes/triangle.h"
+#include "interaction.h"
+#include "parallel.h"
+#include "paramset.h"
+#include "texture.h"
+#include "stats.h"
+
+namespace pbrt {
+
+STAT_COUNTER("Scene/Displaced triangles", nDisplacedTriangles);
+STAT_COUNTER("Geometry/Displaced triangles tessellated", nTessellated);
+STAT_INT_DISTRIBUTION("Geometry/Displaced triangle level", triangleLevel);
+
+// Displacement Macros
+#define NEXT(i) (((i) + 1) % 3)
+
+// Displacement Local Structures
+struct DisplacementMesh {
+    // DisplacementMesh Methods
+    Point2f UV(int face, int k) const {
+        if (base->uv) return base->uv[base->vertexIndices[3 * face + k]];
+        const Point2f defaultUV[3] = {Point2f(0, 0), Point2f(1, 0),
+                                      Point2f(1, 1)};
+        return defaultUV[k];
+    }
+    Float Displacement(const Point3f &p, const Normal3f &n,
+                       const Point2f &uv) const {
+        SurfaceInteraction si;
+        si.p = p;
+        si.n = si.shading.n = n;
+        si.uv = uv;
+        return displacement->Evaluate(si);
+    }
+    Point3f Displace(const Point3f &p, const Normal3f &n,
+                     const Point2f &uv) const {
+        return p + Displacement(p, n, uv) * Vector3f(n);
+    }
+    Point3f EdgeVertex(int face, int e, int level, int k, Point2f *uv,
+                       Normal3f *n) const;
+    Float SampledDisplacement(int face, int res) const;
+
+    // DisplacementMesh Data
+    std::shared_ptr<TriangleMesh> base;
+    std::shared_ptr<Texture<Float>> displacement;
+    // Unit-length normals that the vertices are displaced along
+    std::vector<Normal3f> n;
+    // Tessellation level of each face's edges; shared edges have the same
+    // level in both faces so that their triangles meet without cracks
+    std::vector<uint8_t> edgeLevel;
+    // Bound on the magnitude of the displacement, or -1 if each triangle's
+    // displaced vertices are bounded instead
+    Float displacementBound;
+};
+
+// DisplacementMesh Method Definitions
+// Returns the displaced vertex _k_ of the _2^level_ segments of edge _e_ of
+// _face_. It's computed from the edge's vertices in the order of their
+// indices, so that both faces that share the edge get exactly the same
+// result.
+Point3f DisplacementMesh::EdgeVertex(int face, int e, int level, int k,
+                                     Point2f *uv, Normal3f *n) const {
+    const int *v = &base->vertexIndices[3 * face];
+    int a = e, b = NEXT(e), res = 1 << level;
+    if (v[a] > v[b]) {
+        std::swap(a, b);
+        k = res - k;
+    }
+    Float t = Float(k) / res;
+    *uv = Lerp(t, UV(face, a), UV(face, b));
+    *n = Normalize((1 - t) * this->n[v[a]] + t * this->n[v[b]]);
+    return Displace(Lerp(t, base->p[v[a]], base->p[v[b]]), *n, *uv);
+}
+
+// Returns the largest magnitude of the displacement at the vertices of a
+// grid that splits each edge of _face_ into _res_ segments.
+Float DisplacementMesh::SampledDisplacement(int face, int res) const {
+    const int *v = &base->vertexIndices[3 * face];
+    Float maxDisp = 0;
+    for (int j = 0; j <= res; ++j)
+        for (int i = 0; i + j <= res; ++i) {
+            Float b1 = Float(i) / res, b2 = Float(j) / res;
+            Float b0 = 1 - b1 - b2;
+            Point3f p = b0 * base->p[v[0]] + b1 * base->p[v[1]] +
+                        b2 * base->p[v[2]];
+            Normal3f nv = Normalize(b0 * n[v[0]] + b1 * n[v[1]] +
+                                    b2 * n[v[2]]);
+            Point2f uv = b0 * UV(face, 0) + b1 * UV(face, 1) +
+                         b2 * UV(face, 2);
+            maxDisp = std::max(maxDisp, std::abs(Displacement(p, nv, uv)));
+        }
+    return maxDisp;
+}
+
+// DisplacedTriangle Method Definitions
+DisplacedTriangle::DisplacedTriangle(
+    const Transform *ObjectToWorld, const Transform *WorldToObject,
+    bool reverseOrientation,
+    const std::shared_ptr<const DisplacementMesh> &mesh, int face)
+    : TessellatedPatch(ObjectToWorld, WorldToObject, reverseOrientation),
+      mesh(mesh),
+      face(face) {
+    ++nDisplacedTriangles;
+    const int *v = &mesh->base->vertexIndices[3 * face];
+    if (mesh->displacementBound >= 0) {
+        // Expand the triangle's bounds by the largest displacement
+        for (int k = 0; k < 3; ++k)
+            bounds = Union(bounds, mesh->base->p[v[k]]);
+        bounds = Expand(bounds, mesh->displacementBound);
+    } else {
+        // Bound the displaced vertices; they're recomputed with the same
+        // results when the triangle is tessellated
+        std::vector<Point3f> P;
+        std::vector<Point2f> uv;
+        std::vector<Normal3f> n;
+        DisplaceVertices(Level(), &P, &uv, &n);
+        for (const Point3f &p : P) bounds = Union(bounds, p);
+    }
+}
+
+int DisplacedTriangle::Level() const {
+    const uint8_t *edgeLevel = &mesh->edgeLevel[3 * face];
+    return std::max({edgeLevel[0], edgeLevel[1], edgeLevel[2]});
+}
+
+// Computes the displaced vertices of the triangle's grid at _level_, which
+// splits each edge into _2^level_ segments. Grid vertex $(i, j)$ has
+// barycentric coordinates $(i, j) / 2^\roman{level}$ with respect to the
+// triangle's second and third vertices; vertices are stored row by row of
+// increasing $j$. _N_ is set to the normals they're displaced along.
+void DisplacedTriangle::DisplaceVertices(int level, std::vector<Point3f> *P,
+                                         std::vector<Point2f> *uv,
+                                         std::vector<Normal3f> *N) const {
+    const DisplacementMesh &m = *mesh;
+    const int *v = &m.base->vertexIndices[3 * face];
+    const uint8_t *edgeLevel = &m.edgeLevel[3 * face];
+    int res = 1 << level;
+    Point3f p[3];
+    Normal3f n[3];
+    Point2f st[3];
+    for (int k = 0; k < 3; ++k) {
+        p[k] = m.base->p[v[k]];
+        n[k] = m.n[v[k]];
+        st[k] = m.UV(face, k);
+    }
+    P->reserve((res + 1) * (res + 2) / 2);
+    uv->reserve((res + 1) * (res + 2) / 2);
+    N->reserve((res + 1) * (res + 2) / 2);
+    for (int j = 0; j <= res; ++j)
+        for (int i = 0; i + j <= res; ++i) {
+            // Find the edge that the vertex is on and its position along it
+            int e = -1, k = 0;
+            if (j == 0) {
+                e = 0;
+                k = i;
+            } else if (i + j == res) {
+                e = 1;
+                k = j;
+            } else if (i == 0) {
+                e = 2;
+                k = res - j;
+            }
+
+            Point2f vuv;
+            Normal3f vn;
+            if (e != -1) {
+                // Snap the vertex to the closest one at its edge's level,
+                // which leaves degenerate triangles along the edge
+                int shift = level - edgeLevel[e];
+                int ke = (k + ((1 << shift) >> 1)) >> shift;
+                P->push_back(
+                    m.EdgeVertex(face, e, edgeLevel[e], ke, &vuv, &vn));
+            } else {
+                Float b1 = Float(i) / res, b2 = Float(j) / res;
+                Float b0 = 1 - b1 - b2;
+                vuv = b0 * st[0] + b1 * st[1] + b2 * st[2];
+                vn = Normalize(b0 * n[0] + b1 * n[1] + b2 * n[2]);
+                P->push_back(
+                    m.Displace(b0 * p[0] + b1 * p[1] + b2 * p[2], vn, vuv));
+            }
+            uv->push_back(vuv);
+            N->push_back(vn);
+        }
+}
+
+PatchTessellation *DisplacedTriangle::Tessellate() const {
+    ++nTessellated;
+    int level = Level();
+    ReportValue(triangleLevel, level);
+    std::vector<Point3f> P;
+    std::vector<Point2f> uv;
+    std::vector<Normal3f> N;
+    DisplaceVertices(level, &P, &uv, &N);
+
+    // Split the triangle into four _level_ times, keeping the children of
+    // each face contiguous; corners are grid coordinates
+    int res = 1 << level;
+    std::vector<Point2i> corners = {Point2i(0, 0), Point2i(res, 0),
+                                    Point2i(0, res)};
+    for (int l = 0; l < level; ++l) {
+        std::vector<Point2i> refined(4 * corners.size());
+        for (size_t f = 0; f < corners.size() / 3; ++f) {
+            const Point2i *c = &corners[3 * f];
+            Point2i mid[3];
+            for (int k = 0; k < 3; ++k)
+                mid[k] = Point2i((c[k].x + c[NEXT(k)].x) / 2,
+                                 (c[k].y + c[NEXT(k)].y) / 2);
+            const Point2i children[12] = {c[0],   mid[0], mid[2], mid[0],
+                                          c[1],   mid[1], mid[2], mid[1],
+                                          c[2],   mid[0], mid[1], mid[2]};
+            std::copy(children, children + 12, &refined[12 * f]);
+        }
+        std::swap(corners, refined);
+    }
+    std::vector<int> indices(corners.size());
+    for (size_t i = 0; i < corners.size(); ++i) {
+        int x = corners[i].x, y = corners[i].y;
+        indices[i] = y * (res + 1) - y * (y - 1) / 2 + x;
+    }
+
+    // Shade with the area-weighted average of the normals of the
+    // micro-triangles around each vertex, oriented like the normals the
+    // vertices were displaced along
+    std::vector<Normal3f> ns(P.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const int *v = &indices[i];
+        Normal3f nf(Cross(P[v[1]] - P[v[0]], P[v[2]] - P[v[0]]));
+        for (int k = 0; k < 3; ++k) ns[v[k]] += nf;
+    }
+    for (size_t i = 0; i < P.size(); ++i) {
+        if (ns[i].LengthSquared() == 0)
+            ns[i] = N[i];
+        else
+            ns[i] = Faceforward(Normalize(ns[i]), N[i]);
+    }
+    const TriangleMesh &base = *mesh->base;
+    return MakeTessellation(
+        level, std::make_shared<TriangleMesh>(
+                   Transform(), corners.size() / 3, indices.data(), P.size(),
+                   P.data(), nullptr, ns.data(), uv.data(), base.alphaMask,
+                   base.shadowAlphaMask));
+}
+
+std::vector<std::shared_ptr<Shape>> CreateDisplacedMesh(
+    const std::vector<std::shared_ptr<Shape>> &triangles,
+    const ParamSet &params,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    const SubdivisionView *view) {
+    std::string texName = params.FindTexture("displacement");
+    if (floatTextures->find(texName) == floatTextures->end()) {
+        Error("Couldn't find float texture \"%s\" for \"displacement\" "
+              "parameter", texName.c_str());
+        return triangles;
+    }
+    const Triangle *first = dynamic_cast<const Triangle *>(triangles[0].get());
+    if (!first) {
+        Error("\"displacement\" is only supported for triangle meshes.");
+        return triangles;
+    }
+    const std::shared_ptr<TriangleMesh> &base = first->GetMesh();
+    if (base->nTimeSamples > 1) {
+        Warning("Ignoring \"displacement\" for deforming triangle mesh.");
+        return triangles;
+    }
+    int nLevels = Clamp(params.FindOneInt("levels", 6), 0, 10);
+    Float edgeLength = params.FindOneFloat("edgelength", 1.f);
+
+    // Image textures must be complete before displacements are evaluated
+    WaitForAsyncTasks();
+
+    auto mesh = std::make_shared<DisplacementMesh>();
+    mesh->base = base;
+    mesh->displacement = (*floatTextures)[texName];
+
+    // Displace along the mesh's normals or, if it doesn't have any, along
+    // the area-weighted average of the normals of the faces around each
+    // vertex, oriented like the triangles' geometric normals
+    int nVertices = base->nVertices, nFaces = base->nTriangles;
+    const int *vi = base->vertexIndices.data();
+    mesh->n.resize(nVertices);
+    if (base->n)
+        for (int i = 0; i < nVertices; ++i)
+            mesh->n[i] = Normalize(base->n[i]);
+    else {
+        for (int f = 0; f < nFaces; ++f) {
+            const Point3f *p = base->p.get();
+            Normal3f nf(Cross(p[vi[3 * f + 1]] - p[vi[3 * f]],
+                              p[vi[3 * f + 2]] - p[vi[3 * f]]));
+            for (int k = 0; k < 3; ++k) mesh->n[vi[3 * f + k]] += nf;
+        }
+        bool flip = first->reverseOrientation ^ first->transformSwapsHandedness;
+        for (Normal3f &n : mesh->n)
+            if (n.LengthSquared() > 0) n = flip ? -Normalize(n) : Normalize(n);
+    }
+
+    // Choose edge tessellation levels so that micro-triangle edges span
+    // about _edgeLength_ pixels, up to _nLevels_
+    mesh->edgeLevel.resize(3 * nFaces);
+    for (int i = 0; i < 3 * nFaces; ++i) {
+        int v0 = vi[i], v1 = vi[3 * (i / 3) + NEXT(i % 3)];
+        mesh->edgeLevel[i] =
+            EdgeLevel(view, edgeLength, nLevels, base->p[std::min(v0, v1)],
+                      base->p[std::max(v0, v1)]);
+    }
+
+    // Find the bound on the displacement that the triangles' bounds are
+    // expanded by; without one, each triangle bounds its displaced vertices
+    Float value;
+    mesh->displacementBound = params.FindOneFloat("displacementbound", -1);
+    if (mesh->displacementBound < 0 && mesh->displacement->IsConstant(&value))
+        mesh->displacementBound = std::abs(value);
+    else if (mesh->displacementBound < 0 &&
+             params.FindOneBool("estimatebounds", false)) {
+        // Estimate a bound from the displacement at a few points of each
+        // triangle, so that the texture isn't evaluated at every vertex of
+        // the tessellations at load time. This isn't conservative: detail
+        // between the points may extend past it and be missed.
+        std::vector<Float> faceDisp(nFaces);
+        ParallelFor([&](int64_t f) {
+            faceDisp[f] = mesh->SampledDisplacement(f, 4);
+        }, nFaces, 256);
+        mesh->displacementBound =
+            2 * *std::max_element(faceDisp.begin(), faceDisp.end());
+    }
+
+    // Create the triangles in parallel; without a bound on the
+    // displacement, each one computes its displaced vertices to bound them
+    std::vector<std::shared_ptr<Shape>> shapes(nFaces);
+    ParallelFor([&](int64_t f) {
+        shapes[f] = std::make_shared<DisplacedTriangle>(
+            first->ObjectToWorld, first->WorldToObject,
+            first->reverseOrientation, mesh, f);
+    }, nFaces, 256);
+    return shapes;
+}
+
+}  // namespace pbrt
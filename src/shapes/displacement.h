@@ -0,0 +1,83 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_SHAPES_DISPLACEMENT_H
+#define PBRT_SHAPES_DISPLACEMENT_H
+
+// shapes/displacement.h*
+#include "shapes/tessellation.h"
+#include <map>
+
+namespace pbrt {
+
+struct DisplacementMesh;
+
+// DisplacedTriangle Declarations
+// A triangle of a mesh whose surface is displaced along the vertex normals
+// by a float texture. The triangle is split into a grid of micro-triangles
+// the first time a ray reaches its bounds, and the grid's vertices are
+// displaced.
+class DisplacedTriangle : public TessellatedPatch {
+  public:
+    // DisplacedTriangle Public Methods
+    DisplacedTriangle(const Transform *ObjectToWorld,
+                      const Transform *WorldToObject, bool reverseOrientation,
+                      const std::shared_ptr<const DisplacementMesh> &mesh,
+                      int face);
+
+  private:
+    // DisplacedTriangle Private Methods
+    PatchTessellation *Tessellate() const;
+    int Level() const;
+    void DisplaceVertices(int level, std::vector<Point3f> *P,
+                          std::vector<Point2f> *uv,
+                          std::vector<Normal3f> *N) const;
+
+    // DisplacedTriangle Private Data
+    const std::shared_ptr<const DisplacementMesh> mesh;
+    const int face;
+};
+
+std::vector<std::shared_ptr<Shape>> CreateDisplacedMesh(
+    const std::vector<std::shared_ptr<Shape>> &triangles,
+    const ParamSet &params,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    const SubdivisionView *view = nullptr);
+
+}  // namespace pbrt
+
+#endif  // PBRT_SHAPES_DISPLACEMENT_H
@@ -35,10 +35,309 @@
 #include "shapes/heightfield.h"
 #include "shapes/triangle.h"
 #include "paramset.h"
+#include "sampling.h"
+#include "stats.h"
 
 namespace pbrt {
 
-// Heightfield Definitions
+STAT_MEMORY_COUNTER("Memory/Heightfields", heightfieldBytes);
+STAT_PERCENT("Intersections/Ray-heightfield intersection tests", nHits,
+             nTests);
+
+// Heightfield Method Definitions
+Heightfield::Heightfield(const Transform *ObjectToWorld,
+                         const Transform *WorldToObject,
+                         bool reverseOrientation, int nx, int ny,
+                         const Float *zs)
+    : Shape(ObjectToWorld, WorldToObject, reverseOrientation),
+      nx(nx),
+      ny(ny),
+      z(zs, zs + nx * ny) {
+    zMin = *std::min_element(z.begin(), z.end());
+    zMax = *std::max_element(z.begin(), z.end());
+    heightfieldBytes += sizeof(*this) + z.size() * sizeof(Float);
+
+    // Compute the height ranges of 2x2 blocks of cells from the heights
+    Point2i cells(nx - 1, ny - 1);
+    Point2i res((cells.x + 1) / 2, (cells.y + 1) / 2);
+    if (cells.x > 1 || cells.y > 1) {
+        std::vector<HeightRange> ranges(res.x * res.y);
+        for (int y = 0; y < res.y; ++y)
+            for (int x = 0; x < res.x; ++x) {
+                HeightRange &range = ranges[y * res.x + x];
+                range.min = Infinity;
+                range.max = -Infinity;
+                for (int j = 2 * y; j <= std::min(2 * y + 2, ny - 1); ++j)
+                    for (int i = 2 * x; i <= std::min(2 * x + 2, nx - 1);
+                         ++i) {
+                        range.min = std::min(range.min, z[j * nx + i]);
+                        range.max = std::max(range.max, z[j * nx + i]);
+                    }
+            }
+        levels.push_back(std::move(ranges));
+        levelRes.push_back(res);
+    }
+
+    // Compute the height ranges of larger blocks until one covers the grid
+    while (res.x > 1 || res.y > 1) {
+        Point2i prevRes = res;
+        res = Point2i((res.x + 1) / 2, (res.y + 1) / 2);
+        const std::vector<HeightRange> &prev = levels.back();
+        std::vector<HeightRange> ranges(res.x * res.y);
+        for (int y = 0; y < res.y; ++y)
+            for (int x = 0; x < res.x; ++x) {
+                HeightRange &range = ranges[y * res.x + x];
+                range = prev[2 * y * prevRes.x + 2 * x];
+                for (int j = 2 * y; j < std::min(2 * y + 2, prevRes.y); ++j)
+                    for (int i = 2 * x; i < std::min(2 * x + 2, prevRes.x);
+                         ++i) {
+                        const HeightRange &child = prev[j * prevRes.x + i];
+                        range.min = std::min(range.min, child.min);
+                        range.max = std::max(range.max, child.max);
+                    }
+            }
+        levels.push_back(std::move(ranges));
+        levelRes.push_back(res);
+    }
+    for (const std::vector<HeightRange> &ranges : levels)
+        heightfieldBytes += ranges.size() * sizeof(HeightRange);
+}
+
+// Defined here, where _Distribution1D_ is complete, so that users of
+// heightfield.h need not include sampling.h.
+Heightfield::~Heightfield() {}
+
+Bounds3f Heightfield::ObjectBound() const {
+    return Bounds3f(Point3f(0, 0, zMin), Point3f(1, 1, zMax));
+}
+
+void Heightfield::GetCellPositions(int x, int y, Point3f p[4]) const {
+    // Compute the positions of the cell's corners the same way as a
+    // _TriangleMesh_ of the heightfield would
+    auto position = [&](int i, int j) {
+        return (*ObjectToWorld)(Point3f((float)i / (float)(nx - 1),
+                                        (float)j / (float)(ny - 1),
+                                        z[j * nx + i]));
+    };
+    p[0] = position(x, y);
+    p[1] = position(x + 1, y);
+    p[2] = position(x + 1, y + 1);
+    p[3] = position(x, y + 1);
+}
+
+template <typename Func>
+void Heightfield::Traverse(const Ray &ray, Func func) const {
+    // Transform the ray to grid space, where cells are unit squares
+    Point3f o = (*WorldToObject)(ray.o);
+    Vector3f d = (*WorldToObject)(ray.d);
+    Ray gridRay(Point3f(o.x * (nx - 1), o.y * (ny - 1), o.z),
+                Vector3f(d.x * (nx - 1), d.y * (ny - 1), d.z));
+    // Pad block bounds to account for round-off error in the transformation
+    Float pad = gamma(32) *
+                std::max({std::abs(gridRay.o.x), std::abs(gridRay.o.y),
+                          std::abs(gridRay.o.z), Float(nx), Float(ny),
+                          std::abs(zMin), std::abs(zMax)});
+    int nearX = gridRay.d.x < 0, nearY = gridRay.d.y < 0;
+
+    // Descend the height range pyramid, visiting blocks nearest to the ray
+    // origin first. Level 0 holds the cells themselves.
+    struct Block {
+        int level, x, y;
+    };
+    Block todo[64];
+    int toVisitOffset = 0;
+    todo[toVisitOffset++] = Block{(int)levels.size(), 0, 0};
+    while (toVisitOffset > 0) {
+        Block block = todo[--toVisitOffset];
+        // Intersect the ray with the block's bounds
+        int x0 = block.x << block.level, y0 = block.y << block.level;
+        int x1 = std::min(x0 + (1 << block.level), nx - 1);
+        int y1 = std::min(y0 + (1 << block.level), ny - 1);
+        HeightRange range;
+        if (block.level == 0) {
+            range.min = std::min({z[y0 * nx + x0], z[y0 * nx + x1],
+                                  z[y1 * nx + x0], z[y1 * nx + x1]});
+            range.max = std::max({z[y0 * nx + x0], z[y0 * nx + x1],
+                                  z[y1 * nx + x0], z[y1 * nx + x1]});
+        } else
+            range = levels[block.level - 1]
+                          [block.y * levelRes[block.level - 1].x + block.x];
+        Bounds3f bounds(Point3f(x0 - pad, y0 - pad, range.min - pad),
+                        Point3f(x1 + pad, y1 + pad, range.max + pad));
+        gridRay.tMax = ray.tMax;
+        if (!bounds.IntersectP(gridRay)) continue;
+
+        if (block.level == 0) {
+            if (func(block.x, block.y)) return;
+            continue;
+        }
+        // Enqueue the block's children, farthest first
+        Point2i res = block.level == 1 ? Point2i(nx - 1, ny - 1)
+                                       : levelRes[block.level - 2];
+        const int order[4][2] = {{1 - nearX, 1 - nearY},
+                                 {nearX, 1 - nearY},
+                                 {1 - nearX, nearY},
+                                 {nearX, nearY}};
+        for (int i = 0; i < 4; ++i) {
+            int cx = 2 * block.x + order[i][0], cy = 2 * block.y + order[i][1];
+            if (cx < res.x && cy < res.y)
+                todo[toVisitOffset++] = Block{block.level - 1, cx, cy};
+        }
+    }
+}
+
+bool Heightfield::IntersectCell(const Ray &ray, int x, int y, Float *tHit,
+                                SurfaceInteraction *isect) const {
+    ++nTests;
+    Point3f pc[4];
+    GetCellPositions(x, y, pc);
+    const int tris[2][3] = {{0, 1, 2}, {0, 2, 3}};
+    const Point2i offsets[4] = {Point2i(0, 0), Point2i(1, 0), Point2i(1, 1),
+                                Point2i(0, 1)};
+
+    // Find the closer of the hits with the cell's two triangles
+    int hitTri = -1;
+    Float tMax = ray.tMax, b[3];
+    for (int i = 0; i < 2; ++i) {
+        Float t, b0, b1, b2;
+        Ray triRay = ray;
+        triRay.tMax = tMax;
+        if (IntersectTriangle(triRay, pc[tris[i][0]], pc[tris[i][1]],
+                              pc[tris[i][2]], &t, &b0, &b1, &b2)) {
+            hitTri = i;
+            tMax = t;
+            b[0] = b0;
+            b[1] = b1;
+            b[2] = b2;
+        }
+    }
+    if (hitTri == -1) return false;
+    ++nHits;
+    *tHit = tMax;
+    if (!isect) return true;
+
+    // Get the hit triangle's vertices and $(u,v)$ coordinates
+    Point3f p0 = pc[tris[hitTri][0]], p1 = pc[tris[hitTri][1]],
+            p2 = pc[tris[hitTri][2]];
+    Point2f uv[3];
+    for (int i = 0; i < 3; ++i) {
+        Point2i g = Point2i(x, y) + offsets[tris[hitTri][i]];
+        uv[i] = Point2f((float)g.x / (float)(nx - 1),
+                        (float)g.y / (float)(ny - 1));
+    }
+
+    // Compute deltas for triangle partial derivatives
+    Vector3f dpdu, dpdv;
+    Vector2f duv02 = uv[0] - uv[2], duv12 = uv[1] - uv[2];
+    Vector3f dp02 = p0 - p2, dp12 = p1 - p2;
+    Float determinant = duv02[0] * duv12[1] - duv02[1] * duv12[0];
+    bool degenerateUV = std::abs(determinant) < 1e-8;
+    if (!degenerateUV) {
+        Float invdet = 1 / determinant;
+        dpdu = (duv12[1] * dp02 - duv02[1] * dp12) * invdet;
+        dpdv = (-duv12[0] * dp02 + duv02[0] * dp12) * invdet;
+    }
+    if (degenerateUV || Cross(dpdu, dpdv).LengthSquared() == 0)
+        // Handle zero determinant for triangle partial derivative matrix
+        CoordinateSystem(Normalize(Cross(p2 - p0, p1 - p0)), &dpdu, &dpdv);
+
+    // Compute error bounds for triangle intersection
+    Float xAbsSum = (std::abs(b[0] * p0.x) + std::abs(b[1] * p1.x) +
+                     std::abs(b[2] * p2.x));
+    Float yAbsSum = (std::abs(b[0] * p0.y) + std::abs(b[1] * p1.y) +
+                     std::abs(b[2] * p2.y));
+    Float zAbsSum = (std::abs(b[0] * p0.z) + std::abs(b[1] * p1.z) +
+                     std::abs(b[2] * p2.z));
+    Vector3f pError = gamma(7) * Vector3f(xAbsSum, yAbsSum, zAbsSum);
+
+    // Interpolate $(u,v)$ parametric coordinates and hit point
+    Point3f pHit = b[0] * p0 + b[1] * p1 + b[2] * p2;
+    Point2f uvHit = b[0] * uv[0] + b[1] * uv[1] + b[2] * uv[2];
+
+    // Fill in _SurfaceInteraction_ from triangle hit
+    *isect = SurfaceInteraction(pHit, pError, uvHit, -ray.d, dpdu, dpdv,
+                                Normal3f(0, 0, 0), Normal3f(0, 0, 0), ray.time,
+                                this);
+    isect->n = isect->shading.n = Normal3f(Normalize(Cross(dp02, dp12)));
+    if (reverseOrientation ^ transformSwapsHandedness)
+        isect->n = isect->shading.n = -isect->n;
+    return true;
+}
+
+bool Heightfield::Intersect(const Ray &r, Float *tHit,
+                            SurfaceInteraction *isect,
+                            bool testAlphaTexture) const {
+    ProfilePhase p(Prof::ShapeIntersect);
+    Ray ray = r;
+    bool hit = false;
+    Traverse(ray, [&](int x, int y) {
+        Float t;
+        if (IntersectCell(ray, x, y, &t, isect)) {
+            ray.tMax = t;
+            hit = true;
+        }
+        return false;
+    });
+    if (hit) *tHit = ray.tMax;
+    return hit;
+}
+
+bool Heightfield::IntersectP(const Ray &ray, bool testAlphaTexture) const {
+    ProfilePhase p(Prof::ShapeIntersectP);
+    bool hit = false;
+    Traverse(ray, [&](int x, int y) {
+        Float t;
+        hit = IntersectCell(ray, x, y, &t, nullptr);
+        return hit;
+    });
+    return hit;
+}
+
+void Heightfield::InitSampling() const {
+    // Compute the areas of the heightfield's triangles
+    std::vector<Float> areas(2 * (nx - 1) * (ny - 1));
+    area = 0;
+    for (int y = 0; y < ny - 1; ++y)
+        for (int x = 0; x < nx - 1; ++x) {
+            Point3f p[4];
+            GetCellPositions(x, y, p);
+            Float *a = &areas[2 * (y * (nx - 1) + x)];
+            a[0] = 0.5 * Cross(p[1] - p[0], p[2] - p[0]).Length();
+            a[1] = 0.5 * Cross(p[2] - p[0], p[3] - p[0]).Length();
+            area += a[0] + a[1];
+        }
+    triangleDistrib.reset(new Distribution1D(areas.data(), areas.size()));
+}
+
+Float Heightfield::Area() const {
+    std::call_once(samplingInitialized, [&]() { InitSampling(); });
+    return area;
+}
+
+Interaction Heightfield::Sample(const Point2f &u, Float *pdf) const {
+    std::call_once(samplingInitialized, [&]() { InitSampling(); });
+    // Choose a triangle in proportion to its area
+    Float uRemapped;
+    int tri = triangleDistrib->SampleDiscrete(u[0], nullptr, &uRemapped);
+    Point3f pc[4];
+    GetCellPositions((tri / 2) % (nx - 1), (tri / 2) / (nx - 1), pc);
+    const Point3f &p0 = pc[0];
+    const Point3f &p1 = (tri & 1) ? pc[2] : pc[1];
+    const Point3f &p2 = (tri & 1) ? pc[3] : pc[2];
+
+    // Sample a point on the triangle
+    Point2f b = UniformSampleTriangle(Point2f(uRemapped, u[1]));
+    Interaction it;
+    it.p = b[0] * p0 + b[1] * p1 + (1 - b[0] - b[1]) * p2;
+    it.n = Normalize(Normal3f(Cross(p1 - p0, p2 - p0)));
+    if (reverseOrientation ^ transformSwapsHandedness) it.n *= -1;
+    Point3f pAbsSum =
+        Abs(b[0] * p0) + Abs(b[1] * p1) + Abs((1 - b[0] - b[1]) * p2);
+    it.pError = gamma(6) * Vector3f(pAbsSum.x, pAbsSum.y, pAbsSum.z);
+    *pdf = 1 / area;
+    return it;
+}
+
 std::vector<std::shared_ptr<Shape>> CreateHeightfield(
     const Transform *ObjectToWorld, const Transform *WorldToObject,
     bool reverseOrientation, const ParamSet &params) {
@@ -48,42 +347,12 @@ std::vector<std::shared_ptr<Shape>> CreateHeightfield(
     const Float *z = params.FindFloat("Pz", &nitems);
     CHECK_EQ(nitems, nx * ny);
     CHECK(nx != -1 && ny != -1 && z != nullptr);
-
-    int ntris = 2 * (nx - 1) * (ny - 1);
-    std::unique_ptr<int[]> indices(new int[3 * ntris]);
-    std::unique_ptr<Point3f[]> P(new Point3f[nx * ny]);
-    std::unique_ptr<Point2f[]> uvs(new Point2f[nx * ny]);
-    int nverts = nx * ny;
-    // Compute heightfield vertex positions
-    int pos = 0;
-    for (int y = 0; y < ny; ++y) {
-        for (int x = 0; x < nx; ++x) {
-            P[pos].x = uvs[pos].x = (float)x / (float)(nx - 1);
-            P[pos].y = uvs[pos].y = (float)y / (float)(ny - 1);
-            P[pos].z = z[pos];
-            ++pos;
-        }
-    }
-
-    // Fill in heightfield vertex offset array
-    int *vp = indices.get();
-    for (int y = 0; y < ny - 1; ++y) {
-        for (int x = 0; x < nx - 1; ++x) {
-#define VERT(x, y) ((x) + (y)*nx)
-            *vp++ = VERT(x, y);
-            *vp++ = VERT(x + 1, y);
-            *vp++ = VERT(x + 1, y + 1);
-
-            *vp++ = VERT(x, y);
-            *vp++ = VERT(x + 1, y + 1);
-            *vp++ = VERT(x, y + 1);
-        }
-#undef VERT
+    if (nx < 2 || ny < 2) {
+        Error("Heightfield needs at least 2x2 heights; got %dx%d.", nx, ny);
+        return std::vector<std::shared_ptr<Shape>>();
     }
-
-    return CreateTriangleMesh(ObjectToWorld, WorldToObject, reverseOrientation,
-                              ntris, indices.get(), nverts, P.get(), nullptr,
-                              nullptr, uvs.get(), nullptr, nullptr);
+    return {std::make_shared<Heightfield>(ObjectToWorld, WorldToObject,
+                                          reverseOrientation, nx, ny, z)};
 }
 
 }  // namespace pbrt
@@ -40,10 +40,58 @@
 
 // shapes/heightfield.h*
 #include "shape.h"
+#include <mutex>
 
 namespace pbrt {
 
+class Distribution1D;
+
 // Heightfield Declarations
+// A grid of _nx_ by _ny_ heights over [0,1]^2 in object space, made of two
+// triangles per grid cell. Rays are intersected by descending a pyramid of
+// the heights' minima and maxima over ever larger blocks of cells, so only
+// the height samples and the pyramid are stored.
+class Heightfield : public Shape {
+  public:
+    // Heightfield Public Methods
+    Heightfield(const Transform *ObjectToWorld, const Transform *WorldToObject,
+                bool reverseOrientation, int nx, int ny, const Float *z);
+    ~Heightfield();
+    Bounds3f ObjectBound() const;
+    bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
+                   bool testAlphaTexture) const;
+    bool IntersectP(const Ray &ray, bool testAlphaTexture) const;
+    Float Area() const;
+
+    using Shape::Sample;  // Bring in the other Sample() overload.
+    Interaction Sample(const Point2f &u, Float *pdf) const;
+
+  private:
+    // Heightfield Private Methods
+    template <typename Func>
+    void Traverse(const Ray &ray, Func func) const;
+    void GetCellPositions(int x, int y, Point3f p[4]) const;
+    bool IntersectCell(const Ray &ray, int x, int y, Float *tHit,
+                       SurfaceInteraction *isect) const;
+    void InitSampling() const;
+
+    // Heightfield Private Data
+    struct HeightRange {
+        Float min, max;
+    };
+    const int nx, ny;
+    std::vector<Float> z;
+    // _levels[k]_ holds the height ranges of blocks of _2^(k+1)_ by
+    // _2^(k+1)_ cells, which there are _levelRes[k]_ of
+    std::vector<std::vector<HeightRange>> levels;
+    std::vector<Point2i> levelRes;
+    Float zMin, zMax;
+    // Triangle areas, computed the first time the heightfield is sampled
+    mutable std::once_flag samplingInitialized;
+    mutable std::unique_ptr<Distribution1D> triangleDistrib;
+    mutable Float area;
+};
+
 std::vector<std::shared_ptr<Shape>> CreateHeightfield(const Transform *o2w,
                                                       const Transform *w2o,
                                                       bool ro,
@@ -35,105 +35,107 @@
 #include "shapes/loopsubdiv.h"
 #include "shapes/triangle.h"
 #include "paramset.h"
-#include <set>
-#include <map>
+#include "sampling.h"
+#include "stats.h"
+#include <algorithm>
 
 namespace pbrt {
 
-struct SDFace;
-struct SDVertex;
+STAT_COUNTER("Scene/Subdivision surface patches", nPatches);
+STAT_COUNTER("Geometry/Subdivision patches tessellated", nTessellated);
+STAT_INT_DISTRIBUTION("Geometry/Subdivision patch level", patchLevel);
 
 // LoopSubdiv Macros
 #define NEXT(i) (((i) + 1) % 3)
 #define PREV(i) (((i) + 2) % 3)
 
 // LoopSubdiv Local Structures
-struct SDVertex {
-    // SDVertex Constructor
-    SDVertex(const Point3f &p = Point3f(0, 0, 0)) : p(p) {}
-
-    // SDVertex Methods
-    int valence();
-    void oneRing(Point3f *p);
-    Point3f p;
-    SDFace *startFace = nullptr;
-    SDVertex *child = nullptr;
-    bool regular = false, boundary = false;
+struct LoopSubdivMesh {
+    // LoopSubdivMesh Data
+    // World-space control points and the faces' vertex indices
+    std::vector<Point3f> p;
+    std::vector<int> vertexIndices;
+    // Face across edge _k_ of face _f_, from its vertex _k_ to vertex
+    // _NEXT(k)_, is _neighbors[3 * f + k]_, or -1 for boundary edges
+    std::vector<int> neighbors;
+    // Faces incident to vertex _v_ are _vertexFaces_ entries
+    // [_vertexFaceOffset[v]_, _vertexFaceOffset[v + 1]_)
+    std::vector<int> vertexFaceOffset, vertexFaces;
+    // Subdivision level of each face's edges; shared edges have the same
+    // level in both faces so that their patches meet without cracks
+    std::vector<uint8_t> edgeLevel;
 };
 
-struct SDFace {
-    // SDFace Constructor
-    SDFace() {
-        for (int i = 0; i < 3; ++i) {
-            v[i] = nullptr;
-            f[i] = nullptr;
-        }
-        for (int i = 0; i < 4; ++i) children[i] = nullptr;
+// Flat half-edge mesh that a patch is refined in. Half-edge _3 * f + k_ runs
+// from face _f_'s vertex _v[3 * f + k]_ to _v[3 * f + NEXT(k)]_ and
+// _nbr[3 * f + k]_ is the face on its other side, or -1.
+struct SDMesh {
+    // SDMesh Methods
+    int nFaces() const { return (int)v.size() / 3; }
+    int nVertices() const { return (int)p.size(); }
+    int AddVertex(const Point3f &pv, uint64_t k, bool isBoundary,
+                  bool isCentral) {
+        p.push_back(pv);
+        key.push_back(k);
+        startFace.push_back(-1);
+        boundary.push_back(isBoundary);
+        central.push_back(isCentral);
+        corner.push_back(-1);
+        edge.push_back(-1);
+        edgeParam.push_back(0);
+        return nVertices() - 1;
     }
-
-    // SDFace Methods
-    int vnum(SDVertex *vert) const {
+    int vnum(int f, int vert) const {
         for (int i = 0; i < 3; ++i)
-            if (v[i] == vert) return i;
-        LOG(FATAL) << "Basic logic error in SDFace::vnum()";
+            if (v[3 * f + i] == vert) return i;
+        LOG(FATAL) << "Basic logic error in SDMesh::vnum()";
         return -1;
     }
-    SDFace *nextFace(SDVertex *vert) { return f[vnum(vert)]; }
-    SDFace *prevFace(SDVertex *vert) { return f[PREV(vnum(vert))]; }
-    SDVertex *nextVert(SDVertex *vert) { return v[NEXT(vnum(vert))]; }
-    SDVertex *prevVert(SDVertex *vert) { return v[PREV(vnum(vert))]; }
-    SDVertex *otherVert(SDVertex *v0, SDVertex *v1) {
+    int nextFace(int f, int vert) const { return nbr[3 * f + vnum(f, vert)]; }
+    int prevFace(int f, int vert) const {
+        return nbr[3 * f + PREV(vnum(f, vert))];
+    }
+    int nextVert(int f, int vert) const {
+        return v[3 * f + NEXT(vnum(f, vert))];
+    }
+    int prevVert(int f, int vert) const {
+        return v[3 * f + PREV(vnum(f, vert))];
+    }
+    int otherVert(int f, int v0, int v1) const {
         for (int i = 0; i < 3; ++i)
-            if (v[i] != v0 && v[i] != v1) return v[i];
-        LOG(FATAL) << "Basic logic error in SDVertex::otherVert()";
-        return nullptr;
+            if (v[3 * f + i] != v0 && v[3 * f + i] != v1) return v[3 * f + i];
+        LOG(FATAL) << "Basic logic error in SDMesh::otherVert()";
+        return -1;
     }
-    SDVertex *v[3];
-    SDFace *f[3];
-    SDFace *children[4];
-};
-
-struct SDEdge {
-    // SDEdge Constructor
-    SDEdge(SDVertex *v0 = nullptr, SDVertex *v1 = nullptr) {
-        v[0] = std::min(v0, v1);
-        v[1] = std::max(v0, v1);
-        f[0] = f[1] = nullptr;
-        f0edgeNum = -1;
+    int valence(int vert) const;
+    void oneRing(int vert, int *ring) const;
+    // Returns the position of _vert_ along edge _e_ of the patch's face, in
+    // units of edges at a level where the face's edges are split into
+    // _res_ segments, or -1 if _vert_ isn't on that edge.
+    int paramOnEdge(int vert, int e, int res) const {
+        if (edge[vert] == e) return edgeParam[vert];
+        if (corner[vert] == e) return 0;
+        if (corner[vert] == NEXT(e)) return res;
+        return -1;
     }
 
-    // SDEdge Comparison Function
-    bool operator<(const SDEdge &e2) const {
-        if (v[0] == e2.v[0]) return v[1] < e2.v[1];
-        return v[0] < e2.v[0];
-    }
-    SDVertex *v[2];
-    SDFace *f[2];
-    int f0edgeNum;
+    // SDMesh Data
+    std::vector<int> v, nbr;
+    // Per-vertex data. Vertices are identified across patches by _key_,
+    // which is computed from the vertices they were refined from.
+    // Vertices of the patch's own faces are _central_; the refinement only
+    // keeps the faces around them.
+    std::vector<Point3f> p;
+    std::vector<uint64_t> key;
+    std::vector<int> startFace;
+    std::vector<uint8_t> boundary, central;
+    // Position on the boundary of the patch's face: the corner, or the edge
+    // and the position along it
+    std::vector<int8_t> corner, edge;
+    std::vector<int> edgeParam;
 };
 
-// LoopSubdiv Local Declarations
-static Point3f weightOneRing(SDVertex *vert, Float beta);
-static Point3f weightBoundary(SDVertex *vert, Float beta);
-
 // LoopSubdiv Inline Functions
-inline int SDVertex::valence() {
-    SDFace *f = startFace;
-    if (!boundary) {
-        // Compute valence of interior vertex
-        int nf = 1;
-        while ((f = f->nextFace(this)) != startFace) ++nf;
-        return nf;
-    } else {
-        // Compute valence of boundary vertex
-        int nf = 1;
-        while ((f = f->nextFace(this)) != nullptr) ++nf;
-        f = startFace;
-        while ((f = f->prevFace(this)) != nullptr) ++nf;
-        return nf + 1;
-    }
-}
-
 inline Float beta(int valence) {
     if (valence == 3)
         return 3.f / 16.f;
@@ -145,266 +147,413 @@ inline Float loopGamma(int valence) {
     return 1.f / (valence + 3.f / (8.f * beta(valence)));
 }
 
-// LoopSubdiv Function Definitions
-static std::vector<std::shared_ptr<Shape>> LoopSubdivide(
-    const Transform *ObjectToWorld, const Transform *WorldToObject,
-    bool reverseOrientation, int nLevels, int nIndices,
-    const int *vertexIndices, int nVertices, const Point3f *p) {
-    std::vector<SDVertex *> vertices;
-    std::vector<SDFace *> faces;
-    // Allocate _LoopSubdiv_ vertices and faces
-    std::unique_ptr<SDVertex[]> verts(new SDVertex[nVertices]);
-    for (int i = 0; i < nVertices; ++i) {
-        verts[i] = SDVertex(p[i]);
-        vertices.push_back(&verts[i]);
-    }
-    int nFaces = nIndices / 3;
-    std::unique_ptr<SDFace[]> fs(new SDFace[nFaces]);
-    for (int i = 0; i < nFaces; ++i) faces.push_back(&fs[i]);
+inline uint64_t MixKeys(uint64_t a, uint64_t b) {
+    uint64_t h = a * 0x9e3779b97f4a7c15ull + b + 0x632be59bd9b4e019ull;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
 
-    // Set face to vertex pointers
-    const int *vp = vertexIndices;
-    for (int i = 0; i < nFaces; ++i, vp += 3) {
-        SDFace *f = faces[i];
-        for (int j = 0; j < 3; ++j) {
-            SDVertex *v = vertices[vp[j]];
-            f->v[j] = v;
-            v->startFace = f;
-        }
-    }
+inline uint64_t EvenKey(uint64_t parent) { return MixKeys(parent, 1); }
 
-    // Set neighbor pointers in _faces_
-    std::set<SDEdge> edges;
-    for (int i = 0; i < nFaces; ++i) {
-        SDFace *f = faces[i];
-        for (int edgeNum = 0; edgeNum < 3; ++edgeNum) {
-            // Update neighbor pointer for _edgeNum_
-            int v0 = edgeNum, v1 = NEXT(edgeNum);
-            SDEdge e(f->v[v0], f->v[v1]);
-            if (edges.find(e) == edges.end()) {
-                // Handle new edge
-                e.f[0] = f;
-                e.f0edgeNum = edgeNum;
-                edges.insert(e);
-            } else {
-                // Handle previously seen edge
-                e = *edges.find(e);
-                e.f[0]->f[e.f0edgeNum] = f;
-                f->f[edgeNum] = e.f[0];
-                edges.erase(e);
-            }
-        }
+inline uint64_t OddKey(uint64_t k0, uint64_t k1) {
+    return MixKeys(std::min(k0, k1) + 2, std::max(k0, k1));
+}
+
+// Sorts vertices by key; a vertex shared by several patches is computed from
+// its neighbors in this order so that every patch gets exactly the same
+// floating-point result.
+inline void SortByKey(const SDMesh &m, int *verts, int n) {
+    std::sort(verts, verts + n,
+              [&](int a, int b) { return m.key[a] < m.key[b]; });
+}
+
+// LoopSubdiv Function Definitions
+int SDMesh::valence(int vert) const {
+    int f = startFace[vert];
+    if (!boundary[vert]) {
+        // Compute valence of interior vertex
+        int nf = 1;
+        while ((f = nextFace(f, vert)) != startFace[vert]) ++nf;
+        return nf;
+    } else {
+        // Compute valence of boundary vertex
+        int nf = 1;
+        while ((f = nextFace(f, vert)) != -1) ++nf;
+        f = startFace[vert];
+        while ((f = prevFace(f, vert)) != -1) ++nf;
+        return nf + 1;
     }
+}
 
-    // Finish vertex initialization
-    for (int i = 0; i < nVertices; ++i) {
-        SDVertex *v = vertices[i];
-        SDFace *f = v->startFace;
+void SDMesh::oneRing(int vert, int *ring) const {
+    if (!boundary[vert]) {
+        // Get one-ring vertices for interior vertex
+        int face = startFace[vert];
         do {
-            f = f->nextFace(v);
-        } while (f && f != v->startFace);
-        v->boundary = (f == nullptr);
-        if (!v->boundary && v->valence() == 6)
-            v->regular = true;
-        else if (v->boundary && v->valence() == 4)
-            v->regular = true;
-        else
-            v->regular = false;
+            *ring++ = nextVert(face, vert);
+            face = nextFace(face, vert);
+        } while (face != startFace[vert]);
+    } else {
+        // Get one-ring vertices for boundary vertex
+        int face = startFace[vert], f2;
+        while ((f2 = nextFace(face, vert)) != -1) face = f2;
+        *ring++ = nextVert(face, vert);
+        do {
+            *ring++ = prevVert(face, vert);
+            face = prevFace(face, vert);
+        } while (face != -1);
     }
+}
 
-    // Refine _LoopSubdiv_ into triangles
-    std::vector<SDFace *> f = faces;
-    std::vector<SDVertex *> v = vertices;
-    MemoryArena arena;
-    for (int i = 0; i < nLevels; ++i) {
-        // Update _f_ and _v_ for next level of subdivision
-        std::vector<SDFace *> newFaces;
-        std::vector<SDVertex *> newVertices;
-
-        // Allocate next level of children in mesh tree
-        for (SDVertex *vertex : v) {
-            vertex->child = arena.Alloc<SDVertex>();
-            vertex->child->regular = vertex->regular;
-            vertex->child->boundary = vertex->boundary;
-            newVertices.push_back(vertex->child);
-        }
-        for (SDFace *face : f) {
-            for (int k = 0; k < 4; ++k) {
-                face->children[k] = arena.Alloc<SDFace>();
-                newFaces.push_back(face->children[k]);
-            }
-        }
+static Point3f weightOneRing(const SDMesh &m, int vert, Float beta) {
+    // Put _vert_ one-ring in _ring_
+    int valence = m.valence(vert);
+    int *ring = ALLOCA(int, valence);
+    m.oneRing(vert, ring);
+    SortByKey(m, ring, valence);
+    Point3f p = (1 - valence * beta) * m.p[vert];
+    for (int i = 0; i < valence; ++i) p += beta * m.p[ring[i]];
+    return p;
+}
 
-        // Update vertex positions and create new edge vertices
+static Point3f weightBoundary(const SDMesh &m, int vert, Float beta) {
+    // Put _vert_ one-ring in _ring_
+    int valence = m.valence(vert);
+    int *ring = ALLOCA(int, valence);
+    m.oneRing(vert, ring);
+    int ends[2] = {ring[0], ring[valence - 1]};
+    SortByKey(m, ends, 2);
+    Point3f p = (1 - 2 * beta) * m.p[vert];
+    p += beta * m.p[ends[0]];
+    p += beta * m.p[ends[1]];
+    return p;
+}
 
-        // Update vertex positions for even vertices
-        for (SDVertex *vertex : v) {
-            if (!vertex->boundary) {
-                // Apply one-ring rule for even vertex
-                if (vertex->regular)
-                    vertex->child->p = weightOneRing(vertex, 1.f / 16.f);
-                else
-                    vertex->child->p =
-                        weightOneRing(vertex, beta(vertex->valence()));
-            } else {
-                // Apply boundary rule for even vertex
-                vertex->child->p = weightBoundary(vertex, 1.f / 8.f);
-            }
-        }
+static Point3f LimitPosition(const SDMesh &m, int vert) {
+    if (m.boundary[vert]) return weightBoundary(m, vert, 1.f / 5.f);
+    return weightOneRing(m, vert, loopGamma(m.valence(vert)));
+}
 
-        // Compute new odd edge vertices
-        std::map<SDEdge, SDVertex *> edgeVerts;
-        for (SDFace *face : f) {
-            for (int k = 0; k < 3; ++k) {
-                // Compute odd vertex on _k_th edge
-                SDEdge edge(face->v[k], face->v[NEXT(k)]);
-                SDVertex *vert = edgeVerts[edge];
-                if (!vert) {
-                    // Create and initialize new odd vertex
-                    vert = arena.Alloc<SDVertex>();
-                    newVertices.push_back(vert);
-                    vert->regular = true;
-                    vert->boundary = (face->f[k] == nullptr);
-                    vert->startFace = face->children[3];
-
-                    // Apply edge rules to compute new vertex position
-                    if (vert->boundary) {
-                        vert->p = 0.5f * edge.v[0]->p;
-                        vert->p += 0.5f * edge.v[1]->p;
-                    } else {
-                        vert->p = 3.f / 8.f * edge.v[0]->p;
-                        vert->p += 3.f / 8.f * edge.v[1]->p;
-                        vert->p += 1.f / 8.f *
-                                   face->otherVert(edge.v[0], edge.v[1])->p;
-                        vert->p +=
-                            1.f / 8.f *
-                            face->f[k]->otherVert(edge.v[0], edge.v[1])->p;
-                    }
-                    edgeVerts[edge] = vert;
-                }
-            }
+static Normal3f LimitNormal(const SDMesh &m, int vert) {
+    Vector3f S(0, 0, 0), T(0, 0, 0);
+    int valence = m.valence(vert);
+    int *ring = ALLOCA(int, valence);
+    m.oneRing(vert, ring);
+    Point3f *pRing = ALLOCA(Point3f, valence);
+    for (int i = 0; i < valence; ++i) pRing[i] = m.p[ring[i]];
+    if (!m.boundary[vert]) {
+        // Compute tangents of interior face
+        for (int j = 0; j < valence; ++j) {
+            S += std::cos(2 * Pi * j / valence) * Vector3f(pRing[j]);
+            T += std::sin(2 * Pi * j / valence) * Vector3f(pRing[j]);
         }
-
-        // Update new mesh topology
-
-        // Update even vertex face pointers
-        for (SDVertex *vertex : v) {
-            int vertNum = vertex->startFace->vnum(vertex);
-            vertex->child->startFace = vertex->startFace->children[vertNum];
+    } else {
+        // Compute tangents of boundary face
+        S = pRing[valence - 1] - pRing[0];
+        if (valence == 2)
+            T = Vector3f(pRing[0] + pRing[1] - 2 * m.p[vert]);
+        else if (valence == 3)
+            T = pRing[1] - m.p[vert];
+        else if (valence == 4)  // regular
+            T = Vector3f(-1 * pRing[0] + 2 * pRing[1] + 2 * pRing[2] +
+                         -1 * pRing[3] + -2 * m.p[vert]);
+        else {
+            Float theta = Pi / float(valence - 1);
+            T = Vector3f(std::sin(theta) * (pRing[0] + pRing[valence - 1]));
+            for (int k = 1; k < valence - 1; ++k) {
+                Float wt = (2 * std::cos(theta) - 2) * std::sin((k)*theta);
+                T += Vector3f(wt * pRing[k]);
+            }
+            T = -T;
         }
+    }
+    return Normal3f(Cross(S, T));
+}
 
-        // Update face neighbor pointers
-        for (SDFace *face : f) {
-            for (int j = 0; j < 3; ++j) {
-                // Update children _f_ pointers for siblings
-                face->children[3]->f[j] = face->children[NEXT(j)];
-                face->children[j]->f[NEXT(j)] = face->children[3];
-
-                // Update children _f_ pointers for neighbor children
-                SDFace *f2 = face->f[j];
-                face->children[j]->f[j] =
-                    f2 ? f2->children[f2->vnum(face->v[j])] : nullptr;
-                f2 = face->f[PREV(j)];
-                face->children[j]->f[PREV(j)] =
-                    f2 ? f2->children[f2->vnum(face->v[j])] : nullptr;
+// Initializes _m_ with face _face_ of _mesh_ and the faces around its
+// vertices, which are all that subdivision rules need to refine it.
+static void ExtractPatch(const LoopSubdivMesh &mesh, int face, SDMesh *m) {
+    const int *fv = &mesh.vertexIndices[3 * face];
+    std::vector<int> faces(1, face);
+    for (int i = 0; i < 3; ++i)
+        for (int j = mesh.vertexFaceOffset[fv[i]];
+             j < mesh.vertexFaceOffset[fv[i] + 1]; ++j)
+            if (std::find(faces.begin(), faces.end(), mesh.vertexFaces[j]) ==
+                faces.end())
+                faces.push_back(mesh.vertexFaces[j]);
+
+    // Set face vertex indices, creating vertices as they're first seen
+    std::vector<int> meshVertex;
+    for (size_t i = 0; i < faces.size(); ++i)
+        for (int k = 0; k < 3; ++k) {
+            int mv = mesh.vertexIndices[3 * faces[i] + k];
+            auto iter = std::find(meshVertex.begin(), meshVertex.end(), mv);
+            int vert = iter - meshVertex.begin();
+            if (iter == meshVertex.end()) {
+                meshVertex.push_back(mv);
+                m->AddVertex(mesh.p[mv], MixKeys(mv, 0), false, false);
             }
+            m->v.push_back(vert);
+            m->startFace[vert] = i;
         }
 
-        // Update face vertex pointers
-        for (SDFace *face : f) {
-            for (int j = 0; j < 3; ++j) {
-                // Update child vertex pointer to new even vertex
-                face->children[j]->v[j] = face->v[j]->child;
-
-                // Update child vertex pointer to new odd vertex
-                SDVertex *vert =
-                    edgeVerts[SDEdge(face->v[j], face->v[NEXT(j)])];
-                face->children[j]->v[NEXT(j)] = vert;
-                face->children[NEXT(j)]->v[j] = vert;
-                face->children[3]->v[j] = vert;
-            }
+    // Set face neighbors, leaving ones outside the patch unset
+    for (size_t i = 0; i < faces.size(); ++i)
+        for (int k = 0; k < 3; ++k) {
+            int f2 = mesh.neighbors[3 * faces[i] + k];
+            auto iter = std::find(faces.begin(), faces.end(), f2);
+            m->nbr.push_back(iter == faces.end() ? -1 : iter - faces.begin());
         }
 
-        // Prepare for next level of subdivision
-        f = newFaces;
-        v = newVertices;
+    // Initialize the corners of the patch's face
+    for (int k = 0; k < 3; ++k) {
+        int vert = m->v[k];
+        m->central[vert] = true;
+        m->corner[vert] = k;
+        int f = m->startFace[vert];
+        do {
+            f = m->nextFace(f, vert);
+        } while (f != -1 && f != m->startFace[vert]);
+        m->boundary[vert] = (f == -1);
     }
+}
 
-    // Push vertices to limit surface
-    std::unique_ptr<Point3f[]> pLimit(new Point3f[v.size()]);
-    for (size_t i = 0; i < v.size(); ++i) {
-        if (v[i]->boundary)
-            pLimit[i] = weightBoundary(v[i], 1.f / 5.f);
+// Refines _m_ by one level into _r_. Only the children of the faces around
+// _m_'s central vertices are kept. _m_'s first _nCentral_ faces are the
+// central ones, and their children become _r_'s first faces, in order;
+// _res_ is the number of edges each edge of the patch's face is split into
+// in _m_.
+static void Refine(const SDMesh &m, int nCentral, int res, SDMesh *r) {
+    int nFaces = m.nFaces();
+    auto edgeIsCentral = [&](int f, int k) {
+        int f2 = m.nbr[3 * f + k];
+        return f < nCentral || (f2 != -1 && f2 < nCentral);
+    };
+
+    // Choose the child faces to keep, numbering central faces' children first
+    std::vector<int> children(4 * nFaces, -1);
+    int nChildren = 0;
+    for (int f = 0; f < nFaces; ++f) {
+        bool central[3];
+        for (int k = 0; k < 3; ++k) central[k] = edgeIsCentral(f, k);
+        for (int j = 0; j < 3; ++j)
+            if (m.central[m.v[3 * f + j]] || central[j] || central[PREV(j)])
+                children[4 * f + j] = nChildren++;
+        if (central[0] || central[1] || central[2])
+            children[4 * f + 3] = nChildren++;
+    }
+    r->v.assign(3 * nChildren, -1);
+    r->nbr.assign(3 * nChildren, -1);
+
+    // Update vertex positions for even vertices
+    std::vector<int> evenVerts(m.nVertices(), -1);
+    for (int vert = 0; vert < m.nVertices(); ++vert) {
+        if (!m.central[vert]) continue;
+        Point3f p;
+        if (!m.boundary[vert])
+            // Apply one-ring rule for even vertex
+            p = weightOneRing(m, vert, beta(m.valence(vert)));
         else
-            pLimit[i] = weightOneRing(v[i], loopGamma(v[i]->valence()));
+            // Apply boundary rule for even vertex
+            p = weightBoundary(m, vert, 1.f / 8.f);
+        int child =
+            r->AddVertex(p, EvenKey(m.key[vert]), m.boundary[vert], true);
+        r->corner[child] = m.corner[vert];
+        r->edge[child] = m.edge[vert];
+        r->edgeParam[child] = 2 * m.edgeParam[vert];
+        evenVerts[vert] = child;
     }
-    for (size_t i = 0; i < v.size(); ++i) v[i]->p = pLimit[i];
-
-    // Compute vertex tangents on limit surface
-    std::vector<Normal3f> Ns;
-    Ns.reserve(v.size());
-    std::vector<Point3f> pRing(16, Point3f());
-    for (SDVertex *vertex : v) {
-        Vector3f S(0, 0, 0), T(0, 0, 0);
-        int valence = vertex->valence();
-        if (valence > (int)pRing.size()) pRing.resize(valence);
-        vertex->oneRing(&pRing[0]);
-        if (!vertex->boundary) {
-            // Compute tangents of interior face
-            for (int j = 0; j < valence; ++j) {
-                S += std::cos(2 * Pi * j / valence) * Vector3f(pRing[j]);
-                T += std::sin(2 * Pi * j / valence) * Vector3f(pRing[j]);
-            }
+
+    // Computes the odd vertex on edge _k_ of face _f_ the first time it's
+    // needed; both faces that share the edge record it in _oddVerts_
+    std::vector<int> oddVerts(3 * nFaces, -1);
+    auto oddVertex = [&](int f, int k) {
+        if (oddVerts[3 * f + k] != -1) return oddVerts[3 * f + k];
+        int v0 = m.v[3 * f + k], v1 = m.v[3 * f + NEXT(k)];
+        int f2 = m.nbr[3 * f + k];
+        int ends[2] = {v0, v1};
+        SortByKey(m, ends, 2);
+        Point3f p;
+        if (f2 == -1) {
+            p = 0.5f * m.p[ends[0]];
+            p += 0.5f * m.p[ends[1]];
         } else {
-            // Compute tangents of boundary face
-            S = pRing[valence - 1] - pRing[0];
-            if (valence == 2)
-                T = Vector3f(pRing[0] + pRing[1] - 2 * vertex->p);
-            else if (valence == 3)
-                T = pRing[1] - vertex->p;
-            else if (valence == 4)  // regular
-                T = Vector3f(-1 * pRing[0] + 2 * pRing[1] + 2 * pRing[2] +
-                             -1 * pRing[3] + -2 * vertex->p);
-            else {
-                Float theta = Pi / float(valence - 1);
-                T = Vector3f(std::sin(theta) * (pRing[0] + pRing[valence - 1]));
-                for (int k = 1; k < valence - 1; ++k) {
-                    Float wt = (2 * std::cos(theta) - 2) * std::sin((k)*theta);
-                    T += Vector3f(wt * pRing[k]);
-                }
-                T = -T;
+            int others[2] = {m.otherVert(f, v0, v1), m.otherVert(f2, v0, v1)};
+            SortByKey(m, others, 2);
+            p = 3.f / 8.f * m.p[ends[0]];
+            p += 3.f / 8.f * m.p[ends[1]];
+            p += 1.f / 8.f * m.p[others[0]];
+            p += 1.f / 8.f * m.p[others[1]];
+        }
+        int vert = r->AddVertex(p, OddKey(m.key[v0], m.key[v1]), f2 == -1,
+                                edgeIsCentral(f, k));
+        // Track odd vertices on the boundary of the patch's face
+        for (int e = 0; e < 3; ++e) {
+            int p0 = m.paramOnEdge(v0, e, res), p1 = m.paramOnEdge(v1, e, res);
+            if (p0 != -1 && p1 != -1) {
+                r->edge[vert] = e;
+                r->edgeParam[vert] = p0 + p1;
+                break;
+            }
+        }
+        oddVerts[3 * f + k] = vert;
+        if (f2 != -1)
+            for (int k2 = 0; k2 < 3; ++k2)
+                if (m.nbr[3 * f2 + k2] == f &&
+                    std::min(m.v[3 * f2 + k2], m.v[3 * f2 + NEXT(k2)]) ==
+                        std::min(v0, v1) &&
+                    std::max(m.v[3 * f2 + k2], m.v[3 * f2 + NEXT(k2)]) ==
+                        std::max(v0, v1))
+                    oddVerts[3 * f2 + k2] = vert;
+        return vert;
+    };
+
+    // Update new mesh topology
+    for (int f = 0; f < nFaces; ++f) {
+        const int *child = &children[4 * f];
+        for (int j = 0; j < 3; ++j) {
+            // Update children neighbors for siblings
+            if (child[3] != -1) r->nbr[3 * child[3] + j] = child[NEXT(j)];
+            if (child[j] == -1) continue;
+            r->nbr[3 * child[j] + NEXT(j)] = child[3];
+
+            // Update children neighbors for neighbor children
+            int f2 = m.nbr[3 * f + j];
+            if (f2 != -1)
+                r->nbr[3 * child[j] + j] =
+                    children[4 * f2 + m.vnum(f2, m.v[3 * f + j])];
+            f2 = m.nbr[3 * f + PREV(j)];
+            if (f2 != -1)
+                r->nbr[3 * child[j] + PREV(j)] =
+                    children[4 * f2 + m.vnum(f2, m.v[3 * f + j])];
+        }
+
+        for (int j = 0; j < 3; ++j) {
+            // Update child vertex index to new even vertex
+            if (child[j] != -1) {
+                CHECK_NE(evenVerts[m.v[3 * f + j]], -1);
+                r->v[3 * child[j] + j] = evenVerts[m.v[3 * f + j]];
             }
+
+            // Update child vertex indices to new odd vertex
+            if (child[j] == -1 && child[NEXT(j)] == -1 && child[3] == -1)
+                continue;
+            int vert = oddVertex(f, j);
+            if (child[j] != -1) r->v[3 * child[j] + NEXT(j)] = vert;
+            if (child[NEXT(j)] != -1) r->v[3 * child[NEXT(j)] + j] = vert;
+            if (child[3] != -1) r->v[3 * child[3] + j] = vert;
         }
-        Ns.push_back(Normal3f(Cross(S, T)));
     }
+    for (int f = 0; f < nChildren; ++f)
+        for (int k = 0; k < 3; ++k) r->startFace[r->v[3 * f + k]] = f;
+}
 
-    // Create triangle mesh from subdivision mesh
-    {
-        size_t ntris = f.size();
-        std::unique_ptr<int[]> verts(new int[3 * ntris]);
-        int *vp = verts.get();
-        size_t totVerts = v.size();
-        std::map<SDVertex *, int> usedVerts;
-        for (size_t i = 0; i < totVerts; ++i) usedVerts[v[i]] = i;
-        for (size_t i = 0; i < ntris; ++i) {
-            for (int j = 0; j < 3; ++j) {
-                *vp = usedVerts[f[i]->v[j]];
-                ++vp;
+// LoopSubdivPatch Method Definitions
+LoopSubdivPatch::LoopSubdivPatch(
+    const Transform *ObjectToWorld, const Transform *WorldToObject,
+    bool reverseOrientation, const std::shared_ptr<const LoopSubdivMesh> &mesh,
+    int face)
+    : TessellatedPatch(ObjectToWorld, WorldToObject, reverseOrientation),
+      mesh(mesh),
+      face(face) {
+    ++nPatches;
+    // Bound the control points that influence the patch; the limit surface
+    // lies in their convex hull
+    const int *fv = &mesh->vertexIndices[3 * face];
+    for (int i = 0; i < 3; ++i)
+        for (int j = mesh->vertexFaceOffset[fv[i]];
+             j < mesh->vertexFaceOffset[fv[i] + 1]; ++j)
+            for (int k = 0; k < 3; ++k)
+                bounds = Union(
+                    bounds,
+                    mesh->p[mesh->vertexIndices[3 * mesh->vertexFaces[j] + k]]);
+
+    // Account for round-off error in the refined points
+    int level = std::max({mesh->edgeLevel[3 * face],
+                          mesh->edgeLevel[3 * face + 1],
+                          mesh->edgeLevel[3 * face + 2]});
+    Vector3f extent(Max(Abs(bounds.pMin), Abs(bounds.pMax)));
+    bounds = Expand(bounds, gamma(16 * (level + 1)) * MaxComponent(extent));
+}
+
+PatchTessellation *LoopSubdivPatch::Tessellate() const {
+    ++nTessellated;
+    const uint8_t *edgeLevel = &mesh->edgeLevel[3 * face];
+    int level = std::max({edgeLevel[0], edgeLevel[1], edgeLevel[2]});
+    ReportValue(patchLevel, level);
+
+    // Compute the limit positions of the vertices on the face's boundary.
+    // They're computed at the level of their edge, which may be coarser than
+    // the patch's, so that they match the neighboring patch exactly.
+    SDMesh m;
+    ExtractPatch(*mesh, face, &m);
+    Point3f cornerP[3];
+    std::vector<Point3f> edgeP[3];
+    for (int k = 0; k < 3; ++k) cornerP[k] = LimitPosition(m, m.v[k]);
+    int nCentral = 1;
+    for (int l = 1; l <= level; ++l) {
+        SDMesh r;
+        Refine(m, nCentral, 1 << (l - 1), &r);
+        std::swap(m, r);
+        nCentral *= 4;
+        for (int e = 0; e < 3; ++e)
+            if (edgeLevel[e] == l) {
+                edgeP[e].resize((1 << l) + 1);
+                for (int vert = 0; vert < m.nVertices(); ++vert)
+                    if (m.edge[vert] == e)
+                        edgeP[e][m.edgeParam[vert]] = LimitPosition(m, vert);
             }
+    }
+
+    // Create triangle mesh from the patch's refined faces
+    std::vector<int> meshVertex(m.nVertices(), -1);
+    std::vector<int> indices(3 * nCentral);
+    std::vector<Point3f> P;
+    std::vector<Normal3f> N;
+    for (int i = 0; i < 3 * nCentral; ++i) {
+        int vert = m.v[i];
+        if (meshVertex[vert] == -1) {
+            meshVertex[vert] = P.size();
+            Point3f p;
+            if (m.corner[vert] != -1)
+                p = cornerP[m.corner[vert]];
+            else if (m.edge[vert] != -1) {
+                // Snap the vertex to the closest one at its edge's level,
+                // which leaves degenerate triangles along the edge
+                int e = m.edge[vert], shift = level - edgeLevel[e];
+                int j = (m.edgeParam[vert] + ((1 << shift) >> 1)) >> shift;
+                if (j == 0)
+                    p = cornerP[e];
+                else if (j == 1 << edgeLevel[e])
+                    p = cornerP[NEXT(e)];
+                else
+                    p = edgeP[e][j];
+            } else
+                p = LimitPosition(m, vert);
+            P.push_back(p);
+            // Normals are computed from world-space points, which flips
+            // them for transformations that change handedness
+            Normal3f n = LimitNormal(m, vert);
+            N.push_back(ObjectToWorld->SwapsHandedness() ? -n : n);
         }
-        return CreateTriangleMesh(ObjectToWorld, WorldToObject,
-                                  reverseOrientation, ntris, verts.get(),
-                                  totVerts, pLimit.get(), nullptr, &Ns[0],
-                                  nullptr, nullptr, nullptr);
+        indices[i] = meshVertex[vert];
     }
+    return MakeTessellation(
+        level, std::make_shared<TriangleMesh>(
+                   Transform(), nCentral, indices.data(), P.size(), P.data(),
+                   nullptr, N.data(), nullptr, nullptr, nullptr));
 }
 
-std::vector<std::shared_ptr<Shape>> CreateLoopSubdiv(const Transform *o2w,
-                                                     const Transform *w2o,
-                                                     bool reverseOrientation,
-                                                     const ParamSet &params) {
+std::vector<std::shared_ptr<Shape>> CreateLoopSubdiv(
+    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
+    const ParamSet &params, const SubdivisionView *view) {
     int nLevels = params.FindOneInt("levels",
                                     params.FindOneInt("nlevels", 3));
+    nLevels = Clamp(nLevels, 0, 12);
+    Float edgeLength = params.FindOneFloat("edgelength", 1.f);
     int nps, nIndices;
     const int *vertexIndices = params.FindInt("indices", &nIndices);
     const Point3f *P = params.FindPoint3f("P", &nps);
@@ -419,49 +568,63 @@ std::vector<std::shared_ptr<Shape>> CreateLoopSubdiv(const Transform *o2w,
 
     // don't actually use this for now...
     std::string scheme = params.FindOneString("scheme", "loop");
-    return LoopSubdivide(o2w, w2o, reverseOrientation, nLevels, nIndices,
-                         vertexIndices, nps, P);
-}
 
-static Point3f weightOneRing(SDVertex *vert, Float beta) {
-    // Put _vert_ one-ring in _pRing_
-    int valence = vert->valence();
-    Point3f *pRing = ALLOCA(Point3f, valence);
-    vert->oneRing(pRing);
-    Point3f p = (1 - valence * beta) * vert->p;
-    for (int i = 0; i < valence; ++i) p += beta * pRing[i];
-    return p;
-}
+    // Initialize the control mesh's vertices and faces
+    std::shared_ptr<LoopSubdivMesh> mesh = std::make_shared<LoopSubdivMesh>();
+    int nFaces = nIndices / 3;
+    mesh->p.resize(nps);
+    for (int i = 0; i < nps; ++i) mesh->p[i] = (*o2w)(P[i]);
+    mesh->vertexIndices.assign(vertexIndices, vertexIndices + 3 * nFaces);
+
+    // Set face neighbors by sorting the faces' edges so that the two sides
+    // of each edge are adjacent
+    std::vector<std::pair<uint64_t, int>> edges(3 * nFaces);
+    for (int f = 0; f < nFaces; ++f)
+        for (int k = 0; k < 3; ++k) {
+            uint64_t v0 = vertexIndices[3 * f + k];
+            uint64_t v1 = vertexIndices[3 * f + NEXT(k)];
+            edges[3 * f + k] =
+                std::make_pair(std::min(v0, v1) << 32 | std::max(v0, v1),
+                               3 * f + k);
+        }
+    std::sort(edges.begin(), edges.end());
+    mesh->neighbors.assign(3 * nFaces, -1);
+    for (size_t i = 0; i + 1 < edges.size(); ++i)
+        if (edges[i].first == edges[i + 1].first) {
+            mesh->neighbors[edges[i].second] = edges[i + 1].second / 3;
+            mesh->neighbors[edges[i + 1].second] = edges[i].second / 3;
+            ++i;
+        }
 
-void SDVertex::oneRing(Point3f *p) {
-    if (!boundary) {
-        // Get one-ring vertices for interior vertex
-        SDFace *face = startFace;
-        do {
-            *p++ = face->nextVert(this)->p;
-            face = face->nextFace(this);
-        } while (face != startFace);
-    } else {
-        // Get one-ring vertices for boundary vertex
-        SDFace *face = startFace, *f2;
-        while ((f2 = face->nextFace(this)) != nullptr) face = f2;
-        *p++ = face->nextVert(this)->p;
-        do {
-            *p++ = face->prevVert(this)->p;
-            face = face->prevFace(this);
-        } while (face != nullptr);
+    // Find the faces around each vertex
+    mesh->vertexFaceOffset.assign(nps + 1, 0);
+    for (int i = 0; i < 3 * nFaces; ++i)
+        ++mesh->vertexFaceOffset[vertexIndices[i] + 1];
+    for (int i = 0; i < nps; ++i)
+        mesh->vertexFaceOffset[i + 1] += mesh->vertexFaceOffset[i];
+    mesh->vertexFaces.resize(3 * nFaces);
+    std::vector<int> nextFace(mesh->vertexFaceOffset.begin(),
+                              mesh->vertexFaceOffset.end() - 1);
+    for (int i = 0; i < 3 * nFaces; ++i)
+        mesh->vertexFaces[nextFace[vertexIndices[i]]++] = i / 3;
+
+    // Choose edge subdivision levels so that refined edges span about
+    // _edgeLength_ pixels, up to _nLevels_
+    mesh->edgeLevel.resize(3 * nFaces);
+    for (int i = 0; i < 3 * nFaces; ++i) {
+        Point3f p0 = mesh->p[vertexIndices[i]];
+        Point3f p1 = mesh->p[vertexIndices[3 * (i / 3) + NEXT(i % 3)]];
+        if (vertexIndices[i] > vertexIndices[3 * (i / 3) + NEXT(i % 3)])
+            std::swap(p0, p1);
+        mesh->edgeLevel[i] = EdgeLevel(view, edgeLength, nLevels, p0, p1);
     }
-}
 
-static Point3f weightBoundary(SDVertex *vert, Float beta) {
-    // Put _vert_ one-ring in _pRing_
-    int valence = vert->valence();
-    Point3f *pRing = ALLOCA(Point3f, valence);
-    vert->oneRing(pRing);
-    Point3f p = (1 - 2 * beta) * vert->p;
-    p += beta * pRing[0];
-    p += beta * pRing[valence - 1];
-    return p;
+    std::vector<std::shared_ptr<Shape>> shapes;
+    shapes.reserve(nFaces);
+    for (int f = 0; f < nFaces; ++f)
+        shapes.push_back(std::make_shared<LoopSubdivPatch>(
+            o2w, w2o, reverseOrientation, mesh, f));
+    return shapes;
 }
 
 }  // namespace pbrt
@@ -39,15 +39,35 @@
 #define PBRT_SHAPES_LOOPSUBDIV_H
 
 // shapes/loopsubdiv.h*
-#include "shape.h"
+#include "shapes/tessellation.h"
 
 namespace pbrt {
 
+struct LoopSubdivMesh;
+
 // LoopSubdiv Declarations
-std::vector<std::shared_ptr<Shape>> CreateLoopSubdiv(const Transform *o2w,
-                                                     const Transform *w2o,
-                                                     bool reverseOrientation,
-                                                     const ParamSet &params);
+// A single face of a Loop subdivision surface's control mesh, refined into
+// triangles the first time a ray reaches its bounds.
+class LoopSubdivPatch : public TessellatedPatch {
+  public:
+    // LoopSubdivPatch Public Methods
+    LoopSubdivPatch(const Transform *ObjectToWorld,
+                    const Transform *WorldToObject, bool reverseOrientation,
+                    const std::shared_ptr<const LoopSubdivMesh> &mesh,
+                    int face);
+
+  private:
+    // LoopSubdivPatch Private Methods
+    PatchTessellation *Tessellate() const;
+
+    // LoopSubdivPatch Private Data
+    const std::shared_ptr<const LoopSubdivMesh> mesh;
+    const int face;
+};
+
+std::vector<std::shared_ptr<Shape>> CreateLoopSubdiv(
+    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
+    const ParamSet &params, const SubdivisionView *view = nullptr);
 
 }  // namespace pbrt
 
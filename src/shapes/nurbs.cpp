@@ -142,10 +142,9 @@ static Point3f NURBSEvaluateSurface(int uOrder, const Float *uKnot, int ucp,
     return Point3f(P.x / P.w, P.y / P.w, P.z / P.w);
 }
 
-std::vector<std::shared_ptr<Shape>> CreateNURBS(const Transform *o2w,
-                                                const Transform *w2o,
-                                                bool reverseOrientation,
-                                                const ParamSet &params) {
+std::vector<std::shared_ptr<Shape>> CreateNURBS(
+    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
+    const ParamSet &params, std::shared_ptr<TriangleMesh> *compressedMesh) {
     int nu = params.FindOneInt("nu", -1);
     if (nu == -1) {
         Error("Must provide number of control points \"nu\" with NURBS shape.");
@@ -304,7 +303,8 @@ std::vector<std::shared_ptr<Shape>> CreateNURBS(const Transform *o2w,
 
     return CreateTriangleMesh(o2w, w2o, reverseOrientation, nTris,
                               vertices.get(), nVerts, evalPs.get(), nullptr,
-                              evalNs.get(), uvs.get(), nullptr, nullptr);
+                              evalNs.get(), uvs.get(), nullptr, nullptr, 1, 0,
+                              1, compressedMesh);
 }
 
 }  // namespace pbrt
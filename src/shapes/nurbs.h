@@ -45,10 +45,12 @@
 
 namespace pbrt {
 
-std::vector<std::shared_ptr<Shape>> CreateNURBS(const Transform *o2w,
-                                                const Transform *w2o,
-                                                bool reverseOrientation,
-                                                const ParamSet &params);
+struct TriangleMesh;
+
+std::vector<std::shared_ptr<Shape>> CreateNURBS(
+    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
+    const ParamSet &params,
+    std::shared_ptr<TriangleMesh> *compressedMesh = nullptr);
 
 }  // namespace pbrt
 
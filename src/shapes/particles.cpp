@@ -0,0 +1,422 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// shapes/particles.cpp*
+#include "shapes/particles.h"
+#include "efloat.h"
+#include "paramset.h"
+#include "sampling.h"
+#include "stats.h"
+#include <numeric>
+
+namespace pbrt {
+
+STAT_MEMORY_COUNTER("Memory/Particles", particleBytes);
+STAT_COUNTER("Scene/Particles", nParticlesCreated);
+STAT_PERCENT("Intersections/Ray-particle intersection tests", nHits, nTests);
+STAT_COUNTER("Intersections/Particle tests solved with EFloat", nEFloatTests);
+
+// Particles Method Definitions
+Particles::Particles(const Transform *ObjectToWorld,
+                     const Transform *WorldToObject, bool reverseOrientation,
+                     int nParticles, const Point3f *P, const Float *radii)
+    : Shape(ObjectToWorld, WorldToObject, reverseOrientation),
+      nParticles(nParticles) {
+    ProfilePhase _(Prof::AccelConstruction);
+    nParticlesCreated += nParticles;
+    std::vector<Point3f> p(P, P + nParticles);
+    std::vector<Float> r(radii, radii + nParticles);
+    std::vector<int> order(nParticles);
+    std::iota(order.begin(), order.end(), 0);
+    nodes.reserve(2 * (nParticles / BlockSize + 1));
+    if (nParticles > 0) BuildBVH(order, p, r, 0, nParticles);
+
+    // Store the particles in BVH order, padding out the last block
+    int nStored = (nParticles + BlockSize - 1) / BlockSize * BlockSize;
+    cx.resize(nStored);
+    cy.resize(nStored);
+    cz.resize(nStored);
+    radius.resize(nStored);
+    area = 0;
+    for (int i = 0; i < nParticles; ++i) {
+        const Point3f &pi = p[order[i]];
+        cx[i] = pi.x;
+        cy[i] = pi.y;
+        cz[i] = pi.z;
+        radius[i] = r[order[i]];
+        area += 4 * Pi * radius[i] * radius[i];
+    }
+    particleBytes += sizeof(*this) + 4 * nStored * sizeof(Float) +
+                     nodes.size() * sizeof(Node);
+}
+
+int Particles::BuildBVH(std::vector<int> &order, const std::vector<Point3f> &p,
+                        const std::vector<Float> &r, int start, int end) {
+    int nodeIndex = nodes.size();
+    nodes.push_back(Node());
+    int nBlocks = (end - start + BlockSize - 1) / BlockSize;
+    if (nBlocks == 1) {
+        // Create leaf _Node_ for a single block of particles
+        Bounds3f bounds;
+        for (int i = start; i < end; ++i) {
+            Vector3f extent(r[order[i]], r[order[i]], r[order[i]]);
+            bounds = Union(bounds, Bounds3f(p[order[i]] - extent,
+                                            p[order[i]] + extent));
+        }
+        nodes[nodeIndex].bounds = bounds;
+        nodes[nodeIndex].particlesOffset = start;
+        nodes[nodeIndex].nParticles = end - start;
+        return nodeIndex;
+    }
+
+    // Partition particles using binned SAH, moving the split to the nearest
+    // block boundary so that leaves start at multiples of _BlockSize_
+    Bounds3f centroidBounds;
+    for (int i = start; i < end; ++i)
+        centroidBounds = Union(centroidBounds, p[order[i]]);
+    int dim = centroidBounds.MaximumExtent();
+    int nLeftBlocks = nBlocks / 2;
+    if (centroidBounds.pMax[dim] > centroidBounds.pMin[dim]) {
+        PBRT_CONSTEXPR int nBuckets = 12;
+        int count[nBuckets] = {0};
+        Bounds3f bucketBounds[nBuckets];
+        Float cMin = centroidBounds.pMin[dim],
+              cExtent = centroidBounds.pMax[dim] - cMin;
+        for (int i = start; i < end; ++i) {
+            int b = nBuckets * ((p[order[i]][dim] - cMin) / cExtent);
+            b = std::min(b, nBuckets - 1);
+            Vector3f extent(r[order[i]], r[order[i]], r[order[i]]);
+            ++count[b];
+            bucketBounds[b] =
+                Union(bucketBounds[b], Bounds3f(p[order[i]] - extent,
+                                                p[order[i]] + extent));
+        }
+        Float minCost = Infinity;
+        for (int i = 0; i < nBuckets - 1; ++i) {
+            Bounds3f b0, b1;
+            int count0 = 0, count1 = 0;
+            for (int j = 0; j <= i; ++j) {
+                b0 = Union(b0, bucketBounds[j]);
+                count0 += count[j];
+            }
+            for (int j = i + 1; j < nBuckets; ++j) {
+                b1 = Union(b1, bucketBounds[j]);
+                count1 += count[j];
+            }
+            if (count0 == 0 || count1 == 0) continue;
+            Float cost = count0 * b0.SurfaceArea() + count1 * b1.SurfaceArea();
+            if (cost < minCost) {
+                minCost = cost;
+                nLeftBlocks = Clamp((count0 + BlockSize / 2) / BlockSize, 1,
+                                    nBlocks - 1);
+            }
+        }
+    }
+    int mid = start + BlockSize * nLeftBlocks;
+    std::nth_element(&order[start], &order[mid], &order[end - 1] + 1,
+                     [&](int a, int b) { return p[a][dim] < p[b][dim]; });
+
+    // Create interior _Node_; its first child immediately follows it
+    BuildBVH(order, p, r, start, mid);
+    int secondChild = BuildBVH(order, p, r, mid, end);
+    nodes[nodeIndex].bounds =
+        Union(nodes[nodeIndex + 1].bounds, nodes[secondChild].bounds);
+    nodes[nodeIndex].secondChildOffset = secondChild;
+    nodes[nodeIndex].nParticles = 0;
+    nodes[nodeIndex].axis = dim;
+    return nodeIndex;
+}
+
+Bounds3f Particles::ObjectBound() const {
+    return nodes.empty() ? Bounds3f() : nodes[0].bounds;
+}
+
+template <typename Func>
+void Particles::Traverse(const Ray &ray, Func func) const {
+    // Visit the leaves that _ray_ passes through until _func_ returns true
+    if (nodes.empty()) return;
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    int nodesToVisit[64];
+    int toVisitOffset = 0, currentNodeIndex = 0;
+    while (true) {
+        const Node &node = nodes[currentNodeIndex];
+        if (node.bounds.IntersectP(ray, invDir, dirIsNeg)) {
+            if (node.nParticles > 0) {
+                if (func(node)) return;
+                if (toVisitOffset == 0) break;
+                currentNodeIndex = nodesToVisit[--toVisitOffset];
+            } else {
+                if (dirIsNeg[node.axis]) {
+                    nodesToVisit[toVisitOffset++] = currentNodeIndex + 1;
+                    currentNodeIndex = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset++] = node.secondChildOffset;
+                    currentNodeIndex = currentNodeIndex + 1;
+                }
+            }
+        } else {
+            if (toVisitOffset == 0) break;
+            currentNodeIndex = nodesToVisit[--toVisitOffset];
+        }
+    }
+}
+
+int Particles::IntersectBlock(const Ray &ray, const Vector3f &invDir,
+                              const Vector3f &oErr, const Vector3f &dErr,
+                              const Node &node, Float *tHit) const {
+    // Cull spheres whose bounding slabs the ray misses, for the whole block
+    // at once; NaNs from zero direction components leave spheres uncull
+    const Vector3f &d = ray.d;
+    const int offset = node.particlesOffset;
+    bool maybeHits[BlockSize];
+    for (int i = 0; i < BlockSize; ++i) {
+        Float tMin = 0, tMax = ray.tMax;
+        const Float *c[3] = {&cx[offset + i], &cy[offset + i], &cz[offset + i]};
+        for (int axis = 0; axis < 3; ++axis) {
+            Float tCenter = (*c[axis] - ray.o[axis]) * invDir[axis];
+            Float tRadius = radius[offset + i] * std::abs(invDir[axis]);
+            Float tPad = gamma(3) * (std::abs(tCenter) + tRadius);
+            tMin = std::max(tMin, tCenter - tRadius - tPad);
+            tMax = std::min(tMax, tCenter + tRadius + tPad);
+        }
+        maybeHits[i] = tMin <= tMax;
+    }
+
+    // Solve the remaining spheres' quadratics in plain floating point
+    Float tHits[BlockSize];
+    bool hits[BlockSize], degenerate[BlockSize];
+    for (int i = 0; i < BlockSize; ++i) {
+        hits[i] = degenerate[i] = false;
+        if (!maybeHits[i]) continue;
+        // Find the ray origin relative to the sphere's center
+        Vector3f f(ray.o.x - cx[offset + i], ray.o.y - cy[offset + i],
+                   ray.o.z - cz[offset + i]);
+        Vector3f fErr = oErr + gamma(1) * Abs(f);
+        Float t0, t1, t0Err, t1Err;
+        if (!RadialQuadratic<3>(f, fErr, d, dErr, radius[offset + i], &t0, &t1,
+                                &t0Err, &t1Err, &degenerate[i]))
+            continue;
+
+        // Check _t0_ and _t1_ for the nearest intersection, as _Sphere_ does
+        if (NextFloatUp(t0 + t0Err) > ray.tMax ||
+            NextFloatDown(t1 - t1Err) <= 0)
+            continue;
+        bool useT1 = NextFloatDown(t0 - t0Err) <= 0;
+        tHits[i] = useT1 ? t1 : t0;
+        hits[i] = NextFloatUp(tHits[i] + (useT1 ? t1Err : t0Err)) <= ray.tMax;
+    }
+
+    // Find the closest hit, solving again with _EFloat_ arithmetic where the
+    // discriminant was too close to zero
+    int hitParticle = -1;
+    *tHit = ray.tMax;
+    nTests += node.nParticles;
+    for (int i = 0; i < node.nParticles; ++i) {
+        if (degenerate[i]) {
+            ++nEFloatTests;
+            Float r = radius[offset + i];
+            Vector3f f(ray.o.x - cx[offset + i], ray.o.y - cy[offset + i],
+                       ray.o.z - cz[offset + i]);
+            Vector3f fErr = oErr + gamma(1) * Abs(f);
+            EFloat fx(f.x, fErr.x), fy(f.y, fErr.y), fz(f.z, fErr.z);
+            EFloat dx(d.x, dErr.x), dy(d.y, dErr.y), dz(d.z, dErr.z);
+            EFloat t0, t1;
+            if (!Quadratic(dx * dx + dy * dy + dz * dz,
+                           2 * (dx * fx + dy * fy + dz * fz),
+                           fx * fx + fy * fy + fz * fz - EFloat(r) * EFloat(r),
+                           &t0, &t1))
+                continue;
+            if (t0.UpperBound() > ray.tMax || t1.LowerBound() <= 0) continue;
+            EFloat t = t0.LowerBound() <= 0 ? t1 : t0;
+            if (t.UpperBound() > ray.tMax) continue;
+            hits[i] = true;
+            tHits[i] = (Float)t;
+        }
+        if (hits[i] && (hitParticle == -1 || tHits[i] < *tHit)) {
+            hitParticle = offset + i;
+            *tHit = tHits[i];
+        }
+    }
+    if (hitParticle != -1) ++nHits;
+    return hitParticle;
+}
+
+bool Particles::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
+                          bool testAlphaTexture) const {
+    ProfilePhase p(Prof::ShapeIntersect);
+    // Transform _Ray_ to object space
+    Vector3f oErr, dErr;
+    Ray ray = (*WorldToObject)(r, &oErr, &dErr);
+
+    // Find the closest particle along the ray
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int hitParticle = -1;
+    Traverse(ray, [&](const Node &node) {
+        Float t;
+        int particle = IntersectBlock(ray, invDir, oErr, dErr, node, &t);
+        if (particle != -1) {
+            hitParticle = particle;
+            ray.tMax = t;
+        }
+        return false;
+    });
+    if (hitParticle == -1) return false;
+
+    // Compute the hit position relative to the particle's center and refine
+    // it to lie on the sphere
+    Point3f center(cx[hitParticle], cy[hitParticle], cz[hitParticle]);
+    Float rad = radius[hitParticle];
+    Vector3f pHit = ray(ray.tMax) - center;
+    pHit *= rad / pHit.Length();
+    if (pHit.x == 0 && pHit.y == 0) pHit.x = 1e-5f * rad;
+    Float phi = std::atan2(pHit.y, pHit.x);
+    if (phi < 0) phi += 2 * Pi;
+
+    // Find parametric representation of the hit, as for a full _Sphere_
+    const Float phiMax = 2 * Pi, thetaMin = Pi, thetaMax = 0;
+    Float u = phi / phiMax;
+    Float theta = std::acos(Clamp(pHit.z / rad, -1, 1));
+    Float v = (theta - thetaMin) / (thetaMax - thetaMin);
+
+    // Compute sphere $\dpdu$ and $\dpdv$
+    Float zRadius = std::sqrt(pHit.x * pHit.x + pHit.y * pHit.y);
+    Float invZRadius = 1 / zRadius;
+    Float cosPhi = pHit.x * invZRadius;
+    Float sinPhi = pHit.y * invZRadius;
+    Vector3f dpdu(-phiMax * pHit.y, phiMax * pHit.x, 0);
+    Vector3f dpdv =
+        (thetaMax - thetaMin) *
+        Vector3f(pHit.z * cosPhi, pHit.z * sinPhi, -rad * std::sin(theta));
+
+    // Compute sphere $\dndu$ and $\dndv$
+    Vector3f d2Pduu = -phiMax * phiMax * Vector3f(pHit.x, pHit.y, 0);
+    Vector3f d2Pduv =
+        (thetaMax - thetaMin) * pHit.z * phiMax * Vector3f(-sinPhi, cosPhi, 0.);
+    Vector3f d2Pdvv = -(thetaMax - thetaMin) * (thetaMax - thetaMin) * pHit;
+
+    // Compute coefficients for fundamental forms
+    Float E = Dot(dpdu, dpdu);
+    Float F = Dot(dpdu, dpdv);
+    Float G = Dot(dpdv, dpdv);
+    Vector3f N = Normalize(Cross(dpdu, dpdv));
+    Float e = Dot(N, d2Pduu);
+    Float f = Dot(N, d2Pduv);
+    Float g = Dot(N, d2Pdvv);
+
+    // Compute $\dndu$ and $\dndv$ from fundamental form coefficients
+    Float invEGF2 = 1 / (E * G - F * F);
+    Normal3f dndu = Normal3f((f * F - e * G) * invEGF2 * dpdu +
+                             (e * F - f * E) * invEGF2 * dpdv);
+    Normal3f dndv = Normal3f((g * F - f * G) * invEGF2 * dpdu +
+                             (f * F - g * E) * invEGF2 * dpdv);
+
+    // Compute error bounds for the hit, including offsetting by the center
+    Point3f pObj = center + pHit;
+    Vector3f pError = gamma(5) * Abs(pHit) + gamma(1) * Abs((Vector3f)pObj);
+
+    // Initialize _SurfaceInteraction_ from parametric information
+    *isect = (*ObjectToWorld)(SurfaceInteraction(pObj, pError, Point2f(u, v),
+                                                 -ray.d, dpdu, dpdv, dndu, dndv,
+                                                 ray.time, this));
+    *tHit = ray.tMax;
+    return true;
+}
+
+bool Particles::IntersectP(const Ray &r, bool testAlphaTexture) const {
+    ProfilePhase p(Prof::ShapeIntersectP);
+    // Transform _Ray_ to object space
+    Vector3f oErr, dErr;
+    Ray ray = (*WorldToObject)(r, &oErr, &dErr);
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    bool hit = false;
+    Traverse(ray, [&](const Node &node) {
+        Float t;
+        hit = IntersectBlock(ray, invDir, oErr, dErr, node, &t) != -1;
+        return hit;
+    });
+    return hit;
+}
+
+Interaction Particles::Sample(const Point2f &u, Float *pdf) const {
+    std::call_once(samplingInitialized, [&]() {
+        std::vector<Float> areas(nParticles);
+        for (int i = 0; i < nParticles; ++i)
+            areas[i] = radius[i] * radius[i];
+        particleDistrib.reset(new Distribution1D(areas.data(), nParticles));
+    });
+    // Choose a particle in proportion to its area
+    Float uRemapped;
+    int i = particleDistrib->SampleDiscrete(u[0], nullptr, &uRemapped);
+    Point3f center(cx[i], cy[i], cz[i]);
+    Vector3f pLocal = radius[i] * UniformSampleSphere(Point2f(uRemapped, u[1]));
+
+    Interaction it;
+    it.n = Normalize((*ObjectToWorld)(Normal3f(pLocal)));
+    if (reverseOrientation) it.n *= -1;
+    Point3f pObj = center + pLocal;
+    Vector3f pObjError =
+        gamma(5) * Abs(pLocal) + gamma(1) * Abs((Vector3f)pObj);
+    it.p = (*ObjectToWorld)(pObj, pObjError, &it.pError);
+    *pdf = 1 / area;
+    return it;
+}
+
+std::vector<std::shared_ptr<Shape>> CreateParticles(
+    const Transform *ObjectToWorld, const Transform *WorldToObject,
+    bool reverseOrientation, const ParamSet &params) {
+    int nParticles;
+    const Point3f *P = params.FindPoint3f("P", &nParticles);
+    if (!P) {
+        Error("\"P\" parameter must be provided with particles shape.");
+        return std::vector<std::shared_ptr<Shape>>();
+    }
+    // Particles may all share one radius or each have their own
+    int nRadii;
+    const Float *radii = params.FindFloat("radius", &nRadii);
+    std::vector<Float> r;
+    if (!radii || nRadii == 1)
+        r.assign(nParticles, radii ? radii[0] : 1.f);
+    else if (nRadii == nParticles)
+        r.assign(radii, radii + nParticles);
+    else {
+        Error("Number of \"radius\" values for particles (%d) doesn't match "
+              "the number of \"P\"s (%d).", nRadii, nParticles);
+        return std::vector<std::shared_ptr<Shape>>();
+    }
+    return {std::make_shared<Particles>(ObjectToWorld, WorldToObject,
+                                        reverseOrientation, nParticles, P,
+                                        r.data())};
+}
+
+}  // namespace pbrt
@@ -0,0 +1,109 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_SHAPES_PARTICLES_H
+#define PBRT_SHAPES_PARTICLES_H
+
+// shapes/particles.h*
+#include "shape.h"
+#include "sampling.h"
+#include <mutex>
+
+namespace pbrt {
+
+// Particles Declarations
+// A set of full spheres given by object-space centers and radii and
+// intersected as a single shape. The spheres are stored as separate
+// coordinate and radius arrays, in the order of an internal BVH whose
+// leaves are blocks of _BlockSize_ spheres, so that the ray-sphere tests
+// for a leaf run together over contiguous data.
+class Particles : public Shape {
+  public:
+    // Particles Public Methods
+    Particles(const Transform *ObjectToWorld, const Transform *WorldToObject,
+              bool reverseOrientation, int nParticles, const Point3f *P,
+              const Float *radii);
+    Bounds3f ObjectBound() const;
+    bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
+                   bool testAlphaTexture) const;
+    bool IntersectP(const Ray &ray, bool testAlphaTexture) const;
+    Float Area() const { return area; }
+
+    using Shape::Sample;  // Bring in the other Sample() overload.
+    Interaction Sample(const Point2f &u, Float *pdf) const;
+    static PBRT_CONSTEXPR int BlockSize = 8;
+
+  private:
+    // Particles Private Types
+    struct Node {
+        Bounds3f bounds;
+        union {
+            int particlesOffset;    // leaf
+            int secondChildOffset;  // interior
+        };
+        uint8_t nParticles;  // 0 -> interior node
+        uint8_t axis;        // interior node: xyz
+    };
+
+    // Particles Private Methods
+    int BuildBVH(std::vector<int> &order, const std::vector<Point3f> &p,
+                 const std::vector<Float> &r, int start, int end);
+    template <typename Func>
+    void Traverse(const Ray &ray, Func func) const;
+    int IntersectBlock(const Ray &ray, const Vector3f &invDir,
+                       const Vector3f &oErr, const Vector3f &dErr,
+                       const Node &node, Float *tHit) const;
+
+    // Particles Private Data
+    const int nParticles;
+    // Centers and radii in BVH order, padded to a multiple of _BlockSize_
+    std::vector<Float> cx, cy, cz, radius;
+    std::vector<Node> nodes;
+    Float area;
+    // Particle areas, computed the first time the particles are sampled
+    mutable std::once_flag samplingInitialized;
+    mutable std::unique_ptr<Distribution1D> particleDistrib;
+};
+
+std::vector<std::shared_ptr<Shape>> CreateParticles(const Transform *o2w,
+                                                    const Transform *w2o,
+                                                    bool reverseOrientation,
+                                                    const ParamSet &params);
+
+}  // namespace pbrt
+
+#endif  // PBRT_SHAPES_PARTICLES_H
@@ -31,23 +31,31 @@
  */
 
 
+
 // shapes/plymesh.cpp*
+#include "shapes/plymesh.h"
 #include "shapes/triangle.h"
 #include "textures/constant.h"
 #include "paramset.h"
+#include "fileutil.h"
+#include "stats.h"
 #include "ext/rply.h"
 
 #include <iostream>
+#include <mutex>
+#include <sstream>
 
 namespace pbrt {
 using namespace std;
 
+STAT_COUNTER("Scene/PLY files read", nPLYFilesRead);
+STAT_COUNTER("Scene/PLY files read via RPly", nPLYFilesRPly);
+
 struct CallbackContext {
     Point3f *p;
     Normal3f *n;
     Point2f *uv;
-    int *indices;
-    int indexCtr;
+    std::vector<int> *indices;
     int face[4];
     bool error;
     int vertexCount;
@@ -57,16 +65,8 @@ struct CallbackContext {
           n(nullptr),
           uv(nullptr),
           indices(nullptr),
-          indexCtr(0),
           error(false),
           vertexCount(0) {}
-
-    ~CallbackContext() {
-        delete[] p;
-        delete[] n;
-        delete[] uv;
-        delete[] indices;
-    }
 };
 
 void rply_message_callback(p_ply ply, const char *message) {
@@ -124,33 +124,32 @@ int rply_face_callback(p_ply_argument argument) {
     }
 
     if (value_index == length - 1) {
-        for (int i = 0; i < 3; ++i)
-            context->indices[context->indexCtr++] = context->face[i];
+        std::vector<int> &indices = *context->indices;
+        for (int i = 0; i < 3; ++i) indices.push_back(context->face[i]);
 
         if (length == 4) {
             /* This was a quad */
-            context->indices[context->indexCtr++] = context->face[3];
-            context->indices[context->indexCtr++] = context->face[0];
-            context->indices[context->indexCtr++] = context->face[2];
+            indices.push_back(context->face[3]);
+            indices.push_back(context->face[0]);
+            indices.push_back(context->face[2]);
         }
     }
     return 1;
 }
 
-std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
-    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
-    const ParamSet &params,
-    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures) {
-    const std::string filename = params.FindOneFilename("filename", "");
+static bool ReadPLYMeshRPly(const std::string &filename, PLYMeshData *mesh) {
+    ++nPLYFilesRPly;
+    *mesh = PLYMeshData();
     p_ply ply = ply_open(filename.c_str(), rply_message_callback, 0, nullptr);
     if (!ply) {
         Error("Couldn't open PLY file \"%s\"", filename.c_str());
-        return std::vector<std::shared_ptr<Shape>>();
+        return false;
     }
 
     if (!ply_read_header(ply)) {
         Error("Unable to read the header of PLY file \"%s\"", filename.c_str());
-        return std::vector<std::shared_ptr<Shape>>();
+        ply_close(ply);
+        return false;
     }
 
     p_ply_element element = nullptr;
@@ -171,7 +170,8 @@ std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
     if (vertexCount == 0 || faceCount == 0) {
         Error("PLY file \"%s\" is invalid! No face/vertex elements found!",
               filename.c_str());
-        return std::vector<std::shared_ptr<Shape>>();
+        ply_close(ply);
+        return false;
     }
 
     CallbackContext context;
@@ -182,11 +182,13 @@ std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
                         0x031) &&
         ply_set_read_cb(ply, "vertex", "z", rply_vertex_callback, &context,
                         0x032)) {
-        context.p = new Point3f[vertexCount];
+        mesh->p.resize(vertexCount);
+        context.p = mesh->p.data();
     } else {
         Error("PLY file \"%s\": Vertex coordinate property not found!",
               filename.c_str());
-        return std::vector<std::shared_ptr<Shape>>();
+        ply_close(ply);
+        return false;
     }
 
     if (ply_set_read_cb(ply, "vertex", "nx", rply_vertex_callback, &context,
@@ -194,8 +196,10 @@ std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
         ply_set_read_cb(ply, "vertex", "ny", rply_vertex_callback, &context,
                         0x131) &&
         ply_set_read_cb(ply, "vertex", "nz", rply_vertex_callback, &context,
-                        0x132))
-        context.n = new Normal3f[vertexCount];
+                        0x132)) {
+        mesh->n.resize(vertexCount);
+        context.n = mesh->n.data();
+    }
 
     /* There seem to be lots of different conventions regarding UV coordinate
      * names */
@@ -214,11 +218,14 @@ std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
         (ply_set_read_cb(ply, "vertex", "texture_s", rply_vertex_callback,
                          &context, 0x220) &&
          ply_set_read_cb(ply, "vertex", "texture_t", rply_vertex_callback,
-                         &context, 0x221)))
-        context.uv = new Point2f[vertexCount];
+                         &context, 0x221))) {
+        mesh->uv.resize(vertexCount);
+        context.uv = mesh->uv.data();
+    }
 
-    /* Allocate enough space in case all faces are quads */
-    context.indices = new int[faceCount * 6];
+    /* Reserve enough space for the case where all faces are triangles */
+    mesh->indices.reserve(faceCount * 3);
+    context.indices = &mesh->indices;
     context.vertexCount = vertexCount;
 
     ply_set_read_cb(ply, "face", "vertex_indices", rply_face_callback, &context,
@@ -228,12 +235,477 @@ std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
         Error("Unable to read the contents of PLY file \"%s\"",
               filename.c_str());
         ply_close(ply);
-        return std::vector<std::shared_ptr<Shape>>();
+        return false;
     }
 
     ply_close(ply);
+    return !context.error;
+}
+
+// Native PLY Reader Definitions
+enum class PLYType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float, Double };
+
+struct PLYProperty {
+    std::string name;
+    PLYType type;
+    // List properties store a count of type _countType_ followed by that
+    // many values of type _type_
+    bool isList;
+    PLYType countType;
+    // Byte offset within the element for elements without lists
+    int offset;
+};
+
+struct PLYElement {
+    std::string name;
+    size_t count;
+    std::vector<PLYProperty> properties;
+    // Size in bytes of each element, or -1 if it has list properties
+    int size;
+
+    const PLYProperty *Find(const char *propName) const {
+        for (const PLYProperty &prop : properties)
+            if (prop.name == propName) return &prop;
+        return nullptr;
+    }
+};
+
+static bool ParsePLYType(const std::string &name, PLYType *type) {
+    static const struct {
+        const char *name;
+        PLYType type;
+    } types[] = {{"char", PLYType::Int8},     {"int8", PLYType::Int8},
+                 {"uchar", PLYType::UInt8},   {"uint8", PLYType::UInt8},
+                 {"short", PLYType::Int16},   {"int16", PLYType::Int16},
+                 {"ushort", PLYType::UInt16}, {"uint16", PLYType::UInt16},
+                 {"int", PLYType::Int32},     {"int32", PLYType::Int32},
+                 {"uint", PLYType::UInt32},   {"uint32", PLYType::UInt32},
+                 {"float", PLYType::Float},   {"float32", PLYType::Float},
+                 {"double", PLYType::Double}, {"float64", PLYType::Double}};
+    for (const auto &t : types)
+        if (name == t.name) {
+            *type = t.type;
+            return true;
+        }
+    return false;
+}
+
+static int PLYTypeSize(PLYType type) {
+    switch (type) {
+    case PLYType::Int8:
+    case PLYType::UInt8:
+        return 1;
+    case PLYType::Int16:
+    case PLYType::UInt16:
+        return 2;
+    case PLYType::Int32:
+    case PLYType::UInt32:
+    case PLYType::Float:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
+template <typename T>
+inline T LoadUnaligned(const char *ptr) {
+    T v;
+    memcpy(&v, ptr, sizeof(T));
+    return v;
+}
+
+static double LoadPLYValue(const char *ptr, PLYType type) {
+    switch (type) {
+    case PLYType::Int8:
+        return LoadUnaligned<int8_t>(ptr);
+    case PLYType::UInt8:
+        return LoadUnaligned<uint8_t>(ptr);
+    case PLYType::Int16:
+        return LoadUnaligned<int16_t>(ptr);
+    case PLYType::UInt16:
+        return LoadUnaligned<uint16_t>(ptr);
+    case PLYType::Int32:
+        return LoadUnaligned<int32_t>(ptr);
+    case PLYType::UInt32:
+        return LoadUnaligned<uint32_t>(ptr);
+    case PLYType::Float:
+        return LoadUnaligned<float>(ptr);
+    default:
+        return LoadUnaligned<double>(ptr);
+    }
+}
+
+// Parses the header of a binary little-endian PLY file, returning false if
+// the file isn't one or the header can't be handled here.
+static bool ParsePLYHeader(const MappedFile &file,
+                           std::vector<PLYElement> *elements,
+                           const char **body) {
+    const char *ptr = file.Data(), *end = file.Data() + file.Size();
+    auto nextLine = [&](std::string *line) {
+        const char *eol = (const char *)memchr(ptr, '\n', end - ptr);
+        if (!eol) return false;
+        line->assign(ptr, eol);
+        if (!line->empty() && line->back() == '\r') line->pop_back();
+        ptr = eol + 1;
+        return true;
+    };
+    std::string line;
+    if (!nextLine(&line) || line != "ply") return false;
+    while (nextLine(&line)) {
+        std::istringstream in(line);
+        std::string keyword;
+        in >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            in >> format;
+            if (format != "binary_little_endian") return false;
+        } else if (keyword == "element") {
+            PLYElement elem;
+            if (!(in >> elem.name >> elem.count)) return false;
+            elem.size = 0;
+            elements->push_back(elem);
+        } else if (keyword == "property") {
+            if (elements->empty()) return false;
+            PLYElement &elem = elements->back();
+            PLYProperty prop;
+            std::string type;
+            in >> type;
+            prop.isList = (type == "list");
+            if (prop.isList) {
+                std::string countType;
+                in >> countType >> type;
+                if (!ParsePLYType(countType, &prop.countType)) return false;
+            }
+            if (!ParsePLYType(type, &prop.type) || !(in >> prop.name))
+                return false;
+            prop.offset = elem.size;
+            if (prop.isList)
+                elem.size = -1;
+            else if (elem.size >= 0)
+                elem.size += PLYTypeSize(prop.type);
+            elem.properties.push_back(prop);
+        } else if (keyword == "end_header") {
+            *body = ptr;
+            return true;
+        } else if (keyword != "comment" && keyword != "obj_info")
+            return false;
+    }
+    return false;
+}
+
+template <typename T>
+static void ConvertStrided(const char *src, size_t count, int srcStride,
+                           Float *dst, int dstStride) {
+    for (size_t i = 0; i < count; ++i)
+        dst[i * dstStride] = Float(LoadUnaligned<T>(src + i * srcStride));
+}
+
+// Copies _nComponents_ scalar vertex properties to _dst_, which has that
+// many _Float_s per vertex.
+static void ReadPLYVertexProperties(const PLYElement &elem, const char *data,
+                                    const PLYProperty *props[],
+                                    int nComponents, Float *dst) {
+    // Use bulk copies if the properties are consecutive _Float_s
+    bool contiguous = true;
+    for (int c = 0; c < nComponents; ++c)
+        contiguous &=
+            (sizeof(Float) == 4 ? props[c]->type == PLYType::Float
+                                : props[c]->type == PLYType::Double) &&
+            props[c]->offset == props[0]->offset + c * int(sizeof(Float));
+    size_t rowSize = nComponents * sizeof(Float);
+    if (contiguous && size_t(elem.size) == rowSize) {
+        memcpy(dst, data, elem.count * rowSize);
+        return;
+    }
+    if (contiguous) {
+        const char *src = data + props[0]->offset;
+        for (size_t i = 0; i < elem.count; ++i)
+            memcpy(dst + i * nComponents, src + i * elem.size, rowSize);
+        return;
+    }
+
+    // Convert each property with a strided loop
+    for (int c = 0; c < nComponents; ++c) {
+        const char *src = data + props[c]->offset;
+        Float *d = dst + c;
+        switch (props[c]->type) {
+        case PLYType::Int8:
+            ConvertStrided<int8_t>(src, elem.count, elem.size, d, nComponents);
+            break;
+        case PLYType::UInt8:
+            ConvertStrided<uint8_t>(src, elem.count, elem.size, d, nComponents);
+            break;
+        case PLYType::Int16:
+            ConvertStrided<int16_t>(src, elem.count, elem.size, d, nComponents);
+            break;
+        case PLYType::UInt16:
+            ConvertStrided<uint16_t>(src, elem.count, elem.size, d,
+                                     nComponents);
+            break;
+        case PLYType::Int32:
+            ConvertStrided<int32_t>(src, elem.count, elem.size, d, nComponents);
+            break;
+        case PLYType::UInt32:
+            ConvertStrided<uint32_t>(src, elem.count, elem.size, d,
+                                     nComponents);
+            break;
+        case PLYType::Float:
+            ConvertStrided<float>(src, elem.count, elem.size, d, nComponents);
+            break;
+        case PLYType::Double:
+            ConvertStrided<double>(src, elem.count, elem.size, d, nComponents);
+            break;
+        }
+    }
+}
+
+// Finds the properties named _names_ or one of the given alternatives,
+// returning false if none of the alternatives are present.
+static bool FindPLYProperties(const PLYElement &elem,
+                              std::initializer_list<const char *> names,
+                              int nComponents, const PLYProperty *props[]) {
+    for (auto iter = names.begin(); iter != names.end();
+         iter += nComponents) {
+        bool found = true;
+        for (int c = 0; c < nComponents; ++c)
+            found &= (props[c] = elem.Find(iter[c])) != nullptr;
+        if (found) return true;
+    }
+    return false;
+}
+
+static bool ReadPLYVertices(const std::string &filename,
+                            const PLYElement &elem, const char *data,
+                            PLYMeshData *mesh) {
+    const PLYProperty *props[3];
+    if (!FindPLYProperties(elem, {"x", "y", "z"}, 3, props)) {
+        Error("PLY file \"%s\": Vertex coordinate property not found!",
+              filename.c_str());
+        return false;
+    }
+    static_assert(sizeof(Point3f) == 3 * sizeof(Float) &&
+                      sizeof(Normal3f) == 3 * sizeof(Float) &&
+                      sizeof(Point2f) == 2 * sizeof(Float),
+                  "Vertex types must be tightly packed");
+    mesh->p.resize(elem.count);
+    ReadPLYVertexProperties(elem, data, props, 3, &mesh->p[0].x);
+    if (FindPLYProperties(elem, {"nx", "ny", "nz"}, 3, props)) {
+        mesh->n.resize(elem.count);
+        ReadPLYVertexProperties(elem, data, props, 3, &mesh->n[0].x);
+    }
+    // There seem to be lots of different conventions regarding UV
+    // coordinate names
+    if (FindPLYProperties(elem,
+                          {"u", "v", "s", "t", "texture_u", "texture_v",
+                           "texture_s", "texture_t"},
+                          2, props)) {
+        mesh->uv.resize(elem.count);
+        ReadPLYVertexProperties(elem, data, props, 2, &mesh->uv[0].x);
+    }
+    return true;
+}
+
+// Reads the faces in _elem_ starting at _*ptr_, which is advanced past
+// them, taking vertex indices from _indexProp_. Returns false if the data
+// is truncated.
+static bool ReadPLYFaces(const PLYElement &elem, const PLYProperty *indexProp,
+                         const char **ptr, const char *end, PLYMeshData *mesh,
+                         size_t *nIgnored) {
+    if (indexProp) mesh->indices.reserve(mesh->indices.size() + 3 * elem.count);
+    const char *p = *ptr;
+    auto addFace = [&](const int *v, int n) {
+        if (n == 3)
+            mesh->indices.insert(mesh->indices.end(), v, v + 3);
+        else if (n == 4)
+            mesh->indices.insert(mesh->indices.end(),
+                                 {v[0], v[1], v[2], v[3], v[0], v[2]});
+        else
+            ++*nIgnored;
+    };
+
+    if (indexProp && elem.properties.size() == 1 &&
+        indexProp->countType == PLYType::UInt8 &&
+        (indexProp->type == PLYType::Int32 ||
+         indexProp->type == PLYType::UInt32)) {
+        // Read the common layout of byte counts and 32-bit indices directly
+        for (size_t f = 0; f < elem.count; ++f) {
+            if (p >= end) return false;
+            int n = uint8_t(*p++);
+            if (size_t(end - p) < 4 * size_t(n)) return false;
+            int v[4];
+            if (n <= 4) memcpy(v, p, 4 * n);
+            addFace(v, n);
+            p += 4 * n;
+        }
+        *ptr = p;
+        return true;
+    }
+
+    // Walk through each face's properties
+    for (size_t f = 0; f < elem.count; ++f) {
+        for (const PLYProperty &prop : elem.properties) {
+            int size = PLYTypeSize(prop.type);
+            if (!prop.isList) {
+                if (end - p < size) return false;
+                p += size;
+                continue;
+            }
+            int countSize = PLYTypeSize(prop.countType);
+            if (end - p < countSize) return false;
+            int64_t n = int64_t(LoadPLYValue(p, prop.countType));
+            p += countSize;
+            if (n < 0 || (end - p) / size < n) return false;
+            if (&prop == indexProp) {
+                int v[4];
+                for (int i = 0; i < std::min<int64_t>(n, 4); ++i)
+                    v[i] = int(LoadPLYValue(p + i * size, prop.type));
+                addFace(v, int(n));
+            }
+            p += n * size;
+        }
+    }
+    *ptr = p;
+    return true;
+}
 
-    if (context.error) return std::vector<std::shared_ptr<Shape>>();
+bool ReadPLYMesh(const std::string &filename, PLYMeshData *mesh) {
+    *mesh = PLYMeshData();
+    MappedFile file(filename);
+    if (!file.IsValid()) {
+        Error("Couldn't open PLY file \"%s\"", filename.c_str());
+        return false;
+    }
+    uint16_t one = 1;
+    bool littleEndian = *(const uint8_t *)&one == 1;
+    std::vector<PLYElement> elements;
+    const char *ptr;
+    if (!littleEndian || !ParsePLYHeader(file, &elements, &ptr))
+        return ReadPLYMeshRPly(filename, mesh);
+    ++nPLYFilesRead;
+
+    const char *end = file.Data() + file.Size();
+    bool haveVertices = false, haveFaces = false;
+    size_t nIgnored = 0;
+    for (const PLYElement &elem : elements) {
+        if (elem.name == "face") {
+            const PLYProperty *indexProp = elem.Find("vertex_indices");
+            if (!indexProp) indexProp = elem.Find("vertex_index");
+            haveFaces = elem.count > 0 && indexProp;
+            if (!ReadPLYFaces(elem, indexProp, &ptr, end, mesh, &nIgnored)) {
+                ptr = nullptr;
+                break;
+            }
+            continue;
+        }
+        if (elem.size < 0) {
+            // Skip over an element with lists that we don't use
+            if (elem.name == "vertex") return ReadPLYMeshRPly(filename, mesh);
+            if (!ReadPLYFaces(elem, nullptr, &ptr, end, nullptr, &nIgnored)) {
+                ptr = nullptr;
+                break;
+            }
+            continue;
+        }
+        if (size_t(end - ptr) / std::max(elem.size, 1) < elem.count) {
+            ptr = nullptr;
+            break;
+        }
+        if (elem.name == "vertex" && elem.count > 0) {
+            haveVertices = true;
+            if (!ReadPLYVertices(filename, elem, ptr, mesh)) return false;
+        }
+        ptr += elem.count * elem.size;
+    }
+    if (!ptr) {
+        Error("Unable to read the contents of PLY file \"%s\"",
+              filename.c_str());
+        return false;
+    }
+    if (!haveVertices || !haveFaces) {
+        Error("PLY file \"%s\" is invalid! No face/vertex elements found!",
+              filename.c_str());
+        return false;
+    }
+    if (nIgnored > 0)
+        Warning(
+            "plymesh: Ignoring %zu faces in \"%s\" that aren't triangles or "
+            "quads",
+            nIgnored, filename.c_str());
+
+    // Check that all vertex indices are valid
+    int nVertices = mesh->p.size();
+    for (int v : mesh->indices)
+        if (v < 0 || v >= nVertices) {
+            Error(
+                "plymesh: Vertex reference %i is out of bounds! "
+                "Valid range is [0..%i)",
+                v, nVertices);
+            return false;
+        }
+    return true;
+}
+
+// PLY files used by more than one shape; see SharePLYMeshes()
+struct SharedPLYMesh {
+    std::mutex mutex;
+    bool read = false;
+    // nullptr if the file couldn't be read
+    std::shared_ptr<PLYMeshData> mesh;
+    // Number of pending CreatePLYMesh() calls for the file
+    int uses = 0;
+};
+static std::mutex sharedMeshesMutex;
+static std::map<std::string, std::shared_ptr<SharedPLYMesh>> sharedMeshes;
+
+void SharePLYMeshes(const std::vector<std::string> &filenames) {
+    std::map<std::string, int> uses;
+    for (const std::string &fn : filenames) ++uses[fn];
+    std::lock_guard<std::mutex> lock(sharedMeshesMutex);
+    for (const auto &u : uses) {
+        if (u.second < 2) continue;
+        std::shared_ptr<SharedPLYMesh> &shared = sharedMeshes[u.first];
+        if (!shared) shared = std::make_shared<SharedPLYMesh>();
+        shared->uses += u.second;
+    }
+}
+
+void ReleaseSharedPLYMeshes() {
+    std::lock_guard<std::mutex> lock(sharedMeshesMutex);
+    sharedMeshes.clear();
+}
+
+std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
+    const Transform *o2w, const Transform *w2o, bool reverseOrientation,
+    const ParamSet &params,
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    std::shared_ptr<TriangleMesh> *compressedMesh) {
+    const std::string filename = params.FindOneFilename("filename", "");
+
+    // Read the file, or find its contents if it's shared with other shapes
+    std::shared_ptr<SharedPLYMesh> shared;
+    {
+        std::lock_guard<std::mutex> lock(sharedMeshesMutex);
+        auto iter = sharedMeshes.find(filename);
+        if (iter != sharedMeshes.end()) {
+            shared = iter->second;
+            if (--shared->uses == 0) sharedMeshes.erase(iter);
+        }
+    }
+    std::shared_ptr<PLYMeshData> mesh;
+    if (shared) {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        if (!shared->read) {
+            shared->mesh = std::make_shared<PLYMeshData>();
+            if (!ReadPLYMesh(filename, shared->mesh.get()))
+                shared->mesh = nullptr;
+            shared->read = true;
+        }
+        mesh = shared->mesh;
+    } else {
+        mesh = std::make_shared<PLYMeshData>();
+        if (!ReadPLYMesh(filename, mesh.get())) mesh = nullptr;
+    }
+    if (!mesh) return std::vector<std::shared_ptr<Shape>>();
 
     // Look up an alpha texture, if applicable
     std::shared_ptr<Texture<Float>> alphaTex;
@@ -261,10 +733,12 @@ std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
     } else if (params.FindOneFloat("shadowalpha", 1.f) == 0.f)
         shadowAlphaTex.reset(new ConstantTexture<Float>(0.f));
 
-    return CreateTriangleMesh(o2w, w2o, reverseOrientation,
-                              context.indexCtr / 3, context.indices,
-                              vertexCount, context.p, nullptr, context.n,
-                              context.uv, alphaTex, shadowAlphaTex);
+    return CreateTriangleMesh(
+        o2w, w2o, reverseOrientation, mesh->indices.size() / 3,
+        mesh->indices.data(), mesh->p.size(), mesh->p.data(), nullptr,
+        mesh->n.empty() ? nullptr : mesh->n.data(),
+        mesh->uv.empty() ? nullptr : mesh->uv.data(), alphaTex,
+        shadowAlphaTex, 1, 0, 1, compressedMesh);
 }
 
 }  // namespace pbrt
@@ -43,11 +43,34 @@
 
 namespace pbrt {
 
+// PLYMeshData Declarations
+struct PLYMeshData {
+    std::vector<Point3f> p;
+    std::vector<Normal3f> n;
+    std::vector<Point2f> uv;
+    // Triangle vertex indices; quads are split into two triangles
+    std::vector<int> indices;
+};
+
+// Reads the vertices and faces of the given PLY file into _mesh_, returning
+// false on failure. Binary little-endian files are read directly from a
+// memory mapping; other encodings go through RPly.
+bool ReadPLYMesh(const std::string &filename, PLYMeshData *mesh);
+
+// Records that CreatePLYMesh() will be called for each of the given files,
+// so that files used by more than one shape are read just once. Their
+// contents are kept from the first of those calls until the last one or
+// until ReleaseSharedPLYMeshes() is called; other files are read by
+// CreatePLYMesh() and released as soon as their mesh has been created.
+void SharePLYMeshes(const std::vector<std::string> &filenames);
+void ReleaseSharedPLYMeshes();
+
 std::vector<std::shared_ptr<Shape>> CreatePLYMesh(
     const Transform *o2w, const Transform *w2o, bool reverseOrientation,
     const ParamSet &params,
     std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures =
-        nullptr);
+        nullptr,
+    std::shared_ptr<TriangleMesh> *compressedMesh = nullptr);
 
 }  // namespace pbrt
 
@@ -46,6 +46,31 @@ Bounds3f Sphere::ObjectBound() const {
                     Point3f(radius, radius, zMax));
 }
 
+// Solves for the _t_ values where the object-space ray meets the
+// sphere, falling back to _EFloat_ arithmetic only where the plain
+// floating-point solve can't bound its error.
+static bool SphereQuadratic(const Ray &ray, const Vector3f &oErr,
+                            const Vector3f &dErr, Float radius, EFloat *t0,
+                            EFloat *t1) {
+    Float tf0, tf1, t0Err, t1Err;
+    bool degenerate;
+    if (RadialQuadratic<3>(ray.o, oErr, ray.d, dErr, radius, &tf0, &tf1,
+                           &t0Err, &t1Err, &degenerate)) {
+        *t0 = EFloat(tf0, t0Err);
+        *t1 = EFloat(tf1, t1Err);
+        return true;
+    }
+    if (!degenerate) return false;
+
+    // Initialize _EFloat_ ray coordinate values
+    EFloat ox(ray.o.x, oErr.x), oy(ray.o.y, oErr.y), oz(ray.o.z, oErr.z);
+    EFloat dx(ray.d.x, dErr.x), dy(ray.d.y, dErr.y), dz(ray.d.z, dErr.z);
+    EFloat ea = dx * dx + dy * dy + dz * dz;
+    EFloat eb = 2 * (dx * ox + dy * oy + dz * oz);
+    EFloat ec = ox * ox + oy * oy + oz * oz - EFloat(radius) * EFloat(radius);
+    return Quadratic(ea, eb, ec, t0, t1);
+}
+
 bool Sphere::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
                        bool testAlphaTexture) const {
     ProfilePhase p(Prof::ShapeIntersect);
@@ -55,18 +80,9 @@ bool Sphere::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
     Vector3f oErr, dErr;
     Ray ray = (*WorldToObject)(r, &oErr, &dErr);
 
-    // Compute quadratic sphere coefficients
-
-    // Initialize _EFloat_ ray coordinate values
-    EFloat ox(ray.o.x, oErr.x), oy(ray.o.y, oErr.y), oz(ray.o.z, oErr.z);
-    EFloat dx(ray.d.x, dErr.x), dy(ray.d.y, dErr.y), dz(ray.d.z, dErr.z);
-    EFloat a = dx * dx + dy * dy + dz * dz;
-    EFloat b = 2 * (dx * ox + dy * oy + dz * oz);
-    EFloat c = ox * ox + oy * oy + oz * oz - EFloat(radius) * EFloat(radius);
-
     // Solve quadratic equation for _t_ values
     EFloat t0, t1;
-    if (!Quadratic(a, b, c, &t0, &t1)) return false;
+    if (!SphereQuadratic(ray, oErr, dErr, radius, &t0, &t1)) return false;
 
     // Check quadric shape _t0_ and _t1_ for nearest intersection
     if (t0.UpperBound() > ray.tMax || t1.LowerBound() <= 0) return false;
@@ -163,18 +179,9 @@ bool Sphere::IntersectP(const Ray &r, bool testAlphaTexture) const {
     Vector3f oErr, dErr;
     Ray ray = (*WorldToObject)(r, &oErr, &dErr);
 
-    // Compute quadratic sphere coefficients
-
-    // Initialize _EFloat_ ray coordinate values
-    EFloat ox(ray.o.x, oErr.x), oy(ray.o.y, oErr.y), oz(ray.o.z, oErr.z);
-    EFloat dx(ray.d.x, dErr.x), dy(ray.d.y, dErr.y), dz(ray.d.z, dErr.z);
-    EFloat a = dx * dx + dy * dy + dz * dz;
-    EFloat b = 2 * (dx * ox + dy * oy + dz * oz);
-    EFloat c = ox * ox + oy * oy + oz * oz - EFloat(radius) * EFloat(radius);
-
     // Solve quadratic equation for _t_ values
     EFloat t0, t1;
-    if (!Quadratic(a, b, c, &t0, &t1)) return false;
+    if (!SphereQuadratic(ray, oErr, dErr, radius, &t0, &t1)) return false;
 
     // Check quadric shape _t0_ and _t1_ for nearest intersection
     if (t0.UpperBound() > ray.tMax || t1.LowerBound() <= 0) return false;
@@ -0,0 +1,352 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+// shapes/tessellation.cpp*
+#include "shapes/tessellation.h"
+#include "shapes/triangle.h"
+#include "sampling.h"
+#include "stats.h"
+#include <mutex>
+
+namespace pbrt {
+
+STAT_COUNTER("Geometry/Tessellated patches evicted from cache", nEvicted);
+
+// Tessellation Local Structures
+struct PatchTessellation {
+    // PatchTessellation Data
+    // The patch is split into _4^level_ triangles, ordered so that the
+    // triangles of each face at a coarser level are contiguous.
+    // _nodeBounds_ holds the bounds of those coarser faces, level by level.
+    int level;
+    std::shared_ptr<TriangleMesh> mesh;
+    std::vector<Triangle> triangles;
+    std::vector<Bounds3f> nodeBounds;
+    std::unique_ptr<Distribution1D> areaDistrib;
+    Float area;
+    size_t bytes;
+};
+
+// TessellationCache Declarations
+// Holds the tessellations of _TessellatedPatch_es, evicting ones that
+// haven't been used recently once they use more than the memory budget
+// given by --subdivcache. Eviction follows the CLOCK algorithm: patches set
+// their _referenced_ flag when used, and the sweep that looks for a patch to
+// evict clears the flags it passes over until it finds one that is unset.
+class TessellationCache {
+  public:
+    // TessellationCache Public Methods
+    void Add(const TessellatedPatch *patch, size_t bytes);
+    void Remove(const TessellatedPatch *patch);
+
+  private:
+    // TessellationCache Private Methods
+    void RemoveSlot(int slot);
+
+    // TessellationCache Private Data
+    std::mutex mutex;
+    std::vector<const TessellatedPatch *> entries;
+    size_t hand = 0, totalBytes = 0;
+    // Evicted tessellations that threads may still be using; each is freed
+    // once its patch has no users
+    std::vector<std::pair<const TessellatedPatch *, const PatchTessellation *>>
+        retired;
+};
+
+static TessellationCache tessellationCache;
+
+// TessellationRef Declarations
+// Gives access to a patch's tessellation, tessellating the patch if it isn't
+// in the cache, and keeps the cache from freeing the tessellation until the
+// _TessellationRef_ goes out of scope.
+class TessellationRef {
+  public:
+    // TessellationRef Public Methods
+    TessellationRef(const TessellatedPatch *patch);
+    ~TessellationRef() {
+        patch->users.fetch_sub(1, std::memory_order_release);
+    }
+    const PatchTessellation *operator->() const { return tess; }
+
+  private:
+    // TessellationRef Private Data
+    const TessellatedPatch *patch;
+    const PatchTessellation *tess;
+};
+
+// Tessellation Function Definitions
+int EdgeLevel(const SubdivisionView *view, Float edgeLength, int maxLevel,
+              const Point3f &p0, const Point3f &p1) {
+    if (!view || edgeLength <= 0) return maxLevel;
+    Float length = Distance(p0, p1);
+    Float dist = Distance(view->cameraPos, (p0 + p1) / 2) - length / 2;
+    Float pixels = length / (dist * view->pixelSpread);
+    if (dist <= 0 || pixels >= edgeLength * (1 << maxLevel)) return maxLevel;
+    return pixels <= edgeLength
+               ? 0
+               : (int)std::ceil(std::log2(pixels / edgeLength));
+}
+
+// TessellatedPatch Method Definitions
+TessellatedPatch::~TessellatedPatch() { tessellationCache.Remove(this); }
+
+Bounds3f TessellatedPatch::ObjectBound() const {
+    return (*WorldToObject)(bounds);
+}
+
+PatchTessellation *TessellatedPatch::MakeTessellation(
+    int level, const std::shared_ptr<TriangleMesh> &mesh) const {
+    int nTriangles = mesh->nTriangles;
+    PatchTessellation *tess = new PatchTessellation;
+    tess->level = level;
+    tess->mesh = mesh;
+    tess->triangles.reserve(nTriangles);
+    std::vector<Float> areas(nTriangles);
+    tess->area = 0;
+    for (int i = 0; i < nTriangles; ++i) {
+        tess->triangles.emplace_back(ObjectToWorld, WorldToObject,
+                                     reverseOrientation, mesh, i);
+        areas[i] = tess->triangles[i].Area();
+        tess->area += areas[i];
+    }
+    tess->areaDistrib.reset(new Distribution1D(areas.data(), nTriangles));
+
+    // Bound the faces at each level coarser than the patch's, finest first
+    const int *indices = mesh->vertexIndices.data();
+    int nNodes = (nTriangles - 1) / 3;
+    tess->nodeBounds.resize(nNodes);
+    for (int l = level - 1, offset = nNodes; l >= 0; --l) {
+        int n = 1 << (2 * l);
+        offset -= n;
+        for (int i = 0; i < n; ++i) {
+            Bounds3f &b = tess->nodeBounds[offset + i];
+            for (int c = 4 * i; c < 4 * i + 4; ++c) {
+                if (l == level - 1)
+                    for (int k = 0; k < 3; ++k)
+                        b = Union(b, mesh->p[indices[3 * c + k]]);
+                else
+                    b = Union(b, tess->nodeBounds[offset + n + c]);
+            }
+        }
+    }
+    tess->bytes = sizeof(PatchTessellation) + sizeof(TriangleMesh) +
+                  nTriangles * (sizeof(Triangle) + 3 * sizeof(int) +
+                                2 * sizeof(Float)) +
+                  mesh->nVertices * sizeof(Point3f) +
+                  (mesh->n ? mesh->nVertices * sizeof(Normal3f) : 0) +
+                  (mesh->uv ? mesh->nVertices * sizeof(Point2f) : 0) +
+                  nNodes * sizeof(Bounds3f);
+    return tess;
+}
+
+// TessellationRef Method Definitions
+TessellationRef::TessellationRef(const TessellatedPatch *patch)
+    : patch(patch) {
+    // Count this thread as a user before loading the tessellation; the
+    // cache clears the pointer before checking for users, so either it sees
+    // this thread or this thread sees that the tessellation was evicted.
+    patch->users.fetch_add(1);
+    tess = patch->tessellation.load();
+    if (!tess) {
+        // Tessellate the patch; if another thread does so concurrently, the
+        // first tessellation stored is used
+        PatchTessellation *newTess = patch->Tessellate();
+        patch->area.store(newTess->area, std::memory_order_relaxed);
+        if (patch->tessellation.compare_exchange_strong(tess, newTess)) {
+            tess = newTess;
+            tessellationCache.Add(patch, tess->bytes);
+        } else
+            delete newTess;
+    }
+    if (!patch->referenced.load(std::memory_order_relaxed))
+        patch->referenced.store(true, std::memory_order_relaxed);
+}
+
+bool TessellatedPatch::Intersect(const Ray &r, Float *tHit,
+                                SurfaceInteraction *isect,
+                                bool testAlphaTexture) const {
+    TessellationRef tess(this);
+    Ray ray = r;
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+    bool hit = false;
+
+    // Traverse the faces of the patch's refinement levels, coarsest first
+    int todoLevel[64], todoIndex[64], todoOffset[64];
+    int toVisitOffset = 0;
+    todoLevel[0] = todoIndex[0] = todoOffset[0] = 0;
+    ++toVisitOffset;
+    while (toVisitOffset > 0) {
+        --toVisitOffset;
+        int l = todoLevel[toVisitOffset], i = todoIndex[toVisitOffset];
+        int offset = todoOffset[toVisitOffset];
+        if (l == tess->level) {
+            Float t;
+            if (tess->triangles[i].Intersect(ray, &t, isect,
+                                             testAlphaTexture)) {
+                ray.tMax = t;
+                hit = true;
+            }
+        } else if (tess->nodeBounds[offset + i].IntersectP(ray, invDir,
+                                                            dirIsNeg)) {
+            for (int c = 0; c < 4; ++c) {
+                todoLevel[toVisitOffset] = l + 1;
+                todoIndex[toVisitOffset] = 4 * i + c;
+                todoOffset[toVisitOffset] = offset + (1 << (2 * l));
+                ++toVisitOffset;
+            }
+        }
+    }
+    if (!hit) return false;
+    // Intersections refer to the patch, since its triangles may be evicted
+    isect->shape = this;
+    *tHit = ray.tMax;
+    return true;
+}
+
+bool TessellatedPatch::IntersectP(const Ray &ray, bool testAlphaTexture) const {
+    TessellationRef tess(this);
+    Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+    int dirIsNeg[3] = {invDir.x < 0, invDir.y < 0, invDir.z < 0};
+
+    // Traverse the faces of the patch's refinement levels, coarsest first
+    int todoLevel[64], todoIndex[64], todoOffset[64];
+    int toVisitOffset = 0;
+    todoLevel[0] = todoIndex[0] = todoOffset[0] = 0;
+    ++toVisitOffset;
+    while (toVisitOffset > 0) {
+        --toVisitOffset;
+        int l = todoLevel[toVisitOffset], i = todoIndex[toVisitOffset];
+        int offset = todoOffset[toVisitOffset];
+        if (l == tess->level) {
+            if (tess->triangles[i].IntersectP(ray, testAlphaTexture))
+                return true;
+        } else if (tess->nodeBounds[offset + i].IntersectP(ray, invDir,
+                                                            dirIsNeg)) {
+            for (int c = 0; c < 4; ++c) {
+                todoLevel[toVisitOffset] = l + 1;
+                todoIndex[toVisitOffset] = 4 * i + c;
+                todoOffset[toVisitOffset] = offset + (1 << (2 * l));
+                ++toVisitOffset;
+            }
+        }
+    }
+    return false;
+}
+
+Float TessellatedPatch::Area() const {
+    Float a = area.load(std::memory_order_relaxed);
+    return a >= 0 ? a : TessellationRef(this)->area;
+}
+
+Interaction TessellatedPatch::Sample(const Point2f &u, Float *pdf) const {
+    TessellationRef tess(this);
+    // Choose a triangle in proportion to its area and sample a point on it
+    Float uRemapped;
+    int tri = tess->areaDistrib->SampleDiscrete(u[0], nullptr, &uRemapped);
+    Interaction it =
+        tess->triangles[tri].Sample(Point2f(uRemapped, u[1]), pdf);
+    *pdf = 1 / tess->area;
+    return it;
+}
+
+// TessellationCache Method Definitions
+void TessellationCache::Add(const TessellatedPatch *patch, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    patch->cacheSlot = entries.size();
+    patch->cacheBytes = bytes;
+    entries.push_back(patch);
+    totalBytes += bytes;
+
+    // Free evicted tessellations whose patches are no longer in use; later
+    // users of those patches can't have found them
+    for (size_t i = 0; i < retired.size();) {
+        if (retired[i].first->users.load() == 0) {
+            delete retired[i].second;
+            retired[i] = retired.back();
+            retired.pop_back();
+        } else
+            ++i;
+    }
+
+    // Evict tessellations until the cache is within its budget; patches
+    // that are in use are skipped, so give up after two sweeps that don't
+    // find one to evict
+    size_t maxBytes = size_t(PbrtOptions.subdivCacheMB) << 20;
+    size_t nVisited = 0;
+    while (totalBytes > maxBytes && nVisited < 2 * entries.size()) {
+        if (hand >= entries.size()) hand = 0;
+        const TessellatedPatch *p = entries[hand];
+        ++nVisited;
+        if (p == patch || p->referenced.exchange(false) ||
+            p->users.load() != 0) {
+            ++hand;
+            continue;
+        }
+        // A thread may start using the patch before its tessellation is
+        // cleared; in that case it's freed once the patch is no longer used
+        const PatchTessellation *tess = p->tessellation.exchange(nullptr);
+        if (p->users.load() == 0)
+            delete tess;
+        else
+            retired.push_back(std::make_pair(p, tess));
+        RemoveSlot(hand);
+        ++nEvicted;
+        nVisited = 0;
+    }
+}
+
+void TessellationCache::Remove(const TessellatedPatch *patch) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (patch->cacheSlot != -1) RemoveSlot(patch->cacheSlot);
+    delete patch->tessellation.exchange(nullptr);
+    for (size_t i = 0; i < retired.size();) {
+        if (retired[i].first == patch) {
+            delete retired[i].second;
+            retired[i] = retired.back();
+            retired.pop_back();
+        } else
+            ++i;
+    }
+}
+
+void TessellationCache::RemoveSlot(int slot) {
+    const TessellatedPatch *patch = entries[slot];
+    totalBytes -= patch->cacheBytes;
+    patch->cacheSlot = -1;
+    entries[slot] = entries.back();
+    entries[slot]->cacheSlot = slot;
+    entries.pop_back();
+}
+
+}  // namespace pbrt
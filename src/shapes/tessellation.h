@@ -0,0 +1,122 @@
+
+/*
+    pbrt source code is Copyright(c) 1998-2016
+                        Matt Pharr, Greg Humphreys, and Wenzel Jakob.
+
+    This file is part of pbrt.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+
+    - Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    - Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+    IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+    TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+    PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#if defined(_MSC_VER)
+#define NOMINMAX
+#pragma once
+#endif
+
+#ifndef PBRT_SHAPES_TESSELLATION_H
+#define PBRT_SHAPES_TESSELLATION_H
+
+// shapes/tessellation.h*
+#include "shape.h"
+#include <atomic>
+
+namespace pbrt {
+
+struct TriangleMesh;
+struct PatchTessellation;
+class TessellationCache;
+
+// Camera information used to choose how finely to tessellate subdivision
+// surfaces and displaced meshes: the camera position and the width of a
+// pixel's footprint at unit distance from it.
+struct SubdivisionView {
+    Point3f cameraPos;
+    Float pixelSpread;
+};
+
+// Returns the level, up to _maxLevel_, at which the edge from _p0_ to _p1_
+// is split into $2^\roman{level}$ segments that span about _edgeLength_
+// pixels; the level is _maxLevel_ without a view or if _edgeLength_ is 0.
+int EdgeLevel(const SubdivisionView *view, Float edgeLength, int maxLevel,
+              const Point3f &p0, const Point3f &p1);
+
+// TessellatedPatch Declarations
+// A shape that is tessellated into triangles the first time a ray reaches
+// its bounds. The tessellation is kept in a cache of bounded size that
+// evicts the least recently used patches once it is full; its triangles
+// form a 4-ary hierarchy of bounds that intersection tests traverse.
+// Threads using a tessellation count themselves in the patch's _users_,
+// which keeps the cache from freeing it under them.
+class TessellatedPatch : public Shape {
+  public:
+    // TessellatedPatch Public Methods
+    TessellatedPatch(const Transform *ObjectToWorld,
+                     const Transform *WorldToObject, bool reverseOrientation)
+        : Shape(ObjectToWorld, WorldToObject, reverseOrientation),
+          tessellation(nullptr),
+          users(0),
+          referenced(false),
+          area(-1) {}
+    ~TessellatedPatch();
+    Bounds3f ObjectBound() const;
+    Bounds3f WorldBound() const { return bounds; }
+    bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
+                   bool testAlphaTexture) const;
+    bool IntersectP(const Ray &ray, bool testAlphaTexture) const;
+    Float Area() const;
+
+    using Shape::Sample;  // Bring in the other Sample() overload.
+    Interaction Sample(const Point2f &u, Float *pdf) const;
+
+  protected:
+    // TessellatedPatch Protected Methods
+    // Returns a new tessellation of the patch; the caller owns it
+    virtual PatchTessellation *Tessellate() const = 0;
+    PatchTessellation *MakeTessellation(
+        int level, const std::shared_ptr<TriangleMesh> &mesh) const;
+
+    // TessellatedPatch Protected Data
+    Bounds3f bounds;
+
+  private:
+    // TessellatedPatch Private Data
+    friend class TessellationCache;
+    friend class TessellationRef;
+    // The patch's tessellation, if it's in the cache, which owns it
+    mutable std::atomic<const PatchTessellation *> tessellation;
+    mutable std::atomic<int> users;
+    mutable std::atomic<bool> referenced;
+    // The patch's surface area, or -1 until it is first tessellated; it's
+    // kept when the tessellation is evicted
+    mutable std::atomic<Float> area;
+    // Position and size of the tessellation in the cache; guarded by the
+    // cache's mutex
+    mutable int cacheSlot = -1;
+    mutable size_t cacheBytes = 0;
+};
+
+}  // namespace pbrt
+
+#endif  // PBRT_SHAPES_TESSELLATION_H
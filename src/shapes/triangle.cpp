@@ -32,11 +32,13 @@
 
 // shapes/triangle.cpp*
 #include "shapes/triangle.h"
+#include "shapes/compressedmesh.h"
 #include "texture.h"
 #include "textures/constant.h"
 #include "paramset.h"
 #include "sampling.h"
 #include "efloat.h"
+#include "parallel.h"
 #include "ext/rply.h"
 #include <array>
 
@@ -55,21 +57,33 @@ TriangleMesh::TriangleMesh(
     const Transform &ObjectToWorld, int nTriangles, const int *vertexIndices,
     int nVertices, const Point3f *P, const Vector3f *S, const Normal3f *N,
     const Point2f *UV, const std::shared_ptr<Texture<Float>> &alphaMask,
-    const std::shared_ptr<Texture<Float>> &shadowAlphaMask)
+    const std::shared_ptr<Texture<Float>> &shadowAlphaMask, int nTimeSamples,
+    Float timeStart, Float timeEnd)
     : nTriangles(nTriangles),
       nVertices(nVertices),
       vertexIndices(vertexIndices, vertexIndices + 3 * nTriangles),
       alphaMask(alphaMask),
-      shadowAlphaMask(shadowAlphaMask) {
+      shadowAlphaMask(shadowAlphaMask),
+      nTimeSamples(nTimeSamples),
+      timeStart(timeStart),
+      timeEnd(timeEnd) {
+    CHECK_GE(nTimeSamples, 1);
     ++nMeshes;
     nTris += nTriangles;
     triMeshBytes += sizeof(*this) + (3 * nTriangles * sizeof(int)) +
-                    nVertices * (sizeof(*P) + (N ? sizeof(*N) : 0) +
-                                 (S ? sizeof(*S) : 0) + (UV ? sizeof(*UV) : 0));
+                    nVertices * (nTimeSamples * sizeof(*P) +
+                                 (N ? sizeof(*N) : 0) + (S ? sizeof(*S) : 0) +
+                                 (UV ? sizeof(*UV) : 0));
 
     // Transform mesh vertices to world space
     p.reset(new Point3f[nVertices]);
     for (int i = 0; i < nVertices; ++i) p[i] = ObjectToWorld(P[i]);
+    if (nTimeSamples > 1) {
+        int nExtra = (nTimeSamples - 1) * nVertices;
+        pTimeSamples.reset(new Point3f[nExtra]);
+        for (int i = 0; i < nExtra; ++i)
+            pTimeSamples[i] = ObjectToWorld(P[nVertices + i]);
+    }
 
     // Copy _UV_, _N_, and _S_ vertex data, if present
     if (UV) {
@@ -86,16 +100,35 @@ TriangleMesh::TriangleMesh(
     }
 }
 
+void TriangleMesh::UpdateVertices(const Transform &ObjectToWorld,
+                                  const Point3f *P, const Normal3f *N,
+                                  const Vector3f *S) {
+    ParallelFor([&](int64_t i) {
+        p[i] = ObjectToWorld(P[i]);
+        for (int sample = 1; sample < nTimeSamples; ++sample)
+            pTimeSamples[(sample - 1) * nVertices + i] =
+                ObjectToWorld(P[sample * nVertices + i]);
+        if (N && n) n[i] = ObjectToWorld(N[i]);
+        if (S && s) s[i] = ObjectToWorld(S[i]);
+    }, nVertices, 4096);
+}
+
 std::vector<std::shared_ptr<Shape>> CreateTriangleMesh(
     const Transform *ObjectToWorld, const Transform *WorldToObject,
     bool reverseOrientation, int nTriangles, const int *vertexIndices,
     int nVertices, const Point3f *p, const Vector3f *s, const Normal3f *n,
     const Point2f *uv, const std::shared_ptr<Texture<Float>> &alphaMask,
-    const std::shared_ptr<Texture<Float>> &shadowAlphaMask) {
+    const std::shared_ptr<Texture<Float>> &shadowAlphaMask, int nTimeSamples,
+    Float timeStart, Float timeEnd,
+    std::shared_ptr<TriangleMesh> *compressedMesh) {
     std::shared_ptr<TriangleMesh> mesh = std::make_shared<TriangleMesh>(
         *ObjectToWorld, nTriangles, vertexIndices, nVertices, p, s, n, uv,
-        alphaMask, shadowAlphaMask);
+        alphaMask, shadowAlphaMask, nTimeSamples, timeStart, timeEnd);
     std::vector<std::shared_ptr<Shape>> tris;
+    if (compressedMesh && CompressedTriangleMesh::Supports(*mesh)) {
+        *compressedMesh = mesh;
+        return tris;
+    }
     tris.reserve(nTriangles);
     for (int i = 0; i < nTriangles; ++i)
         tris.push_back(std::make_shared<Triangle>(ObjectToWorld, WorldToObject,
@@ -162,8 +195,14 @@ Bounds3f Triangle::ObjectBound() const {
     const Point3f &p0 = mesh->p[v[0]];
     const Point3f &p1 = mesh->p[v[1]];
     const Point3f &p2 = mesh->p[v[2]];
-    return Union(Bounds3f((*WorldToObject)(p0), (*WorldToObject)(p1)),
-                 (*WorldToObject)(p2));
+    Bounds3f b = Union(Bounds3f((*WorldToObject)(p0), (*WorldToObject)(p1)),
+                       (*WorldToObject)(p2));
+    // Include all time samples of deforming meshes
+    for (int i = 1; i < mesh->nTimeSamples; ++i) {
+        const Point3f *pt = mesh->TimeSampleP(i);
+        for (int j = 0; j < 3; ++j) b = Union(b, (*WorldToObject)(pt[v[j]]));
+    }
+    return b;
 }
 
 Bounds3f Triangle::WorldBound() const {
@@ -171,20 +210,61 @@ Bounds3f Triangle::WorldBound() const {
     const Point3f &p0 = mesh->p[v[0]];
     const Point3f &p1 = mesh->p[v[1]];
     const Point3f &p2 = mesh->p[v[2]];
-    return Union(Bounds3f(p0, p1), p2);
+    Bounds3f b = Union(Bounds3f(p0, p1), p2);
+    // Include all time samples of deforming meshes
+    for (int i = 1; i < mesh->nTimeSamples; ++i) {
+        const Point3f *pt = mesh->TimeSampleP(i);
+        b = Union(Union(Union(b, pt[v[0]]), pt[v[1]]), pt[v[2]]);
+    }
+    return b;
 }
 
-bool Triangle::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
-                         bool testAlphaTexture) const {
-    ProfilePhase p(Prof::TriIntersect);
-    ++nTests;
-    // Get triangle vertices in _p0_, _p1_, and _p2_
-    const Point3f &p0 = mesh->p[v[0]];
-    const Point3f &p1 = mesh->p[v[1]];
-    const Point3f &p2 = mesh->p[v[2]];
-
-    // Perform ray--triangle intersection test
+void Triangle::WorldBoundKeys(Float time0, Float time1, int nKeys,
+                              Bounds3f *bounds) const {
+    if (mesh->nTimeSamples == 1) {
+        Shape::WorldBoundKeys(time0, time1, nKeys, bounds);
+        return;
+    }
+    auto boundsAt = [&](Float time) {
+        Point3f p0, p1, p2;
+        GetPositions(time, &p0, &p1, &p2);
+        return Union(Bounds3f(p0, p1), p2);
+    };
+    auto keyTime = [&](int i) {
+        return Lerp(Float(i) / Float(nKeys - 1), time0, time1);
+    };
+    auto sampleTime = [&](int i) {
+        return Lerp(Float(i) / Float(mesh->nTimeSamples - 1), mesh->timeStart,
+                    mesh->timeEnd);
+    };
+    // Vertices move linearly between the mesh's time samples, so bounds
+    // at the key times are conservative unless a time sample falls
+    // strictly inside a key segment
+    for (int i = 0; i < nKeys; ++i) bounds[i] = boundsAt(keyTime(i));
+    for (int i = 0; i < nKeys - 1; ++i) {
+        Float t0 = keyTime(i), t1 = keyTime(i + 1);
+        Bounds3f segmentBounds;
+        bool linear = true;
+        for (int j = 0; j < mesh->nTimeSamples; ++j) {
+            Float ts = sampleTime(j);
+            if (t0 < ts && ts < t1) {
+                segmentBounds = Union(segmentBounds, boundsAt(ts));
+                linear = false;
+            }
+        }
+        if (linear) continue;
+        segmentBounds =
+            Union(segmentBounds, Union(boundsAt(t0), boundsAt(t1)));
+        bounds[i] = Union(bounds[i], segmentBounds);
+        bounds[i + 1] = Union(bounds[i + 1], segmentBounds);
+    }
+}
 
+// Watertight ray--triangle test; returns the hit's parametric distance and
+// barycentric coordinates.
+bool IntersectTriangle(const Ray &ray, const Point3f &p0, const Point3f &p1,
+                       const Point3f &p2, Float *tHit, Float *b0, Float *b1,
+                       Float *b2) {
     // Transform triangle vertices to ray coordinate space
 
     // Translate vertices based on ray origin
@@ -251,9 +331,9 @@ bool Triangle::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
 
     // Compute barycentric coordinates and $t$ value for triangle intersection
     Float invDet = 1 / det;
-    Float b0 = e0 * invDet;
-    Float b1 = e1 * invDet;
-    Float b2 = e2 * invDet;
+    *b0 = e0 * invDet;
+    *b1 = e1 * invDet;
+    *b2 = e2 * invDet;
     Float t = tScaled * invDet;
 
     // Ensure that computed triangle $t$ is conservatively greater than zero
@@ -278,6 +358,21 @@ bool Triangle::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
                    (gamma(3) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE) *
                    std::abs(invDet);
     if (t <= deltaT) return false;
+    *tHit = t;
+    return true;
+}
+
+bool Triangle::Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
+                         bool testAlphaTexture) const {
+    ProfilePhase p(Prof::TriIntersect);
+    ++nTests;
+    // Get triangle vertices in _p0_, _p1_, and _p2_
+    Point3f p0, p1, p2;
+    GetPositions(ray.time, &p0, &p1, &p2);
+
+    // Perform ray--triangle intersection test
+    Float t, b0, b1, b2;
+    if (!IntersectTriangle(ray, p0, p1, p2, &t, &b0, &b1, &b2)) return false;
 
     // Compute triangle partial derivatives
     Vector3f dpdu, dpdv;
@@ -395,105 +490,12 @@ bool Triangle::IntersectP(const Ray &ray, bool testAlphaTexture) const {
     ProfilePhase p(Prof::TriIntersectP);
     ++nTests;
     // Get triangle vertices in _p0_, _p1_, and _p2_
-    const Point3f &p0 = mesh->p[v[0]];
-    const Point3f &p1 = mesh->p[v[1]];
-    const Point3f &p2 = mesh->p[v[2]];
+    Point3f p0, p1, p2;
+    GetPositions(ray.time, &p0, &p1, &p2);
 
     // Perform ray--triangle intersection test
-
-    // Transform triangle vertices to ray coordinate space
-
-    // Translate vertices based on ray origin
-    Point3f p0t = p0 - Vector3f(ray.o);
-    Point3f p1t = p1 - Vector3f(ray.o);
-    Point3f p2t = p2 - Vector3f(ray.o);
-
-    // Permute components of triangle vertices and ray direction
-    int kz = MaxDimension(Abs(ray.d));
-    int kx = kz + 1;
-    if (kx == 3) kx = 0;
-    int ky = kx + 1;
-    if (ky == 3) ky = 0;
-    Vector3f d = Permute(ray.d, kx, ky, kz);
-    p0t = Permute(p0t, kx, ky, kz);
-    p1t = Permute(p1t, kx, ky, kz);
-    p2t = Permute(p2t, kx, ky, kz);
-
-    // Apply shear transformation to translated vertex positions
-    Float Sx = -d.x / d.z;
-    Float Sy = -d.y / d.z;
-    Float Sz = 1.f / d.z;
-    p0t.x += Sx * p0t.z;
-    p0t.y += Sy * p0t.z;
-    p1t.x += Sx * p1t.z;
-    p1t.y += Sy * p1t.z;
-    p2t.x += Sx * p2t.z;
-    p2t.y += Sy * p2t.z;
-
-    // Compute edge function coefficients _e0_, _e1_, and _e2_
-    Float e0 = p1t.x * p2t.y - p1t.y * p2t.x;
-    Float e1 = p2t.x * p0t.y - p2t.y * p0t.x;
-    Float e2 = p0t.x * p1t.y - p0t.y * p1t.x;
-
-    // Fall back to double precision test at triangle edges
-    if (sizeof(Float) == sizeof(float) &&
-        (e0 == 0.0f || e1 == 0.0f || e2 == 0.0f)) {
-        double p2txp1ty = (double)p2t.x * (double)p1t.y;
-        double p2typ1tx = (double)p2t.y * (double)p1t.x;
-        e0 = (float)(p2typ1tx - p2txp1ty);
-        double p0txp2ty = (double)p0t.x * (double)p2t.y;
-        double p0typ2tx = (double)p0t.y * (double)p2t.x;
-        e1 = (float)(p0typ2tx - p0txp2ty);
-        double p1txp0ty = (double)p1t.x * (double)p0t.y;
-        double p1typ0tx = (double)p1t.y * (double)p0t.x;
-        e2 = (float)(p1typ0tx - p1txp0ty);
-    }
-
-    // Perform triangle edge and determinant tests
-    if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0))
-        return false;
-    Float det = e0 + e1 + e2;
-    if (det == 0) return false;
-
-    // Compute scaled hit distance to triangle and test against ray $t$ range
-    p0t.z *= Sz;
-    p1t.z *= Sz;
-    p2t.z *= Sz;
-    Float tScaled = e0 * p0t.z + e1 * p1t.z + e2 * p2t.z;
-    if (det < 0 && (tScaled >= 0 || tScaled < ray.tMax * det))
-        return false;
-    else if (det > 0 && (tScaled <= 0 || tScaled > ray.tMax * det))
-        return false;
-
-    // Compute barycentric coordinates and $t$ value for triangle intersection
-    Float invDet = 1 / det;
-    Float b0 = e0 * invDet;
-    Float b1 = e1 * invDet;
-    Float b2 = e2 * invDet;
-    Float t = tScaled * invDet;
-
-    // Ensure that computed triangle $t$ is conservatively greater than zero
-
-    // Compute $\delta_z$ term for triangle $t$ error bounds
-    Float maxZt = MaxComponent(Abs(Vector3f(p0t.z, p1t.z, p2t.z)));
-    Float deltaZ = gamma(3) * maxZt;
-
-    // Compute $\delta_x$ and $\delta_y$ terms for triangle $t$ error bounds
-    Float maxXt = MaxComponent(Abs(Vector3f(p0t.x, p1t.x, p2t.x)));
-    Float maxYt = MaxComponent(Abs(Vector3f(p0t.y, p1t.y, p2t.y)));
-    Float deltaX = gamma(5) * (maxXt + maxZt);
-    Float deltaY = gamma(5) * (maxYt + maxZt);
-
-    // Compute $\delta_e$ term for triangle $t$ error bounds
-    Float deltaE =
-        2 * (gamma(2) * maxXt * maxYt + deltaY * maxXt + deltaX * maxYt);
-
-    // Compute $\delta_t$ term for triangle $t$ error bounds and check _t_
-    Float maxE = MaxComponent(Abs(Vector3f(e0, e1, e2)));
-    Float deltaT = 3 *
-                   (gamma(3) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE) *
-                   std::abs(invDet);
-    if (t <= deltaT) return false;
+    Float t, b0, b1, b2;
+    if (!IntersectTriangle(ray, p0, p1, p2, &t, &b0, &b1, &b2)) return false;
 
     // Test shadow ray intersection against alpha texture, if present
     if (testAlphaTexture && (mesh->alphaMask || mesh->shadowAlphaMask)) {
@@ -533,7 +535,8 @@ bool Triangle::IntersectP(const Ray &ray, bool testAlphaTexture) const {
 }
 
 Float Triangle::Area() const {
-    // Get triangle vertices in _p0_, _p1_, and _p2_
+    // Get triangle vertices in _p0_, _p1_, and _p2_; deforming meshes use
+    // their first time sample
     const Point3f &p0 = mesh->p[v[0]];
     const Point3f &p1 = mesh->p[v[1]];
     const Point3f &p2 = mesh->p[v[2]];
@@ -542,7 +545,8 @@ Float Triangle::Area() const {
 
 Interaction Triangle::Sample(const Point2f &u, Float *pdf) const {
     Point2f b = UniformSampleTriangle(u);
-    // Get triangle vertices in _p0_, _p1_, and _p2_
+    // Get triangle vertices in _p0_, _p1_, and _p2_ at the first time sample,
+    // matching Area()
     const Point3f &p0 = mesh->p[v[0]];
     const Point3f &p1 = mesh->p[v[1]];
     const Point3f &p2 = mesh->p[v[2]];
@@ -608,10 +612,39 @@ Float Triangle::SolidAngle(const Point3f &p, int nSamples) const {
 std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
     const Transform *o2w, const Transform *w2o, bool reverseOrientation,
     const ParamSet &params,
-    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures) {
+    std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures,
+    std::shared_ptr<TriangleMesh> *compressedMesh) {
     int nvi, npi, nuvi, nsi, nni;
     const int *vi = params.FindInt("indices", &nvi);
     const Point3f *P = params.FindPoint3f("P", &npi);
+    // Deforming meshes provide all time samples' positions in "P"
+    int nTimeSamples = params.FindOneInt("ntimesamples", 1);
+    int ntr;
+    const Float *timeRange = params.FindFloat("timerange", &ntr);
+    Float timeStart = 0, timeEnd = 1;
+    if (timeRange) {
+        if (ntr != 2)
+            Error("Expected two values for \"timerange\" parameter. Got %d.",
+                  ntr);
+        else {
+            timeStart = timeRange[0];
+            timeEnd = timeRange[1];
+        }
+    }
+    if (nTimeSamples < 1 || (nTimeSamples > 1 && timeEnd <= timeStart)) {
+        Error("Invalid \"ntimesamples\" or \"timerange\" for triangle "
+              "mesh. Ignoring motion.");
+        nTimeSamples = 1;
+    }
+    if (P && nTimeSamples > 1) {
+        if (npi % nTimeSamples != 0) {
+            Error("Number of \"P\"s for triangle mesh (%d) isn't a multiple "
+                  "of \"ntimesamples\" (%d). Ignoring motion.",
+                  npi, nTimeSamples);
+            nTimeSamples = 1;
+        } else
+            npi /= nTimeSamples;
+    }
     const Point2f *uvs = params.FindPoint2f("uv", &nuvi);
     if (!uvs) uvs = params.FindPoint2f("st", &nuvi);
     std::vector<Point2f> tempUVs;
@@ -692,7 +725,8 @@ std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
         shadowAlphaTex.reset(new ConstantTexture<Float>(0.f));
 
     return CreateTriangleMesh(o2w, w2o, reverseOrientation, nvi / 3, vi, npi, P,
-                              S, N, uvs, alphaTex, shadowAlphaTex);
+                              S, N, uvs, alphaTex, shadowAlphaTex,
+                              nTimeSamples, timeStart, timeEnd, compressedMesh);
 }
 
 }  // namespace pbrt
@@ -54,7 +54,30 @@ struct TriangleMesh {
                  const int *vertexIndices, int nVertices, const Point3f *P,
                  const Vector3f *S, const Normal3f *N, const Point2f *uv,
                  const std::shared_ptr<Texture<Float>> &alphaMask,
-                 const std::shared_ptr<Texture<Float>> &shadowAlphaMask);
+                 const std::shared_ptr<Texture<Float>> &shadowAlphaMask,
+                 int nTimeSamples = 1, Float timeStart = 0,
+                 Float timeEnd = 1);
+    // Returns the position of vertex _vertex_ at _time_, interpolating
+    // between the mesh's time samples if it deforms.
+    Point3f P(int vertex, Float time) const {
+        if (nTimeSamples == 1) return p[vertex];
+        Float u = Clamp((time - timeStart) / (timeEnd - timeStart), 0, 1) *
+                  (nTimeSamples - 1);
+        int sample = std::min(int(u), nTimeSamples - 2);
+        return Lerp(u - sample, TimeSampleP(sample)[vertex],
+                    TimeSampleP(sample + 1)[vertex]);
+    }
+    const Point3f *TimeSampleP(int sample) const {
+        return sample == 0 ? p.get() : &pTimeSamples[(sample - 1) * nVertices];
+    }
+    // Replaces the mesh's object-space vertex positions and, if given,
+    // normals and tangents, e.g. with the next frame of an animated mesh.
+    // Like the constructor's, _P_ holds _nVertices_ positions for each of
+    // the mesh's time samples. Accelerators that hold the mesh's triangles
+    // must be refit afterward.
+    void UpdateVertices(const Transform &ObjectToWorld, const Point3f *P,
+                        const Normal3f *N = nullptr,
+                        const Vector3f *S = nullptr);
 
     // TriangleMesh Data
     const int nTriangles, nVertices;
@@ -64,6 +87,12 @@ struct TriangleMesh {
     std::unique_ptr<Vector3f[]> s;
     std::unique_ptr<Point2f[]> uv;
     std::shared_ptr<Texture<Float>> alphaMask, shadowAlphaMask;
+    // Deforming meshes store vertex positions at _nTimeSamples_ evenly
+    // spaced times over [_timeStart_, _timeEnd_]; _p_ holds the first
+    // sample and _pTimeSamples_ the remaining ones.
+    const int nTimeSamples;
+    const Float timeStart, timeEnd;
+    std::unique_ptr<Point3f[]> pTimeSamples;
 };
 
 class Triangle : public Shape {
@@ -78,9 +107,14 @@ class Triangle : public Shape {
     }
     Bounds3f ObjectBound() const;
     Bounds3f WorldBound() const;
+    void WorldBoundKeys(Float time0, Float time1, int nKeys,
+                        Bounds3f *bounds) const;
     bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
                    bool testAlphaTexture = true) const;
     bool IntersectP(const Ray &ray, bool testAlphaTexture = true) const;
+    // Area() and Sample() do not take a time, so for deforming meshes they
+    // use the first time sample; area lights on such meshes are emitted from
+    // the triangles' positions at _timeStart_.
     Float Area() const;
 
     using Shape::Sample;  // Bring in the other Sample() overload.
@@ -89,9 +123,22 @@ class Triangle : public Shape {
     // Returns the solid angle subtended by the triangle w.r.t. the given
     // reference point p.
     Float SolidAngle(const Point3f &p, int nSamples = 0) const;
+    const std::shared_ptr<TriangleMesh> &GetMesh() const { return mesh; }
 
   private:
     // Triangle Private Methods
+    void GetPositions(Float time, Point3f *p0, Point3f *p1,
+                      Point3f *p2) const {
+        if (mesh->nTimeSamples == 1) {
+            *p0 = mesh->p[v[0]];
+            *p1 = mesh->p[v[1]];
+            *p2 = mesh->p[v[2]];
+        } else {
+            *p0 = mesh->P(v[0], time);
+            *p1 = mesh->P(v[1], time);
+            *p2 = mesh->P(v[2], time);
+        }
+    }
     void GetUVs(Point2f uv[3]) const {
         if (mesh->uv) {
             uv[0] = mesh->uv[v[0]];
@@ -109,17 +156,26 @@ class Triangle : public Shape {
     const int *v;
 };
 
+bool IntersectTriangle(const Ray &ray, const Point3f &p0, const Point3f &p1,
+                       const Point3f &p2, Float *tHit, Float *b0, Float *b1,
+                       Float *b2);
+// If _compressedMesh_ isn't nullptr and the mesh can be stored as a
+// _CompressedTriangleMesh_, the mesh is returned there and no _Triangle_s
+// are created for it.
 std::vector<std::shared_ptr<Shape>> CreateTriangleMesh(
     const Transform *o2w, const Transform *w2o, bool reverseOrientation,
     int nTriangles, const int *vertexIndices, int nVertices, const Point3f *p,
     const Vector3f *s, const Normal3f *n, const Point2f *uv,
     const std::shared_ptr<Texture<Float>> &alphaTexture,
-    const std::shared_ptr<Texture<Float>> &shadowAlphaTexture);
+    const std::shared_ptr<Texture<Float>> &shadowAlphaTexture,
+    int nTimeSamples = 1, Float timeStart = 0, Float timeEnd = 1,
+    std::shared_ptr<TriangleMesh> *compressedMesh = nullptr);
 std::vector<std::shared_ptr<Shape>> CreateTriangleMeshShape(
     const Transform *o2w, const Transform *w2o, bool reverseOrientation,
     const ParamSet &params,
     std::map<std::string, std::shared_ptr<Texture<Float>>> *floatTextures =
-        nullptr);
+        nullptr,
+    std::shared_ptr<TriangleMesh> *compressedMesh = nullptr);
 
 bool WritePlyFile(const std::string &filename, int nTriangles,
                   const int *vertexIndices, int nVertices, const Point3f *P,
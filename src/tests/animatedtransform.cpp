@@ -68,3 +68,43 @@ TEST(AnimatedTransform, Randoms) {
         }
     }
 }
+
+TEST(AnimatedTransform, MotionBoundKeys) {
+    RNG rng;
+    auto r = [&rng]() { return -10. + 20. * rng.UniformFloat(); };
+
+    for (int i = 0; i < 100; ++i) {
+        Transform t0 = RandomTransform(rng);
+        Transform t1 = RandomTransform(rng);
+        // Leave the transformation constant at the start and end of the
+        // range so that some segments include the motion's endpoints.
+        AnimatedTransform at(&t0, .1, &t1, .83);
+        const int nKeys = 5;
+        Bounds3f keys[nKeys];
+
+        for (int j = 0; j < 5; ++j) {
+            Bounds3f bounds(Point3f(r(), r(), r()), Point3f(r(), r(), r()));
+            at.MotionBoundKeys(bounds, 0., 1., nKeys, keys);
+
+            for (Float t = 0.; t <= 1.; t += 1e-3 * rng.UniformFloat()) {
+                // The transformed bounds at _t_ should be inside the
+                // bounds linearly interpolated from the surrounding keys.
+                Transform tr;
+                at.Interpolate(t, &tr);
+                Bounds3f tb = tr(bounds);
+                tb.pMin += (Float)1e-4 * tb.Diagonal();
+                tb.pMax -= (Float)1e-4 * tb.Diagonal();
+
+                Float u = t * (nKeys - 1);
+                int k = std::min(int(u), nKeys - 2);
+                Float dt = u - k;
+                Point3f pMin = Lerp(dt, keys[k].pMin, keys[k + 1].pMin);
+                Point3f pMax = Lerp(dt, keys[k].pMax, keys[k + 1].pMax);
+                for (int c = 0; c < 3; ++c) {
+                    EXPECT_GE(tb.pMin[c], pMin[c]);
+                    EXPECT_LE(tb.pMax[c], pMax[c]);
+                }
+            }
+        }
+    }
+}
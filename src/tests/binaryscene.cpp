@@ -0,0 +1,89 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "api.h"
+#include "binaryscene.h"
+#include "fileutil.h"
+#include "parser.h"
+#include <stdio.h>
+
+using namespace pbrt;
+
+static void WriteFile(const std::string &filename, const std::string &text) {
+    FILE *f = fopen(filename.c_str(), "wb");
+    ASSERT_TRUE(f != nullptr);
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+}
+
+// Parses _filename_ with the given options and returns what was printed.
+static std::string Parse(const std::string &filename, Options opt) {
+    opt.quiet = true;
+    pbrtInit(opt);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(ParseFile(filename));
+    std::string output = testing::internal::GetCapturedStdout();
+    pbrtCleanup();
+    return output;
+}
+
+static const char *testScene =
+    "LookAt 0 2 -6  0 0 0  0 1 0\n"
+    "Camera \"perspective\" \"float fov\" 45\n"
+    "Film \"image\" \"integer xresolution\" [16 12]\n"
+    "  \"bool flag\" [\"true\" \"false\"] \"string filename\" \"out.exr\"\n"
+    "WorldBegin\n"
+    "AttributeBegin\n"
+    "Rotate 30 0 1 0\n"
+    "Transform [1 0 0 0 0 2 0 0 0 0 3 0 4 5 6 1]\n"
+    "Texture \"checks\" \"spectrum\" \"checkerboard\" \"rgb tex1\" [1 0 0]\n"
+    "Material \"matte\" \"texture Kd\" \"checks\"\n"
+    "MediumInterface \"\" \"fog\"\n"
+    "Shape \"trianglemesh\" \"integer indices\" [0 1 2]\n"
+    "  \"point P\" [0 0 0 1 0 0 1 1 0] \"normal N\" [0 0 1 0 0 1 0 0 1]\n"
+    "  \"point2 uv\" [0 0 1 0 1 1] \"vector S\" [1 0 0 1 0 0 1 0 0]\n"
+    "  \"float alpha\" .5\n"
+    "AttributeEnd\n"
+    "ObjectBegin \"empty\"\n"
+    "ObjectEnd\n"
+    "ObjectInstance \"empty\"\n"
+    "WorldEnd\n";
+
+TEST(BinaryScene, RoundTrip) {
+    std::string text = "/tmp/pbrt_test_binary.pbrt";
+    std::string binary = "/tmp/pbrt_test_binary.pbrtb";
+    WriteFile(text, testScene);
+
+    Options toBinary;
+    toBinary.toBinary = binary;
+    EXPECT_EQ("", Parse(text, toBinary));
+
+    // The binary scene's statements should match the text file's
+    Options cat;
+    cat.cat = true;
+    std::string expected = Parse(text, cat);
+    EXPECT_NE(std::string::npos, expected.find("\"normal N\""));
+    EXPECT_EQ(expected, Parse(binary, cat));
+
+    // Truncated files should be detected
+    MappedFile file(binary);
+    ASSERT_TRUE(file.IsValid());
+    EXPECT_TRUE(IsBinaryScene(file.Data(), file.Size()));
+    std::string contents(file.Data(), file.Size());
+    for (size_t size : {contents.size() - 2, contents.size() / 2}) {
+        pbrtInit(cat);
+        testing::internal::CaptureStdout();
+        EXPECT_FALSE(ParseBinaryScene(binary, contents.data(), size));
+        testing::internal::GetCapturedStdout();
+        pbrtCleanup();
+    }
+    WriteFile(binary, contents.substr(0, contents.size() / 2));
+    pbrtInit(cat);
+    testing::internal::CaptureStdout();
+    EXPECT_FALSE(ParseFile(binary));
+    testing::internal::GetCapturedStdout();
+    pbrtCleanup();
+
+    remove(text.c_str());
+    remove(binary.c_str());
+}
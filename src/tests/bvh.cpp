@@ -0,0 +1,243 @@
+
+#include "tests/gtest/gtest.h"
+#include <functional>
+#include "pbrt.h"
+#include "rng.h"
+#include "interaction.h"
+#include "primitive.h"
+#include "sampling.h"
+#include "shapes/sphere.h"
+#include "shapes/triangle.h"
+#include "parallel.h"
+#include "accelerators/bvh.h"
+
+using namespace pbrt;
+
+// Make a BVH over randomly placed spheres; _transforms_ must outlive the
+// returned accelerator.
+static std::shared_ptr<BVHAccel> MakeSphereBVH(
+    RNG &rng, int nSpheres, std::vector<Transform> *transforms) {
+    transforms->reserve(2 * nSpheres);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (int i = 0; i < nSpheres; ++i) {
+        Vector3f p(Lerp(rng.UniformFloat(), -10, 10),
+                   Lerp(rng.UniformFloat(), -10, 10),
+                   Lerp(rng.UniformFloat(), -10, 10));
+        transforms->push_back(Translate(p));
+        transforms->push_back(Translate(-p));
+        Float radius = Lerp(rng.UniformFloat(), .1, 1.5);
+        std::shared_ptr<Shape> sphere = std::make_shared<Sphere>(
+            &(*transforms)[2 * i], &(*transforms)[2 * i + 1], false, radius,
+            -radius, radius, 360);
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            sphere, nullptr, nullptr, MediumInterface()));
+    }
+    return std::make_shared<BVHAccel>(prims, 4);
+}
+
+static Ray RandomRay(RNG &rng) {
+    Point3f o(Lerp(rng.UniformFloat(), -15, 15),
+              Lerp(rng.UniformFloat(), -15, 15), -20);
+    Vector3f d = UniformSampleSphere({rng.UniformFloat(), rng.UniformFloat()});
+    // Keep rays roughly coherent, as they would be for a camera tile
+    d = Normalize(Vector3f(.2f * d.x, .2f * d.y, 1));
+    Float tMax = rng.UniformFloat() < .25f ? 30 : Infinity;
+    return Ray(o, d, tMax);
+}
+
+TEST(BVH, BatchMatchesSingleRay) {
+    RNG rng;
+    std::vector<Transform> transforms;
+    std::shared_ptr<BVHAccel> bvh = MakeSphereBVH(rng, 200, &transforms);
+
+    // Use a ray count that isn't a multiple of the packet size
+    const int nRays = 77;
+    std::vector<Ray> rays, batchRays;
+    for (int i = 0; i < nRays; ++i) rays.push_back(RandomRay(rng));
+    batchRays = rays;
+
+    std::vector<SurfaceInteraction> isects(nRays);
+    std::unique_ptr<bool[]> hits(new bool[nRays]);
+    bvh->IntersectBatch(&batchRays[0], nRays, &isects[0], hits.get());
+
+    std::unique_ptr<bool[]> occluded(new bool[nRays]);
+    bvh->IntersectPBatch(&rays[0], nRays, occluded.get());
+
+    int nHits = 0;
+    for (int i = 0; i < nRays; ++i) {
+        EXPECT_EQ(bvh->IntersectP(rays[i]), occluded[i]);
+        SurfaceInteraction isect;
+        bool hit = bvh->Intersect(rays[i], &isect);
+        EXPECT_EQ(hit, hits[i]);
+        if (hit && hits[i]) {
+            ++nHits;
+            EXPECT_EQ(rays[i].tMax, batchRays[i].tMax);
+            EXPECT_EQ(isect.primitive, isects[i].primitive);
+            EXPECT_EQ(isect.p, isects[i].p);
+        }
+    }
+    // Make sure that the test is exercising something.
+    EXPECT_GT(nHits, 0);
+}
+
+// Make an _n_ x _n_ grid of vertices in the xy plane with heights given by
+// _height_.
+static std::vector<Point3f> GridVertices(
+    int n, const std::function<Float(Float, Float)> &height) {
+    std::vector<Point3f> p;
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x) {
+            Float fx = Float(x) / (n - 1), fy = Float(y) / (n - 1);
+            p.push_back(Point3f(fx, fy, height(fx, fy)));
+        }
+    return p;
+}
+
+static void CheckRefitBVH(BVHAccel::SplitMethod splitMethod,
+                          Float refitRebuildRatio) {
+    ParallelInit();
+    const int n = 33;
+    std::vector<int> indices;
+    for (int y = 0; y < n - 1; ++y)
+        for (int x = 0; x < n - 1; ++x) {
+            int v = y * n + x;
+            indices.insert(indices.end(), {v, v + 1, v + n + 1});
+            indices.insert(indices.end(), {v, v + n + 1, v + n});
+        }
+    // Start from a bumpy surface so that HLBVH's Morton order, whose most
+    // significant bits are z's, differs from the order of the upper-level
+    // SAH splits.
+    std::vector<Point3f> p = GridVertices(n, [](Float x, Float y) {
+        return .2f * std::sin(20 * x) * std::sin(20 * y);
+    });
+    Transform identity;
+    std::vector<std::shared_ptr<Shape>> tris = CreateTriangleMesh(
+        &identity, &identity, false, indices.size() / 3, &indices[0],
+        p.size(), &p[0], nullptr, nullptr, nullptr, nullptr, nullptr);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const auto &tri : tris)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            tri, nullptr, nullptr, MediumInterface()));
+    BVHAccel bvh(prims, 4, splitMethod, refitRebuildRatio);
+
+    // Deform the mesh substantially and refit, twice; all triangles share
+    // the same _TriangleMesh_
+    std::shared_ptr<TriangleMesh> mesh =
+        ((Triangle *)tris[0].get())->GetMesh();
+    RNG rng;
+    for (int frame = 1; frame <= 2; ++frame) {
+        std::vector<Point3f> pMoved =
+            GridVertices(n, [frame](Float x, Float y) {
+                return 4 * std::sin(13 * frame * x) * std::cos(7 * y) +
+                       (x > .5f ? 10 * frame : 0);
+            });
+        mesh->UpdateVertices(identity, &pMoved[0]);
+        bvh.Refit();
+        BVHAccel reference(prims, 4);
+
+        EXPECT_EQ(reference.WorldBound(), bvh.WorldBound());
+        for (int i = 0; i < 1000; ++i) {
+            Point3f o(rng.UniformFloat(), rng.UniformFloat(), -20);
+            Point3f target(rng.UniformFloat(), rng.UniformFloat(), 0);
+            Ray r0(o, target - o), r1(o, target - o);
+            SurfaceInteraction i0, i1;
+            bool hit = reference.Intersect(r0, &i0);
+            EXPECT_EQ(hit, bvh.Intersect(r1, &i1));
+            if (hit) {
+                EXPECT_EQ(r0.tMax, r1.tMax);
+            }
+            EXPECT_EQ(reference.IntersectP(Ray(o, target - o)),
+                      bvh.IntersectP(Ray(o, target - o)));
+        }
+    }
+    ParallelCleanup();
+}
+
+TEST(BVH, Refit) { CheckRefitBVH(BVHAccel::SplitMethod::SAH, 0); }
+
+TEST(BVH, RefitWithRebuild) {
+    CheckRefitBVH(BVHAccel::SplitMethod::SAH, 1.01f);
+}
+
+TEST(BVH, RefitHLBVH) { CheckRefitBVH(BVHAccel::SplitMethod::HLBVH, 0); }
+
+TEST(BVH, RefitHLBVHWithRebuild) {
+    CheckRefitBVH(BVHAccel::SplitMethod::HLBVH, 1.01f);
+}
+
+TEST(BVH, MotionSegments) {
+    // A deforming triangle mesh: each triangle moves along a different
+    // path through four time samples.
+    RNG rng;
+    const int nTris = 300, nTimeSamples = 4;
+    std::vector<int> indices;
+    std::vector<Point3f> p(nTimeSamples * 3 * nTris);
+    for (int i = 0; i < nTris; ++i) {
+        Point3f c(Lerp(rng.UniformFloat(), -10, 10),
+                  Lerp(rng.UniformFloat(), -10, 10),
+                  Lerp(rng.UniformFloat(), -5, 5));
+        for (int s = 0; s < nTimeSamples; ++s) {
+            Vector3f offset(4 * (rng.UniformFloat() - .5f),
+                            4 * (rng.UniformFloat() - .5f), 0);
+            Point3f *ps = &p[s * 3 * nTris + 3 * i];
+            ps[0] = c + offset + Vector3f(-.5, -.5, 0);
+            ps[1] = c + offset + Vector3f(.5, -.5, 0);
+            ps[2] = c + offset + Vector3f(0, .5, 0);
+        }
+        indices.insert(indices.end(), {3 * i, 3 * i + 1, 3 * i + 2});
+    }
+    Transform identity;
+    std::vector<std::shared_ptr<Shape>> tris = CreateTriangleMesh(
+        &identity, &identity, false, nTris, &indices[0], 3 * nTris, &p[0],
+        nullptr, nullptr, nullptr, nullptr, nullptr, nTimeSamples, 0, 1);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const auto &tri : tris)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            tri, nullptr, nullptr, MediumInterface()));
+
+    // Plus a few rigidly moving and rotating instances of it
+    std::shared_ptr<BVHAccel> meshBVH = std::make_shared<BVHAccel>(prims, 4);
+    Transform t0 = Translate(Vector3f(0, 0, 20)),
+              t1 = Translate(Vector3f(5, 0, 25)) * RotateZ(60);
+    AnimatedTransform moving(&t0, .2f, &t1, .7f);
+    std::shared_ptr<Primitive> meshPrim = meshBVH;
+    prims.push_back(std::make_shared<TransformedPrimitive>(meshPrim, moving));
+
+    BVHAccel motionBVH(prims, 4, BVHAccel::SplitMethod::SAH, 0, 5);
+    auto checkMotionBVH = [&]() {
+        BVHAccel reference(prims, 4);
+        int nHits = 0;
+        for (int i = 0; i < 5000; ++i) {
+            Point3f o(Lerp(rng.UniformFloat(), -12, 12),
+                      Lerp(rng.UniformFloat(), -12, 12), -20);
+            Vector3f d(.05f * (rng.UniformFloat() - .5f),
+                       .05f * (rng.UniformFloat() - .5f), 1);
+            // Include a few times outside of the motion range
+            Float time = Lerp(rng.UniformFloat(), -.1f, 1.1f);
+            Ray r0(o, d, Infinity, time), r1(o, d, Infinity, time);
+            SurfaceInteraction i0, i1;
+            bool hit = reference.Intersect(r0, &i0);
+            EXPECT_EQ(hit, motionBVH.Intersect(r1, &i1));
+            if (hit) {
+                ++nHits;
+                EXPECT_EQ(r0.tMax, r1.tMax);
+            }
+            EXPECT_EQ(reference.IntersectP(Ray(o, d, Infinity, time)),
+                      motionBVH.IntersectP(Ray(o, d, Infinity, time)));
+        }
+        EXPECT_GT(nHits, 0);
+    };
+    checkMotionBVH();
+
+    // Updating the vertices replaces all of the mesh's time samples
+    std::shared_ptr<TriangleMesh> mesh =
+        ((Triangle *)tris[0].get())->GetMesh();
+    for (int s = 1; s < nTimeSamples; ++s)
+        for (int i = 0; i < 3 * nTris; ++i)
+            p[s * 3 * nTris + i] += Vector3f(s, -s, 0);
+    mesh->UpdateVertices(identity, &p[0]);
+    EXPECT_EQ(p[3 * nTris * (nTimeSamples - 1)], mesh->P(0, 1));
+    meshBVH->Refit();
+    motionBVH.Refit();
+    checkMotionBVH();
+}
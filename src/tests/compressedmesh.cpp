@@ -0,0 +1,194 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "interaction.h"
+#include "primitive.h"
+#include "accelerators/bvh.h"
+#include "shapes/triangle.h"
+#include "shapes/compressedmesh.h"
+#include "textures/constant.h"
+
+using namespace pbrt;
+
+// Creates an _n_ x _n_ bumpy grid of quads split into triangles, with
+// normals and $(u,v)$s.
+static std::vector<std::shared_ptr<Shape>> BumpyGrid(
+    const Transform *o2w, const Transform *w2o, int n,
+    std::shared_ptr<TriangleMesh> *compressedMesh = nullptr) {
+    std::vector<Point3f> p;
+    std::vector<Normal3f> nrm;
+    std::vector<Point2f> uv;
+    for (int y = 0; y <= n; ++y)
+        for (int x = 0; x <= n; ++x) {
+            Float u = Float(x) / n, v = Float(y) / n;
+            Float h = .05f * std::sin(20 * u) * std::cos(17 * v);
+            p.push_back(Point3f(10 * u - 5, 10 * v - 5, h));
+            nrm.push_back(Normalize(
+                Normal3f(-std::cos(20 * u) * std::cos(17 * v),
+                         std::sin(20 * u) * std::sin(17 * v), 1)));
+            uv.push_back(Point2f(u, v));
+        }
+    std::vector<int> indices;
+    for (int y = 0; y < n; ++y)
+        for (int x = 0; x < n; ++x) {
+            int v00 = y * (n + 1) + x, v10 = v00 + 1;
+            int v01 = v00 + n + 1, v11 = v01 + 1;
+            indices.insert(indices.end(), {v00, v10, v11, v00, v11, v01});
+        }
+    return CreateTriangleMesh(o2w, w2o, false, indices.size() / 3,
+                              indices.data(), p.size(), p.data(), nullptr,
+                              nrm.data(), uv.data(), nullptr, nullptr, 1, 0,
+                              1, compressedMesh);
+}
+
+TEST(Half, RoundTrip) {
+    for (float f : {0.f, 1.f, -2.f, .5f, 65504.f, 6.103515625e-05f})
+        EXPECT_EQ(f, HalfToFloat(FloatToHalf(f)));
+    EXPECT_EQ(Infinity, HalfToFloat(FloatToHalf(1e6f)));
+    RNG rng;
+    for (int i = 0; i < 1000; ++i) {
+        float f = 100 * (rng.UniformFloat() - .5f);
+        EXPECT_LE(std::abs(HalfToFloat(FloatToHalf(f)) - f),
+                  std::abs(f) / 2048);
+    }
+}
+
+// Checks that _CompressedTriangleMesh_ finds the same hits as a BVH of the
+// mesh's _Triangle_s, up to quantization.
+TEST(CompressedTriangleMesh, MatchesTriangles) {
+    Transform identity;
+    std::vector<std::shared_ptr<Shape>> tris =
+        BumpyGrid(&identity, &identity, 100);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (const auto &s : tris)
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            s, nullptr, nullptr, MediumInterface()));
+    BVHAccel bvh(prims);
+    const TriangleMesh &mesh =
+        *static_cast<const Triangle *>(tris[0].get())->GetMesh();
+    ASSERT_TRUE(CompressedTriangleMesh::Supports(mesh));
+    CompressedTriangleMesh compressed(mesh, false, nullptr,
+                                      MediumInterface());
+
+    Bounds3f b = bvh.WorldBound(), bc = compressed.WorldBound();
+    for (int c = 0; c < 3; ++c) {
+        EXPECT_NEAR(b.pMin[c], bc.pMin[c], 1e-3);
+        EXPECT_NEAR(b.pMax[c], bc.pMax[c], 1e-3);
+    }
+
+    RNG rng;
+    int nHits = 0;
+    for (int i = 0; i < 10000; ++i) {
+        Point3f o(12 * rng.UniformFloat() - 6, 12 * rng.UniformFloat() - 6,
+                  2 + rng.UniformFloat());
+        Vector3f d(rng.UniformFloat() - .5f, rng.UniformFloat() - .5f, -1);
+        Ray r(o, d), rc(o, d);
+        SurfaceInteraction isect, isectc;
+        bool hit = bvh.Intersect(r, &isect);
+        EXPECT_EQ(hit, compressed.IntersectP(Ray(o, d)));
+        ASSERT_EQ(hit, compressed.Intersect(rc, &isectc));
+        if (!hit) continue;
+        ++nHits;
+        EXPECT_NEAR(r.tMax, rc.tMax, 1e-3);
+        EXPECT_EQ(&compressed, isectc.primitive);
+        EXPECT_GT(Dot(isect.n, isectc.n), .999f);
+        EXPECT_GT(Dot(isect.shading.n, isectc.shading.n), .999f);
+        EXPECT_NEAR(isect.uv[0], isectc.uv[0], 2e-3);
+        EXPECT_NEAR(isect.uv[1], isectc.uv[1], 2e-3);
+    }
+    EXPECT_GT(nHits, 5000);
+
+    // Flipped orientation
+    CompressedTriangleMesh flipped(mesh, true, nullptr, MediumInterface());
+    Ray r(Point3f(.1, .2, 1), Vector3f(0, 0, -1));
+    SurfaceInteraction isect;
+    ASSERT_TRUE(flipped.Intersect(r, &isect));
+    EXPECT_LT(isect.n.z, 0);
+    EXPECT_LT(isect.shading.n.z, 0);
+}
+
+// Rays aimed exactly at vertices and edges must never slip through the
+// mesh, including along meshlet boundaries.
+TEST(CompressedTriangleMesh, Watertight) {
+    Transform identity;
+    int n = 64;
+    std::vector<std::shared_ptr<Shape>> tris =
+        BumpyGrid(&identity, &identity, n);
+    const TriangleMesh &mesh =
+        *static_cast<const Triangle *>(tris[0].get())->GetMesh();
+    CompressedTriangleMesh compressed(mesh, false, nullptr,
+                                      MediumInterface());
+    RNG rng;
+    for (int y = 1; y < n; ++y)
+        for (int x = 1; x < n; ++x) {
+            // Aim at a vertex and the midpoints of two of its edges
+            Point3f p = mesh.p[y * (n + 1) + x];
+            Point3f targets[3] = {p, (p + mesh.p[y * (n + 1) + x + 1]) / 2,
+                                  (p + mesh.p[(y + 1) * (n + 1) + x]) / 2};
+            for (const Point3f &target : targets) {
+                Point3f o(target.x + rng.UniformFloat() - .5f,
+                          target.y + rng.UniformFloat() - .5f, 3);
+                EXPECT_TRUE(compressed.IntersectP(Ray(o, target - o)));
+            }
+        }
+}
+
+// A large triangle elsewhere in the mesh mustn't reduce the precision of
+// small, detailed parts of it.
+TEST(CompressedTriangleMesh, MeshletPrecision) {
+    Transform identity, tiny = Scale(1e-3f, 1e-3f, 1e-3f);
+    std::vector<std::shared_ptr<Shape>> tris = BumpyGrid(&tiny, &tiny, 64);
+    const TriangleMesh &grid =
+        *static_cast<const Triangle *>(tris[0].get())->GetMesh();
+    std::vector<Point3f> p(grid.p.get(), grid.p.get() + grid.nVertices);
+    std::vector<int> indices = grid.vertexIndices;
+    int nv = p.size();
+    p.insert(p.end(), {Point3f(1e4f, 0, 0), Point3f(2e4f, 0, 0),
+                       Point3f(1e4f, 1e4f, 0)});
+    indices.insert(indices.end(), {nv, nv + 1, nv + 2});
+    TriangleMesh mesh(identity, indices.size() / 3, indices.data(),
+                      p.size(), p.data(), nullptr, nullptr, nullptr, nullptr,
+                      nullptr);
+    CompressedTriangleMesh compressed(mesh, false, nullptr,
+                                      MediumInterface());
+
+    RNG rng;
+    for (int i = 0; i < 1000; ++i) {
+        // Compare against the exact heights of the grid's triangles
+        int t = rng.UniformUInt32(grid.nTriangles);
+        const int *v = &grid.vertexIndices[3 * t];
+        Float b0 = .1f + .3f * rng.UniformFloat(),
+              b1 = .1f + .3f * rng.UniformFloat();
+        Point3f target = b0 * grid.p[v[0]] + b1 * grid.p[v[1]] +
+                         (1 - b0 - b1) * grid.p[v[2]];
+        Ray r(Point3f(target.x, target.y, 1), Vector3f(0, 0, -1));
+        SurfaceInteraction isect;
+        ASSERT_TRUE(compressed.Intersect(r, &isect));
+        EXPECT_NEAR(target.z, isect.p.z, 1e-7);
+    }
+}
+
+// Checks that meshes to be compressed are returned without creating their
+// _Triangle_s.
+TEST(CompressedTriangleMesh, CreatedWithoutTriangles) {
+    Transform identity;
+    std::shared_ptr<TriangleMesh> mesh;
+    std::vector<std::shared_ptr<Shape>> tris =
+        BumpyGrid(&identity, &identity, 10, &mesh);
+    EXPECT_TRUE(tris.empty());
+    ASSERT_TRUE(mesh != nullptr);
+    EXPECT_EQ(200, mesh->nTriangles);
+
+    // Meshes that can't be compressed are still returned as _Triangle_s
+    Point3f p[3] = {Point3f(0, 0, 0), Point3f(1, 0, 0), Point3f(0, 1, 0)};
+    int indices[3] = {0, 1, 2};
+    std::shared_ptr<Texture<Float>> alpha =
+        std::make_shared<ConstantTexture<Float>>(0.f);
+    mesh.reset();
+    tris = CreateTriangleMesh(&identity, &identity, false, 1, indices, 3, p,
+                              nullptr, nullptr, nullptr, alpha, nullptr, 1, 0,
+                              1, &mesh);
+    EXPECT_EQ(1, tris.size());
+    EXPECT_TRUE(mesh == nullptr);
+}
@@ -81,3 +81,59 @@ TEST(ImageIO, RoundTripPFM) { TestRoundTrip("out.pfm", false); }
 TEST(ImageIO, RoundTripTGA) { TestRoundTrip("out.tga", true); }
 
 TEST(ImageIO, RoundTripPNG) { TestRoundTrip("out.png", true); }
+
+TEST(ImageIO, EXRLayers) {
+    // Write a cropped image that spans several of the writer's row blocks
+    // along with a second layer
+    Point2i res(20, 150);
+    Bounds2i bounds(Point2i(3, 5), Point2i(19, 146));
+    Vector2i size = bounds.Diagonal();
+    auto value = [](int x, int y, int c) { return Float(x + 2 * y + c); };
+    ImageLayer beauty{"", [&](int y0, int y1, Float *rgb) {
+        for (int y = y0; y < y1; ++y)
+            for (int x = 0; x < size.x; ++x)
+                for (int c = 0; c < 3; ++c)
+                    *rgb++ = value(x, y, c);
+    }};
+    ImageLayer normal{"normal", [&](int y0, int y1, Float *rgb) {
+        for (int i = 0; i < 3 * size.x * (y1 - y0); ++i) rgb[i] = -1;
+    }};
+    WriteImageLayers("layers.exr", {beauty, normal}, bounds, res,
+                     EXRCompression::PIZ);
+
+    // The unprefixed channels hold the beauty image
+    int width, height;
+    Bounds2i dataWindow, displayWindow;
+    std::unique_ptr<RGBSpectrum[]> pixels(ReadImageEXR(
+        "layers.exr", &width, &height, &dataWindow, &displayWindow));
+    ASSERT_TRUE(pixels.get() != nullptr);
+    EXPECT_EQ(bounds, dataWindow);
+    EXPECT_EQ(Bounds2i(Point2i(0, 0), res), displayWindow);
+    for (int y = 0; y < size.y; ++y)
+        for (int x = 0; x < size.x; ++x) {
+            Float rgb[3];
+            pixels[y * size.x + x].ToRGB(rgb);
+            for (int c = 0; c < 3; ++c)
+                EXPECT_EQ(value(x, y, c), rgb[c]) << x << ", " << y;
+        }
+}
+
+TEST(ImageIO, RGB8) {
+    // 8-bit values are returned as stored, matching _ReadImage()_
+    Point2i res(13, 7);
+    std::vector<Float> pixels(3 * res.x * res.y);
+    for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = (i % 17) / 16.f;
+    for (const char *fn : {"out8.png", "out8.tga"}) {
+        WriteImage(fn, &pixels[0], Bounds2i({0, 0}, res), res);
+        Point2i res8, resSpectrum;
+        std::unique_ptr<uint8_t[]> rgb8 = ReadImageRGB8(fn, &res8);
+        std::unique_ptr<RGBSpectrum[]> rgb = ReadImage(fn, &resSpectrum);
+        ASSERT_TRUE(rgb8.get() != nullptr && rgb.get() != nullptr);
+        EXPECT_EQ(res, res8);
+        EXPECT_EQ(res, resSpectrum);
+        for (int i = 0; i < res.x * res.y; ++i)
+            for (int c = 0; c < 3; ++c)
+                EXPECT_EQ(rgb8[3 * i + c] / 255.f, rgb[i][c]) << fn;
+    }
+    EXPECT_TRUE(ReadImageRGB8("out.pfm", &res) == nullptr);
+}
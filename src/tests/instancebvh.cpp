@@ -0,0 +1,98 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "interaction.h"
+#include "primitive.h"
+#include "sampling.h"
+#include "shapes/sphere.h"
+#include "accelerators/bvh.h"
+#include "accelerators/instancebvh.h"
+
+using namespace pbrt;
+
+static Transform RandomInstanceTransform(RNG &rng) {
+    auto r = [&rng](Float a, Float b) {
+        return Lerp(rng.UniformFloat(), a, b);
+    };
+    Vector3f axis =
+        UniformSampleSphere(Point2f(rng.UniformFloat(), rng.UniformFloat()));
+    return Translate(Vector3f(r(-20, 20), r(-20, 20), r(-5, 5))) *
+           Rotate(r(0, 360), axis) * Scale(r(.5, 2), r(.5, 2), r(.5, 2));
+}
+
+// Checks that _InstanceBVHAccel_ matches a BVH of _TransformedPrimitive_s,
+// with each prototype itself made of nested instances of a few spheres.
+TEST(InstanceBVH, MatchesTransformedPrimitive) {
+    RNG rng;
+    Transform identity;
+    std::shared_ptr<Shape> sphere = std::make_shared<Sphere>(
+        &identity, &identity, false, 1, -1, 1, 360);
+    std::shared_ptr<Primitive> spherePrim =
+        std::make_shared<GeometricPrimitive>(sphere, nullptr, nullptr,
+                                             MediumInterface());
+    std::vector<std::shared_ptr<Primitive>> unitSphere = {spherePrim};
+
+    // Build a nested prototype both ways; _AnimatedTransform_ holds on to
+    // pointers to the transforms, so they're all kept in _transforms_.
+    std::vector<Transform> transforms;
+    transforms.reserve(505);
+    std::vector<std::shared_ptr<Primitive>> nestedRef;
+    std::vector<InstanceBVHAccel::Instance> nestedInstances;
+    for (int i = 0; i < 5; ++i) {
+        transforms.push_back(Translate(Vector3f(3 * i, 0, 0)) *
+                             Scale(1, 1 + .2f * i, 1));
+        AnimatedTransform at(&transforms.back(), 0, &transforms.back(), 1);
+        nestedRef.push_back(
+            std::make_shared<TransformedPrimitive>(spherePrim, at));
+        nestedInstances.push_back(
+            {CompactTransform(transforms.back().GetMatrix()), 0});
+    }
+    std::vector<std::shared_ptr<Primitive>> prototypesRef = {
+        std::make_shared<BVHAccel>(nestedRef)};
+    std::vector<std::shared_ptr<Primitive>> prototypes = {
+        std::make_shared<InstanceBVHAccel>(unitSphere, nestedInstances)};
+
+    // Instance the prototype many times at the top level
+    std::vector<std::shared_ptr<Primitive>> instancesRef;
+    std::vector<InstanceBVHAccel::Instance> instances;
+    for (int i = 0; i < 500; ++i) {
+        transforms.push_back(RandomInstanceTransform(rng));
+        AnimatedTransform at(&transforms.back(), 0, &transforms.back(), 1);
+        instancesRef.push_back(
+            std::make_shared<TransformedPrimitive>(prototypesRef[0], at));
+        instances.push_back(
+            {CompactTransform(transforms.back().GetMatrix()), 0});
+    }
+    BVHAccel reference(instancesRef);
+    InstanceBVHAccel instanceBVH(prototypes, instances);
+
+    Bounds3f refBounds = reference.WorldBound(),
+             bounds = instanceBVH.WorldBound();
+    for (int c = 0; c < 3; ++c) {
+        EXPECT_NEAR(refBounds.pMin[c], bounds.pMin[c], 1e-3);
+        EXPECT_NEAR(refBounds.pMax[c], bounds.pMax[c], 1e-3);
+    }
+
+    int nHits = 0;
+    for (int i = 0; i < 2000; ++i) {
+        Point3f o(Lerp(rng.UniformFloat(), -25, 25),
+                  Lerp(rng.UniformFloat(), -25, 25), -30);
+        Point3f target(Lerp(rng.UniformFloat(), -25, 25),
+                       Lerp(rng.UniformFloat(), -25, 25), 0);
+        Ray r0(o, target - o), r1(o, target - o);
+        SurfaceInteraction i0, i1;
+        bool hit = reference.Intersect(r0, &i0);
+        EXPECT_EQ(hit, instanceBVH.Intersect(r1, &i1));
+        if (hit) {
+            ++nHits;
+            EXPECT_NEAR(r0.tMax, r1.tMax, 1e-4f * r0.tMax);
+            EXPECT_EQ(i0.primitive, i1.primitive);
+            EXPECT_LT(Distance(i0.p, i1.p), 1e-4f * Distance(o, i0.p));
+            EXPECT_GT(Dot(i0.n, i1.n), .999f);
+        }
+        EXPECT_EQ(reference.IntersectP(Ray(o, target - o)),
+                  instanceBVH.IntersectP(Ray(o, target - o)));
+    }
+    EXPECT_GT(nHits, 0);
+}
@@ -0,0 +1,98 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "interaction.h"
+#include "primitive.h"
+#include "parallel.h"
+#include "sampling.h"
+#include "shapes/sphere.h"
+#include "accelerators/bvh.h"
+#include "accelerators/kdtreeaccel.h"
+
+using namespace pbrt;
+
+// Compares a kd-tree built with multiple threads against a BVH, for both
+// single rays and packets.
+TEST(KdTree, ParallelBuildAndPackets) {
+    int nThreads = PbrtOptions.nThreads;
+    PbrtOptions.nThreads = 4;
+    ParallelInit();
+
+    // Enough spheres that the top nodes' edges are sorted in parallel
+    RNG rng;
+    const int nSpheres = 40000;
+    std::vector<Transform> transforms;
+    transforms.reserve(2 * nSpheres);
+    std::vector<std::shared_ptr<Primitive>> prims;
+    for (int i = 0; i < nSpheres; ++i) {
+        Vector3f p(Lerp(rng.UniformFloat(), -10, 10),
+                   Lerp(rng.UniformFloat(), -10, 10),
+                   Lerp(rng.UniformFloat(), -10, 10));
+        transforms.push_back(Translate(p));
+        transforms.push_back(Translate(-p));
+        Float radius = Lerp(rng.UniformFloat(), .01, .1);
+        std::shared_ptr<Shape> sphere = std::make_shared<Sphere>(
+            &transforms[2 * i], &transforms[2 * i + 1], false, radius, -radius,
+            radius, 360);
+        prims.push_back(std::make_shared<GeometricPrimitive>(
+            sphere, nullptr, nullptr, MediumInterface()));
+    }
+    KdTreeAccel kdTree(prims);
+    BVHAccel bvh(prims, 4);
+
+    // Rays in all directions, some starting inside the tree's bounds
+    const int nRays = 1000;
+    std::vector<Ray> rays;
+    for (int i = 0; i < nRays; ++i) {
+        Point3f o(Lerp(rng.UniformFloat(), -15, 15),
+                  Lerp(rng.UniformFloat(), -15, 15),
+                  Lerp(rng.UniformFloat(), -15, 15));
+        Vector3f d = UniformSampleSphere(
+            Point2f(rng.UniformFloat(), rng.UniformFloat()));
+        Float tMax = rng.UniformFloat() < .25f ? 5 : Infinity;
+        rays.push_back(Ray(o, d, tMax));
+    }
+    std::vector<Ray> batchRays = rays;
+    std::vector<SurfaceInteraction> isects(nRays);
+    std::unique_ptr<bool[]> hits(new bool[nRays]);
+    kdTree.IntersectBatch(&batchRays[0], nRays, &isects[0], hits.get());
+    std::unique_ptr<bool[]> occluded(new bool[nRays]);
+    kdTree.IntersectPBatch(&rays[0], nRays, occluded.get());
+
+    int nHits = 0;
+    for (int i = 0; i < nRays; ++i) {
+        Ray r0 = rays[i], r1 = rays[i];
+        SurfaceInteraction i0, i1;
+        bool hit = bvh.Intersect(r0, &i0);
+        EXPECT_EQ(hit, kdTree.Intersect(r1, &i1));
+        EXPECT_EQ(hit, hits[i]);
+        if (hit) {
+            ++nHits;
+            EXPECT_EQ(i0.primitive, i1.primitive);
+            EXPECT_EQ(r0.tMax, r1.tMax);
+            EXPECT_EQ(r0.tMax, batchRays[i].tMax);
+            EXPECT_EQ(i0.primitive, isects[i].primitive);
+        }
+        EXPECT_EQ(bvh.IntersectP(rays[i]), kdTree.IntersectP(rays[i]));
+        EXPECT_EQ(hit, occluded[i]);
+    }
+    EXPECT_GT(nHits, 0);
+
+    // Trees built inside a parallel loop, as instance prototypes are, run
+    // their parallel sorts and subtree builds as nested loops
+    std::vector<std::unique_ptr<KdTreeAccel>> nestedTrees(2);
+    ParallelFor([&](int64_t i) {
+        nestedTrees[i].reset(new KdTreeAccel(prims));
+    }, nestedTrees.size(), 1);
+    for (const auto &tree : nestedTrees)
+        for (int i = 0; i < nRays; ++i) {
+            Ray r0 = rays[i], r1 = rays[i];
+            SurfaceInteraction i0, i1;
+            EXPECT_EQ(kdTree.Intersect(r0, &i0), tree->Intersect(r1, &i1));
+            EXPECT_EQ(i0.primitive, i1.primitive);
+        }
+
+    ParallelCleanup();
+    PbrtOptions.nThreads = nThreads;
+}
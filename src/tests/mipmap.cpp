@@ -0,0 +1,317 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "mipmap.h"
+#include "parallel.h"
+
+using namespace pbrt;
+
+// Checks that lookups in MIP maps whose levels are paged in from the
+// texture cache match lookups in ones held in memory, with a budget small
+// enough that tiles are evicted and read again. The budget is larger than
+// the tiles the threads can hold on to, so all tiles in memory must fit.
+template <typename T>
+static void TestTextureCache(const Point2i &res, ImageWrap wrap) {
+    RNG rng;
+    std::vector<T> texels(res.x * res.y);
+    for (T &t : texels) t = T(rng.UniformFloat());
+
+    int cacheMB = PbrtOptions.textureCacheMB;
+    PbrtOptions.textureCacheMB = 4;
+    MIPMap<T> memory(res, texels.data(), MIPFilter::EWA, 8.f, wrap);
+    MIPMap<T> cached(res, texels.data(), MIPFilter::EWA, 8.f, wrap, true);
+
+    const int n = 20000;
+    std::vector<Point2f> st(n);
+    std::vector<Vector2f> dst0(n), dst1(n);
+    for (int i = 0; i < n; ++i) {
+        st[i] = Point2f(3 * rng.UniformFloat() - 1, 3 * rng.UniformFloat() - 1);
+        Float scale = std::pow(2.f, -12 * rng.UniformFloat());
+        dst0[i] = scale * Vector2f(rng.UniformFloat() - .5f,
+                                   rng.UniformFloat() - .5f);
+        dst1[i] = .3f * scale * Vector2f(rng.UniformFloat() - .5f,
+                                         rng.UniformFloat() - .5f);
+    }
+    std::vector<T> expected(n), trilinear(n), ewa(n);
+    for (int i = 0; i < n; ++i)
+        expected[i] = memory.Lookup(st[i], dst0[i], dst1[i]);
+    ParallelFor([&](int64_t i) {
+        trilinear[i] = cached.Lookup(st[i], dst0[i].Length());
+        ewa[i] = cached.Lookup(st[i], dst0[i], dst1[i]);
+    }, n, 256);
+    for (int i = 0; i < n; ++i) {
+        EXPECT_TRUE(ewa[i] == expected[i]) << i;
+        EXPECT_TRUE(trilinear[i] == memory.Lookup(st[i], dst0[i].Length()))
+            << i;
+    }
+    EXPECT_LE(textureCache.BytesUsed(),
+              (4 << 20) + TiledLevels::TileRes * TiledLevels::TileRes *
+                              sizeof(T));
+    PbrtOptions.textureCacheMB = cacheMB;
+}
+
+TEST(MIPMap, TextureCache) {
+    int nThreads = PbrtOptions.nThreads;
+    PbrtOptions.nThreads = 4;
+    ParallelInit();
+    TestTextureCache<RGBSpectrum>(Point2i(1400, 600), ImageWrap::Repeat);
+    TestTextureCache<Float>(Point2i(1024, 1024), ImageWrap::Black);
+    TestTextureCache<Float>(Point2i(37, 5), ImageWrap::Clamp);
+    ParallelCleanup();
+    PbrtOptions.nThreads = nThreads;
+}
+
+// Checks that MIP maps read from a MIP map file, either in place or paged
+// through the texture cache, match the MIP map the file was written from.
+TEST(MIPMap, TiledFile) {
+    RNG rng;
+    Point2i res(300, 70);
+    std::vector<RGBSpectrum> texels(res.x * res.y);
+    for (RGBSpectrum &t : texels) {
+        Float rgb[3] = {rng.UniformFloat(), rng.UniformFloat(),
+                        rng.UniformFloat()};
+        t = RGBSpectrum::FromRGB(rgb);
+    }
+    MIPMap<RGBSpectrum> memory(res, texels.data());
+
+    std::vector<Point2i> levelResolution;
+    for (int level = 0; level < memory.Levels(); ++level)
+        levelResolution.push_back(memory.LevelResolution(level));
+    const int TileRes = TiledLevels::TileRes;
+    ASSERT_TRUE(WriteTiledMIPMapFile(
+        "test.mip", levelResolution, 3,
+        [&](int level, int tx, int ty, float *dst) {
+            const Point2i &lres = levelResolution[level];
+            for (int t = ty * TileRes;
+                 t < std::min(lres.y, (ty + 1) * TileRes); ++t)
+                for (int s = tx * TileRes;
+                     s < std::min(lres.x, (tx + 1) * TileRes); ++s) {
+                    Float rgb[3];
+                    memory.Texel(level, s, t).ToRGB(rgb);
+                    for (int c = 0; c < 3; ++c) *dst++ = rgb[c];
+                }
+        }));
+
+    std::shared_ptr<const TiledMIPMapFile> mipFile =
+        TiledMIPMapFile::Read("test.mip");
+    ASSERT_TRUE(mipFile != nullptr);
+    EXPECT_EQ(3, mipFile->Channels());
+    ASSERT_EQ(memory.Levels(), mipFile->Levels().Levels());
+    int cacheMB = PbrtOptions.textureCacheMB;
+    PbrtOptions.textureCacheMB = 1;
+    MIPMap<RGBSpectrum> mapped(mipFile, MIPFilter::EWA, 8.f, ImageWrap::Repeat);
+    MIPMap<RGBSpectrum> cached(mipFile, MIPFilter::EWA, 8.f,
+                               ImageWrap::Repeat, true);
+    mipFile.reset();
+
+    for (int i = 0; i < 10000; ++i) {
+        Point2f st(rng.UniformFloat(), rng.UniformFloat());
+        Float scale = std::pow(2.f, -10 * rng.UniformFloat());
+        Vector2f dst0 = scale * Vector2f(rng.UniformFloat() - .5f,
+                                         rng.UniformFloat() - .5f);
+        Vector2f dst1 = .5f * scale * Vector2f(rng.UniformFloat() - .5f,
+                                               rng.UniformFloat() - .5f);
+        RGBSpectrum expected = memory.Lookup(st, dst0, dst1);
+        EXPECT_TRUE(expected == mapped.Lookup(st, dst0, dst1)) << i;
+        EXPECT_TRUE(expected == cached.Lookup(st, dst0, dst1)) << i;
+    }
+    PbrtOptions.textureCacheMB = cacheMB;
+    EXPECT_EQ(0, remove("test.mip"));
+}
+
+// Checks that images are stored in the most compact encoding that
+// represents them exactly and that filtering them stays close to
+// filtering the same image at full precision.
+TEST(MIPMap, CompactEncoding) {
+    RNG rng;
+    Point2i res(128, 64);
+    int nTexels = res.x * res.y;
+    std::vector<RGBSpectrum> srgb(nTexels), linear(nTexels), half(nTexels),
+        full(nTexels), grey(nTexels);
+    for (int i = 0; i < nTexels; ++i) {
+        Float rgb8[3], rgbHalf[3], rgb[3];
+        for (int c = 0; c < 3; ++c) {
+            rgb8[c] = rng.UniformUInt32(256) / 255.f;
+            rgbHalf[c] = HalfToFloat(FloatToHalf(4 * rng.UniformFloat()));
+            rgb[c] = rng.UniformFloat();
+        }
+        linear[i] = RGBSpectrum::FromRGB(rgb8);
+        for (int c = 0; c < 3; ++c) srgb[i][c] = InverseGammaCorrect(rgb8[c]);
+        half[i] = RGBSpectrum::FromRGB(rgbHalf);
+        full[i] = RGBSpectrum::FromRGB(rgb);
+        grey[i] = RGBSpectrum(rgb[0]);
+    }
+    EXPECT_TRUE(TexelEncoding::sRGB8 ==
+                CompactTexelEncoding(srgb.data(), nTexels));
+    EXPECT_TRUE(TexelEncoding::Linear8 ==
+                CompactTexelEncoding(linear.data(), nTexels));
+    EXPECT_TRUE(TexelEncoding::Half ==
+                CompactTexelEncoding(half.data(), nTexels));
+    EXPECT_TRUE(TexelEncoding::Float ==
+                CompactTexelEncoding(full.data(), nTexels));
+
+    MIPMap<RGBSpectrum> greyMIPMap(res, grey.data());
+    EXPECT_EQ(1, greyMIPMap.Format().nChannels);
+    EXPECT_EQ(4, greyMIPMap.Format().texelBytes);
+
+    for (const std::vector<RGBSpectrum> *image : {&srgb, &linear, &half}) {
+        TexelEncoding encoding = CompactTexelEncoding(image->data(), nTexels);
+        MIPMap<RGBSpectrum> compact(res, image->data(), MIPFilter::EWA, 8.f,
+                                    ImageWrap::Repeat, false, encoding);
+        MIPMap<RGBSpectrum> reference(res, image->data());
+        EXPECT_EQ(3, compact.Format().nChannels);
+        EXPECT_GT(reference.Format().texelBytes,
+                  compact.Format().texelBytes);
+
+        // The finest level is represented exactly
+        for (int t = 0; t < res.y; ++t)
+            for (int s = 0; s < res.x; ++s)
+                EXPECT_TRUE(compact.Texel(0, s, t) ==
+                            (*image)[t * res.x + s]);
+
+        // Filtered levels are quantized
+        for (int i = 0; i < 1000; ++i) {
+            Point2f st(rng.UniformFloat(), rng.UniformFloat());
+            Vector2f dst0 = .1f * Vector2f(rng.UniformFloat() - .5f,
+                                           rng.UniformFloat() - .5f);
+            Vector2f dst1 = .05f * Vector2f(rng.UniformFloat() - .5f,
+                                            rng.UniformFloat() - .5f);
+            RGBSpectrum expected = reference.Lookup(st, dst0, dst1);
+            RGBSpectrum v = compact.Lookup(st, dst0, dst1);
+            for (int c = 0; c < 3; ++c)
+                EXPECT_LT(std::abs(v[c] - expected[c]),
+                          .01f * std::max((Float)1, expected[c]))
+                    << i;
+        }
+    }
+
+    // Resampling to a power-of-two resolution changes the texels, so they
+    // can't be stored in the image's 8-bit encoding; the finest level still
+    // matches the resampled image exactly
+    Point2i resNPOT(100, 50);
+    MIPMap<RGBSpectrum> compact(resNPOT, srgb.data(), MIPFilter::EWA, 8.f,
+                                ImageWrap::Repeat, false,
+                                TexelEncoding::sRGB8);
+    MIPMap<RGBSpectrum> reference(resNPOT, srgb.data());
+    EXPECT_TRUE(TexelEncoding::sRGB8 != compact.Format().encoding);
+    ASSERT_EQ(128, compact.Width());
+    for (int t = 0; t < compact.Height(); ++t)
+        for (int s = 0; s < compact.Width(); ++s)
+            EXPECT_TRUE(compact.Texel(0, s, t) == reference.Texel(0, s, t));
+}
+
+// EWA filtering as it was written before texels were filtered a row at a
+// time, visiting each texel in the ellipse's bounding box.
+template <typename T>
+static T ReferenceEWA(const MIPMap<T> &mipmap, int level, Point2f st,
+                      Vector2f dst0, Vector2f dst1) {
+    if (level >= mipmap.Levels())
+        return mipmap.Texel(mipmap.Levels() - 1, 0, 0);
+    Point2i res = mipmap.LevelResolution(level);
+    st[0] = st[0] * res.x - 0.5f;
+    st[1] = st[1] * res.y - 0.5f;
+    dst0[0] *= res.x;
+    dst0[1] *= res.y;
+    dst1[0] *= res.x;
+    dst1[1] *= res.y;
+    Float A = dst0[1] * dst0[1] + dst1[1] * dst1[1] + 1;
+    Float B = -2 * (dst0[0] * dst0[1] + dst1[0] * dst1[1]);
+    Float C = dst0[0] * dst0[0] + dst1[0] * dst1[0] + 1;
+    Float invF = 1 / (A * C - B * B * 0.25f);
+    A *= invF;
+    B *= invF;
+    C *= invF;
+    Float det = -B * B + 4 * A * C;
+    Float invDet = 1 / det;
+    Float uSqrt = std::sqrt(det * C), vSqrt = std::sqrt(A * det);
+    int s0 = std::ceil(st[0] - 2 * invDet * uSqrt);
+    int s1 = std::floor(st[0] + 2 * invDet * uSqrt);
+    int t0 = std::ceil(st[1] - 2 * invDet * vSqrt);
+    int t1 = std::floor(st[1] + 2 * invDet * vSqrt);
+    T sum(0.f);
+    Float sumWts = 0;
+    for (int it = t0; it <= t1; ++it) {
+        Float tt = it - st[1];
+        for (int is = s0; is <= s1; ++is) {
+            Float ss = is - st[0];
+            Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
+            if (r2 < 1) {
+                int index = std::min((int)(r2 * 128), 127);
+                Float lutR2 = Float(index) / Float(127);
+                Float weight = std::exp(-2 * lutR2) - std::exp(Float(-2));
+                sum += mipmap.Texel(level, is, it) * weight;
+                sumWts += weight;
+            }
+        }
+    }
+    return sum / sumWts;
+}
+
+// Checks that filtering texels a row at a time matches visiting them one
+// by one, for footprints that cross the edges of the texture.
+TEST(MIPMap, EWARows) {
+    RNG rng;
+    Point2i res(256, 128);
+    std::vector<RGBSpectrum> texels(res.x * res.y);
+    for (RGBSpectrum &t : texels) {
+        Float rgb[3] = {rng.UniformFloat(), rng.UniformFloat(),
+                        rng.UniformFloat()};
+        t = RGBSpectrum::FromRGB(rgb);
+    }
+    const Float maxAniso = 16;
+    for (ImageWrap wrap :
+         {ImageWrap::Repeat, ImageWrap::Clamp, ImageWrap::Black}) {
+        MIPMap<RGBSpectrum> mipmap(res, texels.data(), MIPFilter::EWA,
+                                   maxAniso, wrap);
+        for (int i = 0; i < 2000; ++i) {
+            Point2f st(3 * rng.UniformFloat() - 1, 3 * rng.UniformFloat() - 1);
+            Float scale = std::pow(2.f, -9 * rng.UniformFloat());
+            Vector2f dst0 = scale * Vector2f(rng.UniformFloat() - .5f,
+                                             rng.UniformFloat() - .5f);
+            Vector2f dst1 = .1f * scale * Vector2f(rng.UniformFloat() - .5f,
+                                                   rng.UniformFloat() - .5f);
+
+            // Select the levels as _MIPMap::Lookup()_ does
+            Vector2f major = dst0, minor = dst1;
+            if (major.LengthSquared() < minor.LengthSquared())
+                std::swap(major, minor);
+            Float majorLength = major.Length(), minorLength = minor.Length();
+            if (minorLength * maxAniso < majorLength) {
+                Float s = majorLength / (minorLength * maxAniso);
+                minor *= s;
+                minorLength *= s;
+            }
+            Float lod = std::max((Float)0, mipmap.Levels() - (Float)1 +
+                                               Log2(minorLength));
+            int ilod = std::floor(lod);
+            RGBSpectrum expected =
+                Lerp(lod - ilod, ReferenceEWA(mipmap, ilod, st, major, minor),
+                     ReferenceEWA(mipmap, ilod + 1, st, major, minor));
+            EXPECT_TRUE(expected == mipmap.Lookup(st, dst0, dst1)) << i;
+        }
+    }
+}
+
+// Checks that multi-probe filtering reproduces constant textures and
+// stays within the range of the texels it filters.
+TEST(MIPMap, MultiProbe) {
+    RNG rng;
+    Point2i res(128, 128);
+    std::vector<Float> constant(res.x * res.y, .75f), texels(res.x * res.y);
+    for (Float &t : texels) t = .25f + .5f * rng.UniformFloat();
+    MIPMap<Float> constantMIPMap(res, constant.data(), MIPFilter::MultiProbe);
+    MIPMap<Float> mipmap(res, texels.data(), MIPFilter::MultiProbe);
+    for (int i = 0; i < 2000; ++i) {
+        Point2f st(rng.UniformFloat(), rng.UniformFloat());
+        Float scale = std::pow(2.f, -7 * rng.UniformFloat());
+        Vector2f dst0 = scale * Vector2f(rng.UniformFloat() - .5f,
+                                         rng.UniformFloat() - .5f);
+        Vector2f dst1 = .1f * scale * Vector2f(rng.UniformFloat() - .5f,
+                                               rng.UniformFloat() - .5f);
+        EXPECT_FLOAT_EQ(.75f, constantMIPMap.Lookup(st, dst0, dst1));
+        Float v = mipmap.Lookup(st, dst0, dst1);
+        EXPECT_GE(v, .25f);
+        EXPECT_LE(v, .75f);
+    }
+}
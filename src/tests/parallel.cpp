@@ -37,3 +37,54 @@ TEST(Parallel, DoNothing) {
 
     ParallelCleanup();
 }
+
+TEST(Parallel, AsyncTasks) {
+    // Use worker threads even if the system has a single core
+    int nThreads = PbrtOptions.nThreads;
+    PbrtOptions.nThreads = 4;
+    ParallelInit();
+
+    // Tasks may run parallel loops of their own
+    std::atomic<int> counter{0};
+    for (int i = 0; i < 20; ++i)
+        RunAsync([&]() {
+            ParallelFor([&](int64_t) { ++counter; }, 100, 7);
+        });
+    WaitForAsyncTasks();
+    EXPECT_EQ(2000, counter);
+
+    // Waiting with no pending tasks returns immediately
+    WaitForAsyncTasks();
+
+    ParallelCleanup();
+    PbrtOptions.nThreads = nThreads;
+}
+
+TEST(Parallel, ConcurrentAndNestedLoops) {
+    int nThreads = PbrtOptions.nThreads;
+    PbrtOptions.nThreads = 4;
+    ParallelInit();
+
+    // Loops are started from asynchronous tasks and from the main thread at
+    // the same time, and their iterations run loops of their own, so loops
+    // finish in a different order than they were added to the work list
+    for (int rep = 0; rep < 10; ++rep) {
+        std::atomic<int> taskCounter{0}, mainCounter{0};
+        for (int i = 0; i < 20; ++i)
+            RunAsync([&]() {
+                ParallelFor([&](int64_t) {
+                    ParallelFor([&](int64_t) { ++taskCounter; }, 50, 3);
+                }, 10, 1);
+            });
+        ParallelFor([&](int64_t) {
+            ParallelFor2D([&](Point2i) { ++mainCounter; }, Point2i(5, 4));
+            ParallelFor([&](int64_t) { ++mainCounter; }, 30, 7);
+        }, 100, 1);
+        WaitForAsyncTasks();
+        EXPECT_EQ(20 * 10 * 50, taskCounter);
+        EXPECT_EQ(100 * (5 * 4 + 30), mainCounter);
+    }
+
+    ParallelCleanup();
+    PbrtOptions.nThreads = nThreads;
+}
@@ -0,0 +1,70 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "paramset.h"
+#include "stringprint.h"
+
+using namespace pbrt;
+
+template <typename T>
+static std::unique_ptr<T[]> Values(std::initializer_list<T> v) {
+    std::unique_ptr<T[]> ret(new T[v.size()]);
+    std::copy(v.begin(), v.end(), ret.get());
+    return ret;
+}
+
+TEST(ParamSet, Lookup) {
+    ParamSet ps;
+    ps.AddFloat("radius", Values<Float>({2.5}));
+    ps.AddInt("indices", Values<int>({0, 1, 2}), 3);
+    ps.AddString("type", Values<std::string>({"cylinder"}), 1);
+    ps.AddTexture("Kd", "checks");
+
+    EXPECT_EQ(2.5, ps.FindOneFloat("radius", 1));
+    // Names are matched per type
+    EXPECT_EQ(7, ps.FindOneInt("radius", 7));
+    EXPECT_EQ("", ps.FindTexture("type"));
+    EXPECT_EQ("checks", ps.FindTexture("Kd"));
+    EXPECT_EQ("cylinder", ps.FindOneString("type", ""));
+    // FindOne*() only matches single values
+    EXPECT_EQ(-1, ps.FindOneInt("indices", -1));
+    int n;
+    const int *indices = ps.FindInt("indices", &n);
+    ASSERT_TRUE(indices != nullptr);
+    EXPECT_EQ(3, n);
+    EXPECT_EQ(2, indices[2]);
+    EXPECT_TRUE(ps.FindFloat("missing", &n) == nullptr);
+
+    // Adding a parameter again replaces it
+    ps.AddFloat("radius", Values<Float>({4}));
+    EXPECT_EQ(4, ps.FindOneFloat("radius", 1));
+    EXPECT_TRUE(ps.EraseFloat("radius"));
+    EXPECT_FALSE(ps.EraseFloat("radius"));
+    EXPECT_EQ(1, ps.FindOneFloat("radius", 1));
+    EXPECT_EQ("cylinder", ps.FindOneString("type", ""));
+}
+
+TEST(ParamSet, ManyParameters) {
+    // Enough parameters to spill out of the inline storage
+    ParamSet ps;
+    for (int i = 0; i < 50; ++i)
+        ps.AddInt(StringPrintf("p%d", i), Values<int>({i}), 1);
+    ParamSet copy = ps;
+    ps.Clear();
+    EXPECT_EQ(-1, ps.FindOneInt("p3", -1));
+    for (int i = 0; i < 50; ++i)
+        EXPECT_EQ(i, copy.FindOneInt(StringPrintf("p%d", i), -1));
+    for (int i = 0; i < 50; i += 2)
+        EXPECT_TRUE(copy.EraseInt(StringPrintf("p%d", i)));
+    for (int i = 0; i < 50; ++i)
+        EXPECT_EQ((i & 1) ? i : -1,
+                  copy.FindOneInt(StringPrintf("p%d", i), -1));
+
+    // Vectors of _ParamSet_s move them rather than copying on reallocation
+    static_assert(std::is_nothrow_move_constructible<ParamSet>::value,
+                  "ParamSet moves must not throw");
+    std::vector<ParamSet> sets(1);
+    sets[0] = std::move(copy);
+    for (int i = 0; i < 16; ++i) sets.push_back(ParamSet());
+    EXPECT_EQ(49, sets[0].FindOneInt("p49", -1));
+}
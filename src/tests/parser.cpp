@@ -0,0 +1,222 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "api.h"
+#include "parser.h"
+#include "rng.h"
+#include "stringprint.h"
+#include <cstdio>
+
+using namespace pbrt;
+
+// Returns a new temporary file name ending in _extension_.
+static std::string TempFilename(const char *extension) {
+    char filename[L_tmpnam];
+#ifdef __GNUG__
+// As in the Fourier BSDF test, tmpnam() is used since mkstemp() isn't
+// available on Windows.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif  // __GNUG__
+    std::tmpnam(filename);
+#ifdef __GNUG__
+#pragma GCC diagnostic pop
+#endif  // __GNUG__
+    return std::string(filename) + extension;
+}
+
+static void WriteFile(const std::string &filename, const std::string &text) {
+    FILE *f = fopen(filename.c_str(), "w");
+    ASSERT_TRUE(f != nullptr);
+    fputs(text.c_str(), f);
+    fclose(f);
+}
+
+// Parses _filename_ with --cat and returns what was printed.
+static std::string ParseAndCat(const std::string &filename) {
+    Options opt;
+    opt.cat = true;
+    opt.quiet = true;
+    pbrtInit(opt);
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(ParseFile(filename));
+    std::string output = testing::internal::GetCapturedStdout();
+    pbrtCleanup();
+    return output;
+}
+
+TEST(Parser, Numbers) {
+    // Numbers must convert exactly as atof() does
+    RNG rng;
+    std::string scene, expected;
+    const char *formats[] = {"%.3f", "%.9g", "%.17g", "%.6e", "%.20f"};
+    for (int i = 0; i < 500; ++i) {
+        std::string v[3];
+        for (int c = 0; c < 3; ++c) {
+            double x = (rng.UniformFloat() - .5) *
+                       std::pow(10., int(rng.UniformUInt32(40)) - 20);
+            v[c] = StringPrintf(formats[rng.UniformUInt32(5)], x);
+        }
+        if (i == 0) v[0] = "-0", v[1] = "+.5", v[2] = "1.e-400";
+        if (i == 1) v[0] = "1e400", v[1] = "7e22", v[2] = "123456789012345678";
+        scene += "Scale " + v[0] + " " + v[1] + "\n" + v[2] + "\n";
+        expected += "Scale";
+        for (int c = 0; c < 3; ++c)
+            expected += StringPrintf(" %.9g", Float(atof(v[c].c_str())));
+        expected += "\n";
+    }
+    std::string fn = TempFilename(".pbrt");
+    WriteFile(fn, scene);
+    EXPECT_EQ(expected, ParseAndCat(fn));
+    remove(fn.c_str());
+}
+
+TEST(Parser, StringsCommentsAndInclude) {
+    std::string included = TempFilename(".pbrt");
+    std::string fn = TempFilename(".pbrt");
+    // As in the original lexer, "\ddd" escapes are decimal.
+    WriteFile(included, "CoordinateSystem \"inc\"# eof comment");
+    WriteFile(fn,
+              "# comment\n"
+              "CoordinateSystem \"a\\tb\\\"c\\\\d\\101\"\n"
+              "Include \"" + included + "\"\n"
+              "CoordSysTransform \"inc\" ActiveTransform All\n"
+              "Transform [ 1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1 ]\n");
+    EXPECT_EQ(
+        "# comment\n"
+        "CoordinateSystem \"a\tb\"c\\de\"\n"
+        "CoordinateSystem \"inc\"\n"
+        "# eof comment"
+        "CoordSysTransform \"inc\"\n"
+        "ActiveTransform All\n"
+        "Transform [ 1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1  ]\n",
+        ParseAndCat(fn));
+    remove(fn.c_str());
+    remove(included.c_str());
+}
+
+TEST(Parser, Parameters) {
+    std::string fn = TempFilename(".pbrt");
+    WriteFile(fn,
+              "Film \"image\" \"integer xresolution\" [ 16 ]\n"
+              "  \"integer yresolution\" 8 \"bool b\" [\"true\" \"false\"]\n"
+              "  \"string filename\" \"out.exr\" \"point3 p\" [1 2 3 4]\n"
+              "  \"rgb c\" [.5 .25 1] \"texture t\" \"tex\"\n");
+    EXPECT_EQ(
+        "Film \"image\" \n"
+        "        \"integer xresolution\" [ 16 ] \n"
+        "        \"integer yresolution\" [ 8 ] \n"
+        "        \"boolean b\" [ \"true\" \"false\" ] \n"
+        "        \"point p\" [ 1 2 3 ] \n"
+        "        \"string filename\" [ \"out.exr\" ] \n"
+        "        \"texture t\" [ \"tex\" ] \n"
+        "        \"rgb c\" [ 0.5 0.25 1 ] \n",
+        ParseAndCat(fn));
+    remove(fn.c_str());
+}
+
+TEST(Parser, BufferedErrors) {
+    // Errors found while parsing included files ahead of time are buffered
+    // so that they can be reported in order
+    struct QuietGuard {
+        bool quiet = PbrtOptions.quiet;
+        ~QuietGuard() { PbrtOptions.quiet = quiet; }
+    } guard;
+    PbrtOptions.quiet = false;
+    std::vector<BufferedError> buffer;
+    EXPECT_TRUE(SetErrorBuffer(&buffer) == nullptr);
+    Error("first %d", 1);
+    Warning("second");
+    EXPECT_EQ(&buffer, SetErrorBuffer(nullptr));
+    ASSERT_EQ(2, buffer.size());
+    EXPECT_EQ("first 1", buffer[0].message);
+    EXPECT_FALSE(buffer[0].warning);
+    EXPECT_EQ("second", buffer[1].message);
+    EXPECT_TRUE(buffer[1].warning);
+}
+
+// Renders _filename_ with four threads and returns the contents of the
+// image it writes to _imageFilename_.
+static std::string Render(const std::string &filename,
+                          const std::string &imageFilename) {
+    Options opt;
+    opt.quiet = true;
+    opt.nThreads = 4;
+    pbrtInit(opt);
+    EXPECT_TRUE(ParseFile(filename));
+    pbrtCleanup();
+    std::string contents;
+    FILE *f = fopen(imageFilename.c_str(), "rb");
+    EXPECT_TRUE(f != nullptr);
+    if (!f) return contents;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) contents.append(buf, n);
+    fclose(f);
+    remove(imageFilename.c_str());
+    return contents;
+}
+
+TEST(Parser, IncludeMatchesInline) {
+    // Included files are parsed ahead of time and instance definitions are
+    // built in parallel; the result must match the same scene given inline.
+    std::string objects =
+        "ObjectBegin \"ball\"\n"
+        "Material \"plastic\" \"rgb Kd\" [.7 .2 .2]\n"
+        "Shape \"sphere\" \"float radius\" .3\n"
+        "ObjectEnd\n"
+        "ObjectBegin \"pair\"\n"
+        "ObjectInstance \"ball\"\n"
+        "Translate .7 0 0\n"
+        "ObjectInstance \"ball\"\n"
+        "Shape \"disk\" \"float radius\" .2\n"
+        "ObjectEnd\n";
+    std::string part =
+        "Translate 0 .5 0\n"
+        "Shape \"trianglemesh\" \"integer indices\" [0 1 2 0 2 3]\n"
+        "  \"point P\" [-1 -1 2 1 -1 2 1 1 2 -1 1 2]\n"
+        "Material \"matte\" \"rgb Kd\" [.2 .6 .2]\n"
+        "Shape \"sphere\" \"float radius\" .4\n"
+        "ObjectInstance \"pair\"\n";
+    std::string header =
+        "LookAt 0 2 -6  0 0 0  0 1 0\n"
+        "Camera \"perspective\" \"float fov\" 45\n"
+        "Sampler \"halton\" \"integer pixelsamples\" 4\n"
+        "Film \"image\" \"integer xresolution\" 16\n"
+        "  \"integer yresolution\" 12 \"string filename\" ";
+    std::string world =
+        "WorldBegin\n"
+        "LightSource \"point\" \"rgb I\" [5 5 5] \"point from\" [0 4 -2]\n";
+
+    std::string inlineFile = TempFilename(".pbrt");
+    std::string includeFile = TempFilename(".pbrt");
+    std::string objectsFile = TempFilename(".pbrt");
+    std::string partFile = TempFilename(".pbrt");
+    std::string inlineImage = TempFilename(".pfm");
+    std::string includeImage = TempFilename(".pfm");
+
+    std::string inlineScene =
+        header + "\"" + inlineImage + "\"\n" + world + objects;
+    std::string includeScene = header + "\"" + includeImage + "\"\n" +
+                               world + "Include \"" + objectsFile + "\"\n";
+    for (int i = 0; i < 3; ++i) {
+        std::string instance =
+            StringPrintf("AttributeBegin\nTranslate %d 0 0\n", i - 1);
+        inlineScene += instance + part + "AttributeEnd\n";
+        includeScene += instance + "Include \"" + partFile + "\"\n" +
+                        "AttributeEnd\n";
+    }
+    inlineScene += "WorldEnd\n";
+    includeScene += "WorldEnd\n";
+    WriteFile(inlineFile, inlineScene);
+    WriteFile(includeFile, includeScene);
+    WriteFile(objectsFile, objects);
+    WriteFile(partFile, part);
+
+    std::string expected = Render(inlineFile, inlineImage);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_TRUE(expected == Render(includeFile, includeImage));
+    for (const std::string &fn :
+         {inlineFile, includeFile, objectsFile, partFile})
+        remove(fn.c_str());
+}
@@ -0,0 +1,169 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "rng.h"
+#include "paramset.h"
+#include "shapes/plymesh.h"
+#include <stdio.h>
+
+using namespace pbrt;
+
+static std::string PLYTestFilename(const char *name) {
+    return std::string("/tmp/pbrt_test_") + name + ".ply";
+}
+
+// Writes a PLY file with the given header and binary body.
+static void WritePLY(const std::string &filename, const std::string &header,
+                     const std::string &body) {
+    FILE *f = fopen(filename.c_str(), "wb");
+    ASSERT_TRUE(f != nullptr);
+    fwrite(header.data(), 1, header.size(), f);
+    fwrite(body.data(), 1, body.size(), f);
+    fclose(f);
+}
+
+template <typename T>
+static void Append(std::string *s, T v) {
+    s->append((const char *)&v, sizeof(T));
+}
+
+TEST(PLYMesh, BinaryFloat) {
+    // Write a mesh with WritePlyFile() and check it's read back exactly
+    RNG rng;
+    std::vector<Point3f> p;
+    std::vector<Normal3f> n;
+    std::vector<Point2f> uv;
+    for (int i = 0; i < 100; ++i) {
+        p.push_back(Point3f(rng.UniformFloat(), rng.UniformFloat(),
+                            rng.UniformFloat()));
+        n.push_back(Normal3f(rng.UniformFloat(), rng.UniformFloat(), 1));
+        uv.push_back(Point2f(rng.UniformFloat(), rng.UniformFloat()));
+    }
+    std::vector<int> indices;
+    for (int i = 0; i < 300; ++i) indices.push_back(rng.UniformUInt32(100));
+    std::string fn = PLYTestFilename("float");
+    ASSERT_TRUE(WritePlyFile(fn, 100, indices.data(), 100, p.data(), nullptr,
+                             n.data(), uv.data()));
+
+    PLYMeshData mesh;
+    ASSERT_TRUE(ReadPLYMesh(fn, &mesh));
+    EXPECT_EQ(p, mesh.p);
+    EXPECT_EQ(n, mesh.n);
+    EXPECT_EQ(uv, mesh.uv);
+    EXPECT_EQ(indices, mesh.indices);
+    remove(fn.c_str());
+}
+
+TEST(PLYMesh, BinaryConvertAndQuads) {
+    // Double-precision vertices, extra properties and elements, 16-bit face
+    // counts, and a mix of triangles and quads
+    std::string header =
+        "ply\nformat binary_little_endian 1.0\ncomment test\n"
+        "element vertex 4\nproperty double x\nproperty uchar flags\n"
+        "property double y\nproperty double z\nproperty float s\n"
+        "property float t\n"
+        "element face 3\nproperty int material\n"
+        "property list ushort uint vertex_indices\n"
+        "element edge 1\nproperty list uchar int vertices\n"
+        "end_header\n";
+    std::string body;
+    for (int i = 0; i < 4; ++i) {
+        Append<double>(&body, i);
+        Append<uint8_t>(&body, 7);
+        Append<double>(&body, 2 * i);
+        Append<double>(&body, -i);
+        Append<float>(&body, .25f * i);
+        Append<float>(&body, .5f);
+    }
+    auto face = [&](std::vector<uint32_t> v) {
+        Append<int32_t>(&body, 1);
+        Append<uint16_t>(&body, v.size());
+        for (uint32_t i : v) Append<uint32_t>(&body, i);
+    };
+    face({0, 1, 2});
+    face({0, 1, 2, 3});
+    face({0, 1});
+    Append<uint8_t>(&body, 2);
+    Append<int32_t>(&body, 0);
+    Append<int32_t>(&body, 1);
+    std::string fn = PLYTestFilename("convert");
+    WritePLY(fn, header, body);
+
+    PLYMeshData mesh;
+    ASSERT_TRUE(ReadPLYMesh(fn, &mesh));
+    ASSERT_EQ(4, mesh.p.size());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(Point3f(i, 2 * i, -i), mesh.p[i]);
+        EXPECT_EQ(Point2f(.25f * i, .5f), mesh.uv[i]);
+    }
+    EXPECT_TRUE(mesh.n.empty());
+    std::vector<int> expected = {0, 1, 2, 0, 1, 2, 3, 0, 2};
+    EXPECT_EQ(expected, mesh.indices);
+
+    // Truncated files and out-of-bounds indices must fail
+    WritePLY(fn, header, body.substr(0, body.size() - 20));
+    EXPECT_FALSE(ReadPLYMesh(fn, &mesh));
+    body[4 * 33 + 4 + 2] = 9;
+    WritePLY(fn, header, body);
+    EXPECT_FALSE(ReadPLYMesh(fn, &mesh));
+    remove(fn.c_str());
+}
+
+TEST(PLYMesh, ASCII) {
+    std::string fn = PLYTestFilename("ascii");
+    WritePLY(fn,
+             "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\n"
+             "property float y\nproperty float z\nelement face 1\n"
+             "property list uchar int vertex_indices\nend_header\n",
+             "0 0 0\n1 0 0\n0 1 0\n3 0 1 2\n");
+    PLYMeshData mesh;
+    ASSERT_TRUE(ReadPLYMesh(fn, &mesh));
+    EXPECT_EQ(3, mesh.p.size());
+    EXPECT_EQ(Point3f(1, 0, 0), mesh.p[1]);
+    std::vector<int> expected = {0, 1, 2};
+    EXPECT_EQ(expected, mesh.indices);
+    remove(fn.c_str());
+}
+
+TEST(PLYMesh, SharedFiles) {
+    std::vector<std::string> filenames;
+    std::vector<int> indices = {0, 1, 2};
+    for (int i = 0; i < 3; ++i) {
+        Point3f p[3] = {Point3f(i, 0, 0), Point3f(i, 1, 0), Point3f(i, 0, 1)};
+        filenames.push_back(PLYTestFilename("shared") + std::to_string(i));
+        ASSERT_TRUE(WritePlyFile(filenames.back(), 1, indices.data(), 3, p,
+                                 nullptr, nullptr, nullptr));
+    }
+    Transform identity;
+    auto create = [&](const std::string &filename) {
+        ParamSet params;
+        std::unique_ptr<std::string[]> fn(new std::string[1]);
+        fn[0] = filename;
+        params.AddString("filename", std::move(fn), 1);
+        return CreatePLYMesh(&identity, &identity, false, params);
+    };
+
+    // The first file is used three times and only read by the first use;
+    // the others are read when their mesh is created
+    SharePLYMeshes({filenames[0], filenames[1], filenames[0], filenames[2],
+                    filenames[0]});
+    std::vector<std::shared_ptr<Shape>> shapes = create(filenames[0]);
+    ASSERT_EQ(1, shapes.size());
+    remove(filenames[0].c_str());
+    EXPECT_EQ(1, create(filenames[1]).size());
+    remove(filenames[1].c_str());
+    for (int i = 0; i < 2; ++i) {
+        shapes = create(filenames[0]);
+        ASSERT_EQ(1, shapes.size());
+        EXPECT_EQ(0, shapes[0]->WorldBound().pMin.x);
+    }
+    // The file's contents were released after its last use
+    EXPECT_TRUE(create(filenames[0]).empty());
+
+    // Unused shared files are released explicitly
+    SharePLYMeshes({filenames[2], filenames[2]});
+    EXPECT_EQ(1, create(filenames[2]).size());
+    ReleaseSharedPLYMeshes();
+    remove(filenames[2].c_str());
+    EXPECT_TRUE(create(filenames[2]).empty());
+}
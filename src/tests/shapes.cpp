@@ -1,5 +1,6 @@
 
 #include "tests/gtest/gtest.h"
+#include <atomic>
 #include <cmath>
 #include <functional>
 #include "pbrt.h"
@@ -7,10 +8,18 @@
 #include "shape.h"
 #include "lowdiscrepancy.h"
 #include "sampling.h"
+#include "paramset.h"
+#include "parallel.h"
+#include "texture.h"
 #include "shapes/cone.h"
+#include "shapes/curve.h"
 #include "shapes/cylinder.h"
 #include "shapes/disk.h"
+#include "shapes/displacement.h"
+#include "shapes/heightfield.h"
+#include "shapes/loopsubdiv.h"
 #include "shapes/paraboloid.h"
+#include "shapes/particles.h"
 #include "shapes/sphere.h"
 #include "shapes/triangle.h"
 
@@ -512,6 +521,385 @@ TEST(Cylinder, Reintersect) {
     }
 }
 
+TEST(Curve, CenterlineHits) {
+    // Rays aimed at points on a curve's centerline must hit it, including
+    // under non-uniformly scaled transformations
+    RNG rng;
+    const char *types[] = {"flat", "cylinder"};
+    for (int i = 0; i < 200; ++i) {
+        Transform objectToWorld = Translate(Vector3f(pUnif(rng), pUnif(rng),
+                                                     pUnif(rng))) *
+                                  Rotate(360 * rng.UniformFloat(),
+                                         Vector3f(pUnif(rng), pUnif(rng), 1)) *
+                                  Scale(Lerp(rng.UniformFloat(), .2, 5),
+                                        Lerp(rng.UniformFloat(), .2, 5),
+                                        Lerp(rng.UniformFloat(), .2, 5));
+        Transform worldToObject = Inverse(objectToWorld);
+        std::unique_ptr<Point3f[]> cp(new Point3f[4]);
+        for (int j = 0; j < 4; ++j)
+            cp[j] = Point3f(pUnif(rng, 2), pUnif(rng, 2), pUnif(rng, 2));
+        Point3f cpCurve[4] = {cp[0], cp[1], cp[2], cp[3]};
+        ParamSet params;
+        params.AddPoint3f("P", std::move(cp), 4);
+        std::unique_ptr<Float[]> width(new Float[1]);
+        width[0] = Lerp(rng.UniformFloat(), .001, .1);
+        params.AddFloat("width", std::move(width));
+        std::unique_ptr<std::string[]> type(new std::string[1]);
+        type[0] = types[i & 1];
+        params.AddString("type", std::move(type), 1);
+        std::vector<std::shared_ptr<Shape>> segments =
+            CreateCurveShape(&objectToWorld, &worldToObject, false, params);
+        ASSERT_FALSE(segments.empty());
+
+        for (int j = 0; j < 20; ++j) {
+            // Evaluate the curve at a random point
+            Float u = rng.UniformFloat();
+            Point3f a[3], b[2];
+            for (int k = 0; k < 3; ++k)
+                a[k] = Lerp(u, cpCurve[k], cpCurve[k + 1]);
+            for (int k = 0; k < 2; ++k) b[k] = Lerp(u, a[k], a[k + 1]);
+            Point3f pCurve = objectToWorld(Lerp(u, b[0], b[1]));
+
+            Point3f o = pCurve + Vector3f(pUnif(rng), pUnif(rng), pUnif(rng));
+            Ray ray(o, pCurve - o, 2);
+            bool hit = false, inside = false;
+            for (const auto &seg : segments) {
+                hit |= seg->IntersectP(ray);
+                inside |= Inside(pCurve, Expand(seg->WorldBound(), 1e-4f));
+            }
+            EXPECT_TRUE(hit) << "curve " << i << ", u = " << u;
+            EXPECT_TRUE(inside) << "curve " << i << ", u = " << u;
+        }
+        // The segments' bounds are at least as tight as their transformed
+        // object-space control point bounds
+        for (const auto &seg : segments) {
+            Bounds3f b = seg->WorldBound();
+            EXPECT_LE(b.Volume(), objectToWorld(seg->ObjectBound()).Volume());
+        }
+    }
+}
+
+TEST(LoopSubdiv, Watertight) {
+    // Refine a perturbed octahedron for a camera close to one of its
+    // vertices, so that its patches are refined to different levels; rays
+    // leaving from its center must always hit it, also when the cache is too
+    // small to hold more than one patch's tessellation.
+    RNG rng;
+    const Float dirs[6][3] = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                              {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+    std::unique_ptr<Point3f[]> P(new Point3f[6]);
+    for (int i = 0; i < 6; ++i)
+        P[i] = Lerp(rng.UniformFloat(), .7f, 1.3f) *
+               Point3f(dirs[i][0], dirs[i][1], dirs[i][2]);
+    const int faces[24] = {0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4,
+                           2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5};
+    std::unique_ptr<int[]> indices(new int[24]);
+    std::copy(faces, faces + 24, indices.get());
+    ParamSet params;
+    params.AddPoint3f("P", std::move(P), 6);
+    params.AddInt("indices", std::move(indices), 24);
+    std::unique_ptr<int[]> levels(new int[1]);
+    levels[0] = 5;
+    params.AddInt("levels", std::move(levels), 1);
+
+    SubdivisionView view;
+    view.cameraPos = Point3f(0.1, 0.2, 1.5);
+    view.pixelSpread = .5f;
+    Transform identity;
+    std::vector<std::shared_ptr<Shape>> patches =
+        CreateLoopSubdiv(&identity, &identity, false, params, &view);
+    ASSERT_EQ(8, patches.size());
+
+    // Trace the rays from several threads, so that tessellations are
+    // evicted while other threads are using them
+    int cacheMB = PbrtOptions.subdivCacheMB, nThreads = PbrtOptions.nThreads;
+    PbrtOptions.nThreads = 4;
+    ParallelInit();
+    for (int budget : {0, cacheMB}) {
+        PbrtOptions.subdivCacheMB = budget;
+        std::atomic<int> nMissed(0);
+        ParallelFor([&](int64_t i) {
+            RNG rng;
+            rng.SetSequence(i);
+            for (int j = 0; j < 200; ++j) {
+                Vector3f d = UniformSampleSphere(
+                    Point2f(rng.UniformFloat(), rng.UniformFloat()));
+                Ray ray(Point3f(0, 0, 0), d);
+                int nHits = 0;
+                for (const auto &patch : patches)
+                    nHits += patch->IntersectP(ray);
+                if (nHits == 0) ++nMissed;
+            }
+        }, 100);
+        EXPECT_EQ(0, nMissed.load()) << "budget " << budget;
+    }
+    ParallelCleanup();
+    PbrtOptions.nThreads = nThreads;
+    PbrtOptions.subdivCacheMB = cacheMB;
+}
+
+// Float texture that displaces points by a wave along _x_ and _y_
+class WaveTexture : public Texture<Float> {
+  public:
+    Float Evaluate(const SurfaceInteraction &si) const {
+        return .1f * std::sin(7 * si.p.x) * std::cos(5 * si.p.y);
+    }
+};
+
+TEST(Displacement, Watertight) {
+    // An octahedron with randomly perturbed vertices, displaced by a wave
+    // and seen from close to one of its vertices, so that its triangles are
+    // tessellated at different levels; rays leaving from its center must
+    // always hit it, also when the cache is too small to hold more than one
+    // triangle's tessellation.
+    RNG rng;
+    const Float dirs[6][3] = {{1, 0, 0},  {-1, 0, 0}, {0, 1, 0},
+                              {0, -1, 0}, {0, 0, 1},  {0, 0, -1}};
+    Point3f P[6];
+    for (int i = 0; i < 6; ++i)
+        P[i] = Lerp(rng.UniformFloat(), .7f, 1.3f) *
+               Point3f(dirs[i][0], dirs[i][1], dirs[i][2]);
+    const int indices[24] = {0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4,
+                             2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5};
+    Transform identity;
+    std::vector<std::shared_ptr<Shape>> tris =
+        CreateTriangleMesh(&identity, &identity, false, 8, indices, 6, P,
+                           nullptr, nullptr, nullptr, nullptr, nullptr);
+
+    ParamSet params;
+    params.AddTexture("displacement", "wave");
+    std::unique_ptr<int[]> levels(new int[1]);
+    levels[0] = 5;
+    params.AddInt("levels", std::move(levels), 1);
+    std::map<std::string, std::shared_ptr<Texture<Float>>> floatTextures;
+    floatTextures["wave"] = std::make_shared<WaveTexture>();
+    SubdivisionView view;
+    view.cameraPos = Point3f(0.1, 0.2, 1.5);
+    view.pixelSpread = .5f;
+    std::vector<std::shared_ptr<Shape>> patches =
+        CreateDisplacedMesh(tris, params, &floatTextures, &view);
+    ASSERT_EQ(8, patches.size());
+
+    int cacheMB = PbrtOptions.subdivCacheMB;
+    for (int budget : {0, cacheMB}) {
+        PbrtOptions.subdivCacheMB = budget;
+        for (int i = 0; i < 20000; ++i) {
+            Vector3f d = UniformSampleSphere(
+                Point2f(rng.UniformFloat(), rng.UniformFloat()));
+            Ray ray(Point3f(0, 0, 0), d);
+            int nHits = 0;
+            for (const auto &patch : patches) nHits += patch->IntersectP(ray);
+            EXPECT_GT(nHits, 0) << "direction " << d;
+        }
+    }
+    PbrtOptions.subdivCacheMB = cacheMB;
+}
+
+TEST(Displacement, Bounds) {
+    // Hits on a displaced quad lie on the displaced surface, and inside the
+    // bounds, whether they are computed from the displaced vertices, from
+    // the given bound on the displacement or from an estimated one; their
+    // shading normals follow the displaced surface
+    const Point3f P[4] = {Point3f(0, 0, 0), Point3f(1, 0, 0), Point3f(1, 1, 0),
+                          Point3f(0, 1, 0)};
+    const int indices[6] = {0, 1, 2, 0, 2, 3};
+    Transform identity;
+    std::vector<std::shared_ptr<Shape>> tris =
+        CreateTriangleMesh(&identity, &identity, false, 2, indices, 4, P,
+                           nullptr, nullptr, nullptr, nullptr, nullptr);
+    std::map<std::string, std::shared_ptr<Texture<Float>>> floatTextures;
+    floatTextures["wave"] = std::make_shared<WaveTexture>();
+
+    RNG rng;
+    for (std::string bounds : {"exact", "given", "estimated"}) {
+        ParamSet params;
+        params.AddTexture("displacement", "wave");
+        std::unique_ptr<int[]> levels(new int[1]);
+        levels[0] = 6;
+        params.AddInt("levels", std::move(levels), 1);
+        if (bounds == "estimated") {
+            std::unique_ptr<bool[]> estimate(new bool[1]);
+            estimate[0] = true;
+            params.AddBool("estimatebounds", std::move(estimate), 1);
+        } else if (bounds == "given") {
+            std::unique_ptr<Float[]> b(new Float[1]);
+            b[0] = .1f;
+            params.AddFloat("displacementbound", std::move(b), 1);
+        }
+        std::vector<std::shared_ptr<Shape>> patches =
+            CreateDisplacedMesh(tris, params, &floatTextures);
+        ASSERT_EQ(2, patches.size());
+
+        for (int i = 0; i < 1000; ++i) {
+            Point3f o(rng.UniformFloat(), rng.UniformFloat(), 1);
+            Ray ray(o, Vector3f(0, 0, -1));
+            Float tHit;
+            SurfaceInteraction isect;
+            bool hit = false;
+            for (const auto &patch : patches) {
+                if (patch->Intersect(ray, &tHit, &isect, false)) {
+                    ray.tMax = tHit;
+                    hit = true;
+                    EXPECT_TRUE(Inside(isect.p, Expand(patch->WorldBound(),
+                                                       1e-5f)));
+                }
+            }
+            ASSERT_TRUE(hit) << bounds << " bounds";
+            // The micro-triangles' edges are 1/64 long, so the surface is
+            // within a small distance of the displacement function
+            Float x = isect.p.x, y = isect.p.y;
+            Float z = .1f * std::sin(7 * x) * std::cos(5 * y);
+            EXPECT_NEAR(z, isect.p.z, 2e-3f);
+            // Interpolated shading normals are closer to the surface's
+            // normal than the micro-triangles' own normals, which are off
+            // by up to about 3 degrees
+            Normal3f n(-.7f * std::cos(7 * x) * std::cos(5 * y),
+                       .5f * std::sin(7 * x) * std::sin(5 * y), 1);
+            EXPECT_GT(Dot(isect.shading.n, Normalize(n)), .9995f);
+        }
+    }
+}
+
+TEST(Heightfield, MatchesTriangleMesh) {
+    // A heightfield must report the same hits as the triangle mesh of its
+    // grid, including for grids whose sizes aren't powers of two
+    RNG rng;
+    const int nx = 23, ny = 17;
+    std::vector<Float> z(nx * ny);
+    for (Float &h : z) h = pUnif(rng, .2);
+    std::vector<Point3f> P;
+    std::vector<Point2f> uv;
+    std::vector<int> indices;
+    for (int y = 0; y < ny; ++y)
+        for (int x = 0; x < nx; ++x) {
+            uv.push_back(Point2f((float)x / (float)(nx - 1),
+                                 (float)y / (float)(ny - 1)));
+            P.push_back(Point3f(uv.back().x, uv.back().y, z[y * nx + x]));
+        }
+    for (int y = 0; y < ny - 1; ++y)
+        for (int x = 0; x < nx - 1; ++x)
+            for (int v : {0, 1, nx + 1, 0, nx + 1, nx})
+                indices.push_back(y * nx + x + v);
+
+    Transform objectToWorld = Translate(Vector3f(1, -2, .5)) *
+                              Rotate(30, Vector3f(1, 1, 0)) *
+                              Scale(4, 3, 2);
+    Transform worldToObject = Inverse(objectToWorld);
+    std::shared_ptr<Shape> heightfield = std::make_shared<Heightfield>(
+        &objectToWorld, &worldToObject, false, nx, ny, z.data());
+    std::vector<std::shared_ptr<Shape>> tris = CreateTriangleMesh(
+        &objectToWorld, &worldToObject, false, indices.size() / 3,
+        indices.data(), P.size(), P.data(), nullptr, nullptr, uv.data(),
+        nullptr, nullptr);
+
+    int nHits = 0;
+    for (int i = 0; i < 10000; ++i) {
+        Point3f pTarget = objectToWorld(Point3f(
+            Lerp(rng.UniformFloat(), -.1, 1.1),
+            Lerp(rng.UniformFloat(), -.1, 1.1), pUnif(rng, .3)));
+        Point3f o = pTarget + Vector3f(pUnif(rng, 5), pUnif(rng, 5),
+                                       pUnif(rng, 5));
+        Ray ray(o, pTarget - o, 2);
+
+        Float tTri = Infinity, t;
+        SurfaceInteraction isect;
+        for (const auto &tri : tris)
+            if (tri->Intersect(ray, &t, &isect) && t < tTri) tTri = t;
+        Float tHeightfield = Infinity;
+        if (heightfield->Intersect(ray, &t, &isect)) {
+            tHeightfield = t;
+            ++nHits;
+        }
+        EXPECT_EQ(tTri, tHeightfield) << "ray " << i;
+        EXPECT_EQ(tTri < Infinity, heightfield->IntersectP(ray));
+    }
+    EXPECT_GT(nHits, 1000);
+}
+
+TEST(Particles, MatchesSpheres) {
+    // Particles must report the same hits as individual spheres, whether
+    // the quadratics are solved in plain floating point or with _EFloat_s
+    RNG rng;
+    const int nParticles = 300;
+    std::vector<Point3f> P;
+    std::vector<Float> radii;
+    for (int i = 0; i < nParticles; ++i) {
+        P.push_back(Point3f(pUnif(rng, 4), pUnif(rng, 4), pUnif(rng, 4)));
+        radii.push_back(Lerp(rng.UniformFloat(), .05, .4));
+    }
+    Transform objectToWorld = Translate(Vector3f(1, -2, .5)) *
+                              Rotate(30, Vector3f(1, 1, 0)) * Scale(2, 2, 2);
+    Transform worldToObject = Inverse(objectToWorld);
+    std::shared_ptr<Shape> particles = std::make_shared<Particles>(
+        &objectToWorld, &worldToObject, false, nParticles, P.data(),
+        radii.data());
+    std::vector<Transform> sphereTransforms;
+    std::vector<std::shared_ptr<Shape>> spheres;
+    sphereTransforms.reserve(2 * nParticles);
+    for (int i = 0; i < nParticles; ++i) {
+        sphereTransforms.push_back(objectToWorld *
+                                   Translate(Vector3f(P[i])));
+        sphereTransforms.push_back(Inverse(sphereTransforms.back()));
+        spheres.push_back(std::make_shared<Sphere>(
+            &sphereTransforms[2 * i], &sphereTransforms[2 * i + 1], false,
+            radii[i], -radii[i], radii[i], 360));
+    }
+
+    // Rays that pass within round-off of a sphere's silhouette may hit or
+    // miss depending on how the arithmetic is ordered, so they're skipped
+    auto grazes = [&](const Ray &ray) {
+        for (int i = 0; i < nParticles; ++i) {
+            Vector3f oc = ray.o - objectToWorld(P[i]);
+            double tc = Dot(oc, ray.d) / (double)ray.d.LengthSquared();
+            double dist = (oc - Float(tc) * ray.d).Length();
+            if (std::abs(dist - 2 * radii[i]) < 1e-4) return true;
+        }
+        return false;
+    };
+
+    int nHits = 0;
+    for (int i = 0; i < 10000; ++i) {
+        Point3f pTarget = objectToWorld(P[rng.UniformUInt32(nParticles)]);
+        Point3f o = pTarget + Vector3f(pUnif(rng, 10), pUnif(rng, 10),
+                                       pUnif(rng, 10));
+        Ray ray(o, pTarget - o + Vector3f(pUnif(rng, .8), pUnif(rng, .8),
+                                          pUnif(rng, .8)));
+        if (grazes(ray)) continue;
+
+        Float tSphere = Infinity, t;
+        SurfaceInteraction isect;
+        for (const auto &sphere : spheres)
+            if (sphere->Intersect(ray, &t, &isect) && t < tSphere)
+                tSphere = t;
+        Float tParticles = Infinity;
+        if (particles->Intersect(ray, &t, &isect)) {
+            tParticles = t;
+            ++nHits;
+        }
+        EXPECT_EQ(tSphere < Infinity, tParticles < Infinity) << "ray " << i;
+        if (tSphere < Infinity) {
+            EXPECT_NEAR(tSphere, tParticles, 1e-4 * tSphere + 1e-5)
+                << "ray " << i;
+        }
+        EXPECT_EQ(tSphere < Infinity, particles->IntersectP(ray));
+    }
+    EXPECT_GT(nHits, 1000);
+}
+
+TEST(Particles, Reintersect) {
+    for (int i = 0; i < 100; ++i) {
+        RNG rng(i);
+        Transform identity;
+        // A single particle far from the origin, so that rays leaving its
+        // surface are solved relative to a center with large coordinates
+        Point3f p(pExp(rng, 3), pExp(rng, 3), pExp(rng, 3));
+        Float radius = pExp(rng, 2);
+        Particles particles(&identity, &identity, false, 1, &p, &radius);
+
+        TestReintersectConvex(particles, rng);
+    }
+}
+
 #if 0
 TEST(Cone, Reintersect) {
     for (int i = 0; i < 1000; ++i) {
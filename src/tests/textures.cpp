@@ -0,0 +1,142 @@
+
+#include "tests/gtest/gtest.h"
+#include "pbrt.h"
+#include "texture.h"
+#include "rng.h"
+#include "textures/constant.h"
+#include "textures/mix.h"
+#include "textures/scale.h"
+#include "textures/uv.h"
+
+using namespace pbrt;
+
+// Float texture that counts how often it's evaluated
+class CountingTexture : public Texture<Float> {
+  public:
+    Float Evaluate(const SurfaceInteraction &si) const {
+        ++evaluations;
+        return si.uv[0];
+    }
+    mutable int evaluations = 0;
+};
+
+static std::shared_ptr<Texture<Float>> Constant(Float v) {
+    return std::make_shared<ConstantTexture<Float>>(v);
+}
+
+TEST(Textures, SimplifyScale) {
+    // Scale of two constants is a constant
+    ScaleTexture<Float, Float> constScale(Constant(2), Constant(3));
+    std::shared_ptr<Texture<Float>> folded = constScale.Simplify();
+    Float value;
+    ASSERT_TRUE(folded && folded->IsConstant(&value));
+    EXPECT_EQ(6, value);
+
+    // A unit scale is dropped
+    auto tex = std::make_shared<CountingTexture>();
+    ScaleTexture<Float, Float> unitScale(Constant(1), tex);
+    EXPECT_EQ(tex, unitScale.Simplify());
+
+    // Chains of constant scales are flattened
+    auto inner = std::make_shared<ScaleTexture<Float, Float>>(Constant(4), tex);
+    ScaleTexture<Float, Float> outer(Constant(.25), inner);
+    std::shared_ptr<Texture<Float>> flattened = outer.Simplify();
+    ASSERT_TRUE(flattened != nullptr);
+    SurfaceInteraction si;
+    si.uv = Point2f(.25, 0);
+    EXPECT_EQ(.25, flattened->Evaluate(si));
+    EXPECT_EQ(1, tex->evaluations);
+    EXPECT_EQ(tex, flattened->Simplify());
+
+    // Varying scales are left alone
+    ScaleTexture<Float, Float> varying(tex, Constant(2));
+    EXPECT_TRUE(varying.Simplify() == nullptr);
+}
+
+TEST(Textures, SimplifyMix) {
+    auto tex1 = std::make_shared<CountingTexture>();
+    auto tex2 = std::make_shared<CountingTexture>();
+    EXPECT_EQ(tex1, MixTexture<Float>(tex1, tex2, Constant(0)).Simplify());
+    EXPECT_EQ(tex2, MixTexture<Float>(tex1, tex2, Constant(1)).Simplify());
+    EXPECT_TRUE(MixTexture<Float>(tex1, tex2, Constant(.5)).Simplify() ==
+                nullptr);
+    EXPECT_TRUE(MixTexture<Float>(Constant(0), Constant(1), tex1)
+                    .Simplify() == nullptr);
+
+    std::shared_ptr<Texture<Spectrum>> folded =
+        MixTexture<Spectrum>(std::make_shared<ConstantTexture<Spectrum>>(2.f),
+                             std::make_shared<ConstantTexture<Spectrum>>(4.f),
+                             Constant(.25))
+            .Simplify();
+    Spectrum value;
+    ASSERT_TRUE(folded && folded->IsConstant(&value));
+    EXPECT_EQ(Spectrum(2.5f), value);
+}
+
+TEST(Textures, CachedFloatTexture) {
+    auto tex = std::make_shared<CountingTexture>();
+    CachedFloatTexture cached(tex);
+
+    SurfaceInteraction si;
+    si.uv = Point2f(.25, 0);
+    EXPECT_EQ(.25, cached.Evaluate(si));
+    EXPECT_EQ(.25, cached.Evaluate(si));
+    EXPECT_EQ(1, tex->evaluations);
+
+    // Each interaction has its own values
+    SurfaceInteraction si2;
+    si2.uv = Point2f(.75, 0);
+    EXPECT_EQ(.75, cached.Evaluate(si2));
+    EXPECT_EQ(2, tex->evaluations);
+
+    // Values are recomputed after the cache is cleared
+    si.textureValues.Clear();
+    EXPECT_EQ(.25, cached.Evaluate(si));
+    EXPECT_EQ(3, tex->evaluations);
+
+    // The cache holds a few textures at once
+    CachedFloatTexture other(tex);
+    EXPECT_EQ(.25, other.Evaluate(si));
+    EXPECT_EQ(.25, cached.Evaluate(si));
+    EXPECT_EQ(4, tex->evaluations);
+}
+
+TEST(Noise, Lattice) {
+    // Noise is zero at the corners of the lattice cells
+    for (int z = -3; z <= 3; ++z)
+        for (int y = -3; y <= 3; ++y)
+            for (int x = -3; x <= 3; ++x) EXPECT_EQ(0, Noise(x, y, z));
+}
+
+TEST(Noise, Batch) {
+    RNG rng;
+    const int n = 37;
+    Point3f p[n];
+    for (int i = 0; i < n; ++i)
+        p[i] = Point3f(100 * (rng.UniformFloat() - .5f),
+                       100 * (rng.UniformFloat() - .5f),
+                       100 * (rng.UniformFloat() - .5f));
+    Float noise[n];
+    Noise(n, p, noise);
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(Noise(p[i]), noise[i]);
+        EXPECT_LE(std::abs(noise[i]), 1.5f);
+    }
+}
+
+TEST(Noise, FBmOctaves) {
+    RNG rng;
+    // With tiny differentials all octaves are evaluated in full
+    Vector3f dp(1e-6f, 0, 0);
+    for (int i = 0; i < 100; ++i) {
+        Point3f p(10 * rng.UniformFloat(), 10 * rng.UniformFloat(),
+                  10 * rng.UniformFloat());
+        Float sum = 0, lambda = 1, o = 1;
+        for (int octave = 0; octave < 6; ++octave) {
+            sum += o * Noise(lambda * p);
+            lambda *= 1.99f;
+            o *= .5f;
+        }
+        EXPECT_EQ(sum, FBm(p, dp, dp, .5f, 6));
+    }
+}
@@ -52,6 +52,10 @@ class ConstantTexture : public Texture<T> {
     // ConstantTexture Public Methods
     ConstantTexture(const T &value) : value(value) {}
     T Evaluate(const SurfaceInteraction &) const { return value; }
+    bool IsConstant(T *v) const {
+        *v = value;
+        return true;
+    }
 
   private:
     T value;
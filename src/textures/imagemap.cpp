@@ -38,31 +38,65 @@
 
 namespace pbrt {
 
+// Images that aren't .mip files are decoded and filtered in memory before
+// their levels are moved to the texture cache; larger ones than this are
+// better converted to .mip files, whose tiles are read as they're needed
+static PBRT_CONSTEXPR int64_t LargeTextureBytes = int64_t(256) << 20;
+
 // ImageTexture Method Definitions
 template <typename Tmemory, typename Treturn>
 ImageTexture<Tmemory, Treturn>::ImageTexture(
     std::unique_ptr<TextureMapping2D> mapping, const std::string &filename,
-    bool doTrilinear, Float maxAniso, ImageWrap wrapMode, Float scale,
+    MIPFilter filter, Float maxAniso, ImageWrap wrapMode, Float scale,
     bool gamma)
-    : mapping(std::move(mapping)) {
-    mipmap =
-        GetTexture(filename, doTrilinear, maxAniso, wrapMode, scale, gamma);
+    : mapping(std::move(mapping)),
+      mipmap(GetTexture(filename, filter, maxAniso, wrapMode, scale, gamma)) {
 }
 
 template <typename Tmemory, typename Treturn>
-MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::GetTexture(
-    const std::string &filename, bool doTrilinear, Float maxAniso,
-    ImageWrap wrap, Float scale, bool gamma) {
+const std::unique_ptr<MIPMap<Tmemory>> &
+ImageTexture<Tmemory, Treturn>::GetTexture(const std::string &filename,
+                                           MIPFilter filter, Float maxAniso,
+                                           ImageWrap wrap, Float scale,
+                                           bool gamma) {
     // Return _MIPMap_ from texture cache if present
-    TexInfo texInfo(filename, doTrilinear, maxAniso, wrap, scale, gamma);
-    if (textures.find(texInfo) != textures.end())
-        return textures[texInfo].get();
+    TexInfo texInfo(filename, filter, maxAniso, wrap, scale, gamma);
+    auto iter = textures.find(texInfo);
+    if (iter != textures.end()) return iter->second;
 
+    // Create the _MIPMap_ asynchronously while parsing continues; its entry
+    // in _textures_ is filled in before _WaitForAsyncTasks()_ returns
+    std::unique_ptr<MIPMap<Tmemory>> &mipmap = textures[texInfo];
+    RunAsync([=, &mipmap]() {
+        mipmap.reset(
+            CreateMIPMap(filename, filter, maxAniso, wrap, scale, gamma));
+    });
+    return mipmap;
+}
+
+template <typename Tmemory, typename Treturn>
+MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::CreateMIPMap(
+    const std::string &filename, MIPFilter filter, Float maxAniso,
+    ImageWrap wrap, Float scale, bool gamma) {
     // Create _MIPMap_ for _filename_
     ProfilePhase _(Prof::TextureLoading);
     Point2i resolution;
-    std::unique_ptr<RGBSpectrum[]> texels = ReadImage(filename, &resolution);
-    if (!texels) {
+    std::unique_ptr<RGBSpectrum[]> texels;
+    std::unique_ptr<uint8_t[]> texels8;
+    if (HasExtension(filename, ".mip")) {
+        // Use the prefiltered levels of a MIP map file
+        std::shared_ptr<const TiledMIPMapFile> mipFile =
+            TiledMIPMapFile::Read(filename);
+        if (mipFile)
+            return CreateMIPMap(mipFile, filter, maxAniso, wrap, scale);
+    } else if (HasExtension(filename, ".png") ||
+               HasExtension(filename, ".tga"))
+        // Keep 8-bit images' values as stored; they're converted to
+        // _Tmemory_ with table lookups below
+        texels8 = ReadImageRGB8(filename, &resolution);
+    else
+        texels = ReadImage(filename, &resolution);
+    if (!texels && !texels8) {
         Warning("Creating a constant grey texture to replace \"%s\".",
                 filename.c_str());
         resolution.x = resolution.y = 1;
@@ -70,32 +104,78 @@ MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::GetTexture(
         *rgb = RGBSpectrum(0.5f);
         texels.reset(rgb);
     }
+    if (TextureCache::Enabled() &&
+        int64_t(resolution.x) * resolution.y * sizeof(Tmemory) >
+            LargeTextureBytes)
+        Warning("\"%s\" is held in memory while its MIP map is built and "
+                "then copied to a temporary file for the texture cache. "
+                "Convert it to a .mip file with \"imgtool maketx\" so that "
+                "its tiles are only read as they're needed.",
+                filename.c_str());
+
+    // Convert texels to type _Tmemory_, flipping the image in y; texture
+    // coordinate space has (0,0) at the lower left corner.
+    int nTexels = resolution.x * resolution.y;
+    std::unique_ptr<Tmemory[]> convertedTexels(new Tmemory[nTexels]);
+    ParallelFor([&](int y) {
+        Tmemory *dst = &convertedTexels[y * resolution.x];
+        int srcOffset = (resolution.y - 1 - y) * resolution.x;
+        if (texels8)
+            for (int x = 0; x < resolution.x; ++x)
+                convertIn(&texels8[3 * (srcOffset + x)], &dst[x], scale,
+                          gamma);
+        else
+            for (int x = 0; x < resolution.x; ++x)
+                convertIn(texels[srcOffset + x], &dst[x], scale, gamma);
+    }, resolution.y, 16);
+
+    // Store the MIP map's texels in the most compact encoding that
+    // represents the image exactly; unscaled 8-bit RGB images keep their
+    // encoding. Images that the _MIPMap_ resamples to a power-of-two
+    // resolution use the most compact encoding of the resampled texels
+    // instead.
+    TexelEncoding encoding;
+    if (texels8 && scale == 1 && std::is_same<Tmemory, RGBSpectrum>::value)
+        encoding = gamma ? TexelEncoding::sRGB8 : TexelEncoding::Linear8;
+    else
+        encoding = CompactTexelEncoding(convertedTexels.get(), nTexels);
+    texels.reset();
+    texels8.reset();
+    return new MIPMap<Tmemory>(resolution, convertedTexels.get(), filter,
+                               maxAniso, wrap, true, encoding);
+}
 
-    // Flip image in y; texture coordinate space has (0,0) at the lower
-    // left corner.
-    for (int y = 0; y < resolution.y / 2; ++y)
-        for (int x = 0; x < resolution.x; ++x) {
-            int o1 = y * resolution.x + x;
-            int o2 = (resolution.y - 1 - y) * resolution.x + x;
-            std::swap(texels[o1], texels[o2]);
-        }
-
-    MIPMap<Tmemory> *mipmap = nullptr;
-    if (texels) {
-        // Convert texels to type _Tmemory_ and create _MIPMap_
-        std::unique_ptr<Tmemory[]> convertedTexels(
-            new Tmemory[resolution.x * resolution.y]);
-        for (int i = 0; i < resolution.x * resolution.y; ++i)
-            convertIn(texels[i], &convertedTexels[i], scale, gamma);
-        mipmap = new MIPMap<Tmemory>(resolution, convertedTexels.get(),
-                                     doTrilinear, maxAniso, wrap);
-    } else {
-        // Create one-valued _MIPMap_
-        Tmemory oneVal = scale;
-        mipmap = new MIPMap<Tmemory>(Point2i(1, 1), &oneVal);
+template <typename Tmemory, typename Treturn>
+MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::CreateMIPMap(
+    std::shared_ptr<const TiledMIPMapFile> mipFile, MIPFilter filter,
+    Float maxAniso, ImageWrap wrap, Float scale) {
+    // Use the file's texels in place unless they need to be scaled
+    if (scale == 1)
+        return new MIPMap<Tmemory>(mipFile, filter, maxAniso, wrap, true);
+
+    // Convert the file's levels to _Tmemory_; they're already filtered
+    const TiledLevels &levels = mipFile->Levels();
+    std::vector<std::unique_ptr<Tmemory[]>> levelTexels;
+    int g = mipFile->Channels() == 3 ? 1 : 0, b = 2 * g;
+    for (int level = 0; level < levels.Levels(); ++level) {
+        Point2i res = levels.levelResolution[level];
+        levelTexels.push_back(
+            std::unique_ptr<Tmemory[]>(new Tmemory[res.x * res.y]));
+        Tmemory *l = levelTexels.back().get();
+        ParallelFor([&](int t) {
+            for (int s = 0; s < res.x; ++s) {
+                const float *v = mipFile->Texel(level, s, t);
+                Float rgb[3] = {v[0], v[g], v[b]};
+                convertIn(RGBSpectrum::FromRGB(rgb), &l[t * res.x + s], scale,
+                          false);
+            }
+        }, res.y, 16);
     }
-    textures[texInfo].reset(mipmap);
-    return mipmap;
+    TexelEncoding encoding = CompactTexelEncoding(
+        levelTexels[0].get(), levels.levelResolution[0].x *
+                                  levels.levelResolution[0].y);
+    return new MIPMap<Tmemory>(levels.levelResolution, levelTexels,
+                               filter, maxAniso, wrap, true, encoding);
 }
 
 template <typename Tmemory, typename Treturn>
@@ -129,6 +209,16 @@ ImageTexture<Float, Float> *CreateImageFloatTexture(const Transform &tex2world,
     // Initialize _ImageTexture_ parameters
     Float maxAniso = tp.FindFloat("maxanisotropy", 8.f);
     bool trilerp = tp.FindBool("trilinear", false);
+    std::string filterName =
+        tp.FindString("filter", trilerp ? "trilinear" : "ewa");
+    MIPFilter filter = MIPFilter::EWA;
+    if (filterName == "trilinear")
+        filter = MIPFilter::Trilinear;
+    else if (filterName == "multiprobe")
+        filter = MIPFilter::MultiProbe;
+    else if (filterName != "ewa")
+        Error("Texture filter \"%s\" unknown; using EWA.",
+              filterName.c_str());
     std::string wrap = tp.FindString("wrap", "repeat");
     ImageWrap wrapMode = ImageWrap::Repeat;
     if (wrap == "black")
@@ -139,7 +229,7 @@ ImageTexture<Float, Float> *CreateImageFloatTexture(const Transform &tex2world,
     std::string filename = tp.FindFilename("filename");
     bool gamma = tp.FindBool("gamma", HasExtension(filename, ".tga") ||
                                           HasExtension(filename, ".png"));
-    return new ImageTexture<Float, Float>(std::move(map), filename, trilerp,
+    return new ImageTexture<Float, Float>(std::move(map), filename, filter,
                                           maxAniso, wrapMode, scale, gamma);
 }
 
@@ -171,6 +261,16 @@ ImageTexture<RGBSpectrum, Spectrum> *CreateImageSpectrumTexture(
     // Initialize _ImageTexture_ parameters
     Float maxAniso = tp.FindFloat("maxanisotropy", 8.f);
     bool trilerp = tp.FindBool("trilinear", false);
+    std::string filterName =
+        tp.FindString("filter", trilerp ? "trilinear" : "ewa");
+    MIPFilter filter = MIPFilter::EWA;
+    if (filterName == "trilinear")
+        filter = MIPFilter::Trilinear;
+    else if (filterName == "multiprobe")
+        filter = MIPFilter::MultiProbe;
+    else if (filterName != "ewa")
+        Error("Texture filter \"%s\" unknown; using EWA.",
+              filterName.c_str());
     std::string wrap = tp.FindString("wrap", "repeat");
     ImageWrap wrapMode = ImageWrap::Repeat;
     if (wrap == "black")
@@ -182,7 +282,7 @@ ImageTexture<RGBSpectrum, Spectrum> *CreateImageSpectrumTexture(
     bool gamma = tp.FindBool("gamma", HasExtension(filename, ".tga") ||
                                           HasExtension(filename, ".png"));
     return new ImageTexture<RGBSpectrum, Spectrum>(
-        std::move(map), filename, trilerp, maxAniso, wrapMode, scale, gamma);
+        std::move(map), filename, filter, maxAniso, wrapMode, scale, gamma);
 }
 
 }  // namespace pbrt
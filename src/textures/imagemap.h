@@ -49,23 +49,23 @@ namespace pbrt {
 
 // TexInfo Declarations
 struct TexInfo {
-    TexInfo(const std::string &f, bool dt, Float ma, ImageWrap wm, Float sc,
-            bool gamma)
+    TexInfo(const std::string &f, MIPFilter filter, Float ma, ImageWrap wm,
+            Float sc, bool gamma)
         : filename(f),
-          doTrilinear(dt),
+          filter(filter),
           maxAniso(ma),
           wrapMode(wm),
           scale(sc),
           gamma(gamma) {}
     std::string filename;
-    bool doTrilinear;
+    MIPFilter filter;
     Float maxAniso;
     ImageWrap wrapMode;
     Float scale;
     bool gamma;
     bool operator<(const TexInfo &t2) const {
         if (filename != t2.filename) return filename < t2.filename;
-        if (doTrilinear != t2.doTrilinear) return doTrilinear < t2.doTrilinear;
+        if (filter != t2.filter) return filter < t2.filter;
         if (maxAniso != t2.maxAniso) return maxAniso < t2.maxAniso;
         if (scale != t2.scale) return scale < t2.scale;
         if (gamma != t2.gamma) return !gamma;
@@ -79,9 +79,11 @@ class ImageTexture : public Texture<Treturn> {
   public:
     // ImageTexture Public Methods
     ImageTexture(std::unique_ptr<TextureMapping2D> m,
-                 const std::string &filename, bool doTri, Float maxAniso,
+                 const std::string &filename, MIPFilter filter, Float maxAniso,
                  ImageWrap wm, Float scale, bool gamma);
     static void ClearCache() {
+        // Wait for any textures that are still being built
+        WaitForAsyncTasks();
         textures.erase(textures.begin(), textures.end());
     }
     Treturn Evaluate(const SurfaceInteraction &si) const {
@@ -95,9 +97,16 @@ class ImageTexture : public Texture<Treturn> {
 
   private:
     // ImageTexture Private Methods
-    static MIPMap<Tmemory> *GetTexture(const std::string &filename,
-                                       bool doTrilinear, Float maxAniso,
-                                       ImageWrap wm, Float scale, bool gamma);
+    static const std::unique_ptr<MIPMap<Tmemory>> &GetTexture(
+        const std::string &filename, MIPFilter filter, Float maxAniso,
+        ImageWrap wm, Float scale, bool gamma);
+    static MIPMap<Tmemory> *CreateMIPMap(const std::string &filename,
+                                         MIPFilter filter, Float maxAniso,
+                                         ImageWrap wm, Float scale,
+                                         bool gamma);
+    static MIPMap<Tmemory> *CreateMIPMap(
+        std::shared_ptr<const TiledMIPMapFile> mipFile, MIPFilter filter,
+        Float maxAniso, ImageWrap wm, Float scale);
     static void convertIn(const RGBSpectrum &from, RGBSpectrum *to, Float scale,
                           bool gamma) {
         for (int i = 0; i < RGBSpectrum::nSamples; ++i)
@@ -107,6 +116,18 @@ class ImageTexture : public Texture<Treturn> {
                           bool gamma) {
         *to = scale * (gamma ? InverseGammaCorrect(from.y()) : from.y());
     }
+    static void convertIn(const uint8_t *from, RGBSpectrum *to, Float scale,
+                          bool gamma) {
+        const Float *toLinear = gamma ? sRGB8ToLinear : linear8ToLinear;
+        for (int i = 0; i < RGBSpectrum::nSamples; ++i)
+            (*to)[i] = scale * toLinear[from[i]];
+    }
+    static void convertIn(const uint8_t *from, Float *to, Float scale,
+                          bool gamma) {
+        Float rgb[3] = {linear8ToLinear[from[0]], linear8ToLinear[from[1]],
+                        linear8ToLinear[from[2]]};
+        convertIn(RGBSpectrum::FromRGB(rgb), to, scale, gamma);
+    }
     static void convertOut(const RGBSpectrum &from, Spectrum *to) {
         Float rgb[3];
         from.ToRGB(rgb);
@@ -116,7 +137,9 @@ class ImageTexture : public Texture<Treturn> {
 
     // ImageTexture Private Data
     std::unique_ptr<TextureMapping2D> mapping;
-    MIPMap<Tmemory> *mipmap;
+    // Refers to the _MIPMap_'s entry in _textures_, which may still be
+    // being built until _WaitForAsyncTasks()_ is called
+    const std::unique_ptr<MIPMap<Tmemory>> &mipmap;
     static std::map<TexInfo, std::unique_ptr<MIPMap<Tmemory>>> textures;
 };
 
@@ -42,6 +42,7 @@
 #include "pbrt.h"
 #include "texture.h"
 #include "paramset.h"
+#include "textures/constant.h"
 
 namespace pbrt {
 
@@ -59,6 +60,18 @@ class MixTexture : public Texture<T> {
         Float amt = amount->Evaluate(si);
         return (1 - amt) * t1 + amt * t2;
     }
+    std::shared_ptr<Texture<T>> Simplify() const {
+        Float amt;
+        if (!amount->IsConstant(&amt)) return nullptr;
+        // Select one of the textures or fold the mix of two constants
+        if (amt == 0) return tex1;
+        if (amt == 1) return tex2;
+        T t1, t2;
+        if (tex1->IsConstant(&t1) && tex2->IsConstant(&t2))
+            return std::make_shared<ConstantTexture<T>>((1 - amt) * t1 +
+                                                        amt * t2);
+        return nullptr;
+    }
 
   private:
     std::shared_ptr<Texture<T>> tex1, tex2;
@@ -42,6 +42,7 @@
 #include "pbrt.h"
 #include "texture.h"
 #include "paramset.h"
+#include "textures/constant.h"
 
 namespace pbrt {
 
@@ -56,6 +57,24 @@ class ScaleTexture : public Texture<T2> {
     T2 Evaluate(const SurfaceInteraction &si) const {
         return tex1->Evaluate(si) * tex2->Evaluate(si);
     }
+    std::shared_ptr<Texture<T2>> Simplify() const {
+        T1 s1;
+        if (!tex1->IsConstant(&s1)) return nullptr;
+        // Fold a constant scale into a constant _tex2_; drop a unit scale
+        T2 s2;
+        if (tex2->IsConstant(&s2))
+            return std::make_shared<ConstantTexture<T2>>(s1 * s2);
+        if (s1 == T1(1.f)) return tex2;
+
+        // Flatten chains of constant scales into a single scale
+        const ScaleTexture *scale2 =
+            dynamic_cast<const ScaleTexture *>(tex2.get());
+        T1 s;
+        if (scale2 && scale2->tex1->IsConstant(&s))
+            return std::make_shared<ScaleTexture>(
+                std::make_shared<ConstantTexture<T1>>(s1 * s), scale2->tex2);
+        return nullptr;
+    }
 
   private:
     // ScaleTexture Private Data
@@ -11,6 +11,7 @@
 #include <algorithm>
 #include "fileutil.h"
 #include "imageio.h"
+#include "mipmap.h"
 #include "pbrt.h"
 #include "spectrum.h"
 #include "parallel.h"
@@ -31,7 +32,7 @@ static void usage(const char *msg = nullptr, ...) {
     }
     fprintf(stderr, R"(usage: imgtool <command> [options] <filenames...>
 
-commands: assemble, cat, convert, diff, info, makesky
+commands: assemble, cat, convert, diff, info, makesky, maketx
 
 assemble option:
     --outfile          Output image filename.
@@ -70,6 +71,20 @@ diff options:
     --outfile <name>   Filename to use for saving an image that encodes the
                        absolute value of per-pixel differences.
 
+maketx options:
+    --gamma            Convert the input from sRGB gamma-encoded values to
+                       linear. Default for PNG and TGA inputs.
+    --linear           Use the input's values as they are. Default for all
+                       other formats.
+    --luminance        Store only luminance, which is what "float" imagemap
+                       textures use.
+    --wrap <mode>      Wrap mode used when resampling the image to a
+                       power-of-two resolution: "repeat", "black", or
+                       "clamp". Default: "repeat"
+
+    maketx writes a prefiltered MIP map to a file with a ".mip" extension,
+    which "imagemap" textures load without any further processing.
+
 makesky options:
     --albedo <a>       Albedo of ground-plane (range 0-1). Default: 0.5
     --elevation <e>    Elevation of the sun in degrees (range 0-90). Default: 10
@@ -762,6 +777,118 @@ int convert(int argc, char *argv[]) {
     return 0;
 }
 
+static void StoreTexel(Float v, float *dst) { dst[0] = v; }
+
+static void StoreTexel(const RGBSpectrum &v, float *dst) {
+    Float rgb[3];
+    v.ToRGB(rgb);
+    for (int c = 0; c < 3; ++c) dst[c] = rgb[c];
+}
+
+template <typename T>
+static bool writeMIPMap(const char *filename, const MIPMap<T> &mipmap,
+                        int nChannels) {
+    std::vector<Point2i> levelResolution;
+    for (int level = 0; level < mipmap.Levels(); ++level)
+        levelResolution.push_back(mipmap.LevelResolution(level));
+    const int TileRes = TiledLevels::TileRes;
+    return WriteTiledMIPMapFile(
+        filename, levelResolution, nChannels,
+        [&](int level, int tx, int ty, float *dst) {
+            const Point2i &res = levelResolution[level];
+            for (int t = ty * TileRes; t < std::min(res.y, (ty + 1) * TileRes);
+                 ++t)
+                for (int s = tx * TileRes;
+                     s < std::min(res.x, (tx + 1) * TileRes); ++s) {
+                    StoreTexel(mipmap.Texel(level, s, t), dst);
+                    dst += nChannels;
+                }
+        });
+}
+
+int maketx(int argc, char *argv[]) {
+    int gamma = -1;
+    bool luminance = false;
+    ImageWrap wrap = ImageWrap::Repeat;
+
+    int i;
+    for (i = 0; i < argc; ++i) {
+        if (argv[i][0] != '-') break;
+        if (!strcmp(argv[i], "--gamma") || !strcmp(argv[i], "-gamma"))
+            gamma = 1;
+        else if (!strcmp(argv[i], "--linear") || !strcmp(argv[i], "-linear"))
+            gamma = 0;
+        else if (!strcmp(argv[i], "--luminance") ||
+                 !strcmp(argv[i], "-luminance"))
+            luminance = true;
+        else if (!strcmp(argv[i], "--wrap") || !strcmp(argv[i], "-wrap")) {
+            if (i + 1 == argc)
+                usage("missing value after %s flag", argv[i]);
+            const char *mode = argv[++i];
+            if (!strcmp(mode, "repeat"))
+                wrap = ImageWrap::Repeat;
+            else if (!strcmp(mode, "black"))
+                wrap = ImageWrap::Black;
+            else if (!strcmp(mode, "clamp"))
+                wrap = ImageWrap::Clamp;
+            else
+                usage("unknown wrap mode \"%s\"", mode);
+        } else
+            usage("unknown \"maketx\" option");
+    }
+
+    if (i >= argc)
+        usage("missing filenames for \"maketx\"");
+    else if (i + 1 >= argc)
+        usage("missing second filename for \"maketx\"");
+    const char *inFilename = argv[i], *outFilename = argv[i + 1];
+    if (!HasExtension(outFilename, ".mip"))
+        usage("output filename for \"maketx\" must have a \".mip\" "
+              "extension");
+    Point2i res;
+    std::unique_ptr<RGBSpectrum[]> image(ReadImage(inFilename, &res));
+    if (!image) {
+        fprintf(stderr, "%s: unable to read image\n", inFilename);
+        return 1;
+    }
+    if (gamma == -1)
+        gamma = HasExtension(inFilename, ".tga") ||
+                HasExtension(inFilename, ".png");
+
+    // Flip the image in $y$ and convert it to linear values, as
+    // _ImageTexture_ does
+    ParallelInit();
+    bool ok;
+    if (luminance) {
+        std::unique_ptr<Float[]> texels(new Float[res.x * res.y]);
+        for (int y = 0; y < res.y; ++y)
+            for (int x = 0; x < res.x; ++x) {
+                Float v = image[(res.y - 1 - y) * res.x + x].y();
+                texels[y * res.x + x] = gamma ? InverseGammaCorrect(v) : v;
+            }
+        image.reset();
+        MIPMap<Float> mipmap(res, texels.get(), MIPFilter::EWA, 8.f, wrap);
+        texels.reset();
+        ok = writeMIPMap(outFilename, mipmap, 1);
+    } else {
+        std::unique_ptr<RGBSpectrum[]> texels(new RGBSpectrum[res.x * res.y]);
+        for (int y = 0; y < res.y; ++y)
+            for (int x = 0; x < res.x; ++x) {
+                const RGBSpectrum &v = image[(res.y - 1 - y) * res.x + x];
+                for (int c = 0; c < RGBSpectrum::nSamples; ++c)
+                    texels[y * res.x + x][c] =
+                        gamma ? InverseGammaCorrect(v[c]) : v[c];
+            }
+        image.reset();
+        MIPMap<RGBSpectrum> mipmap(res, texels.get(), MIPFilter::EWA, 8.f,
+                                   wrap);
+        texels.reset();
+        ok = writeMIPMap(outFilename, mipmap, 3);
+    }
+    ParallelCleanup();
+    return ok ? 0 : 1;
+}
+
 int main(int argc, char *argv[]) {
     google::InitGoogleLogging(argv[0]);
     FLAGS_stderrthreshold = 1; // Warning and above.
@@ -780,6 +907,8 @@ int main(int argc, char *argv[]) {
         return info(argc - 2, argv + 2);
     else if (!strcmp(argv[1], "makesky"))
         return makesky(argc - 2, argv + 2);
+    else if (!strcmp(argv[1], "maketx"))
+        return maketx(argc - 2, argv + 2);
     else
         usage("unknown command \"%s\"", argv[1]);
 